@@ -0,0 +1,29 @@
+// mirrors FrameUniforms, ViewUniforms and PassUniforms, bound at Renderer's uniform block bindings
+
+layout (std140, binding = 0) uniform FrameBlock
+{
+    float time;
+    float deltaTime;
+    uint frameIndex;
+} frame;
+
+layout (std140, binding = 1) uniform ViewBlock
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec4 position;
+    vec2 jitter;
+    vec2 viewportSize;
+    float nearZ;
+    float farZ;
+} view;
+
+layout (std140, binding = 2) uniform PassBlock
+{
+    mat4 viewProjection;
+    vec2 viewportSize;
+} pass;
@@ -0,0 +1,15 @@
+// mirrors InstanceArena's InstanceData, one per instance arena slot
+
+struct InstanceData
+{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    uint id;
+    uint materialIndex;
+    uint meshIndex;
+};
+
+layout (std430, binding = 3) readonly buffer InstanceBuffer
+{
+    InstanceData instances[];
+};
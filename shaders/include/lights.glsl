@@ -0,0 +1,19 @@
+// mirrors LightData in the light arena and LightClusters' {offset, count} cluster ranges
+
+struct LightData
+{
+    vec3 position;
+    float range;
+    vec3 color;
+    float intensity;
+    vec3 direction;
+    uint type;
+    float innerConeCos;
+    float outerConeCos;
+};
+
+struct LightGrid
+{
+    uint offset;
+    uint count;
+};
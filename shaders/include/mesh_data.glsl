@@ -0,0 +1,16 @@
+// mirrors GeometryArena::MeshData and Renderer::MeshDrawState, one per geometry arena mesh
+
+struct MeshData
+{
+    vec4 boundsMin;
+    vec4 boundsMax;
+    uint indexCount;
+    uint firstIndex;
+    int baseVertex;
+};
+
+struct MeshDrawState
+{
+    uint instanceOffset;
+    uint visibleCount;
+};
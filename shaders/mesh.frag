@@ -0,0 +1,247 @@
+#version 460 core
+
+#extension GL_ARB_bindless_texture : require
+
+#include "include/lights.glsl"
+#include "include/frame_uniforms.glsl"
+
+struct Material
+{
+    uint baseColorTexIndex;
+    uint metallicRoughnessTexIndex;
+    uint normalTexIndex;
+    uint aoTexIndex;
+    uint emissionTexIndex;
+    vec4 baseColorFactor;
+    vec4 emissionFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    float occlusionFactor;
+    vec2 tiling;
+    vec2 offset;
+};
+
+struct ShadowTile
+{
+    mat4 viewProjection;
+    vec4 atlasRect;
+};
+
+layout (std430, binding = 1) readonly buffer BindlessTextureBuffer
+{
+    uvec2 textures[];
+};
+
+layout (std430, binding = 2) readonly buffer MaterialBuffer
+{
+    Material materials[];
+};
+
+layout (std430, binding = 10) readonly buffer LightBuffer
+{
+    LightData lights[];
+};
+
+// one {offset, count} range of lightIndices per cluster, see LightClusters
+layout (std430, binding = 11) readonly buffer LightGridBuffer
+{
+    LightGrid lightGrids[];
+};
+
+layout (std430, binding = 12) readonly buffer LightIndexBuffer
+{
+    uint lightIndices[];
+};
+
+// per light slot, the first of the light's tiles in the shadow atlas, see ShadowAtlas
+layout (std430, binding = 15) readonly buffer LightShadowBuffer
+{
+    uint lightShadows[];
+};
+
+layout (std430, binding = 16) readonly buffer ShadowTileBuffer
+{
+    ShadowTile shadowTiles[];
+};
+
+in VS_OUT
+{
+    vec3 fragPos;
+    vec2 texCoords;
+    vec3 normal;
+    flat uint materialIndex;
+} fs_in;
+
+out vec4 fragColor;
+
+// one depth layer per cascade, compared in hardware
+layout (binding = 0) uniform sampler2DArrayShadow uShadowMap;
+layout (binding = 1) uniform sampler2DShadow uShadowAtlas;
+
+const uint MaxDirectionalLights = 4;
+const uint CascadeCount = 4;
+const uint LightTypePoint = 2u;
+const uint LightTypeSpot = 3u;
+const uint InvalidShadowIndex = 0xFFFFFFFFu;
+const uvec3 ClusterGridSize = uvec3(16, 9, 24);
+
+uniform vec2 uSliceScaleBias;
+uniform uint uDirectionalLightCount;
+uniform uint uDirectionalLights[MaxDirectionalLights];
+uniform uint uShadowLight;
+uniform mat4 uCascadeViewProjections[CascadeCount];
+uniform vec4 uCascadeSplits;
+uniform vec4 uCascadeTexelSizes;
+uniform uint uLightShadowCount;
+
+// used while the scene has no directional light
+const vec3 defaultLightDirection = normalize(vec3(0.3, 1.0, 0.5));
+
+uint clusterIndex(float viewDepth)
+{
+    float slice = log(viewDepth) * uSliceScaleBias.x + uSliceScaleBias.y;
+
+    uvec2 tile = uvec2(gl_FragCoord.xy / view.viewportSize * vec2(ClusterGridSize.xy));
+    tile = min(tile, ClusterGridSize.xy - 1);
+
+    uint sliceIndex = uint(clamp(slice, 0.0, float(ClusterGridSize.z - 1)));
+
+    return tile.x + tile.y * ClusterGridSize.x + sliceIndex * ClusterGridSize.x * ClusterGridSize.y;
+}
+
+// windowed inverse square falloff, reaches zero at the light's range
+vec3 localLight(LightData light, vec3 normal)
+{
+    vec3 toLight = light.position - fs_in.fragPos;
+    float distanceSq = dot(toLight, toLight);
+    vec3 lightDirection = toLight * inversesqrt(max(distanceSq, 1e-8));
+
+    float ratio = distanceSq / (light.range * light.range);
+    float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+    float attenuation = window * window / (distanceSq + 1.0);
+
+    if (light.type == LightTypeSpot)
+        attenuation *= smoothstep(light.outerConeCos, light.innerConeCos, dot(-lightDirection, light.direction));
+
+    return light.color * light.intensity * attenuation * max(dot(normal, lightDirection), 0.0);
+}
+
+// built with SHADOWS when the renderer has shadows on, without it the lookups compile away
+#ifdef SHADOWS
+// the first cascade whose far split covers the fragment, offset along the normal by a few
+// texels of that cascade and filtered with a 3x3 pcf kernel
+float shadowFactor(vec3 normal, vec3 lightDirection, float viewDepth)
+{
+    uint cascade = 0;
+    while (cascade < CascadeCount - 1 && viewDepth > uCascadeSplits[cascade])
+        ++cascade;
+
+    if (viewDepth > uCascadeSplits[CascadeCount - 1])
+        return 1.0;
+
+    float cosTheta = clamp(dot(normal, -lightDirection), 0.0, 1.0);
+    float slope = sqrt(1.0 - cosTheta * cosTheta) / max(cosTheta, 0.05);
+    vec3 offsetPos = fs_in.fragPos + normal * uCascadeTexelSizes[cascade] * (1.0 + min(slope, 4.0));
+
+    vec4 lightPos = uCascadeViewProjections[cascade] * vec4(offsetPos, 1.0);
+    vec3 shadowCoord = lightPos.xyz / lightPos.w * 0.5 + 0.5;
+
+    vec2 texelSize = 1.0 / vec2(textureSize(uShadowMap, 0).xy);
+    float shadow = 0.0;
+
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            vec2 uv = shadowCoord.xy + vec2(x, y) * texelSize;
+            shadow += texture(uShadowMap, vec4(uv, float(cascade), shadowCoord.z));
+        }
+    }
+
+    return shadow / 9.0;
+}
+
+// point lights use the tile of the cube face along the major axis, +X -X +Y -Y +Z -Z. The
+// coordinates are clamped to the tile so the filter doesn't reach into its neighbours
+float localShadowFactor(uint lightIndex, LightData light, vec3 normal)
+{
+    if (lightIndex >= uLightShadowCount || lightShadows[lightIndex] == InvalidShadowIndex)
+        return 1.0;
+
+    uint tileIndex = lightShadows[lightIndex];
+    vec3 toFragment = fs_in.fragPos - light.position;
+
+    if (light.type == LightTypePoint)
+    {
+        vec3 axisDistance = abs(toFragment);
+        uint axis = axisDistance.x >= axisDistance.y && axisDistance.x >= axisDistance.z? 0u : (axisDistance.y >= axisDistance.z? 1u : 2u);
+        tileIndex += axis * 2u + (toFragment[axis] < 0.0? 1u : 0u);
+    }
+
+    ShadowTile tile = shadowTiles[tileIndex];
+
+    // about a texel and a half of normal offset at the fragment's distance from the light
+    float texelSize = tile.atlasRect.w * length(toFragment);
+    vec4 lightPos = tile.viewProjection * vec4(fs_in.fragPos + normal * texelSize * 1.5, 1.0);
+    vec3 shadowCoord = lightPos.xyz / lightPos.w * 0.5 + 0.5;
+
+    float halfTexel = 0.5 / (tile.atlasRect.z * float(textureSize(uShadowAtlas, 0).x));
+    vec2 uv = clamp(shadowCoord.xy, halfTexel, 1.0 - halfTexel) * tile.atlasRect.z + tile.atlasRect.xy;
+
+    return texture(uShadowAtlas, vec3(uv, shadowCoord.z));
+}
+#endif
+
+// sampling decodes the sRGB color textures, lighting runs on linear values and the color target
+// holds them sRGB encoded
+vec3 linearToSrgb(vec3 color)
+{
+    vec3 low = color * 12.92;
+    vec3 high = 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055;
+    return mix(high, low, lessThanEqual(color, vec3(0.0031308)));
+}
+
+void main()
+{
+    Material material = materials[fs_in.materialIndex];
+
+    vec2 texCoords = fs_in.texCoords * material.tiling + material.offset;
+    vec4 baseColor = texture(sampler2D(textures[material.baseColorTexIndex]), texCoords) * material.baseColorFactor;
+
+    vec3 normal = normalize(fs_in.normal);
+    vec3 lighting = vec3(0.0);
+    float viewDepth = -(view.view * vec4(fs_in.fragPos, 1.0)).z;
+
+    for (uint i = 0; i < uDirectionalLightCount; ++i)
+    {
+        LightData light = lights[uDirectionalLights[i]];
+#ifdef SHADOWS
+        float shadow = uDirectionalLights[i] == uShadowLight? shadowFactor(normal, light.direction, viewDepth) : 1.0;
+#else
+        float shadow = 1.0;
+#endif
+        lighting += light.color * light.intensity * shadow * max(dot(normal, -light.direction), 0.0);
+    }
+
+    if (uDirectionalLightCount == 0)
+        lighting = vec3(max(dot(normal, defaultLightDirection), 0.0));
+
+    // only the point and spot lights binned into this fragment's cluster
+    LightGrid grid = lightGrids[clusterIndex(viewDepth)];
+
+    for (uint i = 0; i < grid.count; ++i)
+    {
+        uint lightIndex = lightIndices[grid.offset + i];
+        LightData light = lights[lightIndex];
+        vec3 radiance = localLight(light, normal);
+
+#ifdef SHADOWS
+        if (any(greaterThan(radiance, vec3(0.0))))
+            radiance *= localShadowFactor(lightIndex, light, normal);
+#endif
+
+        lighting += radiance;
+    }
+
+    fragColor = vec4(linearToSrgb(baseColor.rgb * (0.15 + 0.85 * lighting)), baseColor.a);
+}
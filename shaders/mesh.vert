@@ -0,0 +1,43 @@
+#version 460 core
+
+layout (location = 0) in vec3 aPosition;
+layout (location = 1) in vec2 aTexCoords;
+layout (location = 2) in vec3 aNormal;
+layout (location = 3) in vec3 aTangent;
+layout (location = 4) in vec3 aBitangent;
+
+#include "include/instance_data.glsl"
+#include "include/frame_uniforms.glsl"
+
+// instance arena slots of the visible instances, each draw command owns the range starting at its base instance
+layout (std430, binding = 4) readonly buffer VisibleInstanceBuffer
+{
+    uint visibleInstances[];
+};
+
+// the depth prepass and shadow passes only need the position
+#ifndef DEPTH_ONLY
+out VS_OUT
+{
+    vec3 fragPos;
+    vec2 texCoords;
+    vec3 normal;
+    flat uint materialIndex;
+} vs_out;
+#endif
+
+void main()
+{
+    InstanceData instance = instances[visibleInstances[gl_BaseInstance + gl_InstanceID]];
+
+    vec4 worldPos = instance.modelMatrix * vec4(aPosition, 1.0);
+
+#ifndef DEPTH_ONLY
+    vs_out.fragPos = worldPos.xyz;
+    vs_out.texCoords = aTexCoords;
+    vs_out.normal = mat3(instance.normalMatrix) * aNormal;
+    vs_out.materialIndex = instance.materialIndex;
+#endif
+
+    gl_Position = pass.viewProjection * worldPos;
+}
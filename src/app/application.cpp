@@ -9,8 +9,8 @@ static constexpr uint32_t sInitialWindowHeight = 1080;
 
 Application::Application()
     : mWindow(sInitialWindowWidth, sInitialWindowHeight)
-    , mRenderer(std::make_shared<Renderer>())
     , mResourceManager(std::make_shared<ResourceManager>())
+    , mRenderer(std::make_shared<Renderer>(mResourceManager))
     , mEditor(mRenderer, mResourceManager)
 {
 }
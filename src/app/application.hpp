@@ -28,8 +28,8 @@ private:
 
 private:
     Window mWindow;
-    std::shared_ptr<Renderer> mRenderer;
     std::shared_ptr<ResourceManager> mResourceManager;
+    std::shared_ptr<Renderer> mRenderer;
     Editor mEditor;
 };
 
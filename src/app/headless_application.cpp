@@ -0,0 +1,356 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "headless_application.hpp"
+
+static constexpr float sFieldOfView = glm::radians(45.f);
+
+// how long loading waits between polls for the importer's threads
+static constexpr auto sLoadPollInterval = std::chrono::milliseconds(1);
+
+static uint32_t parseUint(std::string_view argument, std::string_view value)
+{
+    uint32_t result = 0;
+    auto [end, errorCode] = std::from_chars(value.data(), value.data() + value.size(), result);
+
+    check(errorCode == std::errc() && end == value.data() + value.size(),
+          std::format("Headless: {} expects a number, got \"{}\".", argument, value).c_str());
+
+    return result;
+}
+
+static std::string jsonString(const std::string& string)
+{
+    std::string escaped;
+    for (char c : string)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+
+    return '"' + escaped + '"';
+}
+
+static std::string timingSummary(std::vector<float> times)
+{
+    std::sort(times.begin(), times.end());
+
+    auto percentile = [&times] (float p) {
+        return times.at(glm::min(static_cast<size_t>(p * times.size()), times.size() - 1));
+    };
+
+    float mean = std::accumulate(times.begin(), times.end(), 0.f) / times.size();
+
+    return std::format(R"({{"mean": {:.4f}, "min": {:.4f}, "p50": {:.4f}, "p95": {:.4f}, "p99": {:.4f}, "max": {:.4f}}})",
+                       mean, times.front(), percentile(0.5f), percentile(0.95f), percentile(0.99f), times.back());
+}
+
+HeadlessApplication::HeadlessApplication(const HeadlessSettings &settings)
+    : mSettings(settings)
+    , mWindow(settings.width, settings.height, true)
+    , mResourceManager(std::make_shared<ResourceManager>())
+    , mRenderer(std::make_shared<Renderer>(mResourceManager))
+    , mSceneGraph(mResourceManager)
+    , mCamera({}, sFieldOfView, static_cast<float>(settings.width), static_cast<float>(settings.height))
+{
+    mRenderer->resize(static_cast<int32_t>(mSettings.width), static_cast<int32_t>(mSettings.height));
+    mRenderer->setCullingMode(mSettings.gpuCulling? Renderer::CullingMode::GPU : Renderer::CullingMode::CPU);
+    mRenderer->setShadows(mSettings.shadows);
+}
+
+HeadlessApplication::~HeadlessApplication()
+{
+}
+
+std::optional<HeadlessSettings> HeadlessApplication::parseArguments(int argc, char **argv)
+{
+    std::vector<std::string_view> arguments(argv + 1, argv + argc);
+
+    if (std::find(arguments.begin(), arguments.end(), "--headless") == arguments.end())
+        return std::nullopt;
+
+    HeadlessSettings settings;
+
+    for (size_t i = 0; i < arguments.size(); ++i)
+    {
+        std::string_view argument = arguments.at(i);
+
+        if (argument == "--headless")
+            continue;
+
+        if (argument == "--gpu-culling")
+        {
+            settings.gpuCulling = true;
+            continue;
+        }
+
+        if (argument == "--no-shadows")
+        {
+            settings.shadows = false;
+            continue;
+        }
+
+        check(i + 1 < arguments.size(), std::format("Headless: {} needs a value.", argument).c_str());
+        std::string_view value = arguments.at(++i);
+
+        if (argument == "--model")
+        {
+            settings.models.emplace_back(value);
+        }
+        else if (argument == "--frames")
+        {
+            settings.frameCount = parseUint(argument, value);
+        }
+        else if (argument == "--warmup")
+        {
+            settings.warmupFrames = parseUint(argument, value);
+        }
+        else if (argument == "--capture-interval")
+        {
+            settings.captureInterval = parseUint(argument, value);
+        }
+        else if (argument == "--benchmark")
+        {
+            settings.benchmarkCount = parseUint(argument, value);
+        }
+        else if (argument == "--output")
+        {
+            settings.outputDir = value;
+        }
+        else if (argument == "--size")
+        {
+            size_t separator = value.find('x');
+            check(separator != std::string_view::npos, std::format("Headless: --size expects WIDTHxHEIGHT, got \"{}\".", value).c_str());
+
+            settings.width = parseUint(argument, value.substr(0, separator));
+            settings.height = parseUint(argument, value.substr(separator + 1));
+        }
+        else
+        {
+            check(false, std::format("Headless: Unknown argument \"{}\".", argument).c_str());
+        }
+    }
+
+    check(settings.frameCount > 0, "Headless: --frames has to be at least 1.");
+    check(settings.width > 0 && settings.height > 0, "Headless: --size has to be at least 1x1.");
+
+    return settings;
+}
+
+int HeadlessApplication::run()
+{
+    std::error_code errorCode;
+    std::filesystem::create_directories(mSettings.outputDir, errorCode);
+    check(!errorCode, std::format("Headless: Failed to create {}.", mSettings.outputDir.string()).c_str());
+
+    auto loadStart = std::chrono::steady_clock::now();
+    loadModels();
+    float loadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+
+    frameScene();
+
+    // first use builds the mesh shader permutation and streams textures in
+    for (uint32_t frame = 0; frame < mSettings.warmupFrames; ++frame)
+        renderFrame();
+
+    std::vector<uint32_t> timerQueries(mSettings.frameCount);
+    glCreateQueries(GL_TIME_ELAPSED, mSettings.frameCount, timerQueries.data());
+
+    std::vector<FrameTiming> frameTimings(mSettings.frameCount);
+
+    for (uint32_t frame = 0; frame < mSettings.frameCount; ++frame)
+    {
+        auto frameStart = std::chrono::steady_clock::now();
+
+        glBeginQuery(GL_TIME_ELAPSED, timerQueries.at(frame));
+        renderFrame();
+        glEndQuery(GL_TIME_ELAPSED);
+
+        frameTimings.at(frame).cpuMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+
+        // reading the frame back drains the pipeline, which the next frame's timing shows
+        bool lastFrame = frame + 1 == mSettings.frameCount;
+        bool onInterval = mSettings.captureInterval && frame % mSettings.captureInterval == 0;
+
+        if (lastFrame || onInterval)
+            captureFrame(mSettings.outputDir / std::format("frame_{:05}.ppm", frame));
+    }
+
+    // the queries of every frame are done by the time the last one was read back
+    for (uint32_t frame = 0; frame < mSettings.frameCount; ++frame)
+    {
+        uint64_t elapsedNs = 0;
+        glGetQueryObjectui64v(timerQueries.at(frame), GL_QUERY_RESULT, &elapsedNs);
+        frameTimings.at(frame).gpuMs = static_cast<float>(elapsedNs) / 1'000'000.f;
+    }
+
+    glDeleteQueries(mSettings.frameCount, timerQueries.data());
+
+    std::string benchmarks = mSettings.benchmarkCount? runBenchmarks() : std::string();
+
+    writeReport(frameTimings, loadMs, benchmarks);
+
+    return 0;
+}
+
+void HeadlessApplication::loadModels()
+{
+    for (const std::filesystem::path& model : mSettings.models)
+        check(mResourceManager->importModel(model), std::format("Headless: {} was given twice.", model.string()).c_str());
+
+    // everything goes through as soon as it can, there's no frame to keep smooth
+    float taskBudget = mResourceManager->taskBudget();
+    mResourceManager->setTaskBudget(FLT_MAX);
+
+    while (mResourceManager->importing())
+    {
+        mResourceManager->processMainThreadTasks();
+
+        // nothing else submits the upload fences
+        glFlush();
+        std::this_thread::sleep_for(sLoadPollInterval);
+    }
+
+    mResourceManager->setTaskBudget(taskBudget);
+
+    for (const auto& [modelID, model] : mResourceManager->mModels)
+        mSceneGraph.instantiate(*model, &mSceneGraph.mRoot, {glm::identity<glm::mat4>()});
+
+    debugLog(std::format("Headless: {} models loaded.", mResourceManager->mModels.size()));
+}
+
+// looks at the scene's bounding sphere from above and to the side, close enough to fill the view
+void HeadlessApplication::frameScene()
+{
+    mSceneGraph.updateTransforms();
+    BoundingBox bounds = mSceneGraph.bvh().bounds();
+
+    if (glm::any(glm::greaterThan(bounds.min, bounds.max)))
+    {
+        mCamera.lookAt(glm::vec3(0.f, 1.f, 5.f), glm::vec3(0.f));
+        return;
+    }
+
+    glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+    float radius = glm::max(glm::length(bounds.max - bounds.min) * 0.5f, 0.01f);
+    float distance = radius / glm::sin(sFieldOfView * 0.5f);
+
+    *mCamera.nearPlane() = glm::max(distance - radius, distance * 0.001f);
+    *mCamera.farPlane() = distance + radius;
+
+    mCamera.lookAt(center + glm::normalize(glm::vec3(1.f, 0.6f, 1.4f)) * distance, center);
+}
+
+void HeadlessApplication::renderFrame()
+{
+    mSceneGraph.updateTransforms();
+    mResourceManager->processMainThreadTasks();
+    mRenderer->render(mCamera);
+}
+
+// binary PPM, top row first
+void HeadlessApplication::captureFrame(const std::filesystem::path &path) const
+{
+    const Texture2D& colorTexture = mRenderer->colorTexture();
+
+    uint32_t width = static_cast<uint32_t>(colorTexture.width());
+    uint32_t height = static_cast<uint32_t>(colorTexture.height());
+    uint32_t rowSize = width * 3;
+
+    std::vector<uint8_t> pixels(rowSize * height);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTextureImage(colorTexture.id(), 0, GL_RGB, GL_UNSIGNED_BYTE, static_cast<GLsizei>(pixels.size()), pixels.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    check(file.is_open(), std::format("Headless: Failed to write {}.", path.string()).c_str());
+
+    file << std::format("P6\n{} {}\n255\n", width, height);
+
+    // opengl rows go bottom up
+    for (uint32_t row = height; row > 0; --row)
+        file.write(reinterpret_cast<const char*>(pixels.data() + (row - 1) * rowSize), rowSize);
+}
+
+std::string HeadlessApplication::runBenchmarks() const
+{
+    auto timing = [] (const BVH::BenchmarkTiming& benchmarkTiming) {
+        return std::format(R"({{"min": {:.4f}, "mean": {:.4f}}})", benchmarkTiming.minMs, benchmarkTiming.meanMs);
+    };
+
+    BVH::BenchmarkResult bvh = BVH::benchmark(mSettings.benchmarkCount);
+
+    debugLog(std::format("Headless: BVH benchmark with {} proxies, build {:.3f} ms, refit {:.3f} ms, query {:.3f} ms at best.",
+                         bvh.proxyCount, bvh.build.minMs, bvh.refit.minMs, bvh.query.minMs));
+
+    Culling::BenchmarkResult culling = Culling::benchmark(mSettings.benchmarkCount);
+
+    debugLog(std::format("Headless: Culling benchmark with {} boxes, scalar {:.3f} ms, {} {:.3f} ms, {} mismatches.",
+                         culling.instanceCount, culling.scalarMs, Culling::simdPath(), culling.simdMs, culling.mismatchCount));
+
+    std::string bvhJson = std::format(R"({{"proxyCount": {}, "iterations": {}, "build": {}, "refit": {}, "query": {}, "visibleCount": {}, "sahCost": {:.4f}}})",
+                                      bvh.proxyCount, bvh.iterations, timing(bvh.build), timing(bvh.refit), timing(bvh.query), bvh.visibleCount, bvh.sahCost);
+
+    std::string cullingJson = std::format(R"({{"instanceCount": {}, "visibleCount": {}, "simdPath": {}, "scalarMs": {:.4f}, "simdMs": {:.4f}, "mismatchCount": {}}})",
+                                          culling.instanceCount, culling.visibleCount, jsonString(Culling::simdPath()), culling.scalarMs, culling.simdMs, culling.mismatchCount);
+
+    return std::format(R"({{"bvh": {}, "culling": {}}})", bvhJson, cullingJson);
+}
+
+void HeadlessApplication::writeReport(const std::vector<FrameTiming> &frameTimings, float loadMs, const std::string &benchmarks) const
+{
+    std::filesystem::path path = mSettings.outputDir / "report.json";
+
+    std::ofstream file(path, std::ios::trunc);
+    check(file.is_open(), std::format("Headless: Failed to write {}.", path.string()).c_str());
+
+    std::vector<float> cpuTimes;
+    std::vector<float> gpuTimes;
+    for (const FrameTiming& frameTiming : frameTimings)
+    {
+        cpuTimes.push_back(frameTiming.cpuMs);
+        gpuTimes.push_back(frameTiming.gpuMs);
+    }
+
+    std::string models;
+    for (const std::filesystem::path& model : mSettings.models)
+        models += (models.empty()? "" : ", ") + jsonString(model.generic_string());
+
+    const Renderer::FrameStats& frameStats = mRenderer->frameStats();
+
+    file << "{\n";
+    file << std::format("  \"renderer\": {},\n", jsonString(reinterpret_cast<const char*>(glGetString(GL_RENDERER))));
+    file << std::format("  \"models\": [{}],\n", models);
+    file << std::format("  \"width\": {},\n  \"height\": {},\n", mSettings.width, mSettings.height);
+    file << std::format("  \"cullingMode\": \"{}\",\n", mSettings.gpuCulling? "GPU" : "CPU");
+    file << std::format("  \"shadows\": {},\n", mSettings.shadows);
+    file << std::format("  \"warmupFrames\": {},\n  \"frameCount\": {},\n", mSettings.warmupFrames, mSettings.frameCount);
+    file << std::format("  \"loadMs\": {:.3f},\n", loadMs);
+    file << std::format("  \"instanceCount\": {},\n  \"drawCommandCount\": {},\n", frameStats.instanceCount, frameStats.drawCommandCount);
+    file << std::format("  \"cpuMs\": {},\n", timingSummary(cpuTimes));
+    file << std::format("  \"gpuMs\": {},\n", timingSummary(gpuTimes));
+
+    if (!benchmarks.empty())
+        file << std::format("  \"benchmarks\": {},\n", benchmarks);
+
+    file << "  \"frames\": [\n";
+
+    for (size_t frame = 0; frame < frameTimings.size(); ++frame)
+    {
+        file << std::format("    {{\"cpuMs\": {:.4f}, \"gpuMs\": {:.4f}}}{}\n",
+                            frameTimings.at(frame).cpuMs,
+                            frameTimings.at(frame).gpuMs,
+                            frame + 1 < frameTimings.size()? "," : "");
+    }
+
+    file << "  ]\n}\n";
+
+    debugLog(std::format("Headless: {} frames, cpu {:.3f} ms, gpu {:.3f} ms on average. Report written to {}",
+                         frameTimings.size(),
+                         std::accumulate(cpuTimes.begin(), cpuTimes.end(), 0.f) / cpuTimes.size(),
+                         std::accumulate(gpuTimes.begin(), gpuTimes.end(), 0.f) / gpuTimes.size(),
+                         path.string()));
+}
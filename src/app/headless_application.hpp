@@ -0,0 +1,76 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_HEADLESS_APPLICATION_HPP
+#define OPENGLRENDERINGENGINE_HEADLESS_APPLICATION_HPP
+
+#include "../window/window.hpp"
+#include "../renderer/renderer.hpp"
+#include "../resource/resource_manager.hpp"
+#include "../scene_graph/scene_graph.hpp"
+#include "../editor/camera.hpp"
+
+struct HeadlessSettings
+{
+    std::vector<std::filesystem::path> models;
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+    // rendered once the models are in, before the timed frames
+    uint32_t warmupFrames = 10;
+    uint32_t frameCount = 100;
+    // every nth timed frame is written, 0 for only the last one
+    uint32_t captureInterval = 0;
+    std::filesystem::path outputDir = "headless";
+    bool gpuCulling = false;
+    bool shadows = true;
+    // boxes for the cpu benchmarks run after the timed frames, 0 skips them
+    uint32_t benchmarkCount = 0;
+};
+
+// Renders without the editor for batch jobs and benchmarks: imports the models, frames them
+// with the camera, renders a fixed number of frames into the renderer's color target through
+// an invisible window and exits. Captured frames go to the output directory as binary PPMs
+// next to report.json, which holds the cpu and gpu time of every timed frame and a summary,
+// plus the BVH and culling benchmark results when --benchmark is given.
+//
+// OpenGLRenderingEngine --headless --model scene.gltf --frames 300 --size 512x512 --output out
+// OpenGLRenderingEngine --headless --frames 1 --benchmark 1000000
+class HeadlessApplication
+{
+public:
+    HeadlessApplication(const HeadlessSettings& settings);
+    ~HeadlessApplication();
+
+    // empty when --headless isn't among the arguments. Throws on a malformed one
+    static std::optional<HeadlessSettings> parseArguments(int argc, char** argv);
+
+    // returns the process exit code
+    int run();
+
+private:
+    struct FrameTiming
+    {
+        float cpuMs;
+        float gpuMs;
+    };
+
+    void loadModels();
+    void frameScene();
+    void renderFrame();
+    void captureFrame(const std::filesystem::path& path) const;
+    // the "benchmarks" object of the report
+    std::string runBenchmarks() const;
+    void writeReport(const std::vector<FrameTiming>& frameTimings, float loadMs, const std::string& benchmarks) const;
+
+private:
+    HeadlessSettings mSettings;
+
+    Window mWindow;
+    std::shared_ptr<ResourceManager> mResourceManager;
+    std::shared_ptr<Renderer> mRenderer;
+    SceneGraph mSceneGraph;
+    Camera mCamera;
+};
+
+#endif //OPENGLRENDERINGENGINE_HEADLESS_APPLICATION_HPP
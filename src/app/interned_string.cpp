@@ -0,0 +1,50 @@
+//
+// Created by Gianni on 3/02/2025.
+//
+
+#include "interned_string.hpp"
+
+InternedString::InternedString()
+    : mString(intern(""))
+{
+}
+
+InternedString::InternedString(std::string_view str)
+    : mString(intern(str))
+{
+}
+
+const std::string &InternedString::str() const
+{
+    return *mString;
+}
+
+const char *InternedString::c_str() const
+{
+    return mString->c_str();
+}
+
+bool InternedString::empty() const
+{
+    return mString->empty();
+}
+
+bool InternedString::operator==(const InternedString &other) const
+{
+    return mString == other.mString;
+}
+
+size_t InternedString::tableSize()
+{
+    return mStringTable.size();
+}
+
+const std::string *InternedString::intern(std::string_view str)
+{
+    auto itr = mStringTable.find(str);
+
+    if (itr == mStringTable.end())
+        itr = mStringTable.emplace(str).first;
+
+    return &(*itr);
+}
@@ -0,0 +1,40 @@
+//
+// Created by Gianni on 3/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_INTERNED_STRING_HPP
+#define OPENGLRENDERINGENGINE_INTERNED_STRING_HPP
+
+// Immutable string stored once in a global table. Copies are a single pointer and equality is
+// a pointer comparison, which makes it cheap to give thousands of scene nodes the same name.
+// Interning is not thread safe and is meant to be used from the main thread.
+class InternedString
+{
+public:
+    InternedString();
+    InternedString(std::string_view str);
+
+    const std::string& str() const;
+    const char* c_str() const;
+    bool empty() const;
+
+    bool operator==(const InternedString& other) const;
+
+    static size_t tableSize();
+
+private:
+    struct StringHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view str) const { return std::hash<std::string_view>()(str); }
+    };
+
+    static const std::string* intern(std::string_view str);
+
+private:
+    const std::string* mString;
+
+    inline static std::unordered_set<std::string, StringHash, std::equal_to<>> mStringTable;
+};
+
+#endif //OPENGLRENDERINGENGINE_INTERNED_STRING_HPP
@@ -0,0 +1,137 @@
+//
+// Created by Gianni on 3/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_POOL_ALLOCATOR_HPP
+#define OPENGLRENDERINGENGINE_POOL_ALLOCATOR_HPP
+
+// Fixed size block pool. Blocks are carved out of large chunks and recycled through an
+// intrusive free list, so allocating many small objects of the same size costs a handful
+// of chunk allocations instead of one heap allocation per object.
+// Not thread safe: the scene graph only lives on the main thread.
+template<size_t BlockSize, size_t BlockAlignment>
+class MemoryPool
+{
+public:
+    // never destroyed: containers living in other statics may still hand blocks back at exit
+    static MemoryPool& instance()
+    {
+        static MemoryPool* pool = new MemoryPool();
+        return *pool;
+    }
+
+    void* allocate()
+    {
+        if (!mFreeList)
+            allocateChunk(mNextChunkCapacity);
+
+        FreeBlock* block = mFreeList;
+        mFreeList = block->next;
+        ++mAllocatedBlocks;
+
+        return block;
+    }
+
+    void deallocate(void* ptr)
+    {
+        FreeBlock* block = static_cast<FreeBlock*>(ptr);
+        block->next = mFreeList;
+        mFreeList = block;
+        --mAllocatedBlocks;
+    }
+
+    // makes sure that at least blockCount blocks can be allocated without touching the heap
+    void reserve(size_t blockCount)
+    {
+        size_t freeBlocks = mBlockCount - mAllocatedBlocks;
+
+        if (blockCount > freeBlocks)
+            allocateChunk(blockCount - freeBlocks);
+    }
+
+    size_t allocatedBlocks() const { return mAllocatedBlocks; }
+    size_t capacity() const { return mBlockCount; }
+    size_t chunkCount() const { return mChunks.size(); }
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    static constexpr size_t sAlignment = BlockAlignment > alignof(FreeBlock)? BlockAlignment : alignof(FreeBlock);
+    static constexpr size_t sBlockSize = ((std::max(BlockSize, sizeof(FreeBlock)) + sAlignment - 1) / sAlignment) * sAlignment;
+    static constexpr size_t sInitialChunkCapacity = 64;
+
+    MemoryPool()
+        : mFreeList()
+        , mBlockCount()
+        , mAllocatedBlocks()
+        , mNextChunkCapacity(sInitialChunkCapacity)
+    {
+    }
+
+    void allocateChunk(size_t blockCount)
+    {
+        blockCount = std::max(blockCount, sInitialChunkCapacity);
+
+        std::byte* chunk = static_cast<std::byte*>(::operator new(blockCount * sBlockSize, std::align_val_t(sAlignment)));
+        mChunks.push_back(chunk);
+
+        // thread the new blocks in address order so consecutive allocations stay contiguous
+        for (size_t i = blockCount; i > 0; --i)
+        {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + (i - 1) * sBlockSize);
+            block->next = mFreeList;
+            mFreeList = block;
+        }
+
+        mBlockCount += blockCount;
+        mNextChunkCapacity = std::max(mNextChunkCapacity, blockCount * 2);
+    }
+
+private:
+    FreeBlock* mFreeList;
+    std::vector<void*> mChunks;
+    size_t mBlockCount;
+    size_t mAllocatedBlocks;
+    size_t mNextChunkCapacity;
+};
+
+template<typename T>
+using ObjectPool = MemoryPool<sizeof(T), alignof(T)>;
+
+// std compatible allocator for node based containers (std::set, std::unordered_set, ...).
+// Single element allocations, which is what the container nodes are, come from the pool of
+// the rebound type. Array allocations (hash table buckets) fall back to the global heap.
+template<typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n)
+    {
+        if (n == 1)
+            return static_cast<T*>(ObjectPool<T>::instance().allocate());
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* ptr, size_t n)
+    {
+        if (n == 1)
+            ObjectPool<T>::instance().deallocate(ptr);
+        else
+            std::allocator<T>().deallocate(ptr, n);
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+};
+
+#endif //OPENGLRENDERINGENGINE_POOL_ALLOCATOR_HPP
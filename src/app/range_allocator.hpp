@@ -0,0 +1,127 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_RANGE_ALLOCATOR_HPP
+#define OPENGLRENDERINGENGINE_RANGE_ALLOCATOR_HPP
+
+// Hands out contiguous [offset, offset + size) ranges of an abstract address space, used to
+// sub-allocate big GPU buffers. First fit over an ordered free list, neighbours are merged on free.
+// The allocator doesn't own any memory: growing the space is up to the caller.
+class RangeAllocator
+{
+public:
+    RangeAllocator()
+        : mCapacity()
+        , mAllocated()
+    {
+    }
+
+    RangeAllocator(uint32_t capacity)
+        : mCapacity()
+        , mAllocated()
+    {
+        grow(capacity);
+    }
+
+    std::optional<uint32_t> allocate(uint32_t size)
+    {
+        if (!size)
+            return 0;
+
+        for (auto itr = mFreeRanges.begin(); itr != mFreeRanges.end(); ++itr)
+        {
+            auto [offset, freeSize] = *itr;
+
+            if (freeSize < size)
+                continue;
+
+            mFreeRanges.erase(itr);
+
+            if (freeSize > size)
+                mFreeRanges.emplace(offset + size, freeSize - size);
+
+            mAllocated += size;
+            return offset;
+        }
+
+        return std::nullopt;
+    }
+
+    void free(uint32_t offset, uint32_t size)
+    {
+        if (!size)
+            return;
+
+        assert(offset + size <= mCapacity);
+
+        mAllocated -= size;
+
+        auto next = mFreeRanges.lower_bound(offset);
+
+        // merge with the following range
+        if (next != mFreeRanges.end() && offset + size == next->first)
+        {
+            size += next->second;
+            next = mFreeRanges.erase(next);
+        }
+
+        // merge with the preceding range
+        if (next != mFreeRanges.begin())
+        {
+            auto prev = std::prev(next);
+
+            if (prev->first + prev->second == offset)
+            {
+                prev->second += size;
+                return;
+            }
+        }
+
+        mFreeRanges.emplace(offset, size);
+    }
+
+    // appends [capacity, newCapacity) to the free space
+    void grow(uint32_t newCapacity)
+    {
+        if (newCapacity <= mCapacity)
+            return;
+
+        uint32_t oldCapacity = mCapacity;
+        mCapacity = newCapacity;
+        mAllocated += newCapacity - oldCapacity;
+
+        free(oldCapacity, newCapacity - oldCapacity);
+    }
+
+    // size of the biggest range that can currently be allocated
+    uint32_t largestFreeRange() const
+    {
+        uint32_t largest = 0;
+
+        for (const auto& [offset, size] : mFreeRanges)
+            largest = std::max(largest, size);
+
+        return largest;
+    }
+
+    uint32_t capacity() const { return mCapacity; }
+    uint32_t allocated() const { return mAllocated; }
+
+    // end of the last allocated range, everything past it is free
+    uint32_t highWaterMark() const
+    {
+        if (mFreeRanges.empty())
+            return mCapacity;
+
+        auto last = std::prev(mFreeRanges.end());
+        return last->first + last->second == mCapacity? last->first : mCapacity;
+    }
+
+private:
+    std::map<uint32_t, uint32_t> mFreeRanges;
+    uint32_t mCapacity;
+    uint32_t mAllocated;
+};
+
+#endif //OPENGLRENDERINGENGINE_RANGE_ALLOCATOR_HPP
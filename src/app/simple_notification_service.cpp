@@ -21,30 +21,33 @@ void Topic::publish(const Message &message)
 }
 
 SubscriberSNS::SubscriberSNS(std::initializer_list<Topic::Type> topics)
-    : mSubscriptionList(topics)
+    : mSubscriptionList()
 {
+    for (auto topic : topics)
+        subscribe(topic);
 }
 
 SubscriberSNS::~SubscriberSNS()
 {
-    for (auto topic : mSubscriptionList)
-        SNS::unsubscribe(topic, this);
+    for (size_t topic = 0; topic < Topic::Type::Count; ++topic)
+        if (mSubscriptionList.test(topic))
+            SNS::unsubscribe(static_cast<Topic::Type>(topic), this);
 }
 
 void SubscriberSNS::subscribe(Topic::Type topicType)
 {
-    if (!mSubscriptionList.contains(topicType))
+    if (!mSubscriptionList.test(topicType))
     {
-        mSubscriptionList.insert(topicType);
+        mSubscriptionList.set(topicType);
         SNS::subscribe(topicType, this);
     }
 }
 
 void SubscriberSNS::unsubscribe(Topic::Type topicType)
 {
-    if (mSubscriptionList.contains(topicType))
+    if (mSubscriptionList.test(topicType))
     {
-        mSubscriptionList.erase(topicType);
+        mSubscriptionList.reset(topicType);
         SNS::unsubscribe(topicType, this);
     }
 }
@@ -6,6 +6,7 @@
 #define OPENGLRENDERINGENGINE_SIMPLE_NOTIFICATION_SERVICE_HPP
 
 #include "../renderer/instanced_mesh.hpp"
+#include "pool_allocator.hpp"
 #include "types.hpp"
 
 class Message
@@ -102,7 +103,10 @@ public:
     void publish(const Message& message);
 
 private:
-    std::unordered_set<SubscriberSNS*> mSubscribers;
+    std::unordered_set<SubscriberSNS*,
+                       std::hash<SubscriberSNS*>,
+                       std::equal_to<SubscriberSNS*>,
+                       PoolAllocator<SubscriberSNS*>> mSubscribers;
 };
 
 class SubscriberSNS
@@ -118,7 +122,7 @@ public:
     void unsubscribe(Topic::Type topicType);
 
 private:
-    std::unordered_set<Topic::Type> mSubscriptionList;
+    std::bitset<Topic::Type::Count> mSubscriptionList;
 };
 
 // SimpleNotificationService
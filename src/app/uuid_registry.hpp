@@ -6,6 +6,7 @@
 #define OPENGLRENDERINGENGINE_UUID_REGISTRY_HPP
 
 #include "types.hpp"
+#include "pool_allocator.hpp"
 #include "../renderer/material.hpp"
 
 enum class ObjectType
@@ -32,7 +33,11 @@ public:
 
 private:
     static uuid64_t generateID(ObjectType type);
-    static inline std::unordered_map<uuid64_t, ObjectType> mIdToType;
+    static inline std::unordered_map<uuid64_t,
+                                     ObjectType,
+                                     std::hash<uuid64_t>,
+                                     std::equal_to<uuid64_t>,
+                                     PoolAllocator<std::pair<const uuid64_t, ObjectType>>> mIdToType;
 };
 
 #endif //OPENGLRENDERINGENGINE_UUID_REGISTRY_HPP
@@ -135,6 +135,18 @@ void Camera::resize(uint32_t width, uint32_t height)
     mAspectRatio = static_cast<float>(glm::max(1u, width)) / static_cast<float>(glm::max(1u,height));
 }
 
+void Camera::lookAt(const glm::vec3 &position, const glm::vec3 &target)
+{
+    glm::vec3 direction = glm::normalize(target - position);
+
+    // inverse of calculateBasis
+    mPosition = position;
+    mTheta = glm::atan(direction.x, direction.z);
+    mPhi = glm::asin(glm::clamp(direction.y, -1.f, 1.f));
+
+    calculateViewProjection();
+}
+
 void Camera::scroll(float x, float y)
 {
     switch (mState)
@@ -29,6 +29,8 @@ public:
     void resize(uint32_t width, uint32_t height);
     void scroll(float x, float y);
     void update(float dt);
+    // places the camera without input, for when there's no editor
+    void lookAt(const glm::vec3& position, const glm::vec3& target);
 
     const glm::mat4& viewProjection() const;
     const glm::mat4& view() const;
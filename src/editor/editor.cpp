@@ -4,11 +4,14 @@
 
 #include "editor.hpp"
 #include "../resource/resource_manager.hpp"
+#include "../renderer/renderer.hpp"
+#include "../renderer/light_arena.hpp"
 
 Editor::Editor(std::shared_ptr<Renderer> renderer, std::shared_ptr<ResourceManager> resourceManager)
     : mRenderer(renderer)
     , mResourceManager(resourceManager)
     , mCamera({}, 30.f, 1920.f, 1080.f)
+    , mSceneGraph(resourceManager)
     , mSelectedObjectID()
     , mShowViewport(true)
     , mShowAssetPanel(true)
@@ -63,7 +66,7 @@ void Editor::update(float dt)
 
 void Editor::render()
 {
-    // renderer->renderScene
+    mRenderer->render(mCamera);
 
     if (mShowViewport)
         viewportPostRender();
@@ -90,6 +93,38 @@ void Editor::mainMenuBar()
 
         if (ImGui::BeginMenu("Settings"))
         {
+            bool compressTextures = mResourceManager->textureCompression();
+            if (ImGui::MenuItem("Compress Imported Textures", nullptr, &compressTextures))
+                mResourceManager->setTextureCompression(compressTextures);
+
+            if (ImGui::BeginMenu("Texture Quality"))
+            {
+                TextureQuality textureQuality = mResourceManager->textureQuality();
+
+                if (ImGui::MenuItem("High (BC7)", nullptr, textureQuality == TextureQuality::High))
+                    mResourceManager->setTextureQuality(TextureQuality::High);
+                if (ImGui::MenuItem("Compact (BC1/BC3)", nullptr, textureQuality == TextureQuality::Compact))
+                    mResourceManager->setTextureQuality(TextureQuality::Compact);
+
+                ImGui::EndMenu();
+            }
+
+            bool streamTextures = mResourceManager->textureStreaming();
+            if (ImGui::MenuItem("Stream Imported Textures", nullptr, &streamTextures))
+                mResourceManager->setTextureStreaming(streamTextures);
+
+            if (ImGui::BeginMenu("Mip Filter"))
+            {
+                MipFilter mipFilter = mResourceManager->mipFilter();
+
+                if (ImGui::MenuItem("Box", nullptr, mipFilter == MipFilter::Box))
+                    mResourceManager->setMipFilter(MipFilter::Box);
+                if (ImGui::MenuItem("Kaiser", nullptr, mipFilter == MipFilter::Kaiser))
+                    mResourceManager->setMipFilter(MipFilter::Kaiser);
+
+                ImGui::EndMenu();
+            }
+
             ImGui::EndMenu();
         }
 
@@ -205,6 +240,23 @@ void Editor::sceneGraphPanel()
     ImGui::Dummy(ImGui::GetContentRegionAvail());
     sceneNodeDragDropTarget(&mSceneGraph.mRoot);
 
+    if (ImGui::BeginPopupContextWindow())
+    {
+        glm::mat4 inFrontOfCamera = glm::translate(glm::identity<glm::mat4>(), mCamera.position() + mCamera.front() * 5.f);
+
+        // pointing down and away from the default view
+        if (ImGui::MenuItem("Add Directional Light"))
+            mSceneGraph.addLight(NodeType::DirectionalLight, &mSceneGraph.mRoot, glm::rotate(glm::identity<glm::mat4>(), glm::radians(-60.f), glm::vec3(1.f, 0.f, 0.f)));
+
+        if (ImGui::MenuItem("Add Point Light"))
+            mSceneGraph.addLight(NodeType::PointLight, &mSceneGraph.mRoot, inFrontOfCamera);
+
+        if (ImGui::MenuItem("Add Spot Light"))
+            mSceneGraph.addLight(NodeType::SpotLight, &mSceneGraph.mRoot, inFrontOfCamera);
+
+        ImGui::EndPopup();
+    }
+
     ImGui::End();
 
     mSceneGraph.updateTransforms();
@@ -282,7 +334,15 @@ void Editor::viewportPreRender()
 
     ImGui::Begin("Viewport", &mShowViewport, windowFlags);
 
-    ImGui::Dummy(ImGui::GetContentRegionAvail());
+    ImVec2 viewportSize = ImGui::GetContentRegionAvail();
+
+    if (viewportSize.x >= 1.f && viewportSize.y >= 1.f)
+    {
+        mRenderer->resize(viewportSize.x, viewportSize.y);
+        mCamera.resize(viewportSize.x, viewportSize.y);
+    }
+
+    ImGui::Image((ImTextureID)(intptr_t)mRenderer->colorTexture().id(), viewportSize, ImVec2(0.f, 1.f), ImVec2(1.f, 0.f));
     modelDragDropTarget();
 }
 
@@ -377,44 +437,6 @@ void Editor::imguiEnd()
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
-// todo: fix mesh instance::addInstance
-// todo: what if node doesn't have a material
-SceneNode *Editor::createModelGraph(std::shared_ptr<Model> model, const Model::Node &modelNode, SceneNode* parent)
-{
-    SceneNode* sceneNode;
-
-    if (auto meshID = modelNode.meshID)
-    {
-        uint32_t instanceID = mResourceManager->mMeshes.at(*meshID)->addInstance({}, {}, {});
-        index_t materialIndex = 0;
-        std::string matName = "";
-
-        if (auto materialID = model->getMaterialID(modelNode))
-            materialIndex = mResourceManager->getMatIndex(*materialID);
-
-        if (auto& matNameOpt = modelNode.materialName)
-            matName = *matNameOpt;
-
-        sceneNode = new MeshNode(NodeType::Mesh,
-                                 modelNode.name,
-                                 modelNode.transformation,
-                                 parent,
-                                 *meshID,
-                                 instanceID,
-                                 materialIndex,
-                                 matName);
-    }
-    else
-    {
-        sceneNode = new SceneNode(NodeType::Empty, modelNode.name, modelNode.transformation, parent);
-    }
-
-    for (const auto& child : modelNode.children)
-        sceneNode->addChild(createModelGraph(model, child, sceneNode));
-
-    return sceneNode;
-}
-
 void Editor::checkPayloadType(const char *type)
 {
     const ImGuiPayload* payload = ImGui::GetDragDropPayload();
@@ -439,24 +461,374 @@ void Editor::inspectorPanel()
         if (*objectType == ObjectType::Texture)
             textureInspector(mSelectedObjectID);
 
+    if (auto objectType = UUIDRegistry::getObjectType(mSelectedObjectID))
+        if (*objectType == ObjectType::SceneNode)
+            if (LightNode* lightNode = dynamic_cast<LightNode*>(mSceneGraph.findNode(mSelectedObjectID)))
+                lightInspector(lightNode);
+
     ImGui::End();
 }
 
 void Editor::rendererPanel()
 {
     ImGui::Begin("Renderer", &mShowRendererPanel);
+
+    if (ImGui::CollapsingHeader("Culling", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        Renderer::CullingMode cullingMode = mRenderer->cullingMode();
+
+        if (ImGui::RadioButton("CPU", cullingMode == Renderer::CullingMode::CPU))
+            mRenderer->setCullingMode(Renderer::CullingMode::CPU);
+
+        ImGui::SameLine();
+
+        if (ImGui::RadioButton("GPU", cullingMode == Renderer::CullingMode::GPU))
+            mRenderer->setCullingMode(Renderer::CullingMode::GPU);
+
+        bool occlusionCulling = mRenderer->occlusionCulling();
+
+        ImGui::BeginDisabled(cullingMode != Renderer::CullingMode::GPU);
+        if (ImGui::Checkbox("Occlusion Culling (Hi-Z)", &occlusionCulling))
+            mRenderer->setOcclusionCulling(occlusionCulling);
+        ImGui::EndDisabled();
+    }
+
+    if (ImGui::CollapsingHeader("Light Assignment", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        Renderer::LightAssignmentMode lightAssignmentMode = mRenderer->lightAssignmentMode();
+
+        if (ImGui::RadioButton("CPU##LightAssignment", lightAssignmentMode == Renderer::LightAssignmentMode::CPU))
+            mRenderer->setLightAssignmentMode(Renderer::LightAssignmentMode::CPU);
+
+        ImGui::SameLine();
+
+        if (ImGui::RadioButton("GPU##LightAssignment", lightAssignmentMode == Renderer::LightAssignmentMode::GPU))
+            mRenderer->setLightAssignmentMode(Renderer::LightAssignmentMode::GPU);
+    }
+
+    if (ImGui::CollapsingHeader("Shadows", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        ShadowCascades& shadowCascades = mRenderer->shadowCascades();
+
+        bool shadows = mRenderer->shadows();
+        bool shadowCaching = mRenderer->shadowCaching();
+        float shadowDistance = shadowCascades.shadowDistance();
+        float splitLambda = shadowCascades.splitLambda();
+
+        if (ImGui::Checkbox("Enable Shadows", &shadows))
+            mRenderer->setShadows(shadows);
+
+        ImGui::BeginDisabled(!shadows);
+
+        if (ImGui::Checkbox("Cache Static Cascades", &shadowCaching))
+            mRenderer->setShadowCaching(shadowCaching);
+
+        if (ImGui::DragFloat("Shadow Distance", &shadowDistance, 1.f, 1.f, 1000.f))
+            shadowCascades.setShadowDistance(shadowDistance);
+
+        if (ImGui::SliderFloat("Split Lambda", &splitLambda, 0.f, 1.f))
+            shadowCascades.setSplitLambda(splitLambda);
+
+        ShadowAtlas& shadowAtlas = mRenderer->shadowAtlas();
+        float updateBudget = static_cast<float>(shadowAtlas.updateBudget()) / 1048576.f;
+
+        if (ImGui::SliderFloat("Atlas Update Budget (MTexels)", &updateBudget, 0.25f, 16.f, "%.2f"))
+            shadowAtlas.setUpdateBudget(static_cast<uint64_t>(updateBudget * 1048576.f));
+
+        ImGui::EndDisabled();
+    }
+
     ImGui::End();
 }
 
 void Editor::console()
 {
     ImGui::Begin("Console", &mShowConsole);
+
+    if (ImGui::Button("Clear"))
+        clearLogHistory();
+
+    ImGui::Separator();
+    ImGui::BeginChild("Log", ImVec2(0.f, 0.f), false, ImGuiWindowFlags_HorizontalScrollbar);
+
+    for (const LogEntry& entry : logHistory())
+    {
+        bool colored = entry.severity != LogSeverity::Info;
+
+        if (entry.severity == LogSeverity::Warning)
+            ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.f, 0.8f, 0.3f, 1.f));
+        if (entry.severity == LogSeverity::Error)
+            ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.f, 0.4f, 0.4f, 1.f));
+
+        ImGui::TextUnformatted(entry.message.c_str());
+
+        if (colored)
+            ImGui::PopStyleColor();
+    }
+
+    // follows new messages unless scrolled up
+    if (ImGui::GetScrollY() >= ImGui::GetScrollMaxY())
+        ImGui::SetScrollHereY(1.f);
+
+    ImGui::EndChild();
     ImGui::End();
 }
 
 void Editor::debugPanel()
 {
     ImGui::Begin("Debug", &mShowDebugPanel);
+
+    if (ImGui::CollapsingHeader("Scene BVH", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        BVH::Stats stats = mSceneGraph.bvh().stats();
+
+        ImGui::Text("Proxies: %u", stats.proxyCount);
+        ImGui::Text("Nodes: %u", stats.nodeCount);
+        ImGui::Text("Height: %u", stats.height);
+        ImGui::Text("SAH Cost: %.2f", stats.sahCost);
+        ImGui::Text("Rebuilds: %u (last %.3f ms)", stats.rebuildCount, stats.lastRebuildMs);
+
+        static std::optional<BVH::BenchmarkResult> benchmarkResult;
+
+        if (ImGui::Button("Run Benchmark (100K proxies)"))
+            benchmarkResult = BVH::benchmark(100'000);
+
+        if (benchmarkResult)
+        {
+            ImGui::Text("Visible: %u / %u", benchmarkResult->visibleCount, benchmarkResult->proxyCount);
+            ImGui::Text("Build: %.3f ms (mean %.3f)", benchmarkResult->build.minMs, benchmarkResult->build.meanMs);
+            ImGui::Text("Refit: %.3f ms (mean %.3f)", benchmarkResult->refit.minMs, benchmarkResult->refit.meanMs);
+            ImGui::Text("Query: %.3f ms (mean %.3f)", benchmarkResult->query.minMs, benchmarkResult->query.meanMs);
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Frustum Culling", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        const Renderer::FrameStats& stats = mRenderer->frameStats();
+
+        bool gpuCulled = mRenderer->cullingMode() == Renderer::CullingMode::GPU;
+
+        ImGui::Text("Path: %s", gpuCulled? "Compute" : Culling::simdPath());
+        ImGui::Text("Meshes: %u", stats.meshCount);
+        ImGui::Text("Instances: %u", stats.instanceCount);
+
+        ImGui::Text("Visible: %u", stats.visibleCount);
+        ImGui::Text("Culled: %u", stats.instanceCount - glm::min(stats.visibleCount, stats.instanceCount));
+
+        if (gpuCulled)
+            ImGui::Text("Occluded: %u", stats.occludedCount);
+
+        ImGui::Text(gpuCulled? "Setup Time: %.3f ms" : "Cull Time: %.3f ms", stats.cullMs);
+
+        static std::optional<Culling::BenchmarkResult> benchmarkResult;
+
+        if (ImGui::Button("Run Benchmark (1M instances)"))
+            benchmarkResult = Culling::benchmark(1'000'000);
+
+        if (benchmarkResult)
+        {
+            ImGui::Text("Visible: %u / %u", benchmarkResult->visibleCount, benchmarkResult->instanceCount);
+            ImGui::Text("Scalar: %.3f ms", benchmarkResult->scalarMs);
+            ImGui::Text("SIMD: %.3f ms", benchmarkResult->simdMs);
+            ImGui::Text("Mismatches: %u", benchmarkResult->mismatchCount);
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Indirect Drawing", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        const GeometryArena& geometryArena = GeometryArena::instance();
+        const InstanceArena& instanceArena = InstanceArena::instance();
+
+        if (mRenderer->cullingMode() == Renderer::CullingMode::CPU)
+            ImGui::Text("Draw Commands: %u", mRenderer->frameStats().drawCommandCount);
+        ImGui::Text("Vertices: %u / %u", geometryArena.vertexCount(), geometryArena.vertexCapacity());
+        ImGui::Text("Indices: %u / %u", geometryArena.indexCount(), geometryArena.indexCapacity());
+        ImGui::Text("Instance Slots: %u / %u", instanceArena.instanceCount(), instanceArena.capacity());
+
+        static std::optional<bool> commandsValid;
+
+        if (ImGui::Button("Validate"))
+            commandsValid = mRenderer->validateDrawCommands();
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Dump"))
+            mRenderer->dumpDrawCommands("draw_commands.txt");
+
+        if (commandsValid)
+            ImGui::Text(*commandsValid? "Commands match the CPU reference" : "Commands DON'T match the CPU reference");
+    }
+
+    if (ImGui::CollapsingHeader("Render Graph", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        const RenderGraph& renderGraph = mRenderer->renderGraph();
+        const RenderGraph::Stats& stats = renderGraph.stats();
+
+        ImGui::Text("Passes: %u (%u culled)", stats.passCount, stats.culledPassCount);
+        ImGui::Text("Transient Textures: %u in %u", stats.transientTextureCount, stats.physicalTextureCount);
+        ImGui::Text("Transient Memory: %.2f MB (%.2f MB unaliased)", stats.physicalBytes / 1048576.0, stats.transientBytes / 1048576.0);
+
+        for (const std::string& passName : renderGraph.executionOrder())
+            ImGui::BulletText("%s", passName.c_str());
+    }
+
+    if (ImGui::CollapsingHeader("Clustered Lighting", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        const LightClusters::Stats& stats = mRenderer->lightClusterStats();
+
+        ImGui::Text("Lights: %u (%u clustered)", LightArena::instance().lightCount(), stats.lightCount);
+        ImGui::Text("Clusters: %u x %u x %u", LightClusters::TileCountX, LightClusters::TileCountY, LightClusters::SliceCount);
+        ImGui::Text("Occupied Clusters: %u / %u", stats.occupiedClusterCount, LightClusters::ClusterCount);
+        ImGui::Text("Light Indices: %u", stats.indexCount);
+        ImGui::Text("Max Lights per Cluster: %u", stats.maxLightsPerCluster);
+
+        if (mRenderer->lightAssignmentMode() == Renderer::LightAssignmentMode::CPU)
+            ImGui::Text("Assign Time: %.3f ms", stats.assignMs);
+
+        static std::optional<bool> clustersValid;
+
+        if (ImGui::Button("Validate##LightClusters"))
+            clustersValid = mRenderer->validateLightClusters();
+
+        ImGui::SameLine();
+
+        // spread over the scene, or around the camera while the scene is empty
+        if (ImGui::Button("Spawn 10k Point Lights"))
+        {
+            BoundingBox bounds = mSceneGraph.bvh().bounds();
+
+            if (!bounds.valid())
+                bounds = BoundingBox(mCamera.position() - 20.f, mCamera.position() + 20.f);
+
+            mSceneGraph.scatterPointLights(10'000, bounds, glm::max(glm::length(bounds.max - bounds.min) * 0.02f, 0.5f));
+        }
+
+        if (clustersValid)
+            ImGui::Text(*clustersValid? "Clusters match the CPU reference" : "Clusters DON'T match the CPU reference");
+    }
+
+    if (ImGui::CollapsingHeader("Shadow Cascades", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        const Renderer::FrameStats& stats = mRenderer->frameStats();
+        const ShadowCascades& shadowCascades = mRenderer->shadowCascades();
+
+        ImGui::Text("Rendered This Frame: %u / %u", stats.shadowCascadesRendered, ShadowCascades::CascadeCount);
+        ImGui::Text("Caster Instances: %u", stats.shadowCasterInstanceCount);
+
+        for (uint32_t i = 0; i < ShadowCascades::CascadeCount; ++i)
+        {
+            const ShadowCascades::Cascade& cascade = shadowCascades.cascades().at(i);
+
+            ImGui::BulletText("Cascade %u: %.1f m, %.3f m/texel, %u renders",
+                              i, cascade.splitDepth, cascade.texelSize, cascade.renderCount);
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Shadow Atlas", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        const ShadowAtlas::Stats& stats = mRenderer->shadowAtlas().stats();
+
+        ImGui::Text("Candidates: %u", stats.candidateCount);
+        ImGui::Text("Shadowed Lights: %u (%u tiles)", stats.shadowedLightCount, stats.tileCount);
+        ImGui::Text("Cached: %u, Pending: %u", stats.cachedLightCount, stats.pendingLightCount);
+        ImGui::Text("Tiles Rendered This Frame: %u", mRenderer->frameStats().shadowTilesRendered);
+        ImGui::Text("Atlas Used: %.1f%%", 100.0 * stats.allocatedTexels / (static_cast<double>(ShadowAtlas::Resolution) * ShadowAtlas::Resolution));
+        ImGui::Text("Texels Rendered: %.2f M", stats.queuedTexels / 1048576.0);
+    }
+
+    if (ImGui::CollapsingHeader("Draw Batching", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        const DrawQueue::Stats& queueStats = mRenderer->drawQueueStats();
+        const StateCache::Counters& stateCounters = mRenderer->stateCounters();
+
+        ImGui::Text("Packets: %u", queueStats.packetCount);
+        ImGui::Text("Batches: %u", queueStats.batchCount);
+        ImGui::Text("Sort Time: %.3f ms", queueStats.sortMs);
+        ImGui::Text("Shader Changes: %u", queueStats.shaderChanges);
+        ImGui::Text("Vertex Array Changes: %u", queueStats.vertexArrayChanges);
+        ImGui::Text("Texture Changes: %u", queueStats.textureChanges);
+        ImGui::Text("State Changes Avoided: %u", queueStats.stateChangesAvoided);
+
+        ImGui::SeparatorText("State Cache");
+        ImGui::Text("Program Binds: %u (%u skipped)", stateCounters.programBinds, stateCounters.programBindsSkipped);
+        ImGui::Text("Vertex Array Binds: %u (%u skipped)", stateCounters.vertexArrayBinds, stateCounters.vertexArrayBindsSkipped);
+        ImGui::Text("Texture Binds: %u (%u skipped)", stateCounters.textureBinds, stateCounters.textureBindsSkipped);
+    }
+
+    if (ImGui::CollapsingHeader("Texture Streaming", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        TextureStreamer& textureStreamer = mResourceManager->mTextureStreamer;
+        const TextureStreamer::Stats& stats = textureStreamer.stats();
+
+        int budget = static_cast<int>(textureStreamer.budget() >> 20);
+        if (ImGui::SliderInt("Budget (MB)", &budget, 16, 4096))
+            textureStreamer.setBudget(static_cast<uint64_t>(budget) << 20);
+
+        int uploadBudget = static_cast<int>(textureStreamer.uploadBudget() >> 20);
+        if (ImGui::SliderInt("Upload Budget (MB/frame)", &uploadBudget, 1, 128))
+            textureStreamer.setUploadBudget(static_cast<uint64_t>(uploadBudget) << 20);
+
+        ImGui::Text("Streamed Textures: %u", stats.streamedTextureCount);
+        ImGui::Text("Resident: %.1f / %.1f MB", stats.residentBytes / 1048576.0, stats.fullBytes / 1048576.0);
+        ImGui::Text("Pending Loads: %u, Retiring: %u", stats.pendingLoadCount, stats.retiringTextureCount);
+        ImGui::Text("Levels This Frame: %u streamed, %u evicted", stats.streamedLevels, stats.evictedLevels);
+        ImGui::Text("Uploaded This Frame: %.2f MB", stats.uploadedBytes / 1048576.0);
+    }
+
+    if (ImGui::CollapsingHeader("Shaders", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        ShaderWatcher& shaderWatcher = mRenderer->mShaderWatcher;
+        ShaderWatcher::Stats stats = shaderWatcher.stats();
+
+        bool hotReload = shaderWatcher.enabled();
+        if (ImGui::Checkbox("Hot Reload", &hotReload))
+            shaderWatcher.setEnabled(hotReload);
+
+        ImGui::Text("Watched Files: %u", stats.watchedFiles);
+        ImGui::Text("Reloads: %u (%u failed, %u pending)", stats.reloads, stats.failedReloads, stats.pendingReloads);
+        ImGui::Text("Mesh Shader Permutations: %u (%u programs)",
+                    mRenderer->mMeshShaders.permutationCount(),
+                    mRenderer->mMeshShaders.programCount());
+    }
+
+    if (ImGui::CollapsingHeader("Uniform Ring", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        UniformRingBuffer::Stats stats = mRenderer->uniformRingStats();
+
+        ImGui::Text("Used Last Frame: %.1f / %.1f KB", stats.usedBytes / 1024.0, stats.frameSize / 1024.0);
+        ImGui::Text("Blocks Written: %u", stats.allocationCount);
+        ImGui::Text("Frames Waited On The GPU: %u", stats.fenceWaits);
+    }
+
+    if (ImGui::CollapsingHeader("Main Thread Tasks", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        MainThreadTaskQueue::Stats stats = mResourceManager->mTaskQueue.stats();
+
+        float taskBudget = mResourceManager->taskBudget();
+        if (ImGui::SliderFloat("Task Budget (ms/frame)", &taskBudget, 0.25f, 16.f, "%.2f"))
+            mResourceManager->setTaskBudget(taskBudget);
+
+        ImGui::Text("Queued: %u", stats.queued);
+        ImGui::Text("Ran This Frame: %u (%.2f ms)", stats.ran, stats.elapsedMs);
+        ImGui::Text("Cost Estimate Scale: %.2f", stats.costScale);
+    }
+
+    if (ImGui::CollapsingHeader("Uploads", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        UploadManager& uploadManager = UploadManager::instance();
+        UploadManager::Stats stats = uploadManager.stats();
+
+        int uploadBudget = static_cast<int>(uploadManager.uploadBudget() >> 20);
+        if (ImGui::SliderInt("Copy Budget (MB/frame)", &uploadBudget, 1, 256))
+            uploadManager.setUploadBudget(static_cast<uint64_t>(uploadBudget) << 20);
+
+        ImGui::Text("Staging Used: %.1f / %u MB", stats.stagingUsed / 1048576.0, UploadManager::StagingSize >> 20);
+        ImGui::Text("Queued: %u (%.1f MB)", stats.queuedSubmissions, stats.queuedBytes / 1048576.0);
+        ImGui::Text("Recorded This Frame: %u (%.2f MB)", stats.recordedSubmissions, stats.recordedBytes / 1048576.0);
+        ImGui::Text("Frames In Flight: %u", stats.framesInFlight);
+        ImGui::Text("Direct Uploads: %u", stats.stagingFallbacks);
+    }
+
     ImGui::End();
 }
 
@@ -623,7 +995,7 @@ void Editor::modelDragDropTarget()
         {
             uuid64_t modelID = *(uuid64_t*)payload->Data;
             std::shared_ptr<Model> model = mResourceManager->getModel(modelID);
-            mSceneGraph.mRoot.addChild(createModelGraph(model, model->root, &mSceneGraph.mRoot));
+            mSceneGraph.instantiate(*model, &mSceneGraph.mRoot, {glm::identity<glm::mat4>()});
         }
 
         ImGui::EndDragDropTarget();
@@ -689,6 +1061,19 @@ void Editor::textureInspector(uuid64_t textureID)
     ImGui::Text("Filter Mode: %s", toStr(texture->filterMode()));
     ImGui::Text("Size: %dx%d", (int)textureSize.x, (int)textureSize.y);
 
+    size_t memory = 0;
+    for (uint32_t level = 0; level < texture->mipLevelCount(); ++level)
+        memory += imageSize(texture->format(), glm::max(texture->width() >> level, 1), glm::max(texture->height() >> level, 1));
+
+    ImGui::Text("Mip Levels: %u", texture->mipLevelCount());
+    ImGui::Text("Memory: %.2f MB", memory / 1e6);
+
+    if (auto itr = mResourceManager->mTextureRefCounts.find(textureID); itr != mResourceManager->mTextureRefCounts.end())
+        ImGui::Text("Model References: %u", itr->second);
+
+    if (auto residency = mResourceManager->mTextureStreamer.residency(textureID))
+        ImGui::Text("Streamed: levels %u to %u resident", residency->first, residency->second - 1);
+
     ImGui::SeparatorText("Preview");
 
     float windowWidth = ImGui::GetContentRegionAvail().x;
@@ -697,3 +1082,46 @@ void Editor::textureInspector(uuid64_t textureID)
     ImGui::SetCursorPosX(ImGui::GetCursorPosX() + xPadding);
     ImGui::Image(imTextureId, ImVec2(windowWidth, newHeight));
 }
+
+void Editor::lightInspector(LightNode *lightNode)
+{
+    static const std::unordered_map<NodeType, const char*> sLightTypeNames {
+        {NodeType::DirectionalLight, "Directional Light"},
+        {NodeType::PointLight, "Point Light"},
+        {NodeType::SpotLight, "Spot Light"}
+    };
+
+    ImGui::Text("Node Type: %s", sLightTypeNames.at(lightNode->type()));
+    ImGui::Text("Light Slot: %u", lightNode->lightSlot());
+
+    glm::vec3 color = lightNode->color();
+    if (ImGui::ColorEdit3("Color", glm::value_ptr(color)))
+        lightNode->setColor(color);
+
+    float intensity = lightNode->intensity();
+    if (ImGui::DragFloat("Intensity", &intensity, 0.05f, 0.f, FLT_MAX, "%.2f"))
+        lightNode->setIntensity(intensity);
+
+    if (lightNode->type() == NodeType::DirectionalLight)
+        return;
+
+    float range = lightNode->range();
+    if (ImGui::DragFloat("Range", &range, 0.1f, 0.01f, FLT_MAX, "%.2f"))
+        lightNode->setRange(range);
+
+    float shadowImportance = lightNode->shadowImportance();
+    if (ImGui::DragFloat("Shadow Importance", &shadowImportance, 0.05f, 0.f, FLT_MAX, "%.2f"))
+        lightNode->setShadowImportance(shadowImportance);
+
+    if (lightNode->type() == NodeType::SpotLight)
+    {
+        float innerAngle = lightNode->innerConeAngle();
+        float outerAngle = lightNode->outerConeAngle();
+
+        bool changed = ImGui::SliderAngle("Inner Cone Angle", &innerAngle, 0.f, 90.f);
+        changed |= ImGui::SliderAngle("Outer Cone Angle", &outerAngle, 0.f, 90.f);
+
+        if (changed)
+            lightNode->setConeAngles(innerAngle, outerAngle);
+    }
+}
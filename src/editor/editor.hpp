@@ -47,10 +47,10 @@ private:
     void materialInspector(uuid64_t materialID);
     bool materialTextureInspector(index_t& textureIndex, std::string label);
     void textureInspector(uuid64_t textureID);
+    void lightInspector(LightNode* lightNode);
 
     void sceneNodeRecursive(SceneNode* node);
     void checkPayloadType(const char* type);
-    SceneNode* createModelGraph(std::shared_ptr<Model> model, const Model::Node& modelNode, SceneNode* parent);
 
     void viewportPreRender();
     void viewportPostRender();
@@ -1,7 +1,14 @@
 #include "app/application.hpp"
+#include "app/headless_application.hpp"
 
-int main()
+int main(int argc, char** argv)
 {
+    if (std::optional<HeadlessSettings> headlessSettings = HeadlessApplication::parseArguments(argc, argv))
+    {
+        HeadlessApplication app(*headlessSettings);
+        return app.run();
+    }
+
     Application app;
     app.run();
 }
@@ -3,6 +3,7 @@
 //
 
 #include "buffer.hpp"
+#include "state_cache.hpp"
 
 // -- VertexAttribute -- //
 
@@ -207,6 +208,7 @@ VertexArray::VertexArray()
 
 VertexArray::~VertexArray()
 {
+    StateCache::vertexArrayDeleted(mRendererID);
     glDeleteVertexArrays(1, &mRendererID);
 }
 
@@ -220,6 +222,7 @@ VertexArray &VertexArray::operator=(VertexArray &&other) noexcept
 {
     if (this != &other)
     {
+        StateCache::vertexArrayDeleted(mRendererID);
         glDeleteVertexArrays(1, &mRendererID);
 
         mRendererID = other.mRendererID;
@@ -255,12 +258,12 @@ void VertexArray::attachIndexBuffer(const IndexBuffer &indexBuffer)
 
 void VertexArray::bind() const
 {
-    glBindVertexArray(mRendererID);
+    StateCache::bindVertexArray(mRendererID);
 }
 
 void VertexArray::unbind() const
 {
-    glBindVertexArray(0);
+    StateCache::bindVertexArray(0);
 }
 
 uint32_t VertexArray::id() const
@@ -268,6 +271,76 @@ uint32_t VertexArray::id() const
     return mRendererID;
 }
 
+// -- IndirectBuffer -- //
+
+IndirectBuffer::IndirectBuffer()
+    : mRendererID()
+    , mSize()
+{
+}
+
+IndirectBuffer::IndirectBuffer(GLenum usage, uint32_t size, const void *data)
+    : mSize(size)
+{
+    glCreateBuffers(1, &mRendererID);
+    glNamedBufferData(mRendererID, size, data, usage);
+}
+
+IndirectBuffer::~IndirectBuffer()
+{
+    glDeleteBuffers(1, &mRendererID);
+}
+
+IndirectBuffer::IndirectBuffer(IndirectBuffer &&other) noexcept
+{
+    mRendererID = other.mRendererID;
+    mSize = other.mSize;
+
+    other.mRendererID = 0;
+    other.mSize = 0;
+}
+
+IndirectBuffer &IndirectBuffer::operator=(IndirectBuffer &&other) noexcept
+{
+    if (this != &other)
+    {
+        glDeleteBuffers(1, &mRendererID);
+
+        mRendererID = other.mRendererID;
+        mSize = other.mSize;
+
+        other.mRendererID = 0;
+        other.mSize = 0;
+    }
+
+    return *this;
+}
+
+void IndirectBuffer::update(uint32_t offset, uint32_t size, const void *data)
+{
+    glNamedBufferSubData(mRendererID, offset, size, data);
+}
+
+void IndirectBuffer::bind() const
+{
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mRendererID);
+}
+
+void IndirectBuffer::unbind() const
+{
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+uint32_t IndirectBuffer::id() const
+{
+    return mRendererID;
+}
+
+uint32_t IndirectBuffer::size() const
+{
+    return mSize;
+}
+
 // -- ShaderBuffer -- //
 
 ShaderBuffer::ShaderBuffer()
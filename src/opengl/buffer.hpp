@@ -119,6 +119,32 @@ private:
     uint32_t mRendererID;
 };
 
+class IndirectBuffer
+{
+public:
+    IndirectBuffer();
+    IndirectBuffer(GLenum usage, uint32_t size, const void* data);
+    ~IndirectBuffer();
+
+    IndirectBuffer(IndirectBuffer&& other) noexcept;
+    IndirectBuffer& operator=(IndirectBuffer&& other) noexcept;
+
+    IndirectBuffer(const IndirectBuffer&) = delete;
+    IndirectBuffer& operator=(const IndirectBuffer&) = delete;
+
+    void update(uint32_t offset, uint32_t size, const void* data);
+
+    void bind() const;
+    void unbind() const;
+
+    uint32_t id() const;
+    uint32_t size() const;
+
+private:
+    uint32_t mRendererID;
+    uint32_t mSize;
+};
+
 // todo: abstract opengl enums
 class ShaderBuffer
 {
@@ -63,6 +63,11 @@ void Framebuffer::addDepthStencilAttachment(const Texture &texture)
     glNamedFramebufferTexture(mRendererID, GL_DEPTH_STENCIL_ATTACHMENT, texture.id(), 0);
 }
 
+void Framebuffer::addDepthAttachmentLayer(const Texture &texture, uint32_t layer)
+{
+    glNamedFramebufferTextureLayer(mRendererID, GL_DEPTH_ATTACHMENT, texture.id(), 0, layer);
+}
+
 void Framebuffer::setDrawBuffers(std::initializer_list<uint32_t> drawBufferIndices)
 {
     bind();
@@ -76,6 +81,15 @@ void Framebuffer::setDrawBuffers(std::initializer_list<uint32_t> drawBufferIndic
     unbind();
 }
 
+void Framebuffer::setDrawBuffers(const std::vector<uint32_t> &drawBufferIndices)
+{
+    std::vector<GLenum> drawBuffers;
+    for (uint32_t i : drawBufferIndices)
+        drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+
+    glNamedFramebufferDrawBuffers(mRendererID, drawBuffers.size(), drawBuffers.data());
+}
+
 void Framebuffer::setDepthStencilOnly(bool depthStencilOnly)
 {
     bind();
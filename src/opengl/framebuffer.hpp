@@ -26,8 +26,11 @@ public:
     void addColorAttachment(const Texture& texture, uint32_t index);
     void addDepthAttachment(const Texture& texture);
     void addDepthStencilAttachment(const Texture& texture);
+    // a single layer of an array texture
+    void addDepthAttachmentLayer(const Texture& texture, uint32_t layer);
 
     void setDrawBuffers(std::initializer_list<uint32_t> drawBufferIndices);
+    void setDrawBuffers(const std::vector<uint32_t>& drawBufferIndices);
     void setDepthStencilOnly(bool depthStencilOnly);
 
     uint32_t id() const;
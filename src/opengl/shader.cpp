@@ -3,114 +3,473 @@
 //
 
 #include "shader.hpp"
+#include "state_cache.hpp"
+
+// identifies the driver build, binaries from another one are rejected or worse
+static const std::string& driverString()
+{
+    static const std::string sDriverString = std::format("{}|{}|{}",
+                                                         reinterpret_cast<const char*>(glGetString(GL_VENDOR)),
+                                                         reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+                                                         reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    return sDriverString;
+}
+
+static bool programBinarySupported()
+{
+    static const bool sSupported = [] () {
+        int32_t formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        return formatCount > 0;
+    }();
+
+    return sSupported;
+}
+
+static bool parallelShaderCompile()
+{
+    return GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile;
+}
+
+static std::string shaderInfoLog(uint32_t shaderID)
+{
+    int32_t length = 0;
+    glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &length);
+
+    std::string log(glm::max(length, 1), '\0');
+    glGetShaderInfoLog(shaderID, length, nullptr, log.data());
+    log.resize(glm::max(length - 1, 0));
+
+    return log;
+}
+
+static std::string programInfoLog(uint32_t programID)
+{
+    int32_t length = 0;
+    glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &length);
+
+    std::string log(glm::max(length, 1), '\0');
+    glGetProgramInfoLog(programID, length, nullptr, log.data());
+    log.resize(glm::max(length - 1, 0));
+
+    return log;
+}
+
+enum class UniformComponent
+{
+    Float,
+    Int,
+    Uint
+};
+
+struct UniformLayout
+{
+    UniformComponent component;
+    uint32_t componentCount;
+    // columns of a matrix, 0 for vectors and scalars
+    uint32_t columnCount;
+};
+
+// samplers and images are plain ints, anything else isn't carried over
+static std::optional<UniformLayout> uniformLayout(GLenum type)
+{
+    switch (type)
+    {
+        case GL_FLOAT: return UniformLayout {UniformComponent::Float, 1, 0};
+        case GL_FLOAT_VEC2: return UniformLayout {UniformComponent::Float, 2, 0};
+        case GL_FLOAT_VEC3: return UniformLayout {UniformComponent::Float, 3, 0};
+        case GL_FLOAT_VEC4: return UniformLayout {UniformComponent::Float, 4, 0};
+        case GL_FLOAT_MAT3: return UniformLayout {UniformComponent::Float, 9, 3};
+        case GL_FLOAT_MAT4: return UniformLayout {UniformComponent::Float, 16, 4};
+        case GL_UNSIGNED_INT: return UniformLayout {UniformComponent::Uint, 1, 0};
+        case GL_UNSIGNED_INT_VEC2: return UniformLayout {UniformComponent::Uint, 2, 0};
+        case GL_UNSIGNED_INT_VEC3: return UniformLayout {UniformComponent::Uint, 3, 0};
+        case GL_UNSIGNED_INT_VEC4: return UniformLayout {UniformComponent::Uint, 4, 0};
+        case GL_INT_VEC2: case GL_BOOL_VEC2: return UniformLayout {UniformComponent::Int, 2, 0};
+        case GL_INT_VEC3: case GL_BOOL_VEC3: return UniformLayout {UniformComponent::Int, 3, 0};
+        case GL_INT_VEC4: case GL_BOOL_VEC4: return UniformLayout {UniformComponent::Int, 4, 0};
+        case GL_INT:
+        case GL_BOOL:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_CUBE:
+        case GL_IMAGE_2D:
+            return UniformLayout {UniformComponent::Int, 1, 0};
+        default:
+            return std::nullopt;
+    }
+}
+
+static void copyUniformValue(uint32_t source, int32_t sourceLocation, uint32_t destination, int32_t destinationLocation, const UniformLayout& layout)
+{
+    std::array<uint32_t, 16> value;
+
+    switch (layout.component)
+    {
+        case UniformComponent::Float:
+        {
+            float* floats = reinterpret_cast<float*>(value.data());
+            glGetnUniformfv(source, sourceLocation, sizeof(value), floats);
+
+            if (layout.columnCount == 3)
+                glProgramUniformMatrix3fv(destination, destinationLocation, 1, GL_FALSE, floats);
+            else if (layout.columnCount == 4)
+                glProgramUniformMatrix4fv(destination, destinationLocation, 1, GL_FALSE, floats);
+            else if (layout.componentCount == 1)
+                glProgramUniform1fv(destination, destinationLocation, 1, floats);
+            else if (layout.componentCount == 2)
+                glProgramUniform2fv(destination, destinationLocation, 1, floats);
+            else if (layout.componentCount == 3)
+                glProgramUniform3fv(destination, destinationLocation, 1, floats);
+            else
+                glProgramUniform4fv(destination, destinationLocation, 1, floats);
+            break;
+        }
+        case UniformComponent::Int:
+        {
+            int32_t* ints = reinterpret_cast<int32_t*>(value.data());
+            glGetnUniformiv(source, sourceLocation, sizeof(value), ints);
+
+            if (layout.componentCount == 1)
+                glProgramUniform1iv(destination, destinationLocation, 1, ints);
+            else if (layout.componentCount == 2)
+                glProgramUniform2iv(destination, destinationLocation, 1, ints);
+            else if (layout.componentCount == 3)
+                glProgramUniform3iv(destination, destinationLocation, 1, ints);
+            else
+                glProgramUniform4iv(destination, destinationLocation, 1, ints);
+            break;
+        }
+        case UniformComponent::Uint:
+        {
+            glGetnUniformuiv(source, sourceLocation, sizeof(value), value.data());
+
+            if (layout.componentCount == 1)
+                glProgramUniform1uiv(destination, destinationLocation, 1, value.data());
+            else if (layout.componentCount == 2)
+                glProgramUniform2uiv(destination, destinationLocation, 1, value.data());
+            else if (layout.componentCount == 3)
+                glProgramUniform3uiv(destination, destinationLocation, 1, value.data());
+            else
+                glProgramUniform4uiv(destination, destinationLocation, 1, value.data());
+            break;
+        }
+    }
+}
+
+// every default block uniform both programs have with the same type, array elements one by one
+static void copyUniformValues(uint32_t source, uint32_t destination)
+{
+    int32_t uniformCount = 0;
+    glGetProgramiv(destination, GL_ACTIVE_UNIFORMS, &uniformCount);
+
+    char buffer[128];
+    for (int32_t i = 0; i < uniformCount; ++i)
+    {
+        int32_t arraySize;
+        GLenum type;
+        glGetActiveUniform(destination, i, sizeof(buffer), nullptr, &arraySize, &type, buffer);
+
+        std::optional<UniformLayout> layout = uniformLayout(type);
+        if (!layout)
+            continue;
+
+        uint32_t sourceIndex = GL_INVALID_INDEX;
+        const char* sourceName = buffer;
+        glGetUniformIndices(source, 1, &sourceName, &sourceIndex);
+
+        if (sourceIndex == GL_INVALID_INDEX)
+            continue;
+
+        int32_t sourceType = GL_NONE;
+        glGetActiveUniformsiv(source, 1, &sourceIndex, GL_UNIFORM_TYPE, &sourceType);
+
+        if (static_cast<GLenum>(sourceType) != type)
+            continue;
+
+        // arrays show up as name[0]
+        std::string name = buffer;
+        if (name.ends_with("[0]"))
+            name.resize(name.size() - 3);
+
+        for (int32_t element = 0; element < arraySize; ++element)
+        {
+            std::string elementName = arraySize > 1? std::format("{}[{}]", name, element) : std::string(buffer);
+
+            int32_t sourceLocation = glGetUniformLocation(source, elementName.c_str());
+            int32_t destinationLocation = glGetUniformLocation(destination, elementName.c_str());
+
+            if (sourceLocation != -1 && destinationLocation != -1)
+                copyUniformValue(source, sourceLocation, destination, destinationLocation, *layout);
+        }
+    }
+}
 
 Shader::Shader()
     : mRendererId()
+    , mCacheKey()
+    , mFinished()
+    , mFromCache()
+{
+}
+
+Shader::Shader(const ShaderList &shaderList, const ShaderDefines &defines)
+    : Shader(shaderList, defines, preprocess(shaderList, defines))
 {
 }
 
-Shader::Shader(ShaderList shaderList)
+Shader::Shader(const ShaderList &shaderList, const ShaderDefines &defines, const std::vector<ShaderStage> &stages)
+    : mRendererId()
+    , mCacheKey(hashBytes(driverString().data(), driverString().size()))
+    , mFinished()
+    , mFromCache()
+    , mShaderList(shaderList)
+    , mDefines(defines)
 {
+    for (const ShaderStage& stage : stages)
+    {
+        mCacheKey = hashBytes(&stage.type, sizeof(GLenum), mCacheKey);
+        mCacheKey = hashBytes(&stage.shader.hash, sizeof(uint64_t), mCacheKey);
+
+        for (const std::filesystem::path& file : stage.shader.files)
+            if (std::find(mFiles.begin(), mFiles.end(), file) == mFiles.end())
+                mFiles.push_back(file);
+    }
+
+    if (programBinarySupported() && loadBinary())
+    {
+        mFromCache = true;
+        finish();
+        return;
+    }
+
     mRendererId = glCreateProgram();
 
-    std::vector<uint32_t> compiledShaders;
-    for (const auto& [shaderType, shaderPath] : shaderList)
+    if (programBinarySupported())
+        glProgramParameteri(mRendererId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    // the compiles and the link return straight away with parallel shader compile
+    for (const ShaderStage& stage : stages)
     {
-        std::string shaderSrc = parseShader(shaderPath);
-        uint32_t shaderID = compileShader(shaderType, shaderSrc);
+        uint32_t shaderID = compileShader(stage.type, stage.shader.source);
         glAttachShader(mRendererId, shaderID);
-        compiledShaders.push_back(shaderID);
+        mPendingShaders.push_back({shaderID, stage.shader.files});
     }
 
     glLinkProgram(mRendererId);
-
-    for (uint32_t shaderID : compiledShaders)
-        glDeleteShader(shaderID);
-
-    queryUniforms();
 }
 
 Shader::~Shader()
 {
+    for (const PendingShader& pendingShader : mPendingShaders)
+        glDeleteShader(pendingShader.id);
+
+    StateCache::programDeleted(mRendererId);
     glDeleteProgram(mRendererId);
 }
 
 Shader::Shader(Shader &&other) noexcept
 {
     mRendererId = other.mRendererId;
-    mUniformLocationCache = std::move(other.mUniformLocationCache);
+    mUniformSlots = std::move(other.mUniformSlots);
+    mUniformBlocks = std::move(other.mUniformBlocks);
+    mStorageBlocks = std::move(other.mStorageBlocks);
+    mPendingShaders = std::move(other.mPendingShaders);
+    mCacheKey = other.mCacheKey;
+    mFinished = other.mFinished;
+    mFromCache = other.mFromCache;
+    mShaderList = std::move(other.mShaderList);
+    mDefines = std::move(other.mDefines);
+    mFiles = std::move(other.mFiles);
+    mReload = std::move(other.mReload);
 
     other.mRendererId = 0;
+    other.mPendingShaders.clear();
 }
 
 Shader &Shader::operator=(Shader &&other) noexcept
 {
     if (this != &other)
     {
+        for (const PendingShader& pendingShader : mPendingShaders)
+            glDeleteShader(pendingShader.id);
+
+        StateCache::programDeleted(mRendererId);
         glDeleteProgram(mRendererId);
 
         mRendererId = other.mRendererId;
-        mUniformLocationCache = std::move(other.mUniformLocationCache);
+        mUniformSlots = std::move(other.mUniformSlots);
+        mUniformBlocks = std::move(other.mUniformBlocks);
+        mStorageBlocks = std::move(other.mStorageBlocks);
+        mPendingShaders = std::move(other.mPendingShaders);
+        mCacheKey = other.mCacheKey;
+        mFinished = other.mFinished;
+        mFromCache = other.mFromCache;
+        mShaderList = std::move(other.mShaderList);
+        mDefines = std::move(other.mDefines);
+        mFiles = std::move(other.mFiles);
+        mReload = std::move(other.mReload);
 
         other.mRendererId = 0;
+        other.mPendingShaders.clear();
     }
 
     return *this;
 }
 
+std::vector<ShaderStage> Shader::preprocess(const ShaderList &shaderList, const ShaderDefines &defines)
+{
+    std::vector<ShaderStage> stages;
+    for (const auto& [shaderType, shaderPath] : shaderList)
+        stages.push_back({shaderType, ShaderPreprocessor::preprocess(shaderPath, defines)});
+    return stages;
+}
+
+void Shader::finishAll(std::initializer_list<Shader *> shaders)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<Shader*> pending(shaders);
+    uint32_t cachedCount = 0;
+
+    while (!pending.empty())
+    {
+        std::erase_if(pending, [&cachedCount] (Shader* shader) {
+            if (!shader->ready())
+                return false;
+
+            shader->finish();
+            cachedCount += shader->fromCache();
+            return true;
+        });
+
+        if (!pending.empty())
+            std::this_thread::yield();
+    }
+
+    float elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    debugLog(std::format("Shader: {} programs ready in {:.1f} ms, {} from the binary cache", shaders.size(), elapsedMs, cachedCount));
+}
+
 void Shader::bind() const
 {
-    glUseProgram(mRendererId);
+    assert(mFinished);
+    StateCache::useProgram(mRendererId);
 }
 
 void Shader::unbind() const
 {
-    glUseProgram(0);
+    StateCache::useProgram(0);
+}
+
+void Shader::setInt(UniformID uniform, int v0) const
+{
+    glProgramUniform1i(mRendererId, getUniformLocation(uniform), v0);
+}
+
+void Shader::setUint(UniformID uniform, uint32_t v0) const
+{
+    glProgramUniform1ui(mRendererId, getUniformLocation(uniform), v0);
+}
+
+void Shader::setUintArray(UniformID uniform, uint32_t count, const uint32_t *values) const
+{
+    glProgramUniform1uiv(mRendererId, getUniformLocation(uniform), count, values);
+}
+
+void Shader::setFloat(UniformID uniform, float v0) const
+{
+    glProgramUniform1f(mRendererId, getUniformLocation(uniform), v0);
 }
 
-void Shader::setInt(const std::string& name, int v0) const
+void Shader::setFloat2(UniformID uniform, float v0, float v1) const
 {
-    glUniform1i(getUniformLocation(name), v0);
+    glProgramUniform2f(mRendererId, getUniformLocation(uniform), v0, v1);
 }
 
-void Shader::setFloat(const std::string& name, float v0) const
+void Shader::setFloat2(UniformID uniform, const glm::vec2 &vec2) const
 {
-    glUniform1f(getUniformLocation(name), v0);
+    glProgramUniform2f(mRendererId, getUniformLocation(uniform), vec2.x, vec2.y);
 }
 
-void Shader::setFloat2(const std::string& name, float v0, float v1) const
+void Shader::setFloat2(UniformID uniform, float v0, float v1, float v2) const
 {
-    glUniform2f(getUniformLocation(name), v0, v1);
+    glProgramUniform3f(mRendererId, getUniformLocation(uniform), v0, v1, v2);
 }
 
-void Shader::setFloat2(const std::string& name, const glm::vec2 &vec2) const
+void Shader::setFloat3(UniformID uniform, const glm::vec3 &vec3) const
 {
-    glUniform2f(getUniformLocation(name), vec2.x, vec2.y);
+    glProgramUniform3f(mRendererId, getUniformLocation(uniform), vec3.x, vec3.y, vec3.z);
 }
 
-void Shader::setFloat2(const std::string& name, float v0, float v1, float v2) const
+void Shader::setFloat4(UniformID uniform, float v0, float v1, float v2, float v3) const
 {
-    glUniform3f(getUniformLocation(name), v0, v1, v2);
+    glProgramUniform4f(mRendererId, getUniformLocation(uniform), v0, v1, v2, v3);
 }
 
-void Shader::setFloat3(const std::string& name, const glm::vec3 &vec3) const
+void Shader::setFloat4(UniformID uniform, const glm::vec4 &vec4) const
 {
-    glUniform3f(getUniformLocation(name), vec3.x, vec3.y, vec3.z);
+    glProgramUniform4f(mRendererId, getUniformLocation(uniform), vec4.x, vec4.y, vec4.z, vec4.w);
 }
 
-void Shader::setFloat4(const std::string& name, float v0, float v1, float v2, float v3) const
+void Shader::setFloat4Array(UniformID uniform, uint32_t count, const glm::vec4 *vec4s) const
 {
-    glUniform4f(getUniformLocation(name), v0, v1, v2, v3);
+    glProgramUniform4fv(mRendererId, getUniformLocation(uniform), count, glm::value_ptr(*vec4s));
 }
 
-void Shader::setFloat4(const std::string& name, const glm::vec4 &vec4) const
+void Shader::setMat4(UniformID uniform, const glm::mat4 &matrix) const
 {
-    glUniform4f(getUniformLocation(name), vec4.x, vec4.y, vec4.z, vec4.w);
+    glProgramUniformMatrix4fv(mRendererId, getUniformLocation(uniform), 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
-void Shader::setMat4(const std::string& name, const glm::mat4 &matrix) const
+void Shader::setMat4Array(UniformID uniform, uint32_t count, const glm::mat4 *matrices) const
 {
-    glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(matrix));
+    glProgramUniformMatrix4fv(mRendererId, getUniformLocation(uniform), count, GL_FALSE, glm::value_ptr(*matrices));
+}
+
+int32_t Shader::uniformLocation(UniformID uniform) const
+{
+    if (mUniformSlots.empty())
+        return -1;
+
+    size_t mask = mUniformSlots.size() - 1;
+
+    // there's always an empty slot to end the probe
+    for (size_t slot = uniform.hash & mask; mUniformSlots.at(slot).hash; slot = (slot + 1) & mask)
+        if (mUniformSlots.at(slot).hash == uniform.hash)
+            return mUniformSlots.at(slot).location;
+
+    return -1;
+}
+
+const Shader::BufferBlock *Shader::uniformBlock(UniformID block) const
+{
+    auto itr = std::find_if(mUniformBlocks.begin(), mUniformBlocks.end(), [block] (const BufferBlock& uniformBlock) {
+        return uniformBlock.hash == block.hash;
+    });
+
+    return itr != mUniformBlocks.end()? &*itr : nullptr;
+}
+
+const Shader::BufferBlock *Shader::storageBlock(UniformID block) const
+{
+    auto itr = std::find_if(mStorageBlocks.begin(), mStorageBlocks.end(), [block] (const BufferBlock& storageBlock) {
+        return storageBlock.hash == block.hash;
+    });
+
+    return itr != mStorageBlocks.end()? &*itr : nullptr;
+}
+
+const std::vector<Shader::BufferBlock> &Shader::uniformBlocks() const
+{
+    return mUniformBlocks;
+}
+
+const std::vector<Shader::BufferBlock> &Shader::storageBlocks() const
+{
+    return mStorageBlocks;
 }
 
 uint32_t Shader::id() const
@@ -118,15 +477,148 @@ uint32_t Shader::id() const
     return mRendererId;
 }
 
-std::string Shader::parseShader(const std::string& path)
+bool Shader::ready() const
+{
+    if (mFinished || !parallelShaderCompile())
+        return true;
+
+    int32_t completed = GL_FALSE;
+    glGetProgramiv(mRendererId, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+void Shader::finish()
+{
+    if (mFinished)
+        return;
+
+    std::string errorLog;
+    if (!link(errorLog))
+    {
+        debugLog(errorLog, LogSeverity::Error);
+        check(false, errorLog.c_str());
+    }
+}
+
+bool Shader::finished() const
+{
+    return mFinished;
+}
+
+bool Shader::fromCache() const
+{
+    return mFromCache;
+}
+
+const std::vector<std::filesystem::path> &Shader::files() const
+{
+    return mFiles;
+}
+
+std::string Shader::name() const
+{
+    std::string name;
+    for (const auto& [shaderType, shaderPath] : mShaderList)
+        name += (name.empty()? "" : ", ") + std::filesystem::path(shaderPath).filename().string();
+    return name;
+}
+
+void Shader::reload()
+{
+    if (mReload)
+        return;
+
+    // a missing file or include throws while preprocessing
+    try
+    {
+        mReload = std::make_unique<Shader>(mShaderList, mDefines);
+    }
+    catch (const std::exception& e)
+    {
+        debugLog(std::format("Shader: Failed to reload {}\n{}", name(), e.what()), LogSeverity::Error);
+    }
+}
+
+Shader::ReloadStatus Shader::pollReload()
 {
-    std::ifstream file(path);
-    check(file.is_open(), "Failed to open shader file.");
+    if (!mReload)
+        return ReloadStatus::Idle;
 
-    std::ostringstream oss;
-    oss << file.rdbuf();
+    if (!mReload->ready())
+        return ReloadStatus::Pending;
 
-    return oss.str();
+    std::string errorLog;
+    bool linked = mReload->mFinished || mReload->link(errorLog);
+
+    if (linked)
+        swapProgram(*mReload);
+    else
+        debugLog(std::format("Shader: Failed to reload {}, keeping the running program\n{}", name(), errorLog), LogSeverity::Error);
+
+    mReload.reset();
+
+    return linked? ReloadStatus::Swapped : ReloadStatus::Failed;
+}
+
+// the compile and link logs go to errorLog when it fails
+bool Shader::link(std::string& errorLog)
+{
+    int32_t linked = GL_FALSE;
+    glGetProgramiv(mRendererId, GL_LINK_STATUS, &linked);
+
+    if (!linked)
+    {
+        for (const PendingShader& pendingShader : mPendingShaders)
+        {
+            int32_t compiled = GL_FALSE;
+            glGetShaderiv(pendingShader.id, GL_COMPILE_STATUS, &compiled);
+
+            if (!compiled)
+            {
+                errorLog += std::format("Failed to compile {}\n", pendingShader.files.front().string());
+
+                // the log refers to files by source string number
+                for (size_t i = 1; i < pendingShader.files.size(); ++i)
+                    errorLog += std::format("  source string {}: {}\n", i, pendingShader.files.at(i).string());
+
+                errorLog += shaderInfoLog(pendingShader.id) + '\n';
+            }
+        }
+
+        errorLog += std::format("Failed to link program\n{}", programInfoLog(mRendererId));
+
+        return false;
+    }
+
+    for (const PendingShader& pendingShader : mPendingShaders)
+    {
+        glDetachShader(mRendererId, pendingShader.id);
+        glDeleteShader(pendingShader.id);
+    }
+
+    if (!mPendingShaders.empty() && programBinarySupported())
+        saveBinary();
+
+    mPendingShaders.clear();
+    mFinished = true;
+
+    reflect();
+
+    return true;
+}
+
+// other is linked. Takes its program and leaves this one's for it to delete
+void Shader::swapProgram(Shader &other)
+{
+    copyUniformValues(mRendererId, other.mRendererId);
+
+    std::swap(mRendererId, other.mRendererId);
+    std::swap(mUniformSlots, other.mUniformSlots);
+    std::swap(mUniformBlocks, other.mUniformBlocks);
+    std::swap(mStorageBlocks, other.mStorageBlocks);
+    std::swap(mCacheKey, other.mCacheKey);
+    std::swap(mFromCache, other.mFromCache);
+    std::swap(mFiles, other.mFiles);
 }
 
 uint32_t Shader::compileShader(uint32_t type, const std::string& shaderSrc)
@@ -140,24 +632,156 @@ uint32_t Shader::compileShader(uint32_t type, const std::string& shaderSrc)
     return shaderId;
 }
 
-void Shader::queryUniforms()
+// a uint32 binary format followed by the binary
+bool Shader::loadBinary()
 {
-    int uniformCount;
-    glGetProgramiv(mRendererId, GL_ACTIVE_UNIFORMS, &uniformCount);
+    std::ifstream file(binaryPath(), std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return false;
+
+    size_t fileSize = static_cast<size_t>(file.tellg());
+    if (fileSize <= sizeof(uint32_t))
+        return false;
+
+    uint32_t binaryFormat;
+    std::vector<char> binary(fileSize - sizeof(uint32_t));
+
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(&binaryFormat), sizeof(uint32_t));
+    file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+
+    if (!file)
+        return false;
+
+    mRendererId = glCreateProgram();
+    glProgramBinary(mRendererId, binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+
+    int32_t linked = GL_FALSE;
+    glGetProgramiv(mRendererId, GL_LINK_STATUS, &linked);
+
+    // drivers may reject their own binaries, e.g. after an update that kept the version string
+    if (!linked)
+    {
+        debugLog(std::format("Shader: Cached binary {} was rejected, compiling instead.", binaryPath().filename().string()), LogSeverity::Warning);
+
+        glDeleteProgram(mRendererId);
+        mRendererId = 0;
+        return false;
+    }
+
+    return true;
+}
+
+void Shader::saveBinary() const
+{
+    int32_t binaryLength = 0;
+    glGetProgramiv(mRendererId, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+
+    if (binaryLength <= 0)
+        return;
+
+    uint32_t binaryFormat;
+    std::vector<char> binary(binaryLength);
+    glGetProgramBinary(mRendererId, binaryLength, nullptr, &binaryFormat, binary.data());
+
+    std::error_code errorCode;
+    std::filesystem::create_directories(binaryPath().parent_path(), errorCode);
+
+    std::ofstream file(binaryPath(), std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        debugLog(std::format("Shader: Failed to write {}", binaryPath().string()), LogSeverity::Warning);
+        return;
+    }
+
+    file.write(reinterpret_cast<const char*>(&binaryFormat), sizeof(uint32_t));
+    file.write(binary.data(), binaryLength);
+}
+
+std::filesystem::path Shader::binaryPath() const
+{
+    return std::filesystem::path(SHADER_CACHE_DIR) / std::format("{:016x}.bin", mCacheKey);
+}
+
+// default block uniforms into the location table, blocks with their bindings and sizes
+void Shader::reflect()
+{
+    mUniformSlots.clear();
+    mUniformBlocks.clear();
+    mStorageBlocks.clear();
 
     char buffer[128];
-    for (int i = 0; i < uniformCount; ++i)
+
+    int32_t uniformCount = 0;
+    glGetProgramInterfaceiv(mRendererId, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+
+    std::vector<std::pair<uint64_t, int32_t>> uniforms;
+    for (int32_t i = 0; i < uniformCount; ++i)
+    {
+        const GLenum properties[] {GL_LOCATION, GL_BLOCK_INDEX};
+        int32_t values[2];
+        glGetProgramResourceiv(mRendererId, GL_UNIFORM, i, 2, properties, 2, nullptr, values);
+
+        // block members have no location
+        if (values[0] == -1 || values[1] != -1)
+            continue;
+
+        glGetProgramResourceName(mRendererId, GL_UNIFORM, i, sizeof(buffer), nullptr, buffer);
+        uniforms.emplace_back(hashString(buffer), values[0]);
+    }
+
+    if (!uniforms.empty())
     {
-        glGetActiveUniform(mRendererId, i, sizeof(buffer), nullptr, nullptr, nullptr, buffer);
-        mUniformLocationCache.emplace(std::string(buffer), glGetUniformLocation(mRendererId, buffer));
+        mUniformSlots.resize(std::bit_ceil(uniforms.size() * 2));
+        size_t mask = mUniformSlots.size() - 1;
+
+        for (const auto& [hash, location] : uniforms)
+        {
+            size_t slot = hash & mask;
+            while (mUniformSlots.at(slot).hash)
+            {
+                if (mUniformSlots.at(slot).hash == hash)
+                    debugLog(std::format("Shader: Two uniforms of {} hash to {:016x}.", name(), hash), LogSeverity::Warning);
+                slot = (slot + 1) & mask;
+            }
+
+            mUniformSlots.at(slot) = {hash, location};
+        }
     }
+
+    auto reflectBlocks = [this, &buffer] (GLenum interface, std::vector<BufferBlock>& blocks) {
+        int32_t blockCount = 0;
+        glGetProgramInterfaceiv(mRendererId, interface, GL_ACTIVE_RESOURCES, &blockCount);
+
+        for (int32_t i = 0; i < blockCount; ++i)
+        {
+            const GLenum properties[] {GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE};
+            int32_t values[2];
+            glGetProgramResourceiv(mRendererId, interface, i, 2, properties, 2, nullptr, values);
+            glGetProgramResourceName(mRendererId, interface, i, sizeof(buffer), nullptr, buffer);
+
+            blocks.push_back({
+                .name = buffer,
+                .hash = hashString(buffer),
+                .binding = static_cast<uint32_t>(values[0]),
+                .dataSize = static_cast<uint32_t>(values[1])
+            });
+        }
+    };
+
+    reflectBlocks(GL_UNIFORM_BLOCK, mUniformBlocks);
+    reflectBlocks(GL_SHADER_STORAGE_BLOCK, mStorageBlocks);
 }
 
-int Shader::getUniformLocation(const std::string& name) const
+int32_t Shader::getUniformLocation(UniformID uniform) const
 {
-    if (mUniformLocationCache.contains(name))
-        return mUniformLocationCache.at(name);
+    int32_t location = uniformLocation(uniform);
+
+    if (location == -1)
+    {
+        debugLog(std::format("Uniform {} doesn't exist or it may not be used.", uniform.name), LogSeverity::Warning);
+        assert(false);
+    }
 
-    debugLog(std::format("Uniform {} doesn't exist or it may not be used.", name));
-    assert(false);
+    return location;
 }
@@ -9,17 +9,72 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "../utils.hpp"
+#include "shader_preprocessor.hpp"
 
 using ShaderPath = std::string;
-using ShaderList = std::initializer_list<std::pair<GLenum, ShaderPath>>;
+using ShaderList = std::vector<std::pair<GLenum, ShaderPath>>;
 
+struct ShaderStage
+{
+    GLenum type;
+    PreprocessedShader shader;
+};
+
+// A uniform or block name hashed at compile time, string literals convert to it. Arrays are
+// named with [0] after them, the way the program lists them
+struct UniformID
+{
+    uint64_t hash;
+    std::string_view name;
+
+    consteval UniformID(const char* name)
+        : hash(hashString(name))
+        , name(name)
+    {
+    }
+};
+
+// A program linked from a list of preprocessed stage sources. Linked programs are kept in a binary
+// cache under SHADER_CACHE_DIR, keyed by a hash of the sources and the driver, so later runs skip
+// compiling. Otherwise the stages are compiled and linked without waiting: drivers with parallel
+// shader compile do it on their own threads, so constructing several programs before finishing
+// any of them compiles them together. finish() has to run before the program is used.
+// reload() builds the current sources into a second program the same way, which takes the
+// running one's place once it linked, see ShaderWatcher.
+// Uniforms, uniform blocks and storage blocks are reflected once the program links. Uniform
+// locations go in a small open addressed table indexed by the name hash, and values are set with
+// glProgramUniform*, so setting one is a masked index with a probe or two and needs no binding.
 class Shader
 {
+public:
+    struct BufferBlock
+    {
+        std::string name;
+        uint64_t hash;
+        uint32_t binding;
+        uint32_t dataSize;
+    };
+
 public:
     Shader();
-    Shader(ShaderList shaderList);
+    Shader(const ShaderList& shaderList, const ShaderDefines& defines = {});
+    // stages preprocessed from the list and defines already
+    Shader(const ShaderList& shaderList, const ShaderDefines& defines, const std::vector<ShaderStage>& stages);
     ~Shader();
 
+    enum class ReloadStatus
+    {
+        Idle,
+        Pending,
+        Swapped,
+        Failed
+    };
+
+    static std::vector<ShaderStage> preprocess(const ShaderList& shaderList, const ShaderDefines& defines);
+
+    // polls each program and finishes the ones done compiling until all are
+    static void finishAll(std::initializer_list<Shader*> shaders);
+
     Shader(Shader&& other) noexcept;
     Shader& operator=(Shader&& other) noexcept;
 
@@ -29,27 +84,88 @@ public:
     void bind() const;
     void unbind() const;
 
-    void setInt(const std::string& name, int v0) const;
-    void setFloat(const std::string& name, float v0) const;
-    void setFloat2(const std::string& name, float v0 , float v1) const;
-    void setFloat2(const std::string& name, const glm::vec2& vec2) const;
-    void setFloat2(const std::string& name, float v0, float v1, float v2) const;
-    void setFloat3(const std::string& name, const glm::vec3& vec3) const;
-    void setFloat4(const std::string& name, float v0, float v1, float v2, float v3) const;
-    void setFloat4(const std::string& name, const glm::vec4& vec4) const;
-    void setMat4(const std::string& name, const glm::mat4& matrix) const;
+    void setInt(UniformID uniform, int v0) const;
+    void setUint(UniformID uniform, uint32_t v0) const;
+    void setUintArray(UniformID uniform, uint32_t count, const uint32_t* values) const;
+    void setFloat(UniformID uniform, float v0) const;
+    void setFloat2(UniformID uniform, float v0 , float v1) const;
+    void setFloat2(UniformID uniform, const glm::vec2& vec2) const;
+    void setFloat2(UniformID uniform, float v0, float v1, float v2) const;
+    void setFloat3(UniformID uniform, const glm::vec3& vec3) const;
+    void setFloat4(UniformID uniform, float v0, float v1, float v2, float v3) const;
+    void setFloat4(UniformID uniform, const glm::vec4& vec4) const;
+    void setFloat4Array(UniformID uniform, uint32_t count, const glm::vec4* vec4s) const;
+    void setMat4(UniformID uniform, const glm::mat4& matrix) const;
+    void setMat4Array(UniformID uniform, uint32_t count, const glm::mat4* matrices) const;
+
+    // -1 when the program has no such uniform or the compiler dropped it
+    int32_t uniformLocation(UniformID uniform) const;
+    // null when the program doesn't use the block
+    const BufferBlock* uniformBlock(UniformID block) const;
+    const BufferBlock* storageBlock(UniformID block) const;
+    const std::vector<BufferBlock>& uniformBlocks() const;
+    const std::vector<BufferBlock>& storageBlocks() const;
 
     uint32_t id() const;
 
+    // never blocks, true once the driver is done compiling and linking
+    bool ready() const;
+    // blocks until linked. Throws with the compile and link logs when it fails
+    void finish();
+    bool finished() const;
+    bool fromCache() const;
+
+    // every file the stages were built from, includes too
+    const std::vector<std::filesystem::path>& files() const;
+    // the stage file names, for logs
+    std::string name() const;
+
+    // starts building the current sources next to the running program, without waiting for the
+    // driver. Does nothing while a reload is pending
+    void reload();
+    // never blocks. A reload that linked takes the running program's place, uniform values carry
+    // over. A failed one logs its errors and the running program stays
+    ReloadStatus pollReload();
+
 private:
-    std::string parseShader(const std::string& path);
+    struct PendingShader
+    {
+        uint32_t id;
+        // by source string number
+        std::vector<std::filesystem::path> files;
+    };
+
+    bool link(std::string& errorLog);
+    void swapProgram(Shader& other);
     uint32_t compileShader(uint32_t type, const std::string& shaderSrc);
-    void queryUniforms();
-    int getUniformLocation(const std::string& name) const;
+    bool loadBinary();
+    void saveBinary() const;
+    std::filesystem::path binaryPath() const;
+    void reflect();
+    int32_t getUniformLocation(UniformID uniform) const;
 
 private:
+    struct UniformSlot
+    {
+        // 0 for an empty slot
+        uint64_t hash;
+        int32_t location;
+    };
+
     uint32_t mRendererId;
-    std::unordered_map<std::string, int> mUniformLocationCache;
+    // a power of two in size, at most half full
+    std::vector<UniformSlot> mUniformSlots;
+    std::vector<BufferBlock> mUniformBlocks;
+    std::vector<BufferBlock> mStorageBlocks;
+    std::vector<PendingShader> mPendingShaders;
+    uint64_t mCacheKey;
+    bool mFinished;
+    bool mFromCache;
+
+    ShaderList mShaderList;
+    ShaderDefines mDefines;
+    std::vector<std::filesystem::path> mFiles;
+    std::unique_ptr<Shader> mReload;
 };
 
 #endif //OPENGLRENDERINGENGINE_SHADER_HPP
@@ -0,0 +1,68 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "shader_permutations.hpp"
+
+ShaderPermutations::ShaderPermutations(const ShaderList &shaderList)
+    : mShaderList(shaderList)
+{
+}
+
+void ShaderPermutations::setLinkCallback(ProgramCallback callback)
+{
+    mLinkCallback = std::move(callback);
+}
+
+Shader &ShaderPermutations::get(const ShaderDefines &defines)
+{
+    uint64_t definesHash = ShaderPreprocessor::hashDefines(defines);
+
+    if (auto itr = mPermutations.find(definesHash); itr != mPermutations.end())
+        return *itr->second;
+
+    std::vector<ShaderStage> stages = Shader::preprocess(mShaderList, defines);
+
+    uint64_t sourceHash = FNVOffsetBasis;
+    for (const ShaderStage& stage : stages)
+    {
+        sourceHash = hashBytes(&stage.type, sizeof(GLenum), sourceHash);
+        sourceHash = hashBytes(&stage.shader.hash, sizeof(uint64_t), sourceHash);
+    }
+
+    auto itr = mPrograms.find(sourceHash);
+
+    // only kept once linked, a failed one throws from finish and is tried again next time
+    if (itr == mPrograms.end())
+    {
+        auto program = std::make_unique<Shader>(mShaderList, defines, stages);
+        program->finish();
+
+        if (mLinkCallback)
+            mLinkCallback(*program);
+
+        itr = mPrograms.emplace(sourceHash, std::move(program)).first;
+    }
+
+    mPermutations.emplace(definesHash, itr->second.get());
+
+    return *itr->second;
+}
+
+std::vector<Shader *> ShaderPermutations::programs() const
+{
+    std::vector<Shader*> programs;
+    for (const auto& [sourceHash, program] : mPrograms)
+        programs.push_back(program.get());
+    return programs;
+}
+
+uint32_t ShaderPermutations::permutationCount() const
+{
+    return static_cast<uint32_t>(mPermutations.size());
+}
+
+uint32_t ShaderPermutations::programCount() const
+{
+    return static_cast<uint32_t>(mPrograms.size());
+}
@@ -0,0 +1,42 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_SHADER_PERMUTATIONS_HPP
+#define OPENGLRENDERINGENGINE_SHADER_PERMUTATIONS_HPP
+
+#include "shader.hpp"
+
+// called with a program once it has linked
+using ProgramCallback = std::function<void(const Shader& shader)>;
+
+// One set of stage sources specialized by define sets. A permutation is preprocessed and linked
+// the first time it's asked for, which the program binary cache turns into a file read after the
+// first run. Define sets that preprocess to the same sources share one program.
+class ShaderPermutations
+{
+public:
+    ShaderPermutations(const ShaderList& shaderList);
+
+    // runs on every new program before get() hands it out, a throwing callback drops the program
+    void setLinkCallback(ProgramCallback callback);
+
+    // blocks until the permutation is linked the first time
+    Shader& get(const ShaderDefines& defines = {});
+
+    // the ones built so far
+    std::vector<Shader*> programs() const;
+
+    uint32_t permutationCount() const;
+    uint32_t programCount() const;
+
+private:
+    ShaderList mShaderList;
+    ProgramCallback mLinkCallback;
+    // define set hash to program
+    std::unordered_map<uint64_t, Shader*> mPermutations;
+    // source hash to program
+    std::unordered_map<uint64_t, std::unique_ptr<Shader>> mPrograms;
+};
+
+#endif //OPENGLRENDERINGENGINE_SHADER_PERMUTATIONS_HPP
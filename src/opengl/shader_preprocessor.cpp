@@ -0,0 +1,150 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "shader_preprocessor.hpp"
+
+struct ExpandState
+{
+    PreprocessedShader& result;
+    // injected at the first #version, at the very top if there isn't one
+    const ShaderDefines* pendingDefines;
+};
+
+static std::mutex sFileCacheMutex;
+static std::unordered_map<std::string, std::shared_ptr<const std::string>> sFileCache;
+
+static std::filesystem::path normalizedPath(const std::filesystem::path& path)
+{
+    std::error_code errorCode;
+    std::filesystem::path absolutePath = std::filesystem::absolute(path, errorCode);
+    return (errorCode? path : absolutePath).lexically_normal();
+}
+
+static std::shared_ptr<const std::string> readFile(const std::filesystem::path& path)
+{
+    std::lock_guard<std::mutex> lock(sFileCacheMutex);
+
+    if (auto itr = sFileCache.find(path.generic_string()); itr != sFileCache.end())
+        return itr->second;
+
+    std::ifstream file(path);
+    check(file.is_open(), std::format("ShaderPreprocessor: Failed to open {}.", path.string()).c_str());
+
+    std::ostringstream oss;
+    oss << file.rdbuf();
+
+    auto contents = std::make_shared<const std::string>(oss.str());
+    sFileCache.emplace(path.generic_string(), contents);
+
+    return contents;
+}
+
+static std::string defineLines(const ShaderDefines& defines)
+{
+    std::string lines;
+    for (const auto& [name, value] : defines)
+        lines += std::format("#define {} {}\n", name, value);
+    return lines;
+}
+
+static bool isDirective(std::string_view line, std::string_view directive)
+{
+    size_t first = line.find_first_not_of(" \t");
+    return first != std::string_view::npos && line.substr(first).starts_with(directive);
+}
+
+static std::filesystem::path includePath(const std::filesystem::path& path, std::string_view line, uint32_t lineNumber)
+{
+    size_t open = line.find('"');
+    size_t close = line.rfind('"');
+
+    check(open != std::string_view::npos && close > open,
+          std::format("ShaderPreprocessor: Malformed #include in {} at line {}.", path.string(), lineNumber).c_str());
+
+    return normalizedPath(path.parent_path() / line.substr(open + 1, close - open - 1));
+}
+
+// #line n sets the number of the line after it
+static void expand(ExpandState& state, const std::filesystem::path& path, uint32_t sourceString)
+{
+    std::shared_ptr<const std::string> contents = readFile(path);
+    std::istringstream stream(*contents);
+
+    std::string line;
+    uint32_t lineNumber = 0;
+
+    while (std::getline(stream, line))
+    {
+        ++lineNumber;
+
+        if (state.pendingDefines && isDirective(line, "#version"))
+        {
+            state.result.source += line + '\n';
+            state.result.source += defineLines(*state.pendingDefines);
+            state.result.source += std::format("#line {} {}\n", lineNumber + 1, sourceString);
+            state.pendingDefines = nullptr;
+            continue;
+        }
+
+        if (isDirective(line, "#include"))
+        {
+            std::filesystem::path included = includePath(path, line, lineNumber);
+
+            if (std::find(state.result.files.begin(), state.result.files.end(), included) == state.result.files.end())
+            {
+                uint32_t includedString = static_cast<uint32_t>(state.result.files.size());
+                state.result.files.push_back(included);
+
+                state.result.source += std::format("#line 1 {}\n", includedString);
+                expand(state, included, includedString);
+            }
+
+            state.result.source += std::format("#line {} {}\n", lineNumber + 1, sourceString);
+            continue;
+        }
+
+        state.result.source += line + '\n';
+    }
+}
+
+namespace ShaderPreprocessor
+{
+    PreprocessedShader preprocess(const std::filesystem::path &path, const ShaderDefines &defines)
+    {
+        PreprocessedShader result {.files = {normalizedPath(path)}};
+        ExpandState state {result, &defines};
+
+        // a copy, includes grow the file list
+        std::filesystem::path shaderPath = result.files.front();
+        expand(state, shaderPath, 0);
+
+        if (state.pendingDefines)
+            result.source = defineLines(defines) + "#line 1 0\n" + result.source;
+
+        result.hash = hashBytes(result.source.data(), result.source.size());
+
+        return result;
+    }
+
+    uint64_t hashDefines(const ShaderDefines &defines)
+    {
+        ShaderDefines sortedDefines = defines;
+        std::sort(sortedDefines.begin(), sortedDefines.end());
+
+        uint64_t hash = FNVOffsetBasis;
+        for (const auto& [name, value] : sortedDefines)
+        {
+            std::string define = std::format("{}={}\n", name, value);
+            hash = hashBytes(define.data(), define.size(), hash);
+        }
+
+        return hash;
+    }
+
+    void invalidate(const std::filesystem::path &path)
+    {
+        std::lock_guard<std::mutex> lock(sFileCacheMutex);
+        sFileCache.erase(normalizedPath(path).generic_string());
+    }
+}
@@ -0,0 +1,36 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_SHADER_PREPROCESSOR_HPP
+#define OPENGLRENDERINGENGINE_SHADER_PREPROCESSOR_HPP
+
+#include "../utils.hpp"
+
+// name and value pairs, the value may be empty
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+struct PreprocessedShader
+{
+    std::string source;
+    // the shader and then its includes, indexed by the #line source string numbers in the source
+    std::vector<std::filesystem::path> files;
+    uint64_t hash;
+};
+
+// Expands #include "file" relative to the including file and injects a #define per entry of the
+// define set right after #version, which is how one source turns into specialized permutations.
+// Each file is included once per shader, so include guards aren't needed and cycles end there.
+// File contents are cached across shaders since the same includes show up in most of them.
+namespace ShaderPreprocessor
+{
+    PreprocessedShader preprocess(const std::filesystem::path& path, const ShaderDefines& defines = {});
+
+    // order independent
+    uint64_t hashDefines(const ShaderDefines& defines);
+
+    // the next preprocess reads the file again
+    void invalidate(const std::filesystem::path& path);
+}
+
+#endif //OPENGLRENDERINGENGINE_SHADER_PREPROCESSOR_HPP
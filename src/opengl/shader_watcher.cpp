@@ -0,0 +1,191 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "shader_watcher.hpp"
+
+static constexpr auto sPollInterval = std::chrono::milliseconds(250);
+
+ShaderWatcher::ShaderWatcher()
+    : mWatchedShaderCount()
+    , mStop()
+    , mEnabled(true)
+    , mStats()
+{
+    mPollThread = std::thread(&ShaderWatcher::pollFiles, this);
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mFileMutex);
+        mStop = true;
+    }
+
+    mStopCondition.notify_one();
+    mPollThread.join();
+}
+
+void ShaderWatcher::watch(Shader &shader)
+{
+    mShaders.push_back(&shader);
+}
+
+void ShaderWatcher::watch(ShaderPermutations &shaderPermutations)
+{
+    mShaderPermutations.push_back(&shaderPermutations);
+}
+
+void ShaderWatcher::setReloadCallback(ProgramCallback callback)
+{
+    mReloadCallback = std::move(callback);
+}
+
+void ShaderWatcher::update()
+{
+    std::vector<Shader*> watchedShaders = shaders();
+
+    // new permutations bring their files along
+    if (watchedShaders.size() != mWatchedShaderCount)
+        updateWatchedFiles(watchedShaders);
+
+    std::vector<std::filesystem::path> changedFiles;
+    {
+        std::lock_guard<std::mutex> lock(mFileMutex);
+        std::swap(changedFiles, mChangedFiles);
+    }
+
+    for (const std::filesystem::path& changedFile : changedFiles)
+        ShaderPreprocessor::invalidate(changedFile);
+
+    for (Shader* shader : watchedShaders)
+    {
+        bool usesChangedFile = std::any_of(changedFiles.begin(), changedFiles.end(), [shader] (const std::filesystem::path& changedFile) {
+            return std::find(shader->files().begin(), shader->files().end(), changedFile) != shader->files().end();
+        });
+
+        if (usesChangedFile)
+        {
+            debugLog(std::format("ShaderWatcher: Reloading {}", shader->name()));
+            shader->reload();
+        }
+    }
+
+    bool swapped = false;
+    mStats.pendingReloads = 0;
+
+    for (Shader* shader : watchedShaders)
+    {
+        switch (shader->pollReload())
+        {
+            case Shader::ReloadStatus::Pending:
+                ++mStats.pendingReloads;
+                break;
+            case Shader::ReloadStatus::Swapped:
+                debugLog(std::format("ShaderWatcher: Reloaded {}", shader->name()));
+                ++mStats.reloads;
+                swapped = true;
+
+                if (mReloadCallback)
+                    mReloadCallback(*shader);
+                break;
+            case Shader::ReloadStatus::Failed:
+                ++mStats.failedReloads;
+                break;
+            case Shader::ReloadStatus::Idle:
+                break;
+        }
+    }
+
+    // a reload can add or drop includes
+    if (swapped)
+        updateWatchedFiles(watchedShaders);
+}
+
+void ShaderWatcher::setEnabled(bool enabled)
+{
+    mEnabled = enabled;
+}
+
+bool ShaderWatcher::enabled() const
+{
+    return mEnabled;
+}
+
+ShaderWatcher::Stats ShaderWatcher::stats() const
+{
+    Stats stats = mStats;
+
+    std::lock_guard<std::mutex> lock(mFileMutex);
+    stats.watchedFiles = static_cast<uint32_t>(mWatchedFiles.size());
+
+    return stats;
+}
+
+std::vector<Shader *> ShaderWatcher::shaders() const
+{
+    std::vector<Shader*> shaders = mShaders;
+
+    for (ShaderPermutations* shaderPermutations : mShaderPermutations)
+    {
+        std::vector<Shader*> programs = shaderPermutations->programs();
+        shaders.insert(shaders.end(), programs.begin(), programs.end());
+    }
+
+    return shaders;
+}
+
+void ShaderWatcher::updateWatchedFiles(const std::vector<Shader *> &shaders)
+{
+    std::vector<std::filesystem::path> watchedFiles;
+
+    for (Shader* shader : shaders)
+        for (const std::filesystem::path& file : shader->files())
+            if (std::find(watchedFiles.begin(), watchedFiles.end(), file) == watchedFiles.end())
+                watchedFiles.push_back(file);
+
+    mWatchedShaderCount = shaders.size();
+
+    std::lock_guard<std::mutex> lock(mFileMutex);
+    mWatchedFiles = std::move(watchedFiles);
+}
+
+// a file seen for the first time only has its write time recorded
+void ShaderWatcher::pollFiles()
+{
+    std::unique_lock<std::mutex> lock(mFileMutex);
+
+    while (!mStop)
+    {
+        std::vector<std::filesystem::path> watchedFiles = mWatchedFiles;
+        bool enabled = mEnabled;
+
+        lock.unlock();
+
+        std::vector<std::filesystem::path> changedFiles;
+
+        for (const std::filesystem::path& file : watchedFiles)
+        {
+            std::error_code errorCode;
+            std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(file, errorCode);
+
+            // editors that save by replacing the file leave it missing for a moment
+            if (errorCode)
+                continue;
+
+            auto [itr, inserted] = mWriteTimes.try_emplace(file.generic_string(), writeTime);
+
+            // while disabled the old write time stays, the edit gets picked up once enabled again
+            if (!inserted && itr->second != writeTime && enabled)
+            {
+                itr->second = writeTime;
+                changedFiles.push_back(file);
+            }
+        }
+
+        lock.lock();
+
+        mChangedFiles.insert(mChangedFiles.end(), changedFiles.begin(), changedFiles.end());
+        mStopCondition.wait_for(lock, sPollInterval, [this] () {return mStop;});
+    }
+}
@@ -0,0 +1,78 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_SHADER_WATCHER_HPP
+#define OPENGLRENDERINGENGINE_SHADER_WATCHER_HPP
+
+#include "shader_permutations.hpp"
+
+// Hot reloads shaders while the app runs. A thread polls the write times of every file the
+// watched programs were built from, includes too. Each frame the main thread drops the changed
+// files from the preprocessor's cache and has the programs using them reload, the driver
+// compiles those in the background and update() swaps them in on the frame they linked. A
+// program that fails to build keeps running, the errors go to the log.
+class ShaderWatcher
+{
+public:
+    struct Stats
+    {
+        uint32_t watchedFiles;
+        uint32_t pendingReloads;
+        // since startup
+        uint32_t reloads;
+        uint32_t failedReloads;
+    };
+
+public:
+    ShaderWatcher();
+    ~ShaderWatcher();
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    // the shaders have to outlive the watcher
+    void watch(Shader& shader);
+    // programs built later are watched too
+    void watch(ShaderPermutations& shaderPermutations);
+
+    // runs on a program the frame its reload is swapped in
+    void setReloadCallback(ProgramCallback callback);
+
+    // main thread, once per frame before anything draws
+    void update();
+
+    // edits made while disabled are reloaded once enabled again
+    void setEnabled(bool enabled);
+    bool enabled() const;
+
+    Stats stats() const;
+
+private:
+    std::vector<Shader*> shaders() const;
+    void updateWatchedFiles(const std::vector<Shader*>& shaders);
+    void pollFiles();
+
+private:
+    std::vector<Shader*> mShaders;
+    std::vector<ShaderPermutations*> mShaderPermutations;
+    size_t mWatchedShaderCount;
+    ProgramCallback mReloadCallback;
+
+    // shared with the polling thread
+    std::vector<std::filesystem::path> mWatchedFiles;
+    std::vector<std::filesystem::path> mChangedFiles;
+    mutable std::mutex mFileMutex;
+    std::condition_variable mStopCondition;
+    bool mStop;
+
+    // polling thread only
+    std::unordered_map<std::string, std::filesystem::file_time_type> mWriteTimes;
+
+    std::atomic<bool> mEnabled;
+    Stats mStats;
+
+    std::thread mPollThread;
+};
+
+#endif //OPENGLRENDERINGENGINE_SHADER_WATCHER_HPP
@@ -0,0 +1,91 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "state_cache.hpp"
+
+static constexpr uint32_t sUnknown = UINT32_MAX;
+
+static uint32_t sProgram = sUnknown;
+static uint32_t sVertexArray = sUnknown;
+static std::vector<uint32_t> sTextureUnits;
+static StateCache::Counters sCounters {};
+
+void StateCache::useProgram(uint32_t program)
+{
+    if (program == sProgram)
+    {
+        ++sCounters.programBindsSkipped;
+        return;
+    }
+
+    glUseProgram(program);
+    sProgram = program;
+    ++sCounters.programBinds;
+}
+
+void StateCache::bindVertexArray(uint32_t vertexArray)
+{
+    if (vertexArray == sVertexArray)
+    {
+        ++sCounters.vertexArrayBindsSkipped;
+        return;
+    }
+
+    glBindVertexArray(vertexArray);
+    sVertexArray = vertexArray;
+    ++sCounters.vertexArrayBinds;
+}
+
+void StateCache::bindTextureUnit(uint32_t unit, uint32_t texture)
+{
+    if (unit >= sTextureUnits.size())
+        sTextureUnits.resize(unit + 1, sUnknown);
+
+    if (sTextureUnits[unit] == texture)
+    {
+        ++sCounters.textureBindsSkipped;
+        return;
+    }
+
+    glBindTextureUnit(unit, texture);
+    sTextureUnits[unit] = texture;
+    ++sCounters.textureBinds;
+}
+
+// a deleted program stays in use until something else is bound, but its name can come back
+void StateCache::programDeleted(uint32_t program)
+{
+    if (program == sProgram)
+        sProgram = sUnknown;
+}
+
+void StateCache::vertexArrayDeleted(uint32_t vertexArray)
+{
+    if (vertexArray == sVertexArray)
+        sVertexArray = 0;
+}
+
+void StateCache::textureDeleted(uint32_t texture)
+{
+    for (uint32_t& boundTexture : sTextureUnits)
+        if (boundTexture == texture)
+            boundTexture = 0;
+}
+
+void StateCache::invalidate()
+{
+    sProgram = sUnknown;
+    sVertexArray = sUnknown;
+    std::fill(sTextureUnits.begin(), sTextureUnits.end(), sUnknown);
+}
+
+const StateCache::Counters &StateCache::counters()
+{
+    return sCounters;
+}
+
+void StateCache::resetCounters()
+{
+    sCounters = {};
+}
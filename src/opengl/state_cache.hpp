@@ -0,0 +1,41 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_STATE_CACHE_HPP
+#define OPENGLRENDERINGENGINE_STATE_CACHE_HPP
+
+#include <glad/glad.h>
+
+// Shadows the program, vertex array and per unit texture bindings made through the opengl
+// wrappers so that binding an object that is already bound doesn't reach the driver.
+// Code that changes these bindings with raw gl calls and doesn't restore them has to call
+// invalidate() afterwards. The imgui backend restores what it touches. Main thread only.
+namespace StateCache
+{
+    struct Counters
+    {
+        uint32_t programBinds;
+        uint32_t programBindsSkipped;
+        uint32_t vertexArrayBinds;
+        uint32_t vertexArrayBindsSkipped;
+        uint32_t textureBinds;
+        uint32_t textureBindsSkipped;
+    };
+
+    void useProgram(uint32_t program);
+    void bindVertexArray(uint32_t vertexArray);
+    void bindTextureUnit(uint32_t unit, uint32_t texture);
+
+    // deleting an object resets the bindings that referenced it, and the name may be reused
+    void programDeleted(uint32_t program);
+    void vertexArrayDeleted(uint32_t vertexArray);
+    void textureDeleted(uint32_t texture);
+
+    void invalidate();
+
+    const Counters& counters();
+    void resetCounters();
+}
+
+#endif //OPENGLRENDERINGENGINE_STATE_CACHE_HPP
@@ -3,6 +3,8 @@
 //
 
 #include "texture.hpp"
+#include "state_cache.hpp"
+#include "texture_container.hpp"
 
 #define ENUM_CASE(EnumType, value) \
     case EnumType::value: return #value;
@@ -20,10 +22,23 @@ GLenum toGLenumFormat(TextureFormat format)
         case TextureFormat::RG8: return GL_RG;
         case TextureFormat::RGB8: return GL_RGB;
         case TextureFormat::RGBA8: return GL_RGBA;
+        case TextureFormat::RGBA8_SRGB: return GL_RGBA;
         case TextureFormat::RGB32F: return GL_RGB;
         case TextureFormat::RGBA32F: return GL_RGBA;
+        case TextureFormat::R32F: return GL_RED;
         case TextureFormat::D32: return GL_DEPTH_COMPONENT;
         case TextureFormat::D24S8: return GL_DEPTH_STENCIL;
+        case TextureFormat::BC1: return GL_RGBA;
+        case TextureFormat::BC2: return GL_RGBA;
+        case TextureFormat::BC3: return GL_RGBA;
+        case TextureFormat::BC1_SRGB: return GL_RGBA;
+        case TextureFormat::BC2_SRGB: return GL_RGBA;
+        case TextureFormat::BC3_SRGB: return GL_RGBA;
+        case TextureFormat::BC4: return GL_RED;
+        case TextureFormat::BC5: return GL_RG;
+        case TextureFormat::BC6H: return GL_RGB;
+        case TextureFormat::BC7: return GL_RGBA;
+        case TextureFormat::BC7_SRGB: return GL_RGBA;
         default: assert(false);
     }
 }
@@ -36,10 +51,23 @@ GLenum toGLenumInternalFormat(TextureFormat format)
         case TextureFormat::RG8: return GL_RG8;
         case TextureFormat::RGB8: return GL_RGB8;
         case TextureFormat::RGBA8: return GL_RGBA8;
+        case TextureFormat::RGBA8_SRGB: return GL_SRGB8_ALPHA8;
         case TextureFormat::RGB32F: return GL_RGB32F;
         case TextureFormat::RGBA32F: return GL_RGBA32F;
+        case TextureFormat::R32F: return GL_R32F;
         case TextureFormat::D32: return GL_DEPTH_COMPONENT32;
         case TextureFormat::D24S8: return GL_DEPTH24_STENCIL8;
+        case TextureFormat::BC1: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case TextureFormat::BC2: return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+        case TextureFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case TextureFormat::BC1_SRGB: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+        case TextureFormat::BC2_SRGB: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+        case TextureFormat::BC3_SRGB: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+        case TextureFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+        case TextureFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+        case TextureFormat::BC6H: return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+        case TextureFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        case TextureFormat::BC7_SRGB: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
         default: assert(false);
     }
 }
@@ -98,10 +126,23 @@ const char* toStr(TextureFormat format)
         ENUM_CASE(TextureFormat, RG8)
         ENUM_CASE(TextureFormat, RGB8)
         ENUM_CASE(TextureFormat, RGBA8)
+        ENUM_CASE(TextureFormat, RGBA8_SRGB)
         ENUM_CASE(TextureFormat, RGB32F)
         ENUM_CASE(TextureFormat, RGBA32F)
+        ENUM_CASE(TextureFormat, R32F)
         ENUM_CASE(TextureFormat, D32)
         ENUM_CASE(TextureFormat, D24S8)
+        ENUM_CASE(TextureFormat, BC1)
+        ENUM_CASE(TextureFormat, BC2)
+        ENUM_CASE(TextureFormat, BC3)
+        ENUM_CASE(TextureFormat, BC1_SRGB)
+        ENUM_CASE(TextureFormat, BC2_SRGB)
+        ENUM_CASE(TextureFormat, BC3_SRGB)
+        ENUM_CASE(TextureFormat, BC4)
+        ENUM_CASE(TextureFormat, BC5)
+        ENUM_CASE(TextureFormat, BC6H)
+        ENUM_CASE(TextureFormat, BC7)
+        ENUM_CASE(TextureFormat, BC7_SRGB)
         default: return "Unknown";
     }
 }
@@ -146,10 +187,23 @@ TextureFormat getTextureFormat(const char* str)
     MAP_TEXTURE_FORMAT(str, RG8)
     MAP_TEXTURE_FORMAT(str, RGB8)
     MAP_TEXTURE_FORMAT(str, RGBA8)
+    MAP_TEXTURE_FORMAT(str, RGBA8_SRGB)
     MAP_TEXTURE_FORMAT(str, RGB32F)
     MAP_TEXTURE_FORMAT(str, RGBA32F)
+    MAP_TEXTURE_FORMAT(str, R32F)
     MAP_TEXTURE_FORMAT(str, D32)
     MAP_TEXTURE_FORMAT(str, D24S8)
+    MAP_TEXTURE_FORMAT(str, BC1)
+    MAP_TEXTURE_FORMAT(str, BC2)
+    MAP_TEXTURE_FORMAT(str, BC3)
+    MAP_TEXTURE_FORMAT(str, BC1_SRGB)
+    MAP_TEXTURE_FORMAT(str, BC2_SRGB)
+    MAP_TEXTURE_FORMAT(str, BC3_SRGB)
+    MAP_TEXTURE_FORMAT(str, BC4)
+    MAP_TEXTURE_FORMAT(str, BC5)
+    MAP_TEXTURE_FORMAT(str, BC6H)
+    MAP_TEXTURE_FORMAT(str, BC7)
+    MAP_TEXTURE_FORMAT(str, BC7_SRGB)
 
     throw std::invalid_argument("Invalid TextureFormat");
 }
@@ -197,11 +251,88 @@ int32_t getRequiredComponents(TextureFormat format)
         case TextureFormat::RGB8:
         case TextureFormat::RGB32F: return 3;
         case TextureFormat::RGBA8:
+        case TextureFormat::RGBA8_SRGB:
         case TextureFormat::RGBA32F: return 4;
         default: assert(false);
     }
 }
 
+bool isCompressed(TextureFormat format)
+{
+    return format == TextureFormat::BC1 || format == TextureFormat::BC2
+        || format == TextureFormat::BC3 || format == TextureFormat::BC1_SRGB
+        || format == TextureFormat::BC2_SRGB || format == TextureFormat::BC3_SRGB
+        || format == TextureFormat::BC4 || format == TextureFormat::BC5
+        || format == TextureFormat::BC6H || format == TextureFormat::BC7
+        || format == TextureFormat::BC7_SRGB;
+}
+
+size_t imageSize(TextureFormat format, int32_t width, int32_t height)
+{
+    size_t blockCount = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+    size_t texelCount = static_cast<size_t>(width) * height;
+
+    switch (format)
+    {
+        case TextureFormat::R8: return texelCount;
+        case TextureFormat::RG8: return texelCount * 2;
+        case TextureFormat::RGB8: return texelCount * 3;
+        case TextureFormat::RGBA8: return texelCount * 4;
+        case TextureFormat::RGBA8_SRGB: return texelCount * 4;
+        case TextureFormat::RGB32F: return texelCount * 12;
+        case TextureFormat::RGBA32F: return texelCount * 16;
+        case TextureFormat::R32F: return texelCount * 4;
+        case TextureFormat::D32: return texelCount * 4;
+        case TextureFormat::D24S8: return texelCount * 4;
+        case TextureFormat::BC1: return blockCount * 8;
+        case TextureFormat::BC2: return blockCount * 16;
+        case TextureFormat::BC3: return blockCount * 16;
+        case TextureFormat::BC1_SRGB: return blockCount * 8;
+        case TextureFormat::BC2_SRGB: return blockCount * 16;
+        case TextureFormat::BC3_SRGB: return blockCount * 16;
+        case TextureFormat::BC4: return blockCount * 8;
+        case TextureFormat::BC5: return blockCount * 16;
+        case TextureFormat::BC6H: return blockCount * 16;
+        case TextureFormat::BC7: return blockCount * 16;
+        case TextureFormat::BC7_SRGB: return blockCount * 16;
+        default: assert(false);
+    }
+}
+
+// every level the container holds, image i goes to array layer or cube face i
+static void uploadContainerImages(uint32_t textureID, const TextureSpecification& spec, const TextureContainer& container, bool layered)
+{
+    // the containers pack rows tightly
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (uint32_t level = 0; level < container.levelCount(); ++level)
+    {
+        int32_t width = container.levelWidth(level);
+        int32_t height = container.levelHeight(level);
+        GLsizei size = static_cast<GLsizei>(container.imageSize(level));
+
+        for (uint32_t image = 0; image < container.imageCount(); ++image)
+        {
+            const uint8_t* data = container.imageData(level, image);
+
+            if (isCompressed(spec.format) && layered)
+                glCompressedTextureSubImage3D(textureID, level, 0, 0, image, width, height, 1, toGLenumInternalFormat(spec.format), size, data);
+            else if (isCompressed(spec.format))
+                glCompressedTextureSubImage2D(textureID, level, 0, 0, width, height, toGLenumInternalFormat(spec.format), size, data);
+            else if (layered)
+                glTextureSubImage3D(textureID, level, 0, 0, image, width, height, 1, toGLenumFormat(spec.format), toGLenum(spec.dataType), data);
+            else
+                glTextureSubImage2D(textureID, level, 0, 0, width, height, toGLenumFormat(spec.format), toGLenum(spec.dataType), data);
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // storage always has the full chain, a partial one in the file limits sampling to the levels it has
+    if (container.levelCount() > 1 && container.levelCount() < calculateMipLevels(spec.width, spec.height))
+        glTextureParameteri(textureID, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(container.levelCount() - 1));
+}
+
 // -- ImageLoader -- //
 
 LoadedImage::LoadedImage()
@@ -234,6 +365,10 @@ LoadedImage::LoadedImage(const std::filesystem::path &imagePath, int32_t require
     if (!mData)
         return;
 
+    // stb reports the file's channel count, the data has the requested one
+    if (requiredComponents)
+        mComponents = requiredComponents;
+
     if (isHDR)
     {
         mDataType = TextureDataType::FLOAT;
@@ -355,6 +490,7 @@ Texture::Texture(const TextureSpecification &spec)
 
 Texture::~Texture()
 {
+    StateCache::textureDeleted(mRendererID);
     glDeleteTextures(1, &mRendererID);
 }
 
@@ -371,6 +507,7 @@ Texture &Texture::operator=(Texture &&other) noexcept
 {
     if (this != &other)
     {
+        StateCache::textureDeleted(mRendererID);
         glDeleteTextures(1, &mRendererID);
 
         mRendererID = other.mRendererID;
@@ -385,12 +522,23 @@ Texture &Texture::operator=(Texture &&other) noexcept
 
 void Texture::bind(uint32_t unit)
 {
-    glBindTextureUnit(unit, mRendererID);
+    StateCache::bindTextureUnit(unit, mRendererID);
 }
 
 void Texture::unbind(uint32_t unit)
 {
-    glBindTextureUnit(unit, 0);
+    StateCache::bindTextureUnit(unit, 0);
+}
+
+void Texture::bindImage(uint32_t unit, uint32_t mipLevel, GLenum access)
+{
+    glBindImageTexture(unit, mRendererID, mipLevel, GL_FALSE, 0, access, toGLenumInternalFormat(mSpecification.format));
+}
+
+void Texture::setDepthCompare(bool depthCompare)
+{
+    glTextureParameteri(mRendererID, GL_TEXTURE_COMPARE_MODE, depthCompare? GL_COMPARE_REF_TO_TEXTURE : GL_NONE);
+    glTextureParameteri(mRendererID, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
 }
 
 uint32_t Texture::id() const
@@ -433,6 +581,18 @@ bool Texture::mips() const
     return mSpecification.generateMipMaps;
 }
 
+const TextureSpecification &Texture::specification() const
+{
+    return mSpecification;
+}
+
+uint32_t Texture::mipLevelCount() const
+{
+    if (mSpecification.generateMipMaps)
+        return calculateMipLevels(mSpecification.width, mSpecification.height);
+    return 1;
+}
+
 // -- Texture2D -- //
 
 Texture2D::Texture2D(const TextureSpecification &spec)
@@ -467,16 +627,83 @@ Texture2D::Texture2D(const TextureSpecification &spec, const std::string &textur
         glGenerateTextureMipmap(mRendererID);
 }
 
+Texture2D::Texture2D(const TextureSpecification &spec, const std::vector<TextureMip> &mips)
+    : Texture(spec)
+{
+    create();
+
+    check(mips.size() == mipLevelCount(), "Texture2D: The mip chain doesn't match the texture.");
+
+    // rows of uncompressed rgb mips aren't 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (uint32_t level = 0; level < mips.size(); ++level)
+    {
+        const TextureMip& mip = mips.at(level);
+        uploadMip(level, mip.width, mip.height, mip.data.data(), mip.data.size());
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+Texture2D::Texture2D(const TextureSpecification &spec, const TextureContainer &container)
+    : Texture(spec)
+{
+    check(container.success() && container.imageCount() == 1, "Texture2D: The container doesn't hold a single 2D image.");
+
+    create();
+    uploadContainerImages(mRendererID, mSpecification, container, false);
+}
+
 void Texture2D::resize(int32_t width, int32_t height)
 {
     mSpecification.width = width;
     mSpecification.height = height;
 
+    StateCache::textureDeleted(mRendererID);
     glDeleteTextures(1, &mRendererID);
 
     create();
 }
 
+void Texture2D::uploadMip(uint32_t level, int32_t width, int32_t height, const void *data, size_t size)
+{
+    if (isCompressed(mSpecification.format))
+    {
+        glCompressedTextureSubImage2D(mRendererID,
+                                      level,
+                                      0, 0,
+                                      width,
+                                      height,
+                                      toGLenumInternalFormat(mSpecification.format),
+                                      static_cast<GLsizei>(size),
+                                      data);
+    }
+    else
+    {
+        glTextureSubImage2D(mRendererID,
+                            level,
+                            0, 0,
+                            width,
+                            height,
+                            toGLenumFormat(mSpecification.format),
+                            toGLenum(mSpecification.dataType),
+                            data);
+    }
+}
+
+void Texture2D::copyMips(const Texture2D &source, uint32_t sourceLevel, uint32_t level, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        glCopyImageSubData(source.id(), GL_TEXTURE_2D, sourceLevel + i, 0, 0, 0,
+                           mRendererID, GL_TEXTURE_2D, level + i, 0, 0, 0,
+                           glm::max(source.width() >> (sourceLevel + i), 1),
+                           glm::max(source.height() >> (sourceLevel + i), 1),
+                           1);
+    }
+}
+
 void Texture2D::create()
 {
     glCreateTextures(GL_TEXTURE_2D, 1, &mRendererID);
@@ -532,6 +759,7 @@ void Texture2DMultisample::resize(int32_t width, int32_t height)
     mSpecification.width = width;
     mSpecification.height = height;
 
+    StateCache::textureDeleted(mRendererID);
     glDeleteTextures(1, &mRendererID);
 
     create();
@@ -548,6 +776,50 @@ void Texture2DMultisample::create()
                                   GL_FALSE);
 }
 
+// -- Texture2DArray -- //
+
+Texture2DArray::Texture2DArray(const TextureSpecification &spec, int32_t layerCount)
+    : Texture(spec)
+    , mLayerCount(layerCount)
+{
+    create();
+}
+
+Texture2DArray::Texture2DArray(const TextureSpecification &spec, const TextureContainer &container)
+    : Texture(spec)
+    , mLayerCount(static_cast<int32_t>(container.layerCount()))
+{
+    check(container.success() && container.faceCount() == 1, "Texture2DArray: The container doesn't hold a 2D array.");
+
+    create();
+    uploadContainerImages(mRendererID, mSpecification, container, true);
+}
+
+int32_t Texture2DArray::layerCount() const
+{
+    return mLayerCount;
+}
+
+void Texture2DArray::create()
+{
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &mRendererID);
+    glTextureParameteri(mRendererID, GL_TEXTURE_WRAP_S, toGLenum(mSpecification.wrapMode));
+    glTextureParameteri(mRendererID, GL_TEXTURE_WRAP_T, toGLenum(mSpecification.wrapMode));
+    glTextureParameteri(mRendererID, GL_TEXTURE_MIN_FILTER, toGLenumMinFilter(mSpecification.filterMode));
+    glTextureParameteri(mRendererID, GL_TEXTURE_MAG_FILTER, toGLenumMagFilter(mSpecification.filterMode));
+
+    uint32_t mipLevels = 1;
+    if (mSpecification.generateMipMaps)
+        mipLevels = calculateMipLevels(mSpecification.width, mSpecification.height);
+
+    glTextureStorage3D(mRendererID,
+                       mipLevels,
+                       toGLenumInternalFormat(mSpecification.format),
+                       mSpecification.width,
+                       mSpecification.height,
+                       mLayerCount);
+}
+
 // -- TextureCube -- //
 
 TextureCube::TextureCube(const TextureSpecification &spec)
@@ -586,6 +858,15 @@ TextureCube::TextureCube(const TextureSpecification &spec, const std::array<std:
         glGenerateTextureMipmap(mRendererID);
 }
 
+TextureCube::TextureCube(const TextureSpecification &spec, const TextureContainer &container)
+    : Texture(spec)
+{
+    check(container.success() && container.faceCount() == 6 && container.layerCount() == 1, "TextureCube: The container doesn't hold a single cube map.");
+
+    create();
+    uploadContainerImages(mRendererID, mSpecification, container, true);
+}
+
 void TextureCube::create()
 {
     glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &mRendererID);
@@ -602,7 +883,7 @@ void TextureCube::create()
         glTextureParameterf(mRendererID, GL_TEXTURE_MAX_ANISOTROPY, glm::max(16.f, maxAnisotropy));
     }
 
-    uint32_t mipLevels = 0;
+    uint32_t mipLevels = 1;
     if (mSpecification.generateMipMaps)
         mipLevels = calculateMipLevels(mSpecification.width, mSpecification.height);
 
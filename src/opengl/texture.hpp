@@ -16,10 +16,23 @@ enum class TextureFormat
     RG8,
     RGB8,
     RGBA8,
+    RGBA8_SRGB,
     RGB32F,
     RGBA32F,
+    R32F,
     D32,
-    D24S8
+    D24S8,
+    BC1,
+    BC2,
+    BC3,
+    BC1_SRGB,
+    BC2_SRGB,
+    BC3_SRGB,
+    BC4,
+    BC5,
+    BC6H,
+    BC7,
+    BC7_SRGB
 };
 
 enum class TextureDataType
@@ -55,6 +68,14 @@ struct TextureSpecification
     bool generateMipMaps;
 };
 
+// one level of a texture with precomputed mips, tightly packed or in 4x4 blocks
+struct TextureMip
+{
+    int32_t width;
+    int32_t height;
+    std::vector<uint8_t> data;
+};
+
 GLenum toGLenumFormat(TextureFormat format);
 GLenum toGLenumInternalFormat(TextureFormat format);
 GLenum toGLenum(TextureDataType dataType);
@@ -76,6 +97,13 @@ uint32_t calculateMipLevels(int32_t textureWidth, int32_t textureHeight);
 
 int32_t getRequiredComponents(TextureFormat format);
 
+// block compressed formats store 4x4 texel blocks
+bool isCompressed(TextureFormat format);
+// bytes of one mip level, partial blocks at the edges count as whole blocks
+size_t imageSize(TextureFormat format, int32_t width, int32_t height);
+
+class TextureContainer;
+
 class LoadedImage
 {
 public:
@@ -126,6 +154,10 @@ public:
 
     void bind(uint32_t unit);
     void unbind(uint32_t unit);
+    void bindImage(uint32_t unit, uint32_t mipLevel, GLenum access);
+
+    // depth formats only, turns texture() on a shadow sampler into a depth comparison
+    void setDepthCompare(bool depthCompare);
 
     uint32_t id() const;
     int32_t width() const;
@@ -135,6 +167,8 @@ public:
     TextureWrap wrapMode() const;
     TextureFilter filterMode() const;
     bool mips() const;
+    uint32_t mipLevelCount() const;
+    const TextureSpecification& specification() const;
 
 protected:
     uint32_t mRendererID;
@@ -148,9 +182,17 @@ public:
     Texture2D(const TextureSpecification& spec);
     Texture2D(const TextureSpecification& spec, const void* textureData);
     Texture2D(const TextureSpecification& spec, const std::string& texturePath);
+    // the full mip chain when the specification asks for mips, otherwise just the base level
+    Texture2D(const TextureSpecification& spec, const std::vector<TextureMip>& mips);
+    Texture2D(const TextureSpecification& spec, const TextureContainer& container);
 
     void resize(int32_t width, int32_t height);
 
+    // one level, tightly packed or in 4x4 blocks
+    void uploadMip(uint32_t level, int32_t width, int32_t height, const void* data, size_t size);
+    // copies count levels of the same format, starting at sourceLevel in source and level in this texture
+    void copyMips(const Texture2D& source, uint32_t sourceLevel, uint32_t level, uint32_t count);
+
 private:
     void create();
     void uploadTextureData(const void* textureData);
@@ -169,6 +211,22 @@ private:
     int32_t mSampleCount;
 };
 
+class Texture2DArray : public Texture
+{
+public:
+    Texture2DArray() = default;
+    Texture2DArray(const TextureSpecification& spec, int32_t layerCount);
+    Texture2DArray(const TextureSpecification& spec, const TextureContainer& container);
+
+    int32_t layerCount() const;
+
+private:
+    void create();
+
+private:
+    int32_t mLayerCount;
+};
+
 class TextureCube : public Texture
 {
 public:
@@ -176,6 +234,7 @@ public:
     TextureCube(const TextureSpecification& spec);
     TextureCube(const TextureSpecification& spec, const void** textureData);
     TextureCube(const TextureSpecification& spec, const std::array<std::string, 6>& texturePaths);
+    TextureCube(const TextureSpecification& spec, const TextureContainer& container);
 
 private:
     void create();
@@ -0,0 +1,548 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "texture_container.hpp"
+
+// -- KTX2 -- //
+
+static constexpr std::array<uint8_t, 12> sKTX2Identifier {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+struct KTX2Header
+{
+    std::array<uint8_t, 12> identifier;
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct KTX2LevelIndex
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+static_assert(sizeof(KTX2Header) == 80);
+static_assert(sizeof(KTX2LevelIndex) == 24);
+
+enum KTX2Supercompression : uint32_t
+{
+    KTX2_SUPERCOMPRESSION_NONE = 0,
+    KTX2_SUPERCOMPRESSION_BASISLZ = 1,
+    KTX2_SUPERCOMPRESSION_ZSTD = 2,
+    KTX2_SUPERCOMPRESSION_ZLIB = 3
+};
+
+static std::optional<TextureFormat> ktx2Format(uint32_t vkFormat)
+{
+    switch (vkFormat)
+    {
+        case 9: return TextureFormat::R8; // VK_FORMAT_R8_UNORM
+        case 16: return TextureFormat::RG8; // VK_FORMAT_R8G8_UNORM
+        case 23: return TextureFormat::RGB8; // VK_FORMAT_R8G8B8_UNORM
+        case 37: return TextureFormat::RGBA8; // VK_FORMAT_R8G8B8A8_UNORM
+        case 43: return TextureFormat::RGBA8_SRGB; // VK_FORMAT_R8G8B8A8_SRGB
+        case 100: return TextureFormat::R32F; // VK_FORMAT_R32_SFLOAT
+        case 106: return TextureFormat::RGB32F; // VK_FORMAT_R32G32B32_SFLOAT
+        case 109: return TextureFormat::RGBA32F; // VK_FORMAT_R32G32B32A32_SFLOAT
+        case 131: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+        case 133: return TextureFormat::BC1; // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+        case 132: // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+        case 134: return TextureFormat::BC1_SRGB; // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+        case 135: return TextureFormat::BC2; // VK_FORMAT_BC2_UNORM_BLOCK
+        case 136: return TextureFormat::BC2_SRGB; // VK_FORMAT_BC2_SRGB_BLOCK
+        case 137: return TextureFormat::BC3; // VK_FORMAT_BC3_UNORM_BLOCK
+        case 138: return TextureFormat::BC3_SRGB; // VK_FORMAT_BC3_SRGB_BLOCK
+        case 139: return TextureFormat::BC4; // VK_FORMAT_BC4_UNORM_BLOCK
+        case 141: return TextureFormat::BC5; // VK_FORMAT_BC5_UNORM_BLOCK
+        case 143: return TextureFormat::BC6H; // VK_FORMAT_BC6H_UFLOAT_BLOCK
+        case 145: return TextureFormat::BC7; // VK_FORMAT_BC7_UNORM_BLOCK
+        case 146: return TextureFormat::BC7_SRGB; // VK_FORMAT_BC7_SRGB_BLOCK
+        default: return {};
+    }
+}
+
+// -- DDS -- //
+
+static constexpr uint32_t makeFourCC(char a, char b, char c, char d)
+{
+    return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8 | static_cast<uint32_t>(c) << 16 | static_cast<uint32_t>(d) << 24;
+}
+
+static constexpr uint32_t sDDSMagic = makeFourCC('D', 'D', 'S', ' ');
+
+static constexpr uint32_t sDDSFlagMipMapCount = 0x20000;
+static constexpr uint32_t sDDSPixelFormatFourCC = 0x4;
+static constexpr uint32_t sDDSPixelFormatRGB = 0x40;
+static constexpr uint32_t sDDSCaps2Cubemap = 0x200;
+static constexpr uint32_t sDDSCaps2Volume = 0x200000;
+static constexpr uint32_t sDDSMiscTextureCube = 0x4;
+static constexpr uint32_t sDDSDimensionTexture2D = 3;
+
+struct DDSPixelFormat
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask;
+    uint32_t gBitMask;
+    uint32_t bBitMask;
+    uint32_t aBitMask;
+};
+
+struct DDSHeader
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DDSPixelFormat pixelFormat;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+struct DDSHeaderDX10
+{
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DDSHeader) == 124);
+static_assert(sizeof(DDSHeaderDX10) == 20);
+
+static std::optional<TextureFormat> dxgiFormat(uint32_t format)
+{
+    switch (format)
+    {
+        case 2: return TextureFormat::RGBA32F; // DXGI_FORMAT_R32G32B32A32_FLOAT
+        case 6: return TextureFormat::RGB32F; // DXGI_FORMAT_R32G32B32_FLOAT
+        case 28: return TextureFormat::RGBA8; // DXGI_FORMAT_R8G8B8A8_UNORM
+        case 29: return TextureFormat::RGBA8_SRGB; // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+        case 41: return TextureFormat::R32F; // DXGI_FORMAT_R32_FLOAT
+        case 49: return TextureFormat::RG8; // DXGI_FORMAT_R8G8_UNORM
+        case 61: return TextureFormat::R8; // DXGI_FORMAT_R8_UNORM
+        case 71: return TextureFormat::BC1; // DXGI_FORMAT_BC1_UNORM
+        case 72: return TextureFormat::BC1_SRGB; // DXGI_FORMAT_BC1_UNORM_SRGB
+        case 74: return TextureFormat::BC2; // DXGI_FORMAT_BC2_UNORM
+        case 75: return TextureFormat::BC2_SRGB; // DXGI_FORMAT_BC2_UNORM_SRGB
+        case 77: return TextureFormat::BC3; // DXGI_FORMAT_BC3_UNORM
+        case 78: return TextureFormat::BC3_SRGB; // DXGI_FORMAT_BC3_UNORM_SRGB
+        case 80: return TextureFormat::BC4; // DXGI_FORMAT_BC4_UNORM
+        case 83: return TextureFormat::BC5; // DXGI_FORMAT_BC5_UNORM
+        case 95: return TextureFormat::BC6H; // DXGI_FORMAT_BC6H_UF16
+        case 98: return TextureFormat::BC7; // DXGI_FORMAT_BC7_UNORM
+        case 99: return TextureFormat::BC7_SRGB; // DXGI_FORMAT_BC7_UNORM_SRGB
+        default: return {};
+    }
+}
+
+// files written without the dx10 header
+static std::optional<TextureFormat> ddsLegacyFormat(const DDSPixelFormat& pixelFormat)
+{
+    if (pixelFormat.flags & sDDSPixelFormatFourCC)
+    {
+        switch (pixelFormat.fourCC)
+        {
+            case makeFourCC('D', 'X', 'T', '1'): return TextureFormat::BC1;
+            case makeFourCC('D', 'X', 'T', '3'): return TextureFormat::BC2;
+            case makeFourCC('D', 'X', 'T', '5'): return TextureFormat::BC3;
+            case makeFourCC('A', 'T', 'I', '1'):
+            case makeFourCC('B', 'C', '4', 'U'): return TextureFormat::BC4;
+            case makeFourCC('A', 'T', 'I', '2'):
+            case makeFourCC('B', 'C', '5', 'U'): return TextureFormat::BC5;
+            case 114: return TextureFormat::R32F; // D3DFMT_R32F
+            case 116: return TextureFormat::RGBA32F; // D3DFMT_A32B32G32R32F
+            default: return {};
+        }
+    }
+
+    if ((pixelFormat.flags & sDDSPixelFormatRGB) && pixelFormat.rgbBitCount == 32 &&
+        pixelFormat.rBitMask == 0x000000FF && pixelFormat.gBitMask == 0x0000FF00 && pixelFormat.bBitMask == 0x00FF0000)
+        return TextureFormat::RGBA8;
+
+    return {};
+}
+
+static TextureDataType dataTypeOf(TextureFormat format)
+{
+    switch (format)
+    {
+        case TextureFormat::R32F:
+        case TextureFormat::RGB32F:
+        case TextureFormat::RGBA32F: return TextureDataType::FLOAT;
+        default: return TextureDataType::UINT8;
+    }
+}
+
+// -- TextureContainer -- //
+
+TextureContainer::TextureContainer(const std::filesystem::path &path)
+    : mPath(path)
+    , mSuccess()
+    , mFile(INVALID_HANDLE_VALUE)
+    , mMapping()
+    , mData()
+    , mSize()
+    , mWidth()
+    , mHeight()
+    , mFormat()
+    , mDataType()
+    , mLevelCount()
+    , mLayerCount()
+    , mFaceCount()
+{
+    if (!map())
+        return;
+
+    if (fileExtension(path) == ".ktx2")
+        mSuccess = parseKTX2();
+    else if (fileExtension(path) == ".dds")
+        mSuccess = parseDDS();
+    else
+        fail("Unknown container.");
+
+    if (!mSuccess)
+        unmap();
+}
+
+TextureContainer::~TextureContainer()
+{
+    unmap();
+}
+
+bool TextureContainer::supported(const std::filesystem::path &path)
+{
+    std::string extension = fileExtension(path);
+    return extension == ".ktx2" || extension == ".dds";
+}
+
+TextureSpecification TextureContainer::specification(TextureWrap wrapMode, TextureFilter filterMode) const
+{
+    if (mLevelCount == 1 && (filterMode == TextureFilter::Trilinear || filterMode == TextureFilter::Anisotropic))
+        filterMode = TextureFilter::Bilinear;
+
+    return {
+        .width = mWidth,
+        .height = mHeight,
+        .format = mFormat,
+        .dataType = mDataType,
+        .wrapMode = wrapMode,
+        .filterMode = filterMode,
+        .generateMipMaps = mLevelCount > 1
+    };
+}
+
+const std::filesystem::path &TextureContainer::path() const
+{
+    return mPath;
+}
+
+bool TextureContainer::success() const
+{
+    return mSuccess;
+}
+
+int32_t TextureContainer::width() const
+{
+    return mWidth;
+}
+
+int32_t TextureContainer::height() const
+{
+    return mHeight;
+}
+
+TextureFormat TextureContainer::format() const
+{
+    return mFormat;
+}
+
+TextureDataType TextureContainer::dataType() const
+{
+    return mDataType;
+}
+
+uint32_t TextureContainer::levelCount() const
+{
+    return mLevelCount;
+}
+
+uint32_t TextureContainer::layerCount() const
+{
+    return mLayerCount;
+}
+
+uint32_t TextureContainer::faceCount() const
+{
+    return mFaceCount;
+}
+
+uint32_t TextureContainer::imageCount() const
+{
+    return mLayerCount * mFaceCount;
+}
+
+const uint8_t *TextureContainer::imageData(uint32_t level, uint32_t image) const
+{
+    return mImages.at(level * imageCount() + image);
+}
+
+size_t TextureContainer::imageSize(uint32_t level) const
+{
+    return ::imageSize(mFormat, levelWidth(level), levelHeight(level));
+}
+
+int32_t TextureContainer::levelWidth(uint32_t level) const
+{
+    return glm::max(mWidth >> level, 1);
+}
+
+int32_t TextureContainer::levelHeight(uint32_t level) const
+{
+    return glm::max(mHeight >> level, 1);
+}
+
+bool TextureContainer::map()
+{
+    mFile = CreateFileW(mPath.wstring().c_str(),
+                        GENERIC_READ,
+                        FILE_SHARE_READ,
+                        nullptr,
+                        OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                        nullptr);
+
+    if (mFile == INVALID_HANDLE_VALUE)
+        return fail("Failed to open the file.");
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart == 0)
+        return fail("Empty file.");
+
+    mSize = static_cast<size_t>(fileSize.QuadPart);
+
+    mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mMapping)
+        return fail("Failed to create the file mapping.");
+
+    mData = static_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    if (!mData)
+        return fail("Failed to map the file.");
+
+    return true;
+}
+
+void TextureContainer::unmap()
+{
+    if (mData)
+        UnmapViewOfFile(mData);
+
+    if (mMapping)
+        CloseHandle(mMapping);
+
+    if (mFile != INVALID_HANDLE_VALUE)
+        CloseHandle(mFile);
+
+    mData = nullptr;
+    mMapping = nullptr;
+    mFile = INVALID_HANDLE_VALUE;
+    mImages.clear();
+}
+
+// levels run from the base level down. A level holds its layers and faces back to back and is
+// compressed as a whole when the file is supercompressed
+bool TextureContainer::parseKTX2()
+{
+    if (mSize < sizeof(KTX2Header))
+        return fail("Truncated header.");
+
+    KTX2Header header;
+    std::memcpy(&header, mData, sizeof(KTX2Header));
+
+    if (header.identifier != sKTX2Identifier)
+        return fail("Not a KTX2 file.");
+
+    if (header.pixelDepth > 1 || header.pixelHeight == 0)
+        return fail("Only 2D textures are supported.");
+
+    if (header.faceCount != 1 && header.faceCount != 6)
+        return fail("Invalid face count.");
+
+    switch (header.supercompressionScheme)
+    {
+        case KTX2_SUPERCOMPRESSION_NONE:
+        case KTX2_SUPERCOMPRESSION_ZLIB: break;
+        case KTX2_SUPERCOMPRESSION_BASISLZ: return fail("BasisLZ supercompression isn't supported.");
+        case KTX2_SUPERCOMPRESSION_ZSTD: return fail("Zstandard supercompression isn't supported.");
+        default: return fail(std::format("Unknown supercompression scheme {}.", header.supercompressionScheme));
+    }
+
+    std::optional<TextureFormat> format = ktx2Format(header.vkFormat);
+    if (!format)
+        return fail(std::format("Unsupported VkFormat {}.", header.vkFormat));
+
+    mWidth = static_cast<int32_t>(header.pixelWidth);
+    mHeight = static_cast<int32_t>(header.pixelHeight);
+    mFormat = *format;
+    mDataType = dataTypeOf(mFormat);
+    // zero means the mips are left to the loader, the base level is all there is
+    mLevelCount = glm::max(header.levelCount, 1u);
+    mLayerCount = glm::max(header.layerCount, 1u);
+    mFaceCount = header.faceCount;
+
+    if (mLevelCount > calculateMipLevels(mWidth, mHeight))
+        return fail("Too many mip levels.");
+
+    if (mSize < sizeof(KTX2Header) + mLevelCount * sizeof(KTX2LevelIndex))
+        return fail("Truncated level index.");
+
+    mImages.resize(mLevelCount * imageCount());
+
+    for (uint32_t level = 0; level < mLevelCount; ++level)
+    {
+        KTX2LevelIndex levelIndex;
+        std::memcpy(&levelIndex, mData + sizeof(KTX2Header) + level * sizeof(KTX2LevelIndex), sizeof(KTX2LevelIndex));
+
+        if (levelIndex.byteOffset > mSize || levelIndex.byteLength > mSize - levelIndex.byteOffset)
+            return fail(std::format("Level {} lies outside the file.", level));
+
+        size_t levelSize = imageSize(level) * imageCount();
+        const uint8_t* levelData = mData + levelIndex.byteOffset;
+
+        if (header.supercompressionScheme == KTX2_SUPERCOMPRESSION_ZLIB)
+        {
+            if (levelIndex.uncompressedByteLength < levelSize)
+                return fail(std::format("Level {} is too small.", level));
+
+            std::vector<uint8_t>& inflated = mInflatedLevels.emplace_back(levelIndex.uncompressedByteLength);
+
+            int32_t inflatedSize = stbi_zlib_decode_buffer(reinterpret_cast<char*>(inflated.data()),
+                                                           static_cast<int32_t>(inflated.size()),
+                                                           reinterpret_cast<const char*>(levelData),
+                                                           static_cast<int32_t>(levelIndex.byteLength));
+
+            if (inflatedSize < static_cast<int32_t>(levelSize))
+                return fail(std::format("Failed to inflate level {}.", level));
+
+            levelData = inflated.data();
+        }
+        else if (levelIndex.byteLength < levelSize)
+        {
+            return fail(std::format("Level {} is too small.", level));
+        }
+
+        for (uint32_t image = 0; image < imageCount(); ++image)
+            mImages.at(level * imageCount() + image) = levelData + image * imageSize(level);
+    }
+
+    return true;
+}
+
+// images run one after the other, each with its full mip chain
+bool TextureContainer::parseDDS()
+{
+    size_t offset = sizeof(uint32_t) + sizeof(DDSHeader);
+
+    if (mSize < offset)
+        return fail("Truncated header.");
+
+    uint32_t magic;
+    std::memcpy(&magic, mData, sizeof(uint32_t));
+
+    if (magic != sDDSMagic)
+        return fail("Not a DDS file.");
+
+    DDSHeader header;
+    std::memcpy(&header, mData + sizeof(uint32_t), sizeof(DDSHeader));
+
+    if (header.caps2 & sDDSCaps2Volume)
+        return fail("Only 2D textures are supported.");
+
+    std::optional<TextureFormat> format;
+    mLayerCount = 1;
+    mFaceCount = (header.caps2 & sDDSCaps2Cubemap)? 6 : 1;
+
+    if ((header.pixelFormat.flags & sDDSPixelFormatFourCC) && header.pixelFormat.fourCC == makeFourCC('D', 'X', '1', '0'))
+    {
+        if (mSize < offset + sizeof(DDSHeaderDX10))
+            return fail("Truncated DX10 header.");
+
+        DDSHeaderDX10 headerDX10;
+        std::memcpy(&headerDX10, mData + offset, sizeof(DDSHeaderDX10));
+        offset += sizeof(DDSHeaderDX10);
+
+        if (headerDX10.resourceDimension != sDDSDimensionTexture2D)
+            return fail("Only 2D textures are supported.");
+
+        format = dxgiFormat(headerDX10.dxgiFormat);
+        if (!format)
+            return fail(std::format("Unsupported DXGI format {}.", headerDX10.dxgiFormat));
+
+        mLayerCount = glm::max(headerDX10.arraySize, 1u);
+        mFaceCount = (headerDX10.miscFlag & sDDSMiscTextureCube)? 6 : 1;
+    }
+    else
+    {
+        format = ddsLegacyFormat(header.pixelFormat);
+        if (!format)
+            return fail("Unsupported pixel format.");
+    }
+
+    mWidth = static_cast<int32_t>(header.width);
+    mHeight = static_cast<int32_t>(header.height);
+    mFormat = *format;
+    mDataType = dataTypeOf(mFormat);
+    mLevelCount = (header.flags & sDDSFlagMipMapCount)? glm::max(header.mipMapCount, 1u) : 1;
+
+    if (mWidth == 0 || mHeight == 0)
+        return fail("Empty texture.");
+
+    if (mLevelCount > calculateMipLevels(mWidth, mHeight))
+        return fail("Too many mip levels.");
+
+    mImages.resize(mLevelCount * imageCount());
+
+    for (uint32_t image = 0; image < imageCount(); ++image)
+    {
+        for (uint32_t level = 0; level < mLevelCount; ++level)
+        {
+            if (imageSize(level) > mSize - offset)
+                return fail("Truncated image data.");
+
+            mImages.at(level * imageCount() + image) = mData + offset;
+            offset += imageSize(level);
+        }
+    }
+
+    return true;
+}
+
+bool TextureContainer::fail(const std::string &reason)
+{
+    debugLog(std::format("TextureContainer: Failed to load {}: {}", mPath.string(), reason), LogSeverity::Error);
+    return false;
+}
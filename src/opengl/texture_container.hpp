@@ -0,0 +1,78 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_TEXTURE_CONTAINER_HPP
+#define OPENGLRENDERINGENGINE_TEXTURE_CONTAINER_HPP
+
+#include "texture.hpp"
+
+// A KTX2 or DDS file mapped into memory. Every mip of every layer and cube face is addressed in
+// place, so the textures upload straight from the mapping without decoding anything.
+// Zlib supercompressed KTX2 levels are the exception, they get inflated into memory on load.
+// BasisLZ and Zstandard need decoders this build doesn't have and fail to load.
+// Opening and parsing doesn't need a GL context and can run on a worker thread.
+class TextureContainer
+{
+public:
+    TextureContainer(const std::filesystem::path& path);
+    ~TextureContainer();
+
+    TextureContainer(const TextureContainer&) = delete;
+    TextureContainer& operator=(const TextureContainer&) = delete;
+
+    // ktx2 and dds
+    static bool supported(const std::filesystem::path& path);
+
+    // filters that need mips fall back to bilinear for single level files
+    TextureSpecification specification(TextureWrap wrapMode, TextureFilter filterMode) const;
+
+    const std::filesystem::path& path() const;
+    bool success() const;
+    int32_t width() const;
+    int32_t height() const;
+    TextureFormat format() const;
+    TextureDataType dataType() const;
+    uint32_t levelCount() const;
+    uint32_t layerCount() const;
+    uint32_t faceCount() const;
+    // layers times faces
+    uint32_t imageCount() const;
+
+    // image is layer * faceCount() + face
+    const uint8_t* imageData(uint32_t level, uint32_t image) const;
+    size_t imageSize(uint32_t level) const;
+    int32_t levelWidth(uint32_t level) const;
+    int32_t levelHeight(uint32_t level) const;
+
+private:
+    bool map();
+    void unmap();
+
+    bool parseKTX2();
+    bool parseDDS();
+    bool fail(const std::string& reason);
+
+private:
+    std::filesystem::path mPath;
+    bool mSuccess;
+
+    HANDLE mFile;
+    HANDLE mMapping;
+    const uint8_t* mData;
+    size_t mSize;
+
+    int32_t mWidth;
+    int32_t mHeight;
+    TextureFormat mFormat;
+    TextureDataType mDataType;
+    uint32_t mLevelCount;
+    uint32_t mLayerCount;
+    uint32_t mFaceCount;
+
+    // level * imageCount() + image
+    std::vector<const uint8_t*> mImages;
+    std::vector<std::vector<uint8_t>> mInflatedLevels;
+};
+
+#endif //OPENGLRENDERINGENGINE_TEXTURE_CONTAINER_HPP
@@ -0,0 +1,122 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "uniform_ring_buffer.hpp"
+
+static constexpr GLbitfield sMapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+// a second per wait before logging, the gpu is hung or very far behind by then
+static constexpr uint64_t sFenceTimeout = 1'000'000'000;
+
+static uint32_t uniformOffsetAlignment()
+{
+    int32_t alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return static_cast<uint32_t>(std::max(alignment, 1));
+}
+
+static uint32_t alignUp(uint32_t value, uint32_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+UniformRingBuffer::UniformRingBuffer(uint32_t frameSize)
+    : mRendererID()
+    , mData()
+    , mAlignment(uniformOffsetAlignment())
+    , mFences()
+    , mFrame()
+    , mOffset()
+    , mAllocationCount()
+    , mStats()
+{
+    // every region starts aligned
+    mFrameSize = alignUp(frameSize, mAlignment);
+
+    glCreateBuffers(1, &mRendererID);
+    glNamedBufferStorage(mRendererID, mFrameSize * FrameCount, nullptr, sMapFlags);
+    mData = static_cast<uint8_t*>(glMapNamedBufferRange(mRendererID, 0, mFrameSize * FrameCount, sMapFlags));
+
+    check(mData, "UniformRingBuffer: Failed to map the buffer.");
+
+    mStats.frameSize = mFrameSize;
+}
+
+UniformRingBuffer::~UniformRingBuffer()
+{
+    for (GLsync fence : mFences)
+        glDeleteSync(fence);
+
+    glUnmapNamedBuffer(mRendererID);
+    glDeleteBuffers(1, &mRendererID);
+}
+
+void UniformRingBuffer::beginFrame()
+{
+    GLsync& fence = mFences.at(mFrame);
+
+    if (fence)
+    {
+        GLenum status = glClientWaitSync(fence, 0, 0);
+
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        {
+            ++mStats.fenceWaits;
+
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, sFenceTimeout) == GL_TIMEOUT_EXPIRED)
+                debugLog("UniformRingBuffer: Still waiting for the gpu to release a frame.", LogSeverity::Warning);
+        }
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    mOffset = 0;
+    mAllocationCount = 0;
+}
+
+void UniformRingBuffer::endFrame()
+{
+    mFences.at(mFrame) = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    mStats.usedBytes = mOffset;
+    mStats.allocationCount = mAllocationCount;
+
+    mFrame = (mFrame + 1) % FrameCount;
+}
+
+UniformRingBuffer::Allocation UniformRingBuffer::write(const void *data, uint32_t size)
+{
+    uint32_t alignedSize = alignUp(size, mAlignment);
+
+    check(mOffset + alignedSize <= mFrameSize,
+          std::format("UniformRingBuffer: {} bytes don't fit in the {} left this frame.", size, mFrameSize - mOffset).c_str());
+
+    Allocation allocation {
+        .offset = mFrame * mFrameSize + mOffset,
+        .size = size
+    };
+
+    std::copy_n(static_cast<const uint8_t*>(data), size, mData + allocation.offset);
+
+    mOffset += alignedSize;
+    ++mAllocationCount;
+
+    return allocation;
+}
+
+void UniformRingBuffer::bind(uint32_t binding, const Allocation &allocation) const
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, mRendererID, allocation.offset, allocation.size);
+}
+
+uint32_t UniformRingBuffer::id() const
+{
+    return mRendererID;
+}
+
+UniformRingBuffer::Stats UniformRingBuffer::stats() const
+{
+    return mStats;
+}
@@ -0,0 +1,76 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_UNIFORM_RING_BUFFER_HPP
+#define OPENGLRENDERINGENGINE_UNIFORM_RING_BUFFER_HPP
+
+#include <glad/glad.h>
+#include "../utils.hpp"
+
+// A persistently mapped uniform buffer split into a region per frame in flight. Data written
+// during a frame is copied into the frame's region at the uniform offset alignment and bound as
+// a range, so a block the shaders read is written once and bound per pass or draw without a
+// buffer update. beginFrame() waits for the gpu to be done with the region it's about to reuse,
+// which only happens when the cpu runs more than FrameCount frames ahead.
+class UniformRingBuffer
+{
+public:
+    static constexpr uint32_t FrameCount = 3;
+
+    // a range of the current frame's region
+    struct Allocation
+    {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    struct Stats
+    {
+        uint32_t frameSize;
+        // last frame
+        uint32_t usedBytes;
+        uint32_t allocationCount;
+        // since startup, frames that had to wait for the gpu
+        uint32_t fenceWaits;
+    };
+
+public:
+    UniformRingBuffer(uint32_t frameSize);
+    ~UniformRingBuffer();
+
+    UniformRingBuffer(const UniformRingBuffer&) = delete;
+    UniformRingBuffer& operator=(const UniformRingBuffer&) = delete;
+
+    void beginFrame();
+    void endFrame();
+
+    // throws when the frame's region is full, frameSize has to cover the worst frame
+    Allocation write(const void* data, uint32_t size);
+
+    template<typename T>
+    Allocation write(const T& data)
+    {
+        return write(&data, sizeof(T));
+    }
+
+    void bind(uint32_t binding, const Allocation& allocation) const;
+
+    uint32_t id() const;
+    Stats stats() const;
+
+private:
+    uint32_t mRendererID;
+    uint8_t* mData;
+    uint32_t mFrameSize;
+    uint32_t mAlignment;
+
+    std::array<GLsync, FrameCount> mFences;
+    uint32_t mFrame;
+    uint32_t mOffset;
+
+    uint32_t mAllocationCount;
+    Stats mStats;
+};
+
+#endif //OPENGLRENDERINGENGINE_UNIFORM_RING_BUFFER_HPP
@@ -0,0 +1,276 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "upload_manager.hpp"
+
+// how long a worker waits for the gpu to free staging space before uploading directly
+static constexpr auto sAllocateTimeout = std::chrono::milliseconds(500);
+
+// texture levels inside an allocation, enough for any texel or block size
+static constexpr uint32_t sMipAlignment = 16;
+
+static constexpr GLbitfield sStagingFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+static uint32_t alignUp(uint32_t value, uint32_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+UploadManager &UploadManager::instance()
+{
+    static UploadManager* uploadManager = new UploadManager();
+    return *uploadManager;
+}
+
+UploadManager::UploadManager()
+    : mStagingBuffer()
+    , mStagingData()
+    , mMainThreadID(std::this_thread::get_id())
+    , mStagingRanges(StagingSize)
+    , mNextTicket()
+    , mIssuedTicket()
+    , mUploadBudget(DefaultUploadBudget)
+    , mStagingFallbacks()
+    , mRecordedSubmissions()
+    , mRecordedBytes()
+{
+    glCreateBuffers(1, &mStagingBuffer);
+    glNamedBufferStorage(mStagingBuffer, StagingSize, nullptr, sStagingFlags);
+    mStagingData = static_cast<uint8_t*>(glMapNamedBufferRange(mStagingBuffer, 0, StagingSize, sStagingFlags));
+
+    check(mStagingData, "UploadManager: Failed to map the staging buffer.");
+}
+
+std::optional<StagingAllocation> UploadManager::allocate(uint32_t size)
+{
+    uint32_t alignedSize = alignUp(glm::max(size, 1u), StagingAlignment);
+
+    if (alignedSize > StagingSize)
+    {
+        ++mStagingFallbacks;
+        return std::nullopt;
+    }
+
+    std::unique_lock<std::mutex> lock(mStagingMutex);
+
+    std::optional<uint32_t> offset = mStagingRanges.allocate(alignedSize);
+
+    if (!offset && std::this_thread::get_id() != mMainThreadID)
+    {
+        mStagingFreed.wait_for(lock, sAllocateTimeout, [&] () {
+            offset = mStagingRanges.allocate(alignedSize);
+            return offset.has_value();
+        });
+    }
+
+    if (!offset)
+    {
+        ++mStagingFallbacks;
+        return std::nullopt;
+    }
+
+    return StagingAllocation {
+        .offset = *offset,
+        .size = alignedSize,
+        .data = mStagingData + *offset
+    };
+}
+
+std::optional<StagedTexture> UploadManager::stageTexture(const std::vector<TextureMip> &mips)
+{
+    StagedTexture stagedTexture;
+
+    uint32_t size = 0;
+    for (const TextureMip& mip : mips)
+    {
+        stagedTexture.mips.push_back({mip.width, mip.height, size, static_cast<uint32_t>(mip.data.size())});
+        size = alignUp(size + static_cast<uint32_t>(mip.data.size()), sMipAlignment);
+    }
+
+    auto allocation = allocate(size);
+
+    if (!allocation)
+        return std::nullopt;
+
+    stagedTexture.allocation = *allocation;
+
+    for (size_t level = 0; level < mips.size(); ++level)
+        std::copy(mips.at(level).data.begin(), mips.at(level).data.end(), allocation->data + stagedTexture.mips.at(level).offset);
+
+    return stagedTexture;
+}
+
+std::optional<StagedTexture> UploadManager::stageTexture(const TextureContainer &container)
+{
+    StagedTexture stagedTexture;
+
+    uint32_t size = 0;
+    for (uint32_t level = 0; level < container.levelCount(); ++level)
+    {
+        uint32_t levelSize = static_cast<uint32_t>(container.imageSize(level));
+
+        stagedTexture.mips.push_back({container.levelWidth(level), container.levelHeight(level), size, levelSize});
+        size = alignUp(size + levelSize, sMipAlignment);
+    }
+
+    auto allocation = allocate(size);
+
+    if (!allocation)
+        return std::nullopt;
+
+    stagedTexture.allocation = *allocation;
+
+    for (uint32_t level = 0; level < container.levelCount(); ++level)
+        std::copy_n(container.imageData(level, 0), container.imageSize(level), allocation->data + stagedTexture.mips.at(level).offset);
+
+    return stagedTexture;
+}
+
+uint64_t UploadManager::submit(const StagingAllocation &allocation, RecordFunc record)
+{
+    std::lock_guard<std::mutex> lock(mSubmissionMutex);
+
+    uint64_t ticket = ++mNextTicket;
+    mSubmissions.push_back({ticket, allocation, std::move(record)});
+
+    return ticket;
+}
+
+uint64_t UploadManager::submitTexture(const StagedTexture &stagedTexture, std::shared_ptr<Texture2D> texture)
+{
+    return submit(stagedTexture.allocation, [mips = stagedTexture.mips, texture] (uint32_t stagingBuffer, uint32_t offset) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffer);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        // with a pixel unpack buffer bound the data pointer is an offset into it
+        for (uint32_t level = 0; level < mips.size(); ++level)
+        {
+            const StagedTexture::Mip& mip = mips.at(level);
+            const void* data = reinterpret_cast<const void*>(static_cast<uintptr_t>(offset + mip.offset));
+
+            texture->uploadMip(level, mip.width, mip.height, data, mip.size);
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        // partial chains from containers
+        if (mips.size() > 1 && mips.size() < texture->mipLevelCount())
+            glTextureParameteri(texture->id(), GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mips.size() - 1));
+    });
+}
+
+bool UploadManager::issued(uint64_t ticket) const
+{
+    return mIssuedTicket >= ticket;
+}
+
+uint64_t UploadManager::lastTicket() const
+{
+    std::lock_guard<std::mutex> lock(mSubmissionMutex);
+    return mNextTicket;
+}
+
+void UploadManager::update()
+{
+    releaseCompleted();
+
+    mRecordedSubmissions = 0;
+    mRecordedBytes = 0;
+
+    InFlightFrame frame {};
+
+    while (true)
+    {
+        Submission submission;
+
+        {
+            std::lock_guard<std::mutex> lock(mSubmissionMutex);
+
+            if (mSubmissions.empty())
+                break;
+
+            // the first one always goes, however big
+            uint32_t size = mSubmissions.front().allocation.size;
+            if (mRecordedBytes > 0 && mRecordedBytes + size > mUploadBudget)
+                break;
+
+            submission = std::move(mSubmissions.front());
+            mSubmissions.pop_front();
+        }
+
+        submission.record(mStagingBuffer, submission.allocation.offset);
+
+        frame.allocations.push_back(submission.allocation);
+        mIssuedTicket = submission.ticket;
+
+        ++mRecordedSubmissions;
+        mRecordedBytes += submission.allocation.size;
+    }
+
+    if (frame.allocations.empty())
+        return;
+
+    frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    mInFlightFrames.push_back(std::move(frame));
+}
+
+void UploadManager::setUploadBudget(uint64_t uploadBudget)
+{
+    mUploadBudget = uploadBudget;
+}
+
+uint64_t UploadManager::uploadBudget() const
+{
+    return mUploadBudget;
+}
+
+UploadManager::Stats UploadManager::stats() const
+{
+    Stats stats {
+        .framesInFlight = static_cast<uint32_t>(mInFlightFrames.size()),
+        .stagingFallbacks = mStagingFallbacks,
+        .recordedSubmissions = mRecordedSubmissions,
+        .recordedBytes = mRecordedBytes
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mStagingMutex);
+        stats.stagingUsed = mStagingRanges.allocated();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mSubmissionMutex);
+        stats.queuedSubmissions = static_cast<uint32_t>(mSubmissions.size());
+        stats.queuedBytes = 0;
+        for (const Submission& submission : mSubmissions)
+            stats.queuedBytes += submission.allocation.size;
+    }
+
+    return stats;
+}
+
+// frames complete in order, the first unsignaled fence ends the search
+void UploadManager::releaseCompleted()
+{
+    while (!mInFlightFrames.empty())
+    {
+        InFlightFrame& frame = mInFlightFrames.front();
+        GLenum status = glClientWaitSync(frame.fence, 0, 0);
+
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+
+        {
+            std::lock_guard<std::mutex> lock(mStagingMutex);
+            for (const StagingAllocation& allocation : frame.allocations)
+                mStagingRanges.free(allocation.offset, allocation.size);
+        }
+
+        glDeleteSync(frame.fence);
+        mInFlightFrames.pop_front();
+
+        mStagingFreed.notify_all();
+    }
+}
@@ -0,0 +1,134 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_UPLOAD_MANAGER_HPP
+#define OPENGLRENDERINGENGINE_UPLOAD_MANAGER_HPP
+
+#include <glad/glad.h>
+#include "../app/range_allocator.hpp"
+#include "texture.hpp"
+#include "texture_container.hpp"
+
+// a range of the staging buffer, data points at its mapped memory
+struct StagingAllocation
+{
+    uint32_t offset;
+    uint32_t size;
+    uint8_t* data;
+};
+
+struct StagedTexture
+{
+    struct Mip
+    {
+        int32_t width;
+        int32_t height;
+        // relative to the allocation
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    StagingAllocation allocation;
+    std::vector<Mip> mips;
+};
+
+// Moves loaded data to the gpu without stalling the frame. Worker threads copy into ranges of a
+// persistently mapped staging buffer and the main thread submits what should be recorded from
+// each range: buffer copies or texture uploads sourced from the staging buffer. Submissions are
+// recorded at the end of the frame in order until the upload budget is spent, the rest wait for
+// the next frame. A fence per frame tells when the gpu has read the ranges so they can be reused.
+// Everything is recorded on the main context, a second context would need its own fences for
+// every consumer and the workers already do the cpu copies.
+class UploadManager
+{
+public:
+    static constexpr uint32_t StagingSize = 64u << 20;
+    static constexpr uint32_t StagingAlignment = 256;
+    static constexpr uint64_t DefaultUploadBudget = 32ull << 20;
+
+    using RecordFunc = std::function<void(uint32_t stagingBuffer, uint32_t offset)>;
+
+    struct Stats
+    {
+        uint32_t stagingUsed;
+        uint32_t queuedSubmissions;
+        uint64_t queuedBytes;
+        uint32_t framesInFlight;
+        // since startup
+        uint32_t stagingFallbacks;
+        // this frame
+        uint32_t recordedSubmissions;
+        uint64_t recordedBytes;
+    };
+
+public:
+    // created on first use, which needs to happen on the main thread with a context current.
+    // never destroyed: the context is already gone by the time statics are torn down
+    static UploadManager& instance();
+
+    // any thread. Workers wait a little for the gpu to free space, the main thread doesn't since
+    // it's the one freeing it. Empty when the data doesn't fit, the caller uploads directly then
+    std::optional<StagingAllocation> allocate(uint32_t size);
+    std::optional<StagedTexture> stageTexture(const std::vector<TextureMip>& mips);
+    // the first image of every level
+    std::optional<StagedTexture> stageTexture(const TextureContainer& container);
+
+    // record runs on the main thread once the budget allows, the allocation is freed after the gpu used it.
+    // Returns a ticket for issued()
+    uint64_t submit(const StagingAllocation& allocation, RecordFunc record);
+    uint64_t submitTexture(const StagedTexture& stagedTexture, std::shared_ptr<Texture2D> texture);
+
+    // the submission with this ticket and every earlier one has been recorded
+    bool issued(uint64_t ticket) const;
+    uint64_t lastTicket() const;
+
+    // main thread, once per frame
+    void update();
+
+    void setUploadBudget(uint64_t uploadBudget);
+    uint64_t uploadBudget() const;
+
+    Stats stats() const;
+
+private:
+    UploadManager();
+
+    void releaseCompleted();
+
+private:
+    struct Submission
+    {
+        uint64_t ticket;
+        StagingAllocation allocation;
+        RecordFunc record;
+    };
+
+    struct InFlightFrame
+    {
+        GLsync fence;
+        std::vector<StagingAllocation> allocations;
+    };
+
+    uint32_t mStagingBuffer;
+    uint8_t* mStagingData;
+    std::thread::id mMainThreadID;
+
+    RangeAllocator mStagingRanges;
+    mutable std::mutex mStagingMutex;
+    std::condition_variable mStagingFreed;
+
+    std::deque<Submission> mSubmissions;
+    mutable std::mutex mSubmissionMutex;
+    uint64_t mNextTicket;
+    std::atomic<uint64_t> mIssuedTicket;
+
+    std::deque<InFlightFrame> mInFlightFrames;
+
+    uint64_t mUploadBudget;
+    std::atomic<uint32_t> mStagingFallbacks;
+    uint32_t mRecordedSubmissions;
+    uint64_t mRecordedBytes;
+};
+
+#endif //OPENGLRENDERINGENGINE_UPLOAD_MANAGER_HPP
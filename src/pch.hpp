@@ -10,16 +10,23 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <deque>
+#include <queue>
 #include <set>
+#include <map>
+#include <bitset>
 #include <string>
 #include <string_view>
 #include <memory>
 #include <cstdint>
 #include <optional>
+#include <random>
+#include <bit>
+#include <numeric>
 #include <variant>
 
 #include <iostream>
 #include <format>
+#include <charconv>
 #include <sstream>
 #include <fstream>
 
@@ -18,11 +18,77 @@ struct BoundingBox
     {
     }
 
+    BoundingBox(const glm::vec3& min, const glm::vec3& max)
+        : min(min)
+        , max(max)
+    {
+    }
+
     void expand(const glm::vec3& point)
     {
         min = glm::min(min, point);
         max = glm::max(max, point);
     }
+
+    void expand(const BoundingBox& other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    bool valid() const
+    {
+        return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+    }
+
+    glm::vec3 center() const
+    {
+        return (min + max) * 0.5f;
+    }
+
+    glm::vec3 extents() const
+    {
+        return (max - min) * 0.5f;
+    }
+
+    float surfaceArea() const
+    {
+        glm::vec3 d = max - min;
+        return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    bool contains(const BoundingBox& other) const
+    {
+        return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+    }
+
+    bool overlaps(const BoundingBox& other) const
+    {
+        return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+    }
+
+    float distance2(const glm::vec3& point) const
+    {
+        glm::vec3 d = glm::max(glm::max(min - point, point - max), glm::vec3(0.f));
+        return glm::dot(d, d);
+    }
+
+    // bounds of the transformed box (Arvo's method)
+    BoundingBox transform(const glm::mat4& matrix) const
+    {
+        glm::vec3 newCenter = glm::vec3(matrix * glm::vec4(center(), 1.f));
+        glm::vec3 oldExtents = extents();
+        glm::vec3 newExtents = glm::abs(glm::vec3(matrix[0])) * oldExtents.x +
+                               glm::abs(glm::vec3(matrix[1])) * oldExtents.y +
+                               glm::abs(glm::vec3(matrix[2])) * oldExtents.z;
+
+        return {newCenter - newExtents, newCenter + newExtents};
+    }
+
+    static BoundingBox merge(const BoundingBox& a, const BoundingBox& b)
+    {
+        return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+    }
 };
 
 #endif //OPENGLRENDERINGENGINE_BOUNDING_BOX_HPP
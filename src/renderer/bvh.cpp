@@ -0,0 +1,708 @@
+//
+// Created by Gianni on 4/02/2025.
+//
+
+#include "bvh.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+static constexpr float sFatMarginRatio = 0.1f;
+static constexpr float sFatMarginMin = 0.05f;
+static constexpr uint32_t sMinRebuildModifications = 64;
+static constexpr uint32_t sSahBinCount = 16;
+
+BVH::BVH()
+    : mRoot(NullNode)
+    , mFreeList(NullNode)
+    , mNodeCount()
+    , mProxyCount()
+    , mModificationCount()
+    , mRebuildCount()
+    , mLastRebuildMs()
+    , mSahCost()
+    , mSahCostDirty(true)
+{
+}
+
+uint32_t BVH::insert(const BoundingBox &bounds, uint64_t userData)
+{
+    uint32_t leaf = allocateNode();
+
+    mNodes.at(leaf).bounds = fatten(bounds);
+    mNodes.at(leaf).userData = userData;
+
+    insertLeaf(leaf);
+
+    ++mProxyCount;
+    ++mModificationCount;
+    mSahCostDirty = true;
+
+    return leaf;
+}
+
+void BVH::remove(uint32_t proxyID)
+{
+    assert(mNodes.at(proxyID).leaf());
+
+    removeLeaf(proxyID);
+    freeNode(proxyID);
+
+    --mProxyCount;
+    ++mModificationCount;
+    mSahCostDirty = true;
+}
+
+bool BVH::update(uint32_t proxyID, const BoundingBox &bounds)
+{
+    Node& leaf = mNodes.at(proxyID);
+    assert(leaf.leaf());
+
+    if (leaf.bounds.contains(bounds))
+        return false;
+
+    leaf.bounds = fatten(bounds);
+    refitAncestors(leaf.parent);
+
+    ++mModificationCount;
+    mSahCostDirty = true;
+
+    return true;
+}
+
+void BVH::clear()
+{
+    mNodes.clear();
+    mRoot = NullNode;
+    mFreeList = NullNode;
+    mNodeCount = 0;
+    mProxyCount = 0;
+    mModificationCount = 0;
+    mSahCostDirty = true;
+}
+
+bool BVH::needsRebuild() const
+{
+    return mModificationCount > glm::max(sMinRebuildModifications, mProxyCount / 4);
+}
+
+void BVH::rebuild()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // keep the leaves (their indices are the proxy IDs) and throw away every internal node
+    std::vector<uint32_t> leaves;
+    leaves.reserve(mProxyCount);
+
+    std::vector<uint32_t> stack;
+    if (mRoot != NullNode)
+        stack.push_back(mRoot);
+
+    while (!stack.empty())
+    {
+        uint32_t nodeIndex = stack.back();
+        stack.pop_back();
+
+        const Node& node = mNodes.at(nodeIndex);
+
+        if (node.leaf())
+        {
+            leaves.push_back(nodeIndex);
+        }
+        else
+        {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+            freeNode(nodeIndex);
+        }
+    }
+
+    mRoot = NullNode;
+
+    if (!leaves.empty())
+    {
+        mRoot = buildRecursive(leaves, 0, static_cast<uint32_t>(leaves.size()));
+        mNodes.at(mRoot).parent = NullNode;
+    }
+
+    mModificationCount = 0;
+    mSahCostDirty = true;
+    ++mRebuildCount;
+    mLastRebuildMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void BVH::queryFrustum(const Frustum &frustum, std::vector<uint64_t> &results) const
+{
+    if (mRoot == NullNode)
+        return;
+
+    std::vector<uint32_t> stack(1, mRoot);
+
+    while (!stack.empty())
+    {
+        uint32_t nodeIndex = stack.back();
+        stack.pop_back();
+
+        const Node& node = mNodes[nodeIndex];
+
+        if (!frustum.intersects(node.bounds))
+            continue;
+
+        // fully inside: everything below is visible, no need to test it
+        if (node.leaf() || frustum.contains(node.bounds))
+        {
+            collectLeaves(nodeIndex, results);
+            continue;
+        }
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+}
+
+void BVH::queryOverlap(const BoundingBox &bounds, std::vector<uint64_t> &results) const
+{
+    if (mRoot == NullNode)
+        return;
+
+    std::vector<uint32_t> stack(1, mRoot);
+
+    while (!stack.empty())
+    {
+        uint32_t nodeIndex = stack.back();
+        stack.pop_back();
+
+        const Node& node = mNodes[nodeIndex];
+
+        if (!node.bounds.overlaps(bounds))
+            continue;
+
+        if (node.leaf())
+        {
+            results.push_back(node.userData);
+            continue;
+        }
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+}
+
+void BVH::queryRay(const Ray &ray, float maxDistance, std::vector<RayHit> &hits) const
+{
+    if (mRoot == NullNode)
+        return;
+
+    glm::vec3 invDirection = 1.f / ray.direction;
+
+    // slab test, returns the entry distance or a negative value on a miss
+    auto intersect = [&ray, &invDirection, maxDistance] (const BoundingBox& bb) {
+        glm::vec3 t0 = (bb.min - ray.origin) * invDirection;
+        glm::vec3 t1 = (bb.max - ray.origin) * invDirection;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+
+        float tEnter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.f));
+        float tExit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+
+        return tEnter <= tExit? tEnter : -1.f;
+    };
+
+    size_t firstHit = hits.size();
+    std::vector<uint32_t> stack(1, mRoot);
+
+    while (!stack.empty())
+    {
+        uint32_t nodeIndex = stack.back();
+        stack.pop_back();
+
+        const Node& node = mNodes[nodeIndex];
+        float distance = intersect(node.bounds);
+
+        if (distance < 0.f)
+            continue;
+
+        if (node.leaf())
+        {
+            hits.push_back({node.userData, distance});
+            continue;
+        }
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+
+    std::sort(hits.begin() + firstHit, hits.end(), [] (const RayHit& a, const RayHit& b) {
+        return a.distance < b.distance;
+    });
+}
+
+void BVH::queryNearest(const glm::vec3 &point, uint32_t k, std::vector<uint64_t> &results) const
+{
+    if (mRoot == NullNode || !k)
+        return;
+
+    using Entry = std::pair<float, uint32_t>;
+
+    // best first: always expand the closest node, stop once it's further than the k-th best leaf
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    std::priority_queue<Entry> best;
+
+    open.emplace(mNodes[mRoot].bounds.distance2(point), mRoot);
+
+    while (!open.empty())
+    {
+        auto [distance2, nodeIndex] = open.top();
+        open.pop();
+
+        if (best.size() == k && distance2 >= best.top().first)
+            break;
+
+        const Node& node = mNodes[nodeIndex];
+
+        if (node.leaf())
+        {
+            best.emplace(distance2, nodeIndex);
+
+            if (best.size() > k)
+                best.pop();
+
+            continue;
+        }
+
+        open.emplace(mNodes[node.left].bounds.distance2(point), node.left);
+        open.emplace(mNodes[node.right].bounds.distance2(point), node.right);
+    }
+
+    size_t firstResult = results.size();
+    results.resize(firstResult + best.size());
+
+    for (size_t i = results.size(); i > firstResult; --i)
+    {
+        results[i - 1] = mNodes[best.top().second].userData;
+        best.pop();
+    }
+}
+
+uint64_t BVH::userData(uint32_t proxyID) const
+{
+    return mNodes.at(proxyID).userData;
+}
+
+const BoundingBox &BVH::fatBounds(uint32_t proxyID) const
+{
+    return mNodes.at(proxyID).bounds;
+}
+
+uint32_t BVH::proxyCount() const
+{
+    return mProxyCount;
+}
+
+BoundingBox BVH::bounds() const
+{
+    if (mRoot == NullNode)
+        return {};
+    return mNodes.at(mRoot).bounds;
+}
+
+BVH::Stats BVH::stats() const
+{
+    if (mSahCostDirty)
+    {
+        mSahCost = computeSahCost();
+        mSahCostDirty = false;
+    }
+
+    return {
+        .proxyCount = mProxyCount,
+        .nodeCount = mNodeCount,
+        .height = mRoot == NullNode? 0 : mNodes[mRoot].height,
+        .sahCost = mSahCost,
+        .rebuildCount = mRebuildCount,
+        .lastRebuildMs = mLastRebuildMs
+    };
+}
+
+BVH::BenchmarkResult BVH::benchmark(uint32_t proxyCount, uint32_t iterations)
+{
+    assert(iterations > 0);
+
+    std::mt19937 rng(proxyCount);
+    std::uniform_real_distribution<float> position(-500.f, 500.f);
+    std::uniform_real_distribution<float> size(0.5f, 5.f);
+    std::uniform_real_distribution<float> movement(-2.f, 2.f);
+
+    // every box moves once per iteration, some stay inside their fat bounds and some don't
+    std::vector<BoundingBox> bounds(proxyCount);
+    std::vector<BoundingBox> movedBounds(proxyCount);
+
+    for (uint32_t i = 0; i < proxyCount; ++i)
+    {
+        glm::vec3 center(position(rng), position(rng), position(rng));
+        glm::vec3 extents(size(rng), size(rng), size(rng));
+        glm::vec3 offset(movement(rng), movement(rng), movement(rng));
+
+        bounds.at(i) = {center - extents, center + extents};
+        movedBounds.at(i) = {center + offset - extents, center + offset + extents};
+    }
+
+    glm::mat4 projection = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 400.f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.f), glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f));
+    Frustum frustum(projection * view);
+
+    std::vector<float> buildTimes;
+    std::vector<float> refitTimes;
+    std::vector<float> queryTimes;
+
+    std::vector<uint32_t> proxyIDs(proxyCount);
+    std::vector<uint64_t> visible;
+    visible.reserve(proxyCount);
+
+    auto elapsedMs = [] (std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    BenchmarkResult result {};
+    result.proxyCount = proxyCount;
+    result.iterations = iterations;
+
+    for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+    {
+        BVH bvh;
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < proxyCount; ++i)
+            proxyIDs.at(i) = bvh.insert(bounds.at(i), i);
+        bvh.rebuild();
+        buildTimes.push_back(elapsedMs(start));
+
+        start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < proxyCount; ++i)
+            bvh.update(proxyIDs.at(i), movedBounds.at(i));
+        refitTimes.push_back(elapsedMs(start));
+
+        start = std::chrono::steady_clock::now();
+        visible.clear();
+        bvh.queryFrustum(frustum, visible);
+        queryTimes.push_back(elapsedMs(start));
+
+        result.visibleCount = static_cast<uint32_t>(visible.size());
+        result.sahCost = bvh.stats().sahCost;
+    }
+
+    auto summarize = [iterations] (const std::vector<float>& times) {
+        return BenchmarkTiming {
+            .minMs = *std::ranges::min_element(times),
+            .meanMs = std::accumulate(times.begin(), times.end(), 0.f) / static_cast<float>(iterations)
+        };
+    };
+
+    result.build = summarize(buildTimes);
+    result.refit = summarize(refitTimes);
+    result.query = summarize(queryTimes);
+
+    return result;
+}
+
+uint32_t BVH::allocateNode()
+{
+    uint32_t nodeIndex;
+
+    if (mFreeList == NullNode)
+    {
+        nodeIndex = static_cast<uint32_t>(mNodes.size());
+        mNodes.emplace_back();
+    }
+    else
+    {
+        nodeIndex = mFreeList;
+        mFreeList = mNodes[nodeIndex].parent;
+    }
+
+    Node& node = mNodes[nodeIndex];
+    node.bounds = BoundingBox();
+    node.userData = 0;
+    node.parent = NullNode;
+    node.left = NullNode;
+    node.right = NullNode;
+    node.height = 0;
+
+    ++mNodeCount;
+
+    return nodeIndex;
+}
+
+void BVH::freeNode(uint32_t nodeIndex)
+{
+    mNodes.at(nodeIndex).parent = mFreeList;
+    mFreeList = nodeIndex;
+    --mNodeCount;
+}
+
+// walks down picking the child that increases the total surface area the least (Box2D style)
+void BVH::insertLeaf(uint32_t leaf)
+{
+    if (mRoot == NullNode)
+    {
+        mRoot = leaf;
+        mNodes[leaf].parent = NullNode;
+        return;
+    }
+
+    BoundingBox leafBounds = mNodes[leaf].bounds;
+    uint32_t index = mRoot;
+
+    while (!mNodes[index].leaf())
+    {
+        const Node& node = mNodes[index];
+
+        float area = node.bounds.surfaceArea();
+        float combinedArea = BoundingBox::merge(node.bounds, leafBounds).surfaceArea();
+
+        // cost of making a new parent for this node and the leaf
+        float cost = 2.f * combinedArea;
+        // minimum cost of pushing the leaf further down
+        float inheritanceCost = 2.f * (combinedArea - area);
+
+        auto descendCost = [this, &leafBounds, inheritanceCost] (uint32_t child) {
+            const Node& childNode = mNodes[child];
+            float mergedArea = BoundingBox::merge(childNode.bounds, leafBounds).surfaceArea();
+
+            if (childNode.leaf())
+                return mergedArea + inheritanceCost;
+            return mergedArea - childNode.bounds.surfaceArea() + inheritanceCost;
+        };
+
+        float leftCost = descendCost(node.left);
+        float rightCost = descendCost(node.right);
+
+        if (cost < leftCost && cost < rightCost)
+            break;
+
+        index = leftCost < rightCost? node.left : node.right;
+    }
+
+    uint32_t sibling = index;
+    uint32_t oldParent = mNodes[sibling].parent;
+    uint32_t newParent = allocateNode();
+
+    mNodes[newParent].parent = oldParent;
+    mNodes[newParent].left = sibling;
+    mNodes[newParent].right = leaf;
+    mNodes[sibling].parent = newParent;
+    mNodes[leaf].parent = newParent;
+
+    if (oldParent == NullNode)
+        mRoot = newParent;
+    else if (mNodes[oldParent].left == sibling)
+        mNodes[oldParent].left = newParent;
+    else
+        mNodes[oldParent].right = newParent;
+
+    refitAncestors(newParent);
+}
+
+void BVH::removeLeaf(uint32_t leaf)
+{
+    if (leaf == mRoot)
+    {
+        mRoot = NullNode;
+        return;
+    }
+
+    uint32_t parent = mNodes[leaf].parent;
+    uint32_t grandParent = mNodes[parent].parent;
+    uint32_t sibling = mNodes[parent].left == leaf? mNodes[parent].right : mNodes[parent].left;
+
+    // the sibling takes the parent's place
+    mNodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    if (grandParent == NullNode)
+    {
+        mRoot = sibling;
+        return;
+    }
+
+    if (mNodes[grandParent].left == parent)
+        mNodes[grandParent].left = sibling;
+    else
+        mNodes[grandParent].right = sibling;
+
+    refitAncestors(grandParent);
+}
+
+void BVH::refitAncestors(uint32_t nodeIndex)
+{
+    while (nodeIndex != NullNode)
+    {
+        Node& node = mNodes[nodeIndex];
+        const Node& left = mNodes[node.left];
+        const Node& right = mNodes[node.right];
+
+        node.bounds = BoundingBox::merge(left.bounds, right.bounds);
+        node.height = 1 + glm::max(left.height, right.height);
+
+        nodeIndex = node.parent;
+    }
+}
+
+void BVH::collectLeaves(uint32_t nodeIndex, std::vector<uint64_t> &results) const
+{
+    std::vector<uint32_t> stack(1, nodeIndex);
+
+    while (!stack.empty())
+    {
+        const Node& node = mNodes[stack.back()];
+        stack.pop_back();
+
+        if (node.leaf())
+        {
+            results.push_back(node.userData);
+            continue;
+        }
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+}
+
+// top down build splitting on the cheapest of sSahBinCount candidate planes along the widest centroid axis
+uint32_t BVH::buildRecursive(std::vector<uint32_t> &leaves, uint32_t begin, uint32_t end)
+{
+    uint32_t count = end - begin;
+
+    if (count == 1)
+        return leaves[begin];
+
+    BoundingBox centroidBounds;
+    for (uint32_t i = begin; i < end; ++i)
+        centroidBounds.expand(mNodes[leaves[i]].bounds.center());
+
+    glm::vec3 centroidExtents = centroidBounds.max - centroidBounds.min;
+    int axis = 0;
+    if (centroidExtents.y > centroidExtents[axis]) axis = 1;
+    if (centroidExtents.z > centroidExtents[axis]) axis = 2;
+
+    uint32_t mid = begin + count / 2;
+
+    if (count > 2 && centroidExtents[axis] > 0.f)
+    {
+        struct Bin
+        {
+            BoundingBox bounds;
+            uint32_t count = 0;
+        };
+
+        std::array<Bin, sSahBinCount> bins;
+        float binScale = sSahBinCount / centroidExtents[axis];
+
+        auto binIndex = [&] (uint32_t leaf) {
+            float offset = mNodes[leaf].bounds.center()[axis] - centroidBounds.min[axis];
+            return glm::min(static_cast<uint32_t>(offset * binScale), sSahBinCount - 1);
+        };
+
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            Bin& bin = bins[binIndex(leaves[i])];
+            bin.bounds.expand(mNodes[leaves[i]].bounds);
+            ++bin.count;
+        }
+
+        // sweep from the right to get the cost of everything behind each plane
+        std::array<float, sSahBinCount> rightCosts {};
+        BoundingBox rightBounds;
+        uint32_t rightCount = 0;
+
+        for (uint32_t i = sSahBinCount - 1; i > 0; --i)
+        {
+            rightBounds.expand(bins[i].bounds);
+            rightCount += bins[i].count;
+            rightCosts[i - 1] = rightCount? rightCount * rightBounds.surfaceArea() : 0.f;
+        }
+
+        BoundingBox leftBounds;
+        uint32_t leftCount = 0;
+        float bestCost = FLT_MAX;
+        uint32_t bestSplit = 0;
+
+        for (uint32_t i = 0; i < sSahBinCount - 1; ++i)
+        {
+            leftBounds.expand(bins[i].bounds);
+            leftCount += bins[i].count;
+
+            float cost = (leftCount? leftCount * leftBounds.surfaceArea() : 0.f) + rightCosts[i];
+
+            if (leftCount && leftCount < count && cost < bestCost)
+            {
+                bestCost = cost;
+                bestSplit = i;
+            }
+        }
+
+        auto itr = std::partition(leaves.begin() + begin, leaves.begin() + end, [&] (uint32_t leaf) {
+            return binIndex(leaf) <= bestSplit;
+        });
+
+        mid = static_cast<uint32_t>(itr - leaves.begin());
+    }
+
+    // degenerate split (everything in one bin or identical centroids), fall back to the median
+    if (mid == begin || mid == end)
+    {
+        mid = begin + count / 2;
+
+        std::nth_element(leaves.begin() + begin, leaves.begin() + mid, leaves.begin() + end, [&] (uint32_t a, uint32_t b) {
+            return mNodes[a].bounds.center()[axis] < mNodes[b].bounds.center()[axis];
+        });
+    }
+
+    uint32_t left = buildRecursive(leaves, begin, mid);
+    uint32_t right = buildRecursive(leaves, mid, end);
+    uint32_t nodeIndex = allocateNode();
+
+    Node& node = mNodes[nodeIndex];
+    node.left = left;
+    node.right = right;
+    node.bounds = BoundingBox::merge(mNodes[left].bounds, mNodes[right].bounds);
+    node.height = 1 + glm::max(mNodes[left].height, mNodes[right].height);
+
+    mNodes[left].parent = nodeIndex;
+    mNodes[right].parent = nodeIndex;
+
+    return nodeIndex;
+}
+
+// expected traversal cost relative to the root: sum of node areas over the root area
+float BVH::computeSahCost() const
+{
+    if (mRoot == NullNode)
+        return 0.f;
+
+    float rootArea = mNodes[mRoot].bounds.surfaceArea();
+    float totalArea = 0.f;
+
+    std::vector<uint32_t> stack(1, mRoot);
+
+    while (!stack.empty())
+    {
+        const Node& node = mNodes[stack.back()];
+        stack.pop_back();
+
+        totalArea += node.bounds.surfaceArea();
+
+        if (!node.leaf())
+        {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+
+    return rootArea > 0.f? totalArea / rootArea : 0.f;
+}
+
+BoundingBox BVH::fatten(const BoundingBox &bounds)
+{
+    glm::vec3 margin = glm::max((bounds.max - bounds.min) * sFatMarginRatio, glm::vec3(sFatMarginMin));
+    return {bounds.min - margin, bounds.max + margin};
+}
@@ -0,0 +1,136 @@
+//
+// Created by Gianni on 4/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_BVH_HPP
+#define OPENGLRENDERINGENGINE_BVH_HPP
+
+#include <glm/glm.hpp>
+#include "bounding_box.hpp"
+#include "frustum.hpp"
+
+struct Ray
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+// Dynamic AABB tree. Every leaf is one proxy holding a user value (a scene node ID for the scene graph).
+// Leaves store fat bounds, so small movements don't touch the tree at all. Bigger movements refit the
+// leaf and its ancestors in place, which is cheap but lets the tree quality drift, so the tree keeps
+// count of the modifications and gets rebuilt top down with the binned SAH once enough have piled up.
+// Proxy IDs are stable for the lifetime of the proxy, including across rebuilds.
+class BVH
+{
+public:
+    static constexpr uint32_t NullNode = UINT32_MAX;
+
+    struct RayHit
+    {
+        uint64_t userData;
+        float distance;
+    };
+
+    struct Stats
+    {
+        uint32_t proxyCount;
+        uint32_t nodeCount;
+        uint32_t height;
+        float sahCost;
+        uint32_t rebuildCount;
+        float lastRebuildMs;
+    };
+
+    struct BenchmarkTiming
+    {
+        float minMs;
+        float meanMs;
+    };
+
+    struct BenchmarkResult
+    {
+        uint32_t proxyCount;
+        uint32_t iterations;
+        // inserting every proxy and the SAH rebuild
+        BenchmarkTiming build;
+        // moving every proxy once
+        BenchmarkTiming refit;
+        BenchmarkTiming query;
+        uint32_t visibleCount;
+        float sahCost;
+    };
+
+public:
+    BVH();
+
+    uint32_t insert(const BoundingBox& bounds, uint64_t userData);
+    void remove(uint32_t proxyID);
+    // returns true if the fat bounds had to change
+    bool update(uint32_t proxyID, const BoundingBox& bounds);
+    void clear();
+
+    bool needsRebuild() const;
+    void rebuild();
+
+    void queryFrustum(const Frustum& frustum, std::vector<uint64_t>& results) const;
+    void queryOverlap(const BoundingBox& bounds, std::vector<uint64_t>& results) const;
+    // hits are sorted front to back
+    void queryRay(const Ray& ray, float maxDistance, std::vector<RayHit>& hits) const;
+    // the k proxies closest to point, closest first
+    void queryNearest(const glm::vec3& point, uint32_t k, std::vector<uint64_t>& results) const;
+
+    uint64_t userData(uint32_t proxyID) const;
+    const BoundingBox& fatBounds(uint32_t proxyID) const;
+    uint32_t proxyCount() const;
+    // fat bounds of the whole tree, invalid while it is empty
+    BoundingBox bounds() const;
+    // the SAH cost is only walked again after the tree changed
+    Stats stats() const;
+
+    // builds, refits and frustum queries a tree of proxyCount random boxes iterations times.
+    // The boxes come from a fixed seed so runs compare, doesn't need a GL context
+    static BenchmarkResult benchmark(uint32_t proxyCount, uint32_t iterations = 10);
+
+private:
+    struct Node
+    {
+        BoundingBox bounds;
+        uint64_t userData;
+        uint32_t parent; // next free node while on the free list
+        uint32_t left;
+        uint32_t right;
+        uint32_t height;
+
+        bool leaf() const { return left == NullNode; }
+    };
+
+    uint32_t allocateNode();
+    void freeNode(uint32_t nodeIndex);
+
+    void insertLeaf(uint32_t leaf);
+    void removeLeaf(uint32_t leaf);
+    void refitAncestors(uint32_t nodeIndex);
+
+    void collectLeaves(uint32_t nodeIndex, std::vector<uint64_t>& results) const;
+
+    uint32_t buildRecursive(std::vector<uint32_t>& leaves, uint32_t begin, uint32_t end);
+    float computeSahCost() const;
+
+    static BoundingBox fatten(const BoundingBox& bounds);
+
+private:
+    std::vector<Node> mNodes;
+    uint32_t mRoot;
+    uint32_t mFreeList;
+    uint32_t mNodeCount;
+    uint32_t mProxyCount;
+
+    uint32_t mModificationCount;
+    uint32_t mRebuildCount;
+    float mLastRebuildMs;
+
+    mutable float mSahCost;
+    mutable bool mSahCostDirty;
+};
+
+#endif //OPENGLRENDERINGENGINE_BVH_HPP
@@ -0,0 +1,288 @@
+//
+// Created by Gianni on 5/02/2025.
+//
+
+#include "culling.hpp"
+#include "../utils.hpp"
+
+#if defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
+#include <glm/gtc/matrix_transform.hpp>
+
+static constexpr uint32_t sLaneCount = 8;
+
+static uint32_t paddedSize(uint32_t count)
+{
+    return (count + sLaneCount - 1) / sLaneCount * sLaneCount;
+}
+
+AABBArray::AABBArray()
+    : mSize()
+{
+}
+
+void AABBArray::resize(uint32_t count)
+{
+    for (std::vector<float>& component : mComponents)
+        component.resize(paddedSize(count), 0.f);
+
+    mSize = count;
+}
+
+void AABBArray::set(uint32_t index, const BoundingBox &bb)
+{
+    assert(index < mSize);
+
+    glm::vec3 center = bb.center();
+    glm::vec3 extents = bb.extents();
+
+    mComponents[CenterX][index] = center.x;
+    mComponents[CenterY][index] = center.y;
+    mComponents[CenterZ][index] = center.z;
+    mComponents[ExtentX][index] = extents.x;
+    mComponents[ExtentY][index] = extents.y;
+    mComponents[ExtentZ][index] = extents.z;
+}
+
+void AABBArray::swapRemove(uint32_t index)
+{
+    assert(index < mSize);
+
+    uint32_t lastIndex = mSize - 1;
+
+    for (std::vector<float>& component : mComponents)
+        component[index] = component[lastIndex];
+
+    resize(lastIndex);
+}
+
+uint32_t AABBArray::size() const
+{
+    return mSize;
+}
+
+const float *AABBArray::data(AABBArray::Component component) const
+{
+    return mComponents[component].data();
+}
+
+namespace Culling
+{
+    // lanes past the end of the array hold padding or stale boxes
+    static uint32_t tailMask(uint32_t base, uint32_t count, uint32_t laneCount)
+    {
+        uint32_t remaining = count - base;
+        return remaining >= laneCount? (1u << laneCount) - 1 : (1u << remaining) - 1;
+    }
+
+    static void appendVisible(uint32_t mask, uint32_t base, std::vector<uint32_t>& visibleIndices)
+    {
+        while (mask)
+        {
+            visibleIndices.push_back(base + std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    uint32_t frustumCull(const Frustum &frustum, const AABBArray &bounds, std::vector<uint32_t> &visibleIndices)
+    {
+        uint32_t count = bounds.size();
+        size_t firstIndex = visibleIndices.size();
+
+        const float* cx = bounds.data(AABBArray::CenterX);
+        const float* cy = bounds.data(AABBArray::CenterY);
+        const float* cz = bounds.data(AABBArray::CenterZ);
+        const float* ex = bounds.data(AABBArray::ExtentX);
+        const float* ey = bounds.data(AABBArray::ExtentY);
+        const float* ez = bounds.data(AABBArray::ExtentZ);
+
+#if defined(__AVX__)
+        __m256 planes[Frustum::Count * 4];
+        for (uint32_t p = 0; p < Frustum::Count; ++p)
+        {
+            planes[p * 4 + 0] = _mm256_set1_ps(frustum.planes[p].x);
+            planes[p * 4 + 1] = _mm256_set1_ps(frustum.planes[p].y);
+            planes[p * 4 + 2] = _mm256_set1_ps(frustum.planes[p].z);
+            planes[p * 4 + 3] = _mm256_set1_ps(frustum.planes[p].w);
+        }
+
+        const __m256 signMask = _mm256_set1_ps(-0.f);
+
+        for (uint32_t base = 0; base < count; base += 8)
+        {
+            __m256 centerX = _mm256_loadu_ps(cx + base);
+            __m256 centerY = _mm256_loadu_ps(cy + base);
+            __m256 centerZ = _mm256_loadu_ps(cz + base);
+            __m256 extentX = _mm256_loadu_ps(ex + base);
+            __m256 extentY = _mm256_loadu_ps(ey + base);
+            __m256 extentZ = _mm256_loadu_ps(ez + base);
+
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+            for (uint32_t p = 0; p < Frustum::Count; ++p)
+            {
+                __m256 nx = planes[p * 4 + 0];
+                __m256 ny = planes[p * 4 + 1];
+                __m256 nz = planes[p * 4 + 2];
+
+                // signed distance of the center and projected radius of the box onto the normal
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, centerX), _mm256_mul_ps(ny, centerY)),
+                                                _mm256_add_ps(_mm256_mul_ps(nz, centerZ), planes[p * 4 + 3]));
+                __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, nx), extentX),
+                                                            _mm256_mul_ps(_mm256_andnot_ps(signMask, ny), extentY)),
+                                              _mm256_mul_ps(_mm256_andnot_ps(signMask, nz), extentZ));
+
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+            }
+
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside)) & tailMask(base, count, 8);
+            appendVisible(mask, base, visibleIndices);
+        }
+#elif defined(__SSE2__)
+        __m128 planes[Frustum::Count * 4];
+        for (uint32_t p = 0; p < Frustum::Count; ++p)
+        {
+            planes[p * 4 + 0] = _mm_set1_ps(frustum.planes[p].x);
+            planes[p * 4 + 1] = _mm_set1_ps(frustum.planes[p].y);
+            planes[p * 4 + 2] = _mm_set1_ps(frustum.planes[p].z);
+            planes[p * 4 + 3] = _mm_set1_ps(frustum.planes[p].w);
+        }
+
+        const __m128 signMask = _mm_set1_ps(-0.f);
+
+        for (uint32_t base = 0; base < count; base += 4)
+        {
+            __m128 centerX = _mm_loadu_ps(cx + base);
+            __m128 centerY = _mm_loadu_ps(cy + base);
+            __m128 centerZ = _mm_loadu_ps(cz + base);
+            __m128 extentX = _mm_loadu_ps(ex + base);
+            __m128 extentY = _mm_loadu_ps(ey + base);
+            __m128 extentZ = _mm_loadu_ps(ez + base);
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+            for (uint32_t p = 0; p < Frustum::Count; ++p)
+            {
+                __m128 nx = planes[p * 4 + 0];
+                __m128 ny = planes[p * 4 + 1];
+                __m128 nz = planes[p * 4 + 2];
+
+                // signed distance of the center and projected radius of the box onto the normal
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, centerX), _mm_mul_ps(ny, centerY)),
+                                             _mm_add_ps(_mm_mul_ps(nz, centerZ), planes[p * 4 + 3]));
+                __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, nx), extentX),
+                                                      _mm_mul_ps(_mm_andnot_ps(signMask, ny), extentY)),
+                                           _mm_mul_ps(_mm_andnot_ps(signMask, nz), extentZ));
+
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+            }
+
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(inside)) & tailMask(base, count, 4);
+            appendVisible(mask, base, visibleIndices);
+        }
+#else
+        frustumCullScalar(frustum, bounds, visibleIndices);
+#endif
+
+        return static_cast<uint32_t>(visibleIndices.size() - firstIndex);
+    }
+
+    uint32_t frustumCullScalar(const Frustum &frustum, const AABBArray &bounds, std::vector<uint32_t> &visibleIndices)
+    {
+        uint32_t count = bounds.size();
+        size_t firstIndex = visibleIndices.size();
+
+        const float* cx = bounds.data(AABBArray::CenterX);
+        const float* cy = bounds.data(AABBArray::CenterY);
+        const float* cz = bounds.data(AABBArray::CenterZ);
+        const float* ex = bounds.data(AABBArray::ExtentX);
+        const float* ey = bounds.data(AABBArray::ExtentY);
+        const float* ez = bounds.data(AABBArray::ExtentZ);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            BoundingBox bb(glm::vec3(cx[i] - ex[i], cy[i] - ey[i], cz[i] - ez[i]),
+                           glm::vec3(cx[i] + ex[i], cy[i] + ey[i], cz[i] + ez[i]));
+
+            if (frustum.intersects(bb))
+                visibleIndices.push_back(i);
+        }
+
+        return static_cast<uint32_t>(visibleIndices.size() - firstIndex);
+    }
+
+    BenchmarkResult benchmark(uint32_t instanceCount)
+    {
+        static constexpr uint32_t sIterations = 10;
+
+        std::mt19937 rng(instanceCount);
+        std::uniform_real_distribution<float> position(-500.f, 500.f);
+        std::uniform_real_distribution<float> size(0.5f, 5.f);
+
+        AABBArray bounds;
+        bounds.resize(instanceCount);
+
+        for (uint32_t i = 0; i < instanceCount; ++i)
+        {
+            glm::vec3 center(position(rng), position(rng), position(rng));
+            glm::vec3 extents(size(rng), size(rng), size(rng));
+            bounds.set(i, {center - extents, center + extents});
+        }
+
+        glm::mat4 projection = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 400.f);
+        glm::mat4 view = glm::lookAt(glm::vec3(0.f), glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f));
+        Frustum frustum(projection * view);
+
+        std::vector<uint32_t> scalarIndices;
+        std::vector<uint32_t> simdIndices;
+        scalarIndices.reserve(instanceCount);
+        simdIndices.reserve(instanceCount);
+
+        auto time = [&] (auto cullFunc, std::vector<uint32_t>& visibleIndices) {
+            auto start = std::chrono::steady_clock::now();
+
+            for (uint32_t i = 0; i < sIterations; ++i)
+            {
+                visibleIndices.clear();
+                cullFunc(frustum, bounds, visibleIndices);
+            }
+
+            return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() / sIterations;
+        };
+
+        BenchmarkResult result {};
+        result.instanceCount = instanceCount;
+        result.scalarMs = time(frustumCullScalar, scalarIndices);
+        result.simdMs = time(frustumCull, simdIndices);
+        result.visibleCount = static_cast<uint32_t>(simdIndices.size());
+
+        std::ranges::sort(scalarIndices);
+        std::ranges::sort(simdIndices);
+
+        std::vector<uint32_t> mismatches;
+        std::ranges::set_symmetric_difference(scalarIndices, simdIndices, std::back_inserter(mismatches));
+        result.mismatchCount = static_cast<uint32_t>(mismatches.size());
+
+        if (result.mismatchCount)
+        {
+            debugLog(std::format("Culling: {} culling differs from the scalar reference for {} of {} boxes, first at {}.",
+                                 simdPath(), result.mismatchCount, instanceCount, mismatches.front()),
+                     LogSeverity::Error);
+        }
+
+        return result;
+    }
+
+    const char* simdPath()
+    {
+#if defined(__AVX__)
+        return "AVX (8 wide)";
+#elif defined(__SSE2__)
+        return "SSE (4 wide)";
+#else
+        return "Scalar";
+#endif
+    }
+}
@@ -0,0 +1,70 @@
+//
+// Created by Gianni on 5/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_CULLING_HPP
+#define OPENGLRENDERINGENGINE_CULLING_HPP
+
+#include <glm/glm.hpp>
+#include "bounding_box.hpp"
+#include "frustum.hpp"
+
+// World space AABBs stored as structure of arrays (centers and extents) so they can be
+// frustum tested several at a time. Indices match the instance indices of the owning mesh.
+class AABBArray
+{
+public:
+    enum Component
+    {
+        CenterX,
+        CenterY,
+        CenterZ,
+        ExtentX,
+        ExtentY,
+        ExtentZ,
+        Count
+    };
+
+public:
+    AABBArray();
+
+    void resize(uint32_t count);
+    void set(uint32_t index, const BoundingBox& bb);
+    // moves the last box into index, same as the instance buffer does on removal
+    void swapRemove(uint32_t index);
+
+    uint32_t size() const;
+    // padded to a multiple of the widest SIMD lane count
+    const float* data(Component component) const;
+
+private:
+    uint32_t mSize;
+    std::array<std::vector<float>, Component::Count> mComponents;
+};
+
+namespace Culling
+{
+    struct BenchmarkResult
+    {
+        uint32_t instanceCount;
+        uint32_t visibleCount;
+        float scalarMs;
+        float simdMs;
+        // boxes only one of the two paths found visible, 0 when they agree
+        uint32_t mismatchCount;
+    };
+
+    // appends the indices of the boxes intersecting the frustum to visibleIndices, returns how many were added.
+    // tests 8 boxes at a time with AVX, 4 with SSE, one at a time otherwise
+    uint32_t frustumCull(const Frustum& frustum, const AABBArray& bounds, std::vector<uint32_t>& visibleIndices);
+
+    // reference path, also used for the benchmark comparison
+    uint32_t frustumCullScalar(const Frustum& frustum, const AABBArray& bounds, std::vector<uint32_t>& visibleIndices);
+
+    // culls instanceCount random boxes with both paths and compares their visible sets, doesn't need a GL context
+    BenchmarkResult benchmark(uint32_t instanceCount);
+
+    const char* simdPath();
+}
+
+#endif //OPENGLRENDERINGENGINE_CULLING_HPP
@@ -0,0 +1,191 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "draw_queue.hpp"
+
+static constexpr uint32_t sRadixBits = 8;
+static constexpr uint32_t sRadixSize = 1 << sRadixBits;
+static constexpr uint32_t sRadixPasses = 64 / sRadixBits;
+
+static constexpr uint64_t mask(uint32_t bits)
+{
+    return (uint64_t(1) << bits) - 1;
+}
+
+// for non negative floats the bit pattern orders the same as the value, the top bits of it are
+// a depth quantization that needs no near and far planes
+static uint64_t quantizeDepth(float viewDepth)
+{
+    uint32_t depthBits = std::bit_cast<uint32_t>(glm::max(viewDepth, 0.f));
+    return depthBits >> (32 - DrawQueue::DepthBits);
+}
+
+// LSD radix sort, stable. Passes where every key has the same digit are skipped, which with
+// mostly equal state bits is the majority of them
+void DrawQueue::radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+{
+    scratch.resize(entries.size());
+
+    for (uint32_t pass = 0; pass < sRadixPasses; ++pass)
+    {
+        uint32_t shift = pass * sRadixBits;
+        std::array<uint32_t, sRadixSize> offsets {};
+
+        for (const SortEntry& entry : entries)
+            ++offsets[(entry.key >> shift) & (sRadixSize - 1)];
+
+        if (std::find(offsets.begin(), offsets.end(), entries.size()) != offsets.end())
+            continue;
+
+        uint32_t offset = 0;
+        for (uint32_t& bucket : offsets)
+        {
+            uint32_t bucketSize = bucket;
+            bucket = offset;
+            offset += bucketSize;
+        }
+
+        for (const SortEntry& entry : entries)
+            scratch[offsets[(entry.key >> shift) & (sRadixSize - 1)]++] = entry;
+
+        entries.swap(scratch);
+    }
+}
+
+DrawQueue::DrawQueue()
+    : mStats()
+{
+}
+
+uint64_t DrawQueue::makeSortKey(Pass pass, uint32_t shader, uint32_t vertexArray, uint32_t material, float viewDepth)
+{
+    uint64_t depth = quantizeDepth(viewDepth);
+
+    if (pass == Transparent)
+        depth = mask(DepthBits) - depth;
+
+    return ((uint64_t(pass) & mask(PassBits)) << PassShift) |
+           ((uint64_t(shader) & mask(ShaderBits)) << ShaderShift) |
+           ((uint64_t(vertexArray) & mask(VertexArrayBits)) << VertexArrayShift) |
+           ((uint64_t(material) & mask(MaterialBits)) << MaterialShift) |
+           (depth << DepthShift);
+}
+
+void DrawQueue::clear()
+{
+    mPackets.clear();
+    mStats = {};
+}
+
+void DrawQueue::submit(const DrawPacket &packet)
+{
+    mPackets.push_back(packet);
+}
+
+void DrawQueue::sort()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    mSortEntries.resize(mPackets.size());
+    for (uint32_t i = 0; i < mPackets.size(); ++i)
+        mSortEntries[i] = {mPackets[i].sortKey, i};
+
+    radixSort(mSortEntries, mSortScratch);
+
+    mSortedPackets.resize(mPackets.size());
+    for (uint32_t i = 0; i < mSortEntries.size(); ++i)
+        mSortedPackets[i] = mPackets[mSortEntries[i].index];
+
+    mPackets.swap(mSortedPackets);
+
+    mStats.packetCount = static_cast<uint32_t>(mPackets.size());
+    mStats.sortMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<DrawCommand> DrawQueue::drawCommands() const
+{
+    std::vector<DrawCommand> drawCommands;
+    drawCommands.reserve(mPackets.size());
+
+    for (const DrawPacket& packet : mPackets)
+        drawCommands.push_back(packet.command);
+
+    return drawCommands;
+}
+
+void DrawQueue::execute(const IndirectBuffer &indirectBuffer)
+{
+    indirectBuffer.bind();
+
+    uint32_t batchStart = 0;
+
+    for (uint32_t i = 0; i < mPackets.size(); ++i)
+    {
+        const DrawPacket& packet = mPackets[i];
+        uint64_t changedBits = i == 0? ~uint64_t(0) : packet.sortKey ^ mPackets[i - 1].sortKey;
+
+        bool shaderChanged = changedBits & (mask(PassBits + ShaderBits) << ShaderShift);
+        bool vertexArrayChanged = changedBits & (mask(VertexArrayBits) << VertexArrayShift);
+        bool materialChanged = changedBits & (mask(MaterialBits) << MaterialShift);
+
+        if (shaderChanged || vertexArrayChanged || materialChanged)
+        {
+            if (i > batchStart)
+            {
+                glMultiDrawElementsIndirect(GL_TRIANGLES,
+                                            GL_UNSIGNED_INT,
+                                            reinterpret_cast<const void*>(batchStart * sizeof(DrawCommand)),
+                                            i - batchStart,
+                                            0);
+                ++mStats.batchCount;
+            }
+
+            batchStart = i;
+        }
+        else
+        {
+            ++mStats.stateChangesAvoided;
+        }
+
+        if (shaderChanged)
+        {
+            packet.shader->bind();
+            ++mStats.shaderChanges;
+        }
+
+        if (vertexArrayChanged)
+        {
+            packet.vertexArray->bind();
+            ++mStats.vertexArrayChanges;
+        }
+
+        if (materialChanged && packet.texture)
+        {
+            packet.texture->bind(0);
+            ++mStats.textureChanges;
+        }
+    }
+
+    if (mPackets.size() > batchStart)
+    {
+        glMultiDrawElementsIndirect(GL_TRIANGLES,
+                                    GL_UNSIGNED_INT,
+                                    reinterpret_cast<const void*>(batchStart * sizeof(DrawCommand)),
+                                    mPackets.size() - batchStart,
+                                    0);
+        ++mStats.batchCount;
+    }
+
+    indirectBuffer.unbind();
+}
+
+const std::vector<DrawPacket> &DrawQueue::packets() const
+{
+    return mPackets;
+}
+
+const DrawQueue::Stats &DrawQueue::stats() const
+{
+    return mStats;
+}
@@ -0,0 +1,114 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_DRAW_QUEUE_HPP
+#define OPENGLRENDERINGENGINE_DRAW_QUEUE_HPP
+
+#include <glad/glad.h>
+#include "../opengl/shader.hpp"
+#include "../opengl/buffer.hpp"
+#include "../opengl/texture.hpp"
+
+// layout of glMultiDrawElementsIndirect commands
+struct DrawCommand
+{
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+
+    bool operator==(const DrawCommand& other) const = default;
+};
+
+// one indirect draw and the state it needs. The texture is bound to unit 0 and is optional,
+// bindless materials don't need one
+struct DrawPacket
+{
+    uint64_t sortKey;
+    Shader* shader;
+    const VertexArray* vertexArray;
+    Texture* texture;
+    DrawCommand command;
+};
+
+// Draw packets are radix sorted by their key and walked in order. State is only bound when the
+// key bits that identify it change, and runs of packets sharing all state become a single
+// glMultiDrawElementsIndirect over consecutive commands.
+//
+// key layout, most significant first:
+// | pass 4 | shader 12 | vertex array 8 | material 20 | depth 20 |
+class DrawQueue
+{
+public:
+    enum Pass : uint32_t
+    {
+        DepthPrepass,
+        Opaque,
+        Transparent
+    };
+
+    struct Stats
+    {
+        uint32_t packetCount;
+        uint32_t batchCount;
+        uint32_t shaderChanges;
+        uint32_t vertexArrayChanges;
+        uint32_t textureChanges;
+        // packets that kept the state of the previous one
+        uint32_t stateChangesAvoided;
+        float sortMs;
+    };
+
+    static constexpr uint32_t PassBits = 4;
+    static constexpr uint32_t ShaderBits = 12;
+    static constexpr uint32_t VertexArrayBits = 8;
+    static constexpr uint32_t MaterialBits = 20;
+    static constexpr uint32_t DepthBits = 20;
+
+    static constexpr uint32_t DepthShift = 0;
+    static constexpr uint32_t MaterialShift = DepthShift + DepthBits;
+    static constexpr uint32_t VertexArrayShift = MaterialShift + MaterialBits;
+    static constexpr uint32_t ShaderShift = VertexArrayShift + VertexArrayBits;
+    static constexpr uint32_t PassShift = ShaderShift + ShaderBits;
+
+    static_assert(PassShift + PassBits == 64);
+
+public:
+    DrawQueue();
+
+    // opaque packets sort front to back, transparent ones back to front
+    static uint64_t makeSortKey(Pass pass, uint32_t shader, uint32_t vertexArray, uint32_t material, float viewDepth);
+
+    void clear();
+    void submit(const DrawPacket& packet);
+    void sort();
+
+    // the commands of the sorted packets, in the order they have to be in the indirect buffer
+    std::vector<DrawCommand> drawCommands() const;
+
+    // expects drawCommands() to be in the bound indirect buffer
+    void execute(const IndirectBuffer& indirectBuffer);
+
+    const std::vector<DrawPacket>& packets() const;
+    const Stats& stats() const;
+
+private:
+    struct SortEntry
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    static void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+private:
+    std::vector<DrawPacket> mPackets;
+    std::vector<DrawPacket> mSortedPackets;
+    std::vector<SortEntry> mSortEntries;
+    std::vector<SortEntry> mSortScratch;
+    Stats mStats;
+};
+
+#endif //OPENGLRENDERINGENGINE_DRAW_QUEUE_HPP
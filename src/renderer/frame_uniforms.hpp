@@ -0,0 +1,47 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_FRAME_UNIFORMS_HPP
+#define OPENGLRENDERINGENGINE_FRAME_UNIFORMS_HPP
+
+#include <glm/glm.hpp>
+
+// std140 layouts, mirrored by the blocks in shaders/include/frame_uniforms.glsl. Written to the
+// renderer's uniform ring: frame and view once per frame, a pass block per pass or shadow face
+
+struct FrameUniforms
+{
+    // seconds
+    float time;
+    float deltaTime;
+    uint32_t frameIndex;
+    uint32_t padding;
+};
+
+struct ViewUniforms
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::mat4 inverseView;
+    glm::mat4 inverseProjection;
+    glm::mat4 inverseViewProjection;
+    glm::vec4 position;
+    // sub-pixel offset of the projection in pixels, zero until something jitters it
+    glm::vec2 jitter;
+    glm::vec2 viewportSize;
+    float nearZ;
+    float farZ;
+    glm::vec2 padding;
+};
+
+// what the vertex shader projects with, the camera for the scene and the light for shadows
+struct PassUniforms
+{
+    glm::mat4 viewProjection;
+    glm::vec2 viewportSize;
+    glm::vec2 padding;
+};
+
+#endif //OPENGLRENDERINGENGINE_FRAME_UNIFORMS_HPP
@@ -0,0 +1,80 @@
+//
+// Created by Gianni on 4/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_FRUSTUM_HPP
+#define OPENGLRENDERINGENGINE_FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+#include "bounding_box.hpp"
+
+struct Frustum
+{
+    enum Plane
+    {
+        Left,
+        Right,
+        Bottom,
+        Top,
+        Near,
+        Far,
+        Count
+    };
+
+    // planes point inwards, xyz is the normal and w the distance
+    std::array<glm::vec4, Plane::Count> planes;
+
+    Frustum() = default;
+
+    // Gribb/Hartmann plane extraction for OpenGL clip space
+    Frustum(const glm::mat4& viewProjection)
+    {
+        glm::mat4 m = glm::transpose(viewProjection);
+
+        planes[Left] = m[3] + m[0];
+        planes[Right] = m[3] - m[0];
+        planes[Bottom] = m[3] + m[1];
+        planes[Top] = m[3] - m[1];
+        planes[Near] = m[3] + m[2];
+        planes[Far] = m[3] - m[2];
+
+        for (glm::vec4& plane : planes)
+            plane /= glm::length(glm::vec3(plane));
+    }
+
+    bool intersects(const BoundingBox& bb) const
+    {
+        glm::vec3 center = bb.center();
+        glm::vec3 extents = bb.extents();
+
+        for (const glm::vec4& plane : planes)
+        {
+            glm::vec3 normal(plane);
+            float radius = glm::dot(extents, glm::abs(normal));
+
+            if (glm::dot(normal, center) + plane.w < -radius)
+                return false;
+        }
+
+        return true;
+    }
+
+    bool contains(const BoundingBox& bb) const
+    {
+        glm::vec3 center = bb.center();
+        glm::vec3 extents = bb.extents();
+
+        for (const glm::vec4& plane : planes)
+        {
+            glm::vec3 normal(plane);
+            float radius = glm::dot(extents, glm::abs(normal));
+
+            if (glm::dot(normal, center) + plane.w < radius)
+                return false;
+        }
+
+        return true;
+    }
+};
+
+#endif //OPENGLRENDERINGENGINE_FRUSTUM_HPP
@@ -0,0 +1,201 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "geometry_arena.hpp"
+
+static constexpr uint32_t sVertexSize = sizeof(Vertex);
+static constexpr uint32_t sIndexSize = sizeof(uint32_t);
+static constexpr uint32_t sInitialVertexCapacity = 1 << 16;
+static constexpr uint32_t sInitialIndexCapacity = 1 << 18;
+static constexpr uint32_t sMeshDataSize = sizeof(GeometryArena::MeshData);
+static constexpr uint32_t sInitialMeshCapacity = 256;
+
+GeometryArena &GeometryArena::instance()
+{
+    static GeometryArena* arena = new GeometryArena();
+    return *arena;
+}
+
+GeometryArena::GeometryArena()
+    : mVertexBuffer(GL_STATIC_DRAW, sInitialVertexCapacity * sVertexSize, nullptr)
+    , mIndexBuffer(sInitialIndexCapacity, nullptr)
+    , mMeshBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, MeshBufferBinding, sInitialMeshCapacity * sMeshDataSize, nullptr)
+    , mVertexRanges(sInitialVertexCapacity)
+    , mIndexRanges(sInitialIndexCapacity)
+    , mMeshSlots(sInitialMeshCapacity)
+{
+    mVertexArray.attachVertexBuffer(mVertexBuffer, getVertexBufferLayout(), 0);
+    mVertexArray.attachIndexBuffer(mIndexBuffer);
+}
+
+GeometryArena::Allocation GeometryArena::allocate(const std::vector<Vertex> &vertices,
+                                                  const std::vector<uint32_t> &indices,
+                                                  const std::optional<StagingAllocation>& staging)
+{
+    Allocation allocation {
+        .firstIndex = allocateIndices(indices.size()),
+        .indexCount = static_cast<uint32_t>(indices.size()),
+        .baseVertex = allocateVertices(vertices.size()),
+        .vertexCount = static_cast<uint32_t>(vertices.size()),
+        .meshIndex = allocateMeshIndex()
+    };
+
+    // indices stay relative to the mesh, the draw command adds baseVertex
+    if (staging)
+    {
+        // the buffers may have grown by the time the copy is recorded
+        UploadManager::instance().submit(*staging, [this, allocation] (uint32_t stagingBuffer, uint32_t offset) {
+            uint32_t vertexSize = allocation.vertexCount * sVertexSize;
+
+            glCopyNamedBufferSubData(stagingBuffer, mVertexBuffer.id(), offset, allocation.baseVertex * sVertexSize, vertexSize);
+            glCopyNamedBufferSubData(stagingBuffer, mIndexBuffer.id(), offset + vertexSize, allocation.firstIndex * sIndexSize, allocation.indexCount * sIndexSize);
+        });
+    }
+    else
+    {
+        mVertexBuffer.update(allocation.baseVertex * sVertexSize, allocation.vertexCount * sVertexSize, vertices.data());
+        mIndexBuffer.update(allocation.firstIndex * sIndexSize, allocation.indexCount * sIndexSize, indices.data());
+    }
+
+    BoundingBox bounds;
+    for (const Vertex& vertex : vertices)
+        bounds.expand(vertex.position);
+
+    MeshData meshData {
+        .boundsMin = glm::vec4(bounds.min, 1.f),
+        .boundsMax = glm::vec4(bounds.max, 1.f),
+        .indexCount = allocation.indexCount,
+        .firstIndex = allocation.firstIndex,
+        .baseVertex = static_cast<int32_t>(allocation.baseVertex)
+    };
+
+    mMeshBuffer.update(allocation.meshIndex * sMeshDataSize, sMeshDataSize, &meshData);
+
+    return allocation;
+}
+
+std::optional<StagingAllocation> GeometryArena::stage(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices)
+{
+    uint32_t vertexSize = static_cast<uint32_t>(vertices.size()) * sVertexSize;
+    uint32_t indexSize = static_cast<uint32_t>(indices.size()) * sIndexSize;
+
+    auto staging = UploadManager::instance().allocate(vertexSize + indexSize);
+
+    if (staging)
+    {
+        std::memcpy(staging->data, vertices.data(), vertexSize);
+        std::memcpy(staging->data + vertexSize, indices.data(), indexSize);
+    }
+
+    return staging;
+}
+
+void GeometryArena::free(const Allocation &allocation)
+{
+    mVertexRanges.free(allocation.baseVertex, allocation.vertexCount);
+    mIndexRanges.free(allocation.firstIndex, allocation.indexCount);
+
+    // the mesh data can stay, no instance refers to it anymore
+    if (allocation.meshIndex != InvalidMeshIndex)
+        mMeshSlots.free(allocation.meshIndex, 1);
+}
+
+const VertexArray &GeometryArena::vertexArray() const
+{
+    return mVertexArray;
+}
+
+uint32_t GeometryArena::vertexCount() const
+{
+    return mVertexRanges.allocated();
+}
+
+uint32_t GeometryArena::indexCount() const
+{
+    return mIndexRanges.allocated();
+}
+
+uint32_t GeometryArena::vertexCapacity() const
+{
+    return mVertexRanges.capacity();
+}
+
+uint32_t GeometryArena::indexCapacity() const
+{
+    return mIndexRanges.capacity();
+}
+
+uint32_t GeometryArena::meshSlotCount() const
+{
+    return mMeshSlots.highWaterMark();
+}
+
+uint32_t GeometryArena::allocateVertices(uint32_t count)
+{
+    if (auto offset = mVertexRanges.allocate(count))
+        return *offset;
+
+    uint32_t usedCapacity = mVertexRanges.highWaterMark();
+    uint32_t newCapacity = glm::max(mVertexRanges.capacity() * 2, usedCapacity + count);
+    VertexBuffer newVertexBuffer(GL_STATIC_DRAW, newCapacity * sVertexSize, nullptr);
+
+    glCopyNamedBufferSubData(mVertexBuffer.id(), newVertexBuffer.id(), 0, 0, usedCapacity * sVertexSize);
+
+    mVertexBuffer = std::move(newVertexBuffer);
+    mVertexArray.attachVertexBuffer(mVertexBuffer, getVertexBufferLayout(), 0);
+    mVertexRanges.grow(newCapacity);
+
+    return *mVertexRanges.allocate(count);
+}
+
+uint32_t GeometryArena::allocateIndices(uint32_t count)
+{
+    if (auto offset = mIndexRanges.allocate(count))
+        return *offset;
+
+    uint32_t usedCapacity = mIndexRanges.highWaterMark();
+    uint32_t newCapacity = glm::max(mIndexRanges.capacity() * 2, usedCapacity + count);
+    IndexBuffer newIndexBuffer(newCapacity, nullptr);
+
+    glCopyNamedBufferSubData(mIndexBuffer.id(), newIndexBuffer.id(), 0, 0, usedCapacity * sIndexSize);
+
+    mIndexBuffer = std::move(newIndexBuffer);
+    mVertexArray.attachIndexBuffer(mIndexBuffer);
+    mIndexRanges.grow(newCapacity);
+
+    return *mIndexRanges.allocate(count);
+}
+
+uint32_t GeometryArena::allocateMeshIndex()
+{
+    if (auto meshIndex = mMeshSlots.allocate(1))
+        return *meshIndex;
+
+    uint32_t usedCapacity = mMeshSlots.highWaterMark();
+    uint32_t newCapacity = mMeshSlots.capacity() * 2;
+    ShaderBuffer newMeshBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, MeshBufferBinding, newCapacity * sMeshDataSize, nullptr);
+
+    glCopyNamedBufferSubData(mMeshBuffer.id(), newMeshBuffer.id(), 0, 0, usedCapacity * sMeshDataSize);
+
+    mMeshBuffer = std::move(newMeshBuffer);
+    mMeshSlots.grow(newCapacity);
+
+    return *mMeshSlots.allocate(1);
+}
+
+VertexBufferLayout GeometryArena::getVertexBufferLayout()
+{
+    VertexBufferLayout layout;
+
+    layout.setStride(sVertexSize);
+    layout.setStepRate(StepRate::Vertex);
+
+    layout.addAttribute(0, 3, GL_FLOAT, offsetof(Vertex, position));
+    layout.addAttribute(1, 2, GL_FLOAT, offsetof(Vertex, texCoords));
+    layout.addAttribute(2, 3, GL_FLOAT, offsetof(Vertex, normal));
+    layout.addAttribute(3, 3, GL_FLOAT, offsetof(Vertex, tangent));
+    layout.addAttribute(4, 3, GL_FLOAT, offsetof(Vertex, bitangent));
+
+    return layout;
+}
@@ -0,0 +1,89 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_GEOMETRY_ARENA_HPP
+#define OPENGLRENDERINGENGINE_GEOMETRY_ARENA_HPP
+
+#include "../opengl/buffer.hpp"
+#include "../opengl/upload_manager.hpp"
+#include "../app/range_allocator.hpp"
+#include "vertex.hpp"
+#include "bounding_box.hpp"
+
+inline constexpr uint32_t InvalidMeshIndex = UINT32_MAX;
+
+// One vertex buffer, one index buffer and one vertex array shared by every mesh, so all meshes
+// can be drawn with a single multi draw indirect call. Meshes get a range of each buffer;
+// the buffers grow (copying the old contents) when a range doesn't fit.
+// Every mesh also gets an index into a mesh SSBO holding what the gpu needs to cull its
+// instances and write its draw command.
+class GeometryArena
+{
+public:
+    static constexpr uint32_t MeshBufferBinding = 5;
+
+    struct Allocation
+    {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        uint32_t baseVertex;
+        uint32_t vertexCount;
+        uint32_t meshIndex;
+    };
+
+    // std430 layout, mirrored by MeshData in the shaders
+    struct MeshData
+    {
+        glm::vec4 boundsMin;
+        glm::vec4 boundsMax;
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t baseVertex;
+        uint32_t padding;
+    };
+
+public:
+    // created on first use, which needs to happen on the main thread with a context current.
+    // never destroyed: the context is already gone by the time statics are torn down
+    static GeometryArena& instance();
+
+    // with staging, the vertices and indices are copied from it by the upload manager
+    Allocation allocate(const std::vector<Vertex>& vertices,
+                        const std::vector<uint32_t>& indices,
+                        const std::optional<StagingAllocation>& staging = std::nullopt);
+    // any thread, vertices then indices in one staging allocation
+    static std::optional<StagingAllocation> stage(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+    void free(const Allocation& allocation);
+
+    const VertexArray& vertexArray() const;
+
+    uint32_t vertexCount() const;
+    uint32_t indexCount() const;
+    uint32_t vertexCapacity() const;
+    uint32_t indexCapacity() const;
+    // every mesh index past this one is free
+    uint32_t meshSlotCount() const;
+
+private:
+    GeometryArena();
+
+    uint32_t allocateVertices(uint32_t count);
+    uint32_t allocateIndices(uint32_t count);
+    uint32_t allocateMeshIndex();
+
+    static VertexBufferLayout getVertexBufferLayout();
+
+private:
+    VertexArray mVertexArray;
+    VertexBuffer mVertexBuffer;
+    IndexBuffer mIndexBuffer;
+
+    ShaderBuffer mMeshBuffer;
+
+    RangeAllocator mVertexRanges;
+    RangeAllocator mIndexRanges;
+    RangeAllocator mMeshSlots;
+};
+
+#endif //OPENGLRENDERINGENGINE_GEOMETRY_ARENA_HPP
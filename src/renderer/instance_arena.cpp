@@ -0,0 +1,108 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "instance_arena.hpp"
+
+static constexpr uint32_t sInstanceSize = sizeof(InstanceData);
+static constexpr uint32_t sInitialCapacity = 1024;
+
+static_assert(sInstanceSize % 16 == 0, "InstanceData must match the std430 array stride");
+
+InstanceArena &InstanceArena::instance()
+{
+    static InstanceArena* arena = new InstanceArena();
+    return *arena;
+}
+
+InstanceArena::InstanceArena()
+    : mInstanceBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, InstanceBufferBinding, sInitialCapacity * sInstanceSize, nullptr)
+    , mSlots(sInitialCapacity)
+    , mChangeCount()
+{
+    invalidate(0, sInitialCapacity);
+}
+
+uint32_t InstanceArena::allocate(uint32_t count)
+{
+    ++mChangeCount;
+
+    if (auto firstSlot = mSlots.allocate(count))
+        return *firstSlot;
+
+    grow(count);
+
+    return *mSlots.allocate(count);
+}
+
+void InstanceArena::free(uint32_t firstSlot, uint32_t count)
+{
+    mSlots.free(firstSlot, count);
+    invalidate(firstSlot, count);
+    ++mChangeCount;
+}
+
+void InstanceArena::update(uint32_t firstSlot, uint32_t count, const InstanceData *instances)
+{
+    mInstanceBuffer.update(firstSlot * sInstanceSize, count * sInstanceSize, instances);
+    ++mChangeCount;
+}
+
+void InstanceArena::reserve(uint32_t count)
+{
+    if (mSlots.largestFreeRange() < count)
+        grow(count);
+}
+
+const ShaderBuffer &InstanceArena::buffer() const
+{
+    return mInstanceBuffer;
+}
+
+uint32_t InstanceArena::instanceCount() const
+{
+    return mSlots.allocated();
+}
+
+uint32_t InstanceArena::capacity() const
+{
+    return mSlots.capacity();
+}
+
+uint32_t InstanceArena::slotCount() const
+{
+    return mSlots.highWaterMark();
+}
+
+uint64_t InstanceArena::changeCount() const
+{
+    return mChangeCount;
+}
+
+void InstanceArena::grow(uint32_t minFreeSlots)
+{
+    uint32_t usedCapacity = mSlots.highWaterMark();
+    uint32_t newCapacity = glm::max(mSlots.capacity() * 2, usedCapacity + minFreeSlots);
+    ShaderBuffer newInstanceBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, InstanceBufferBinding, newCapacity * sInstanceSize, nullptr);
+
+    glCopyNamedBufferSubData(mInstanceBuffer.id(), newInstanceBuffer.id(), 0, 0, usedCapacity * sInstanceSize);
+
+    mInstanceBuffer = std::move(newInstanceBuffer);
+    mSlots.grow(newCapacity);
+
+    invalidate(usedCapacity, newCapacity - usedCapacity);
+}
+
+// fills the slots with 0xFF bytes, which makes meshIndex InvalidMeshIndex
+void InstanceArena::invalidate(uint32_t firstSlot, uint32_t count)
+{
+    static constexpr uint32_t sInvalid = UINT32_MAX;
+
+    glClearNamedBufferSubData(mInstanceBuffer.id(),
+                              GL_R32UI,
+                              firstSlot * sInstanceSize,
+                              count * sInstanceSize,
+                              GL_RED_INTEGER,
+                              GL_UNSIGNED_INT,
+                              &sInvalid);
+}
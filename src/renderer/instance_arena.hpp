@@ -0,0 +1,65 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_INSTANCE_ARENA_HPP
+#define OPENGLRENDERINGENGINE_INSTANCE_ARENA_HPP
+
+#include <glm/glm.hpp>
+#include "../opengl/buffer.hpp"
+#include "../app/range_allocator.hpp"
+#include "geometry_arena.hpp"
+
+// std430 layout, mirrored by InstanceData in the shaders
+struct InstanceData
+{
+    glm::mat4 modelMatrix;
+    glm::mat4 normalMatrix;
+    uint32_t id;
+    uint32_t materialIndex;
+    // GeometryArena mesh index, free slots hold InvalidMeshIndex so the culling pass skips them
+    uint32_t meshIndex;
+    uint32_t padding;
+};
+
+// Instance data of every mesh in a single SSBO. Each instance lives in a slot; draw commands
+// reach their instances through a list of slot indices, so the slots of a mesh don't need to
+// be contiguous and removing an instance never moves another one.
+class InstanceArena
+{
+public:
+    static constexpr uint32_t InstanceBufferBinding = 3;
+
+public:
+    // same lifetime rules as GeometryArena::instance()
+    static InstanceArena& instance();
+
+    // returns the first of count contiguous slots
+    uint32_t allocate(uint32_t count);
+    void free(uint32_t firstSlot, uint32_t count);
+    void update(uint32_t firstSlot, uint32_t count, const InstanceData* instances);
+
+    // makes sure count contiguous slots can be allocated without growing the buffer
+    void reserve(uint32_t count);
+
+    const ShaderBuffer& buffer() const;
+    uint32_t instanceCount() const;
+    uint32_t capacity() const;
+    // every slot past this one is free
+    uint32_t slotCount() const;
+    // bumped by every allocation, free and update, caches of the instance data compare against it
+    uint64_t changeCount() const;
+
+private:
+    InstanceArena();
+
+    void grow(uint32_t minFreeSlots);
+    void invalidate(uint32_t firstSlot, uint32_t count);
+
+private:
+    ShaderBuffer mInstanceBuffer;
+    RangeAllocator mSlots;
+    uint64_t mChangeCount;
+};
+
+#endif //OPENGLRENDERINGENGINE_INSTANCE_ARENA_HPP
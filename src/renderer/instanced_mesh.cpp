@@ -4,151 +4,241 @@
 
 #include "instanced_mesh.hpp"
 
-static constexpr uint32_t sVertexSize = sizeof(Vertex);
-static constexpr uint32_t sInstanceSize = sizeof(InstancedMesh::InstanceData);
-static constexpr uint32_t sInitialInstanceBufferCapacity = 32;
-
 InstancedMesh::InstancedMesh()
-    : mInstanceCount()
-    , mInstanceBufferCapacity(sInitialInstanceBufferCapacity)
+    : mGeometry({.meshIndex = InvalidMeshIndex})
+    , mInstanceCount()
 {
 }
 
-InstancedMesh::InstancedMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
-    : mIndexBuffer(indices.size(), indices.data())
-    , mVertexBuffer(GL_STATIC_DRAW, vertices.size() * sVertexSize, vertices.data())
-    , mInstanceBuffer(GL_DYNAMIC_DRAW, sInitialInstanceBufferCapacity * sInstanceSize, nullptr)
+InstancedMesh::InstancedMesh(const std::vector<Vertex>& vertices,
+                             const std::vector<uint32_t>& indices,
+                             const std::optional<StagingAllocation>& staging)
+    : mGeometry(GeometryArena::instance().allocate(vertices, indices, staging))
     , mInstanceCount()
-    , mInstanceBufferCapacity(sInitialInstanceBufferCapacity)
 {
-    mVertexArray.attachIndexBuffer(mIndexBuffer);
-    mVertexArray.attachVertexBuffer(mVertexBuffer, getVertexBufferLayout(), 0);
-    mVertexArray.attachVertexBuffer(mInstanceBuffer, getInstanceBufferLayout(), 1);
+    for (const Vertex& vertex : vertices)
+        mBoundingBox.expand(vertex.position);
 }
 
-uint32_t InstancedMesh::addInstance(const glm::mat4 &model, uint32_t id, uint32_t materialIndex)
+InstancedMesh::~InstancedMesh()
 {
-    checkResize();
+    GeometryArena::instance().free(mGeometry);
 
-    ++mInstanceCount;
+    for (uint32_t slot : mInstanceSlots)
+        InstanceArena::instance().free(slot, 1);
+}
 
+uint32_t InstancedMesh::addInstance(const glm::mat4 &model, uint32_t id, uint32_t materialIndex)
+{
     uint32_t instanceID = generateInstanceID();
-    uint32_t instanceIndex = mInstanceCount - 1;
+    uint32_t instanceIndex = mInstanceCount++;
+    uint32_t slot = InstanceArena::instance().allocate(1);
 
-    assert(mInstanceIdToIndexMap.emplace(instanceID, instanceIndex).second);
-    assert(mInstanceIndexToIdMap.emplace(instanceIndex, instanceID).second);
+    mInstanceIdToIndexMap.emplace(instanceID, instanceIndex);
+    mInstanceIndexToIdMap.emplace(instanceIndex, instanceID);
+    mInstanceSlots.push_back(slot);
 
-    InstancedMesh::InstanceData instanceData {
-        .modelMatrix = model,
-        .normalMatrix = glm::inverseTranspose(glm::mat3(model)),
-        .id = id,
-        .materialIndex = materialIndex
-    };
+    InstanceData instanceData = makeInstanceData(model, id, materialIndex);
+    instanceData.meshIndex = mGeometry.meshIndex;
+    InstanceArena::instance().update(slot, 1, &instanceData);
 
-    mInstanceBuffer.update(instanceID * sInstanceSize, sInstanceSize, &instanceData);
+    mInstanceBounds.resize(mInstanceCount);
+    mInstanceBounds.set(instanceIndex, mBoundingBox.transform(model));
+    mInstanceMaterials.push_back(materialIndex);
 
     return instanceID;
 }
 
+// appends all instances behind the existing ones and uploads them with a single call
+std::vector<uint32_t> InstancedMesh::addInstances(std::vector<InstanceData> instances)
+{
+    std::vector<uint32_t> instanceIDs;
+
+    if (instances.empty())
+        return instanceIDs;
+
+    uint32_t firstIndex = mInstanceCount;
+    uint32_t count = static_cast<uint32_t>(instances.size());
+
+    reserve(mInstanceCount + count);
+    instanceIDs.reserve(count);
+
+    uint32_t firstSlot = InstanceArena::instance().allocate(count);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t instanceID = generateInstanceID();
+
+        mInstanceIdToIndexMap.emplace(instanceID, firstIndex + i);
+        mInstanceIndexToIdMap.emplace(firstIndex + i, instanceID);
+        mInstanceSlots.push_back(firstSlot + i);
+        mInstanceMaterials.push_back(instances[i].materialIndex);
+        instanceIDs.push_back(instanceID);
+
+        instances[i].meshIndex = mGeometry.meshIndex;
+    }
+
+    mInstanceCount += count;
+    InstanceArena::instance().update(firstSlot, count, instances.data());
+
+    mInstanceBounds.resize(mInstanceCount);
+    for (uint32_t i = 0; i < count; ++i)
+        mInstanceBounds.set(firstIndex + i, mBoundingBox.transform(instances[i].modelMatrix));
+
+    return instanceIDs;
+}
+
 void InstancedMesh::updateInstance(uint32_t instanceID, const glm::mat4 &model, uint32_t id, uint32_t materialIndex)
 {
     uint32_t instanceIndex = mInstanceIdToIndexMap.at(instanceID);
 
-    InstancedMesh::InstanceData instanceData {
-        .modelMatrix = model,
-        .normalMatrix = glm::inverseTranspose(glm::mat3(model)),
-        .id = id,
-        .materialIndex = materialIndex
-    };
+    InstanceData instanceData = makeInstanceData(model, id, materialIndex);
+    instanceData.meshIndex = mGeometry.meshIndex;
+    InstanceArena::instance().update(mInstanceSlots.at(instanceIndex), 1, &instanceData);
 
-    mInstanceBuffer.update(instanceIndex * sInstanceSize, sInstanceSize, &instanceData);
+    mInstanceBounds.set(instanceIndex, mBoundingBox.transform(model));
+    mInstanceMaterials.at(instanceIndex) = materialIndex;
 }
 
+// the instance data stays in its slot, only the per mesh arrays are compacted
 void InstancedMesh::removeInstance(uint32_t instanceID)
 {
-    // edge case:  last instance in buffer
     uint32_t removeIndex = mInstanceIdToIndexMap.at(instanceID);
+    uint32_t lastIndex = mInstanceCount - 1;
+
+    InstanceArena::instance().free(mInstanceSlots.at(removeIndex), 1);
+
     mInstanceIdToIndexMap.erase(instanceID);
+    mInstanceSlots.at(removeIndex) = mInstanceSlots.back();
+    mInstanceSlots.pop_back();
+    mInstanceBounds.swapRemove(removeIndex);
+    mInstanceMaterials.at(removeIndex) = mInstanceMaterials.back();
+    mInstanceMaterials.pop_back();
+    --mInstanceCount;
 
-    if (removeIndex == mInstanceCount - 1)
+    // edge case:  last instance in buffer
+    if (removeIndex == lastIndex)
     {
-        --mInstanceCount;
         mInstanceIndexToIdMap.erase(removeIndex);
         return;
     }
 
-    // regular case: Instance is in range [first, last)
-    uint32_t lastIndex = mInstanceCount - 1;
-
-    glCopyNamedBufferSubData(mInstanceBuffer.id(),
-                             mInstanceBuffer.id(),
-                             lastIndex * sInstanceSize,
-                             removeIndex * sInstanceSize,
-                             sInstanceSize);
-
+    // regular case: Instance is in range [first, last). The last instance takes its index
     uint32_t lastIndexInstanceID = mInstanceIndexToIdMap.at(lastIndex);
     mInstanceIdToIndexMap.at(lastIndexInstanceID) = removeIndex;
     mInstanceIndexToIdMap.at(removeIndex) = lastIndexInstanceID;
+    mInstanceIndexToIdMap.erase(lastIndex);
 }
 
-void InstancedMesh::checkResize()
+void InstancedMesh::reserve(uint32_t instanceCount)
 {
-    if (mInstanceCount < mInstanceBufferCapacity)
+    if (instanceCount <= mInstanceCount)
         return;
 
-    uint32_t newCapacity = sInstanceSize * glm::ceil(glm::log2(static_cast<float>(mInstanceCount)));
-    VertexBuffer newInstanceBuffer(GL_DYNAMIC_DRAW, newCapacity, nullptr);
+    InstanceArena::instance().reserve(instanceCount - mInstanceCount);
 
-    glCopyNamedBufferSubData(mInstanceBuffer.id(),
-                             newInstanceBuffer.id(),
-                             0, 0, mInstanceBufferCapacity * sInstanceSize);
+    mInstanceSlots.reserve(instanceCount);
+    mInstanceMaterials.reserve(instanceCount);
+    mInstanceIdToIndexMap.reserve(instanceCount);
+    mInstanceIndexToIdMap.reserve(instanceCount);
+}
 
-    mInstanceBuffer = std::move(newInstanceBuffer);
-    mInstanceBufferCapacity = newCapacity;
+uint32_t InstancedMesh::cull(const Frustum &frustum)
+{
+    mVisibleInstances.clear();
+    return Culling::frustumCull(frustum, mInstanceBounds, mVisibleInstances);
+}
 
-    mVertexArray.attachVertexBuffer(mInstanceBuffer, getInstanceBufferLayout(), 1);
+uint32_t InstancedMesh::cull(const Frustum &frustum, std::vector<uint32_t> &visibleInstances) const
+{
+    visibleInstances.clear();
+    return Culling::frustumCull(frustum, mInstanceBounds, visibleInstances);
 }
 
-uint32_t InstancedMesh::generateInstanceID()
+uint32_t InstancedMesh::instanceCount() const
 {
-    static uint32_t counter = 0;
-    return counter++;
+    return mInstanceCount;
 }
 
-VertexBufferLayout InstancedMesh::getVertexBufferLayout()
+const BoundingBox &InstancedMesh::boundingBox() const
 {
-    VertexBufferLayout layout;
+    return mBoundingBox;
+}
+
+BoundingBox InstancedMesh::instanceBounds() const
+{
+    BoundingBox bounds;
+
+    for (uint32_t i = 0; i < mInstanceCount; ++i)
+    {
+        glm::vec3 center(mInstanceBounds.data(AABBArray::CenterX)[i],
+                         mInstanceBounds.data(AABBArray::CenterY)[i],
+                         mInstanceBounds.data(AABBArray::CenterZ)[i]);
+        glm::vec3 extents(mInstanceBounds.data(AABBArray::ExtentX)[i],
+                          mInstanceBounds.data(AABBArray::ExtentY)[i],
+                          mInstanceBounds.data(AABBArray::ExtentZ)[i]);
+
+        bounds.expand(BoundingBox(center - extents, center + extents));
+    }
 
-    layout.setStride(sVertexSize);
-    layout.setStepRate(StepRate::Vertex);
+    return bounds;
+}
 
-    layout.addAttribute(0, 3, GL_FLOAT, offsetof(Vertex, position));
-    layout.addAttribute(1, 2, GL_FLOAT, offsetof(Vertex, texCoords));
-    layout.addAttribute(2, 3, GL_FLOAT, offsetof(Vertex, normal));
-    layout.addAttribute(3, 3, GL_FLOAT, offsetof(Vertex, tangent));
-    layout.addAttribute(4, 3, GL_FLOAT, offsetof(Vertex, bitangent));
+const std::vector<uint32_t> &InstancedMesh::visibleInstances() const
+{
+    return mVisibleInstances;
+}
 
-    return layout;
+const AABBArray &InstancedMesh::instanceBoxes() const
+{
+    return mInstanceBounds;
+}
+
+const std::vector<uint32_t> &InstancedMesh::instanceMaterials() const
+{
+    return mInstanceMaterials;
 }
 
-VertexBufferLayout InstancedMesh::getInstanceBufferLayout()
+float InstancedMesh::nearestVisibleDepth(const glm::vec3 &viewPosition, const glm::vec3 &viewDirection) const
 {
-    VertexBufferLayout layout;
+    const float* centerX = mInstanceBounds.data(AABBArray::CenterX);
+    const float* centerY = mInstanceBounds.data(AABBArray::CenterY);
+    const float* centerZ = mInstanceBounds.data(AABBArray::CenterZ);
 
-    layout.setStride(sInstanceSize);
-    layout.setStepRate(StepRate::Instance);
+    float nearestDepth = std::numeric_limits<float>::max();
 
-    layout.addAttribute(5, 4, GL_FLOAT, offsetof(InstancedMesh::InstanceData, modelMatrix));
-    layout.addAttribute(6, 4, GL_FLOAT, offsetof(InstancedMesh::InstanceData, modelMatrix) + sizeof(glm::vec4));
-    layout.addAttribute(7, 4, GL_FLOAT, offsetof(InstancedMesh::InstanceData, modelMatrix) + sizeof(glm::vec4) * 2);
-    layout.addAttribute(8, 4, GL_FLOAT, offsetof(InstancedMesh::InstanceData, modelMatrix) + sizeof(glm::vec4) * 3);
+    for (uint32_t instanceIndex : mVisibleInstances)
+    {
+        glm::vec3 center(centerX[instanceIndex], centerY[instanceIndex], centerZ[instanceIndex]);
+        nearestDepth = glm::min(nearestDepth, glm::dot(center - viewPosition, viewDirection));
+    }
 
-    layout.addAttribute(9, 4, GL_FLOAT, offsetof(InstancedMesh::InstanceData, normalMatrix));
-    layout.addAttribute(10, 4, GL_FLOAT, offsetof(InstancedMesh::InstanceData, normalMatrix) + sizeof(glm::vec4));
-    layout.addAttribute(11, 4, GL_FLOAT, offsetof(InstancedMesh::InstanceData, normalMatrix) + sizeof(glm::vec4) * 2);
+    return nearestDepth;
+}
+
+const GeometryArena::Allocation &InstancedMesh::geometry() const
+{
+    return mGeometry;
+}
+
+const std::vector<uint32_t> &InstancedMesh::instanceSlots() const
+{
+    return mInstanceSlots;
+}
 
-    layout.addAttribute(12, 1, GL_UNSIGNED_INT, offsetof(InstancedMesh::InstanceData, id));
-    layout.addAttribute(13, 1, GL_UNSIGNED_INT, offsetof(InstancedMesh::InstanceData, materialIndex));
+InstancedMesh::InstanceData InstancedMesh::makeInstanceData(const glm::mat4 &model, uint32_t id, uint32_t materialIndex)
+{
+    return {
+        .modelMatrix = model,
+        .normalMatrix = glm::mat4(glm::inverseTranspose(glm::mat3(model))),
+        .id = id,
+        .materialIndex = materialIndex,
+        .meshIndex = InvalidMeshIndex
+    };
+}
 
-    return layout;
+uint32_t InstancedMesh::generateInstanceID()
+{
+    static uint32_t counter = 0;
+    return counter++;
 }
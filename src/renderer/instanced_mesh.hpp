@@ -7,43 +7,72 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
-#include "../opengl/buffer.hpp"
 #include "vertex.hpp"
+#include "bounding_box.hpp"
+#include "culling.hpp"
+#include "geometry_arena.hpp"
+#include "instance_arena.hpp"
 
 class InstancedMesh
 {
 public:
-    struct InstanceData
-    {
-        glm::mat4 modelMatrix;
-        glm::mat3 normalMatrix;
-        uint32_t id;
-        uint32_t materialIndex;
-    };
+    using InstanceData = ::InstanceData;
 
 public:
     InstancedMesh();
-    InstancedMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+    InstancedMesh(const std::vector<Vertex>& vertices,
+                  const std::vector<uint32_t>& indices,
+                  const std::optional<StagingAllocation>& staging = std::nullopt);
+    ~InstancedMesh();
+
+    InstancedMesh(const InstancedMesh&) = delete;
+    InstancedMesh& operator=(const InstancedMesh&) = delete;
 
     uint32_t addInstance(const glm::mat4& model, uint32_t id, uint32_t materialIndex);
+    std::vector<uint32_t> addInstances(std::vector<InstanceData> instances);
     void updateInstance(uint32_t instanceID, const glm::mat4& model, uint32_t id, uint32_t materialIndex);
     void removeInstance(uint32_t instanceID);
+    void reserve(uint32_t instanceCount);
+
+    // rebuilds the list of instance indices inside the frustum, returns the visible count
+    uint32_t cull(const Frustum& frustum);
+    // same test into a caller owned list, for views other than the camera's
+    uint32_t cull(const Frustum& frustum, std::vector<uint32_t>& visibleInstances) const;
+
+    uint32_t instanceCount() const;
+    const BoundingBox& boundingBox() const;
+    // world space bounds of all instances
+    BoundingBox instanceBounds() const;
+    const std::vector<uint32_t>& visibleInstances() const;
+    // world space bounds and material index per instance index
+    const AABBArray& instanceBoxes() const;
+    const std::vector<uint32_t>& instanceMaterials() const;
+    // view depth of the closest visible instance center, for front to back sorting
+    float nearestVisibleDepth(const glm::vec3& viewPosition, const glm::vec3& viewDirection) const;
+    const GeometryArena::Allocation& geometry() const;
+    // instance index to instance arena slot
+    const std::vector<uint32_t>& instanceSlots() const;
+
+    static InstanceData makeInstanceData(const glm::mat4& model, uint32_t id, uint32_t materialIndex);
 
 private:
-    void checkResize();
     uint32_t generateInstanceID();
 
-    static VertexBufferLayout getVertexBufferLayout();
-    static VertexBufferLayout getInstanceBufferLayout();
-
 private:
-    VertexArray mVertexArray;
-    IndexBuffer mIndexBuffer;
-    VertexBuffer mVertexBuffer;
-    VertexBuffer mInstanceBuffer;
+    GeometryArena::Allocation mGeometry;
+    std::vector<uint32_t> mInstanceSlots;
 
     uint32_t mInstanceCount;
-    uint32_t mInstanceBufferCapacity;
+
+    // mesh space bounds, instances get theirs by transforming this
+    BoundingBox mBoundingBox;
+
+    // world space bounds per instance index and the compacted indices that survived culling
+    AABBArray mInstanceBounds;
+    std::vector<uint32_t> mVisibleInstances;
+
+    // cpu copy of the material indices in the instance buffer
+    std::vector<uint32_t> mInstanceMaterials;
 
     std::unordered_map<uint32_t, uint32_t> mInstanceIdToIndexMap;
     std::unordered_map<uint32_t, uint32_t> mInstanceIndexToIdMap;
@@ -0,0 +1,36 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_LIGHT_HPP
+#define OPENGLRENDERINGENGINE_LIGHT_HPP
+
+#include <glm/glm.hpp>
+
+// free light arena slots are None, the shaders skip them
+enum class LightType : uint32_t
+{
+    None,
+    Directional,
+    Point,
+    Spot
+};
+
+// std430 layout, mirrored by LightData in the shaders. Position and direction are in world space,
+// the cone angles are stored as cosines. Point and spot lights with a shadow importance above zero
+// compete for the shadow atlas
+struct LightData
+{
+    glm::vec3 position;
+    float range;
+    glm::vec3 color;
+    float intensity;
+    glm::vec3 direction;
+    LightType type;
+    float innerConeCos;
+    float outerConeCos;
+    float shadowImportance;
+    uint32_t padding;
+};
+
+#endif //OPENGLRENDERINGENGINE_LIGHT_HPP
@@ -0,0 +1,108 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "light_arena.hpp"
+
+static constexpr uint32_t sLightSize = sizeof(LightData);
+static constexpr uint32_t sInitialCapacity = 256;
+
+static_assert(sLightSize % 16 == 0, "LightData must match the std430 array stride");
+
+LightArena &LightArena::instance()
+{
+    static LightArena* arena = new LightArena();
+    return *arena;
+}
+
+LightArena::LightArena()
+    : mLightBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, LightBufferBinding, sInitialCapacity * sLightSize, nullptr)
+    , mCapacity(sInitialCapacity)
+    , mDirtyBegin(UINT32_MAX)
+    , mDirtyEnd()
+{
+}
+
+uint32_t LightArena::allocate()
+{
+    uint32_t slot;
+
+    if (!mFreeSlots.empty())
+    {
+        slot = mFreeSlots.back();
+        mFreeSlots.pop_back();
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(mLights.size());
+        mLights.push_back({});
+    }
+
+    return slot;
+}
+
+void LightArena::free(uint32_t slot)
+{
+    mLights.at(slot) = {};
+    mFreeSlots.push_back(slot);
+    markDirty(slot);
+}
+
+void LightArena::update(uint32_t slot, const LightData &light)
+{
+    mLights.at(slot) = light;
+    markDirty(slot);
+}
+
+void LightArena::upload()
+{
+    uint32_t slotCount = static_cast<uint32_t>(mLights.size());
+
+    if (slotCount > mCapacity)
+    {
+        mCapacity = glm::max(mCapacity * 2, slotCount);
+        mLightBuffer = ShaderBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, LightBufferBinding, mCapacity * sLightSize, nullptr);
+
+        // the new buffer starts out empty
+        mDirtyBegin = 0;
+        mDirtyEnd = slotCount;
+    }
+
+    if (mDirtyBegin < mDirtyEnd)
+        mLightBuffer.update(mDirtyBegin * sLightSize, (mDirtyEnd - mDirtyBegin) * sLightSize, mLights.data() + mDirtyBegin);
+
+    mDirtyBegin = UINT32_MAX;
+    mDirtyEnd = 0;
+}
+
+const std::vector<LightData> &LightArena::lights() const
+{
+    return mLights;
+}
+
+const ShaderBuffer &LightArena::buffer() const
+{
+    return mLightBuffer;
+}
+
+uint32_t LightArena::lightCount() const
+{
+    return static_cast<uint32_t>(mLights.size() - mFreeSlots.size());
+}
+
+uint32_t LightArena::capacity() const
+{
+    return mCapacity;
+}
+
+uint32_t LightArena::slotCount() const
+{
+    return static_cast<uint32_t>(mLights.size());
+}
+
+// a single range per frame, lights are usually edited a few at a time or all at once
+void LightArena::markDirty(uint32_t slot)
+{
+    mDirtyBegin = glm::min(mDirtyBegin, slot);
+    mDirtyEnd = glm::max(mDirtyEnd, slot + 1);
+}
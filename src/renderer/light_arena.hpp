@@ -0,0 +1,51 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_LIGHT_ARENA_HPP
+#define OPENGLRENDERINGENGINE_LIGHT_ARENA_HPP
+
+#include "../opengl/buffer.hpp"
+#include "light.hpp"
+
+// Every light of the scene in a single SSBO, with a cpu copy the light clustering reads.
+// Light nodes own a slot each; changes are collected and uploaded once per frame.
+class LightArena
+{
+public:
+    static constexpr uint32_t LightBufferBinding = 10;
+
+public:
+    // same lifetime rules as GeometryArena::instance()
+    static LightArena& instance();
+
+    uint32_t allocate();
+    void free(uint32_t slot);
+    void update(uint32_t slot, const LightData& light);
+
+    // uploads the slots changed since the last call
+    void upload();
+
+    // indexed by slot, free slots have LightType::None
+    const std::vector<LightData>& lights() const;
+    const ShaderBuffer& buffer() const;
+    uint32_t lightCount() const;
+    uint32_t capacity() const;
+    // every slot past this one is free
+    uint32_t slotCount() const;
+
+private:
+    LightArena();
+
+    void markDirty(uint32_t slot);
+
+private:
+    ShaderBuffer mLightBuffer;
+    std::vector<LightData> mLights;
+    std::vector<uint32_t> mFreeSlots;
+    uint32_t mCapacity;
+    uint32_t mDirtyBegin;
+    uint32_t mDirtyEnd;
+};
+
+#endif //OPENGLRENDERINGENGINE_LIGHT_ARENA_HPP
@@ -0,0 +1,288 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "light_clusters.hpp"
+#include <glm/gtc/constants.hpp>
+
+static bool sphereIntersectsBox(const glm::vec4& sphere, const BoundingBox& bb)
+{
+    glm::vec3 center(sphere);
+    glm::vec3 closest = glm::clamp(center, bb.min, bb.max);
+    glm::vec3 d = closest - center;
+
+    return glm::dot(d, d) <= sphere.w * sphere.w;
+}
+
+static uint32_t tileIndex(float ndc, uint32_t tileCount)
+{
+    float tile = glm::floor((ndc * 0.5f + 0.5f) * static_cast<float>(tileCount));
+    return static_cast<uint32_t>(glm::clamp(tile, 0.f, static_cast<float>(tileCount - 1)));
+}
+
+LightClusters::LightClusters()
+    : mProjection()
+    , mNearZ()
+    , mFarZ()
+    , mSliceScaleBias()
+    , mClusterBounds(ClusterCount)
+    , mClusters(ClusterCount)
+    , mStats()
+{
+}
+
+bool LightClusters::setProjection(const glm::mat4 &projection)
+{
+    if (projection == mProjection)
+        return false;
+
+    mProjection = projection;
+
+    // OpenGL perspective projection, see glm::perspective
+    mNearZ = projection[3][2] / (projection[2][2] - 1.f);
+    mFarZ = projection[3][2] / (projection[2][2] + 1.f);
+
+    float depthRatio = glm::log(mFarZ / mNearZ);
+    mSliceScaleBias = glm::vec2(SliceCount / depthRatio, -(SliceCount * glm::log(mNearZ)) / depthRatio);
+
+    buildClusterBounds();
+
+    return true;
+}
+
+void LightClusters::assign(const std::vector<LightData> &lights, const glm::mat4 &view)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    mStats = {};
+    mHits.clear();
+
+    for (uint32_t slot = 0; slot < lights.size(); ++slot)
+    {
+        std::optional<glm::vec4> sphere = lightBounds(lights.at(slot), view);
+
+        if (!sphere)
+            continue;
+
+        ++mStats.lightCount;
+
+        std::optional<ClusterRange> range = clusterRange(*sphere);
+
+        if (!range)
+            continue;
+
+        for (uint32_t slice = range->min.z; slice <= range->max.z; ++slice)
+        {
+            for (uint32_t tileY = range->min.y; tileY <= range->max.y; ++tileY)
+            {
+                for (uint32_t tileX = range->min.x; tileX <= range->max.x; ++tileX)
+                {
+                    uint32_t cluster = clusterIndex(tileX, tileY, slice);
+
+                    if (sphereIntersectsBox(*sphere, mClusterBounds.at(cluster)))
+                        mHits.emplace_back(cluster, slot);
+                }
+            }
+        }
+    }
+
+    // counting sort by cluster, lights stay in slot order inside a cluster
+    for (Cluster& cluster : mClusters)
+        cluster = {};
+
+    for (const auto& [cluster, slot] : mHits)
+        ++mClusters.at(cluster).count;
+
+    uint32_t offset = 0;
+    for (Cluster& cluster : mClusters)
+    {
+        cluster.offset = offset;
+        offset += cluster.count;
+
+        mStats.maxLightsPerCluster = glm::max(mStats.maxLightsPerCluster, cluster.count);
+        mStats.occupiedClusterCount += cluster.count > 0;
+        cluster.count = 0;
+    }
+
+    mLightIndices.resize(mHits.size());
+
+    for (const auto& [cluster, slot] : mHits)
+    {
+        Cluster& c = mClusters.at(cluster);
+        mLightIndices.at(c.offset + c.count++) = slot;
+    }
+
+    mStats.indexCount = static_cast<uint32_t>(mLightIndices.size());
+    mStats.assignMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const std::vector<BoundingBox> &LightClusters::clusterBounds() const
+{
+    return mClusterBounds;
+}
+
+const std::vector<LightClusters::Cluster> &LightClusters::clusters() const
+{
+    return mClusters;
+}
+
+const std::vector<uint32_t> &LightClusters::lightIndices() const
+{
+    return mLightIndices;
+}
+
+const LightClusters::Stats &LightClusters::stats() const
+{
+    return mStats;
+}
+
+const glm::mat4 &LightClusters::projection() const
+{
+    return mProjection;
+}
+
+float LightClusters::nearPlane() const
+{
+    return mNearZ;
+}
+
+float LightClusters::farPlane() const
+{
+    return mFarZ;
+}
+
+glm::vec2 LightClusters::sliceScaleBias() const
+{
+    return mSliceScaleBias;
+}
+
+uint32_t LightClusters::sliceIndex(float viewDepth) const
+{
+    float slice = glm::log(glm::max(viewDepth, mNearZ)) * mSliceScaleBias.x + mSliceScaleBias.y;
+
+    return static_cast<uint32_t>(glm::clamp(slice, 0.f, static_cast<float>(SliceCount - 1)));
+}
+
+uint32_t LightClusters::clusterIndex(uint32_t tileX, uint32_t tileY, uint32_t slice)
+{
+    return tileX + tileY * TileCountX + slice * TileCountX * TileCountY;
+}
+
+// slices from the sphere's depth range. The tiles come from the screen rect of the sphere's box
+// when it is fully in front of the near plane, the projected box contains the projected sphere
+std::optional<LightClusters::ClusterRange> LightClusters::clusterRange(const glm::vec4 &sphere) const
+{
+    glm::vec3 center(sphere);
+    float radius = sphere.w;
+
+    float minDepth = -center.z - radius;
+    float maxDepth = -center.z + radius;
+
+    if (maxDepth < mNearZ || minDepth > mFarZ)
+        return std::nullopt;
+
+    ClusterRange range {
+        .min = glm::uvec3(0, 0, sliceIndex(minDepth)),
+        .max = glm::uvec3(TileCountX - 1, TileCountY - 1, sliceIndex(maxDepth))
+    };
+
+    if (minDepth > mNearZ)
+    {
+        glm::vec2 ndcMin(FLT_MAX);
+        glm::vec2 ndcMax(-FLT_MAX);
+
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            glm::vec3 corner = center + radius * glm::vec3(i & 1? 1.f : -1.f, i & 2? 1.f : -1.f, i & 4? 1.f : -1.f);
+            glm::vec4 clip = mProjection * glm::vec4(corner, 1.f);
+            glm::vec2 ndc = glm::vec2(clip) / clip.w;
+
+            ndcMin = glm::min(ndcMin, ndc);
+            ndcMax = glm::max(ndcMax, ndc);
+        }
+
+        if (ndcMax.x < -1.f || ndcMax.y < -1.f || ndcMin.x > 1.f || ndcMin.y > 1.f)
+            return std::nullopt;
+
+        range.min.x = tileIndex(ndcMin.x, TileCountX);
+        range.max.x = tileIndex(ndcMax.x, TileCountX);
+        range.min.y = tileIndex(ndcMin.y, TileCountY);
+        range.max.y = tileIndex(ndcMax.y, TileCountY);
+    }
+
+    return range;
+}
+
+// spot lights are bounded by the smallest sphere around their cone
+std::optional<glm::vec4> LightClusters::lightBounds(const LightData &light, const glm::mat4 &view)
+{
+    if (light.type != LightType::Point && light.type != LightType::Spot)
+        return std::nullopt;
+
+    glm::vec3 center = light.position;
+    float radius = light.range;
+
+    if (light.type == LightType::Spot)
+    {
+        float cosAngle = light.outerConeCos;
+
+        if (cosAngle > glm::cos(glm::quarter_pi<float>()))
+        {
+            radius = light.range / (2.f * cosAngle);
+            center += light.direction * radius;
+        }
+        else
+        {
+            radius = light.range * glm::sqrt(1.f - cosAngle * cosAngle);
+            center += light.direction * light.range * cosAngle;
+        }
+    }
+
+    return glm::vec4(glm::vec3(view * glm::vec4(center, 1.f)), radius);
+}
+
+// box around the tile's four corner rays between the slice's depth planes
+void LightClusters::buildClusterBounds()
+{
+    glm::mat4 inverseProjection = glm::inverse(mProjection);
+
+    std::array<glm::vec3, (TileCountX + 1) * (TileCountY + 1)> cornerRays;
+
+    for (uint32_t y = 0; y <= TileCountY; ++y)
+    {
+        for (uint32_t x = 0; x <= TileCountX; ++x)
+        {
+            glm::vec2 ndc = glm::vec2(x, y) / glm::vec2(TileCountX, TileCountY) * 2.f - 1.f;
+            glm::vec4 nearPoint = inverseProjection * glm::vec4(ndc, -1.f, 1.f);
+            glm::vec3 ray = glm::vec3(nearPoint) / nearPoint.w;
+
+            // scaled to a view depth of one
+            cornerRays.at(x + y * (TileCountX + 1)) = ray / -ray.z;
+        }
+    }
+
+    for (uint32_t slice = 0; slice < SliceCount; ++slice)
+    {
+        float depthRatio = mFarZ / mNearZ;
+        float sliceNear = mNearZ * glm::pow(depthRatio, static_cast<float>(slice) / SliceCount);
+        float sliceFar = mNearZ * glm::pow(depthRatio, static_cast<float>(slice + 1) / SliceCount);
+
+        for (uint32_t tileY = 0; tileY < TileCountY; ++tileY)
+        {
+            for (uint32_t tileX = 0; tileX < TileCountX; ++tileX)
+            {
+                BoundingBox bb;
+
+                for (uint32_t i = 0; i < 4; ++i)
+                {
+                    const glm::vec3& ray = cornerRays.at((tileX + (i & 1)) + (tileY + (i >> 1)) * (TileCountX + 1));
+
+                    bb.expand(ray * sliceNear);
+                    bb.expand(ray * sliceFar);
+                }
+
+                mClusterBounds.at(clusterIndex(tileX, tileY, slice)) = bb;
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_LIGHT_CLUSTERS_HPP
+#define OPENGLRENDERINGENGINE_LIGHT_CLUSTERS_HPP
+
+#include <glm/glm.hpp>
+#include "bounding_box.hpp"
+#include "light.hpp"
+
+// The view frustum split into TileCountX * TileCountY screen tiles and SliceCount depth slices,
+// spaced exponentially so clusters stay roughly cube shaped. Point and spot lights are binned
+// into the clusters their bounding spheres touch, giving every cluster an {offset, count} range
+// of a shared light index list. A fragment only walks the list of its own cluster.
+// This is the cpu reference; assign_lights.comp is the compute path and has to match it.
+// Doesn't need a GL context.
+class LightClusters
+{
+public:
+    static constexpr uint32_t TileCountX = 16;
+    static constexpr uint32_t TileCountY = 9;
+    static constexpr uint32_t SliceCount = 24;
+    static constexpr uint32_t ClusterCount = TileCountX * TileCountY * SliceCount;
+
+    // std430 layout, mirrored by LightGrid in the shaders
+    struct Cluster
+    {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    // inclusive tile x, tile y and slice range
+    struct ClusterRange
+    {
+        glm::uvec3 min;
+        glm::uvec3 max;
+    };
+
+    struct Stats
+    {
+        uint32_t lightCount;
+        uint32_t indexCount;
+        uint32_t maxLightsPerCluster;
+        uint32_t occupiedClusterCount;
+        float assignMs;
+    };
+
+public:
+    LightClusters();
+
+    // rebuilds the view space cluster bounds if the projection changed, returns whether it did
+    bool setProjection(const glm::mat4& projection);
+
+    // lights are indexed by light arena slot, the index lists hold slots
+    void assign(const std::vector<LightData>& lights, const glm::mat4& view);
+
+    const std::vector<BoundingBox>& clusterBounds() const;
+    const std::vector<Cluster>& clusters() const;
+    const std::vector<uint32_t>& lightIndices() const;
+    const Stats& stats() const;
+
+    const glm::mat4& projection() const;
+    float nearPlane() const;
+    float farPlane() const;
+
+    // slice = log(viewDepth) * scale + bias
+    glm::vec2 sliceScaleBias() const;
+    uint32_t sliceIndex(float viewDepth) const;
+
+    // clusters a view space bounding sphere can touch, before the per cluster test
+    std::optional<ClusterRange> clusterRange(const glm::vec4& sphere) const;
+
+    static uint32_t clusterIndex(uint32_t tileX, uint32_t tileY, uint32_t slice);
+
+    // view space bounding sphere, w is the radius. Directional lights and free slots have none
+    static std::optional<glm::vec4> lightBounds(const LightData& light, const glm::mat4& view);
+
+private:
+    void buildClusterBounds();
+
+private:
+    glm::mat4 mProjection;
+    float mNearZ;
+    float mFarZ;
+    glm::vec2 mSliceScaleBias;
+
+    std::vector<BoundingBox> mClusterBounds;
+    std::vector<Cluster> mClusters;
+    std::vector<uint32_t> mLightIndices;
+    // cluster and light slot of every hit, before they get grouped per cluster
+    std::vector<std::pair<uint32_t, uint32_t>> mHits;
+
+    Stats mStats;
+};
+
+#endif //OPENGLRENDERINGENGINE_LIGHT_CLUSTERS_HPP
@@ -55,4 +55,35 @@ std::unordered_set<uuid64_t> getModelMeshIDs(const Model& model)
     getModelMeshesRecursive(model.root, modelMeshes);
 
     return modelMeshes;
-}
\ No newline at end of file
+}
+
+static void countModelNodesRecursive(const Model::Node& node, uint32_t& nodeCount, uint32_t& meshNodeCount)
+{
+    ++nodeCount;
+
+    if (node.meshID)
+        ++meshNodeCount;
+
+    for (const auto& child : node.children)
+        countModelNodesRecursive(child, nodeCount, meshNodeCount);
+}
+
+uint32_t getModelNodeCount(const Model& model)
+{
+    uint32_t nodeCount = 0;
+    uint32_t meshNodeCount = 0;
+
+    countModelNodesRecursive(model.root, nodeCount, meshNodeCount);
+
+    return nodeCount;
+}
+
+uint32_t getModelMeshNodeCount(const Model& model)
+{
+    uint32_t nodeCount = 0;
+    uint32_t meshNodeCount = 0;
+
+    countModelNodesRecursive(model.root, nodeCount, meshNodeCount);
+
+    return meshNodeCount;
+}
@@ -38,5 +38,7 @@ public:
 };
 
 std::unordered_set<uuid64_t> getModelMeshIDs(const Model& model);
+uint32_t getModelNodeCount(const Model& model);
+uint32_t getModelMeshNodeCount(const Model& model);
 
 #endif //OPENGLRENDERINGENGINE_MODEL_HPP
@@ -0,0 +1,475 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "render_graph.hpp"
+
+static constexpr uint32_t sUnused = UINT32_MAX;
+static constexpr uint32_t sMaxIdleFrames = 3;
+
+static bool isDepthFormat(TextureFormat format)
+{
+    return format == TextureFormat::D32 || format == TextureFormat::D24S8;
+}
+
+static uint32_t bytesPerPixel(TextureFormat format)
+{
+    switch (format)
+    {
+        case TextureFormat::R8: return 1;
+        case TextureFormat::RG8: return 2;
+        case TextureFormat::RGB8: return 3;
+        case TextureFormat::RGBA8: return 4;
+        case TextureFormat::RGB32F: return 12;
+        case TextureFormat::RGBA32F: return 16;
+        case TextureFormat::R32F: return 4;
+        case TextureFormat::D32: return 4;
+        case TextureFormat::D24S8: return 4;
+        default: return 4;
+    }
+}
+
+static uint64_t textureBytes(const TextureSpecification& spec)
+{
+    uint64_t bytes = uint64_t(spec.width) * spec.height * bytesPerPixel(spec.format);
+
+    // a full mip chain adds about a third
+    if (spec.generateMipMaps)
+        bytes += bytes / 3;
+
+    return bytes;
+}
+
+static bool sameFormat(const TextureSpecification& a, const TextureSpecification& b)
+{
+    return a.format == b.format &&
+           a.dataType == b.dataType &&
+           a.wrapMode == b.wrapMode &&
+           a.filterMode == b.filterMode &&
+           a.generateMipMaps == b.generateMipMaps;
+}
+
+static bool sameSpecification(const TextureSpecification& a, const TextureSpecification& b)
+{
+    return a.width == b.width && a.height == b.height && sameFormat(a, b);
+}
+
+// -- PassBuilder -- //
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph &graph, uint32_t passIndex)
+    : mGraph(graph)
+    , mPassIndex(passIndex)
+{
+}
+
+RenderGraph::ResourceHandle RenderGraph::PassBuilder::create(const std::string &name, const TextureSpecification &spec)
+{
+    ResourceHandle resource = static_cast<ResourceHandle>(mGraph.mResources.size());
+
+    mGraph.mResources.push_back({
+        .name = name,
+        .spec = spec,
+        .imported = nullptr,
+        .physicalIndex = sUnused,
+        .firstUse = sUnused,
+        .lastUse = sUnused
+    });
+
+    return write(resource);
+}
+
+RenderGraph::ResourceHandle RenderGraph::PassBuilder::read(ResourceHandle resource)
+{
+    check(resource < mGraph.mResources.size(), "RenderGraph: Invalid resource handle.");
+    mGraph.mPasses.at(mPassIndex).reads.push_back(resource);
+    return resource;
+}
+
+RenderGraph::ResourceHandle RenderGraph::PassBuilder::write(ResourceHandle resource)
+{
+    check(resource < mGraph.mResources.size(), "RenderGraph: Invalid resource handle.");
+    mGraph.mPasses.at(mPassIndex).writes.push_back(resource);
+    return resource;
+}
+
+void RenderGraph::PassBuilder::sideEffect()
+{
+    mGraph.mPasses.at(mPassIndex).sideEffect = true;
+}
+
+// -- RenderGraph -- //
+
+RenderGraph::RenderGraph()
+    : mFrameIndex()
+    , mStats()
+{
+}
+
+void RenderGraph::reset()
+{
+    mPasses.clear();
+    mResources.clear();
+    mExecutionOrder.clear();
+    mStats = {};
+}
+
+RenderGraph::ResourceHandle RenderGraph::importTexture(const std::string &name, Texture2D &texture)
+{
+    TextureSpecification spec {
+        .width = texture.width(),
+        .height = texture.height(),
+        .format = texture.format(),
+        .dataType = texture.dataType(),
+        .wrapMode = texture.wrapMode(),
+        .filterMode = texture.filterMode(),
+        .generateMipMaps = texture.mips()
+    };
+
+    mResources.push_back({
+        .name = name,
+        .spec = spec,
+        .imported = &texture,
+        .physicalIndex = sUnused,
+        .firstUse = sUnused,
+        .lastUse = sUnused
+    });
+
+    return static_cast<ResourceHandle>(mResources.size() - 1);
+}
+
+void RenderGraph::addPass(const std::string &name, PassType type, const SetupFunc &setup, ExecuteFunc execute)
+{
+    mPasses.push_back({
+        .name = name,
+        .type = type,
+        .execute = std::move(execute),
+        .reads = {},
+        .writes = {},
+        .sideEffect = false,
+        .culled = false
+    });
+
+    PassBuilder builder(*this, static_cast<uint32_t>(mPasses.size() - 1));
+    setup(builder);
+
+    const Pass& pass = mPasses.back();
+    check(type == PassType::Compute || !pass.writes.empty() || pass.sideEffect,
+          std::format("RenderGraph: Graphics pass {} writes no texture and has no side effect.", name).c_str());
+}
+
+void RenderGraph::compile()
+{
+    cullPasses();
+    sortPasses();
+    assignTextures();
+
+    ++mFrameIndex;
+}
+
+void RenderGraph::execute()
+{
+    for (uint32_t passIndex : mExecutionOrder)
+    {
+        Pass& pass = mPasses.at(passIndex);
+
+        // a graphics pass without graph writes draws into a framebuffer of its own
+        if (pass.type == PassType::Graphics && !pass.writes.empty())
+            bindFramebuffer(passIndex);
+
+        pass.execute(*this);
+
+        if (pass.type == PassType::Graphics)
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+}
+
+Texture2D &RenderGraph::texture(ResourceHandle resource)
+{
+    Resource& graphResource = mResources.at(resource);
+
+    if (graphResource.imported)
+        return *graphResource.imported;
+
+    check(graphResource.physicalIndex != sUnused, "RenderGraph: Resource has no texture, was it used by a culled pass?");
+    return mTexturePool.at(graphResource.physicalIndex).texture;
+}
+
+std::vector<std::string> RenderGraph::executionOrder() const
+{
+    std::vector<std::string> passNames;
+
+    for (uint32_t passIndex : mExecutionOrder)
+        passNames.push_back(mPasses.at(passIndex).name);
+
+    return passNames;
+}
+
+const RenderGraph::Stats &RenderGraph::stats() const
+{
+    return mStats;
+}
+
+// a pass survives if it has side effects, writes an imported texture, or writes something a
+// surviving pass reads
+void RenderGraph::cullPasses()
+{
+    std::vector<std::vector<uint32_t>> writers(mResources.size());
+    std::vector<uint32_t> worklist;
+
+    for (uint32_t passIndex = 0; passIndex < mPasses.size(); ++passIndex)
+    {
+        Pass& pass = mPasses.at(passIndex);
+        pass.culled = true;
+
+        for (ResourceHandle resource : pass.writes)
+        {
+            writers.at(resource).push_back(passIndex);
+
+            if (mResources.at(resource).imported)
+                pass.sideEffect = true;
+        }
+
+        if (pass.sideEffect)
+        {
+            pass.culled = false;
+            worklist.push_back(passIndex);
+        }
+    }
+
+    while (!worklist.empty())
+    {
+        uint32_t passIndex = worklist.back();
+        worklist.pop_back();
+
+        for (ResourceHandle resource : mPasses.at(passIndex).reads)
+        {
+            for (uint32_t writer : writers.at(resource))
+            {
+                if (mPasses.at(writer).culled)
+                {
+                    mPasses.at(writer).culled = false;
+                    worklist.push_back(writer);
+                }
+            }
+        }
+    }
+
+    for (const Pass& pass : mPasses)
+        mStats.culledPassCount += pass.culled;
+    mStats.passCount = static_cast<uint32_t>(mPasses.size()) - mStats.culledPassCount;
+}
+
+// topological sort, readers after every writer of what they read and writers of the same resource
+// in submission order. Among ready passes the earliest submitted runs first
+void RenderGraph::sortPasses()
+{
+    std::vector<std::vector<uint32_t>> dependents(mPasses.size());
+    std::vector<uint32_t> dependencyCounts(mPasses.size(), 0);
+    std::vector<std::vector<uint32_t>> writers(mResources.size());
+
+    auto addEdge = [&] (uint32_t from, uint32_t to) {
+        if (from == to)
+            return;
+        dependents.at(from).push_back(to);
+        ++dependencyCounts.at(to);
+    };
+
+    for (uint32_t passIndex = 0; passIndex < mPasses.size(); ++passIndex)
+    {
+        if (mPasses.at(passIndex).culled)
+            continue;
+
+        for (ResourceHandle resource : mPasses.at(passIndex).writes)
+        {
+            if (!writers.at(resource).empty())
+                addEdge(writers.at(resource).back(), passIndex);
+            writers.at(resource).push_back(passIndex);
+        }
+    }
+
+    for (uint32_t passIndex = 0; passIndex < mPasses.size(); ++passIndex)
+    {
+        if (mPasses.at(passIndex).culled)
+            continue;
+
+        for (ResourceHandle resource : mPasses.at(passIndex).reads)
+            for (uint32_t writer : writers.at(resource))
+                addEdge(writer, passIndex);
+    }
+
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<>> readyPasses;
+
+    for (uint32_t passIndex = 0; passIndex < mPasses.size(); ++passIndex)
+        if (!mPasses.at(passIndex).culled && dependencyCounts.at(passIndex) == 0)
+            readyPasses.push(passIndex);
+
+    while (!readyPasses.empty())
+    {
+        uint32_t passIndex = readyPasses.top();
+        readyPasses.pop();
+
+        mExecutionOrder.push_back(passIndex);
+
+        for (uint32_t dependent : dependents.at(passIndex))
+            if (--dependencyCounts.at(dependent) == 0)
+                readyPasses.push(dependent);
+    }
+
+    check(mExecutionOrder.size() == mStats.passCount, "RenderGraph: Dependency cycle between passes.");
+}
+
+// transients are placed in order of first use. A pooled texture with the same specification can be
+// taken once the resource it held has had its last use
+void RenderGraph::assignTextures()
+{
+    for (uint32_t step = 0; step < mExecutionOrder.size(); ++step)
+    {
+        const Pass& pass = mPasses.at(mExecutionOrder.at(step));
+
+        for (const std::vector<ResourceHandle>* resources : {&pass.reads, &pass.writes})
+        {
+            for (ResourceHandle resource : *resources)
+            {
+                Resource& graphResource = mResources.at(resource);
+
+                if (graphResource.firstUse == sUnused)
+                    graphResource.firstUse = step;
+                graphResource.lastUse = step;
+            }
+        }
+    }
+
+    std::erase_if(mTexturePool, [this] (const PooledTexture& pooledTexture) {
+        return mFrameIndex - pooledTexture.lastUsedFrame > sMaxIdleFrames;
+    });
+
+    for (PooledTexture& pooledTexture : mTexturePool)
+        pooledTexture.busyUntil = -1;
+
+    std::vector<ResourceHandle> transients;
+    for (ResourceHandle resource = 0; resource < mResources.size(); ++resource)
+        if (!mResources.at(resource).imported && mResources.at(resource).firstUse != sUnused)
+            transients.push_back(resource);
+
+    std::sort(transients.begin(), transients.end(), [this] (ResourceHandle a, ResourceHandle b) {
+        return mResources.at(a).firstUse < mResources.at(b).firstUse;
+    });
+
+    for (ResourceHandle resource : transients)
+    {
+        Resource& graphResource = mResources.at(resource);
+
+        auto available = std::find_if(mTexturePool.begin(), mTexturePool.end(), [&graphResource] (const PooledTexture& pooledTexture) {
+            return pooledTexture.busyUntil < static_cast<int32_t>(graphResource.firstUse) &&
+                   sameSpecification(pooledTexture.texture.specification(), graphResource.spec);
+        });
+
+        if (available == mTexturePool.end())
+        {
+            mTexturePool.push_back({Texture2D(graphResource.spec), 0, -1});
+            available = mTexturePool.end() - 1;
+        }
+
+        available->busyUntil = static_cast<int32_t>(graphResource.lastUse);
+        available->lastUsedFrame = mFrameIndex;
+        graphResource.physicalIndex = static_cast<uint32_t>(available - mTexturePool.begin());
+
+        ++mStats.transientTextureCount;
+        mStats.transientBytes += textureBytes(graphResource.spec);
+    }
+
+    // an idle texture of a format in use at another size is left over from a resize, waiting for it
+    // to time out would keep every size the viewport was dragged through alive
+    std::vector<uint32_t> physicalIndices(mTexturePool.size());
+    std::iota(physicalIndices.begin(), physicalIndices.end(), 0);
+
+    auto staleTexture = [this] (const PooledTexture& pooledTexture) {
+        if (pooledTexture.lastUsedFrame == mFrameIndex)
+            return false;
+
+        return std::any_of(mTexturePool.begin(), mTexturePool.end(), [&pooledTexture, this] (const PooledTexture& other) {
+            return other.lastUsedFrame == mFrameIndex && sameFormat(other.texture.specification(), pooledTexture.texture.specification());
+        });
+    };
+
+    uint32_t keptCount = 0;
+    for (uint32_t i = 0; i < mTexturePool.size(); ++i)
+        physicalIndices.at(i) = staleTexture(mTexturePool.at(i))? sUnused : keptCount++;
+
+    std::vector<PooledTexture> keptTextures;
+    keptTextures.reserve(keptCount);
+    for (uint32_t i = 0; i < mTexturePool.size(); ++i)
+        if (physicalIndices.at(i) != sUnused)
+            keptTextures.push_back(std::move(mTexturePool.at(i)));
+    mTexturePool = std::move(keptTextures);
+
+    for (ResourceHandle resource : transients)
+        mResources.at(resource).physicalIndex = physicalIndices.at(mResources.at(resource).physicalIndex);
+
+    for (const PooledTexture& pooledTexture : mTexturePool)
+    {
+        ++mStats.physicalTextureCount;
+        mStats.physicalBytes += textureBytes(pooledTexture.texture.specification());
+    }
+}
+
+void RenderGraph::bindFramebuffer(uint32_t passIndex)
+{
+    const Pass& pass = mPasses.at(passIndex);
+
+    std::vector<ResourceHandle> colorAttachments;
+    std::optional<ResourceHandle> depthAttachment;
+    GLenum depthAttachmentPoint = GL_NONE;
+
+    for (ResourceHandle resource : pass.writes)
+    {
+        TextureFormat format = mResources.at(resource).spec.format;
+
+        if (isDepthFormat(format))
+        {
+            depthAttachment = resource;
+            depthAttachmentPoint = format == TextureFormat::D32? GL_DEPTH_ATTACHMENT : GL_DEPTH_STENCIL_ATTACHMENT;
+        }
+        else
+        {
+            colorAttachments.push_back(resource);
+        }
+    }
+
+    if (passIndex >= mFramebuffers.size())
+        mFramebuffers.resize(passIndex + 1);
+
+    // attachments are set every frame, the pooled texture behind a resource may have changed
+    PassFramebuffer& passFramebuffer = mFramebuffers.at(passIndex);
+
+    if (passFramebuffer.colorAttachmentCount != colorAttachments.size() || passFramebuffer.depthAttachment != depthAttachmentPoint)
+    {
+        passFramebuffer.framebuffer = Framebuffer();
+        passFramebuffer.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+        passFramebuffer.depthAttachment = depthAttachmentPoint;
+
+        if (colorAttachments.empty())
+        {
+            passFramebuffer.framebuffer.setDepthStencilOnly(true);
+        }
+        else
+        {
+            std::vector<uint32_t> drawBuffers(colorAttachments.size());
+            std::iota(drawBuffers.begin(), drawBuffers.end(), 0);
+            passFramebuffer.framebuffer.setDrawBuffers(drawBuffers);
+        }
+    }
+
+    for (uint32_t i = 0; i < colorAttachments.size(); ++i)
+        passFramebuffer.framebuffer.addColorAttachment(texture(colorAttachments.at(i)), i);
+
+    if (depthAttachmentPoint == GL_DEPTH_ATTACHMENT)
+        passFramebuffer.framebuffer.addDepthAttachment(texture(*depthAttachment));
+    else if (depthAttachmentPoint == GL_DEPTH_STENCIL_ATTACHMENT)
+        passFramebuffer.framebuffer.addDepthStencilAttachment(texture(*depthAttachment));
+
+    passFramebuffer.framebuffer.bind();
+
+    const TextureSpecification& spec = mResources.at(colorAttachments.empty()? *depthAttachment : colorAttachments.front()).spec;
+    glViewport(0, 0, spec.width, spec.height);
+}
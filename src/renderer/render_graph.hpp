@@ -0,0 +1,137 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_RENDER_GRAPH_HPP
+#define OPENGLRENDERINGENGINE_RENDER_GRAPH_HPP
+
+#include <glad/glad.h>
+#include "../opengl/texture.hpp"
+#include "../opengl/framebuffer.hpp"
+
+// Declarative frame graph, rebuilt every frame.
+// Passes declare the textures they create, read and write during setup. compile() drops passes
+// whose results nobody consumes, orders the rest by their dependencies (submission order breaks
+// ties) and maps transient textures onto a pool of physical textures, reusing a texture for
+// another resource with the same specification once its last reader has run.
+// Graphics passes get a framebuffer with everything they write attached, or bind their own
+// when they only have a side effect, compute passes get nothing bound. Buffers aren't tracked:
+// passes communicating through buffers rely on submission order and mark themselves with
+// sideEffect().
+class RenderGraph
+{
+public:
+    using ResourceHandle = uint32_t;
+
+    enum class PassType
+    {
+        Graphics,
+        Compute
+    };
+
+    class PassBuilder
+    {
+    public:
+        ResourceHandle create(const std::string& name, const TextureSpecification& spec);
+        ResourceHandle read(ResourceHandle resource);
+        ResourceHandle write(ResourceHandle resource);
+        // keeps the pass when nothing reads its textures, e.g. it writes buffers
+        void sideEffect();
+
+    private:
+        PassBuilder(RenderGraph& graph, uint32_t passIndex);
+
+        RenderGraph& mGraph;
+        uint32_t mPassIndex;
+
+        friend class RenderGraph;
+    };
+
+    using SetupFunc = std::function<void(PassBuilder&)>;
+    using ExecuteFunc = std::function<void(RenderGraph&)>;
+
+    struct Stats
+    {
+        uint32_t passCount;
+        uint32_t culledPassCount;
+        uint32_t transientTextureCount;
+        uint32_t physicalTextureCount;
+        // bytes the transients would take without aliasing, and the pool that backs them
+        uint64_t transientBytes;
+        uint64_t physicalBytes;
+    };
+
+public:
+    RenderGraph();
+
+    // drops the passes and resources of the last frame, the texture pool is kept
+    void reset();
+
+    // textures owned outside of the graph, writing one keeps the writing pass alive
+    ResourceHandle importTexture(const std::string& name, Texture2D& texture);
+    void addPass(const std::string& name, PassType type, const SetupFunc& setup, ExecuteFunc execute);
+
+    void compile();
+    void execute();
+
+    Texture2D& texture(ResourceHandle resource);
+
+    // pass names in execution order, culled passes excluded
+    std::vector<std::string> executionOrder() const;
+    const Stats& stats() const;
+
+private:
+    struct Resource
+    {
+        std::string name;
+        TextureSpecification spec;
+        Texture2D* imported;
+        uint32_t physicalIndex;
+        uint32_t firstUse;
+        uint32_t lastUse;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        PassType type;
+        ExecuteFunc execute;
+        std::vector<ResourceHandle> reads;
+        std::vector<ResourceHandle> writes;
+        bool sideEffect;
+        bool culled;
+    };
+
+    struct PooledTexture
+    {
+        Texture2D texture;
+        uint32_t lastUsedFrame;
+        // execution step of the last read of the resource it currently backs
+        int32_t busyUntil;
+    };
+
+    struct PassFramebuffer
+    {
+        Framebuffer framebuffer;
+        uint32_t colorAttachmentCount;
+        GLenum depthAttachment;
+    };
+
+    void cullPasses();
+    void sortPasses();
+    void assignTextures();
+    void bindFramebuffer(uint32_t passIndex);
+
+private:
+    std::vector<Pass> mPasses;
+    std::vector<Resource> mResources;
+    std::vector<uint32_t> mExecutionOrder;
+
+    std::vector<PooledTexture> mTexturePool;
+    std::vector<PassFramebuffer> mFramebuffers;
+
+    uint32_t mFrameIndex;
+    Stats mStats;
+};
+
+#endif //OPENGLRENDERINGENGINE_RENDER_GRAPH_HPP
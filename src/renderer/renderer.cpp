@@ -3,12 +3,1374 @@
 //
 
 #include "renderer.hpp"
+#include "../resource/resource_manager.hpp"
+#include "light_arena.hpp"
 
-Renderer::Renderer()
+static constexpr int32_t sInitialWidth = 1920;
+static constexpr int32_t sInitialHeight = 1080;
+static constexpr uint32_t sInitialDrawCommandCapacity = 256;
+static constexpr uint32_t sInitialVisibleInstanceCapacity = 1024;
+static constexpr uint32_t sComputeWorkGroupSize = 64;
+static constexpr uint32_t sHiZWorkGroupSize = 8;
+static constexpr uint32_t sInitialLightIndexCapacity = LightClusters::ClusterCount * 32;
+static constexpr uint32_t sInitialLightShadowCapacity = 1024;
+static constexpr uint32_t sShadowTileCapacity = ShadowAtlas::MaxShadowedLights * ShadowAtlas::MaxFaceCount;
+
+// frame and view blocks, then the camera pass and one per shadow face at most. 512 bytes covers
+// every block at any uniform offset alignment drivers report
+static constexpr uint32_t sUniformRingFrameSize = (3 + ShadowCascades::CascadeCount + sShadowTileCapacity) * 512;
+
+static const TextureSpecification sColorTextureSpec {
+    .width = sInitialWidth,
+    .height = sInitialHeight,
+    .format = TextureFormat::RGBA8,
+    .dataType = TextureDataType::UINT8,
+    .wrapMode = TextureWrap::ClampToEdge,
+    .filterMode = TextureFilter::Bilinear,
+    .generateMipMaps = false
+};
+
+static TextureSpecification depthTextureSpec(int32_t width, int32_t height)
 {
+    return {
+        .width = width,
+        .height = height,
+        .format = TextureFormat::D32,
+        .dataType = TextureDataType::FLOAT,
+        .wrapMode = TextureWrap::ClampToEdge,
+        .filterMode = TextureFilter::Nearest,
+        .generateMipMaps = false
+    };
+}
+
+static const TextureSpecification sShadowMapSpec {
+    .width = ShadowCascades::Resolution,
+    .height = ShadowCascades::Resolution,
+    .format = TextureFormat::D32,
+    .dataType = TextureDataType::FLOAT,
+    .wrapMode = TextureWrap::ClampToEdge,
+    .filterMode = TextureFilter::Bilinear,
+    .generateMipMaps = false
+};
+
+static const TextureSpecification sShadowAtlasSpec {
+    .width = ShadowAtlas::Resolution,
+    .height = ShadowAtlas::Resolution,
+    .format = TextureFormat::D32,
+    .dataType = TextureDataType::FLOAT,
+    .wrapMode = TextureWrap::ClampToEdge,
+    .filterMode = TextureFilter::Bilinear,
+    .generateMipMaps = false
+};
+
+// the blocks a program shares with the others have to match the structs written to the ring.
+// Logs every block that doesn't
+static bool validateUniformBlocks(const Shader& shader)
+{
+    bool valid = true;
+
+    auto validate = [&shader, &valid] (UniformID name, uint32_t binding, uint32_t size) {
+        const Shader::BufferBlock* block = shader.uniformBlock(name);
+
+        if (!block || (block->binding == binding && block->dataSize >= size))
+            return;
+
+        debugLog(std::format("Renderer: {} of {} doesn't match the renderer's layout.", name.name, shader.name()), LogSeverity::Error);
+        valid = false;
+    };
+
+    validate("FrameBlock", Renderer::FrameUniformBinding, offsetof(FrameUniforms, padding));
+    validate("ViewBlock", Renderer::ViewUniformBinding, offsetof(ViewUniforms, padding));
+    validate("PassBlock", Renderer::PassUniformBinding, offsetof(PassUniforms, padding));
+
+    return valid;
+}
+
+// power of two below the viewport, see build_hiz.comp
+static TextureSpecification hiZTextureSpec(int32_t width, int32_t height)
+{
+    return {
+        .width = static_cast<int32_t>(std::bit_floor(static_cast<uint32_t>(width))),
+        .height = static_cast<int32_t>(std::bit_floor(static_cast<uint32_t>(height))),
+        .format = TextureFormat::R32F,
+        .dataType = TextureDataType::FLOAT,
+        .wrapMode = TextureWrap::ClampToEdge,
+        .filterMode = TextureFilter::Nearest,
+        .generateMipMaps = true
+    };
+}
+
+Renderer::Renderer(std::shared_ptr<ResourceManager> resourceManager)
+    : mResourceManager(resourceManager)
+    , mMeshShaders({{GL_VERTEX_SHADER, SHADER_DIR "mesh.vert"}, {GL_FRAGMENT_SHADER, SHADER_DIR "mesh.frag"}})
+    , mCullInstancesShader({{GL_COMPUTE_SHADER, SHADER_DIR "cull_instances.comp"}})
+    , mBuildDrawCommandsShader({{GL_COMPUTE_SHADER, SHADER_DIR "build_draw_commands.comp"}})
+    , mDepthPrepassShader({{GL_VERTEX_SHADER, SHADER_DIR "mesh.vert"}}, {{"DEPTH_ONLY", ""}})
+    , mBuildHiZShader({{GL_COMPUTE_SHADER, SHADER_DIR "build_hiz.comp"}})
+    , mAssignLightsShader({{GL_COMPUTE_SHADER, SHADER_DIR "assign_lights.comp"}})
+    , mColorTexture(sColorTextureSpec)
+    , mCullingMode(CullingMode::CPU)
+    , mOcclusionCulling(false)
+    , mHasPreviousVisibleSet(false)
+    , mIndirectBuffer(GL_DYNAMIC_DRAW, sInitialDrawCommandCapacity * sizeof(DrawCommand), nullptr)
+    , mVisibleInstanceBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, VisibleInstanceBufferBinding, sInitialVisibleInstanceCapacity * sizeof(uint32_t), nullptr)
+    , mMeshDrawStateBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, MeshDrawStateBufferBinding, sInitialDrawCommandCapacity * sizeof(MeshDrawState), nullptr)
+    , mDrawCountBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, DrawCountBufferBinding, sizeof(uint32_t), nullptr)
+    , mCullStatsBuffers{ShaderBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_READ, CullStatsBufferBinding, sizeof(CullStats), nullptr),
+                        ShaderBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_READ, CullStatsBufferBinding, sizeof(CullStats), nullptr)}
+    , mVisibleSlotCount()
+    , mMaxDrawCount()
+    , mFrameIndex()
+    , mLightAssignmentMode(LightAssignmentMode::CPU)
+    , mLightGridBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, LightGridBufferBinding, LightClusters::ClusterCount * sizeof(LightClusters::Cluster), nullptr)
+    , mLightIndexBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, LightIndexBufferBinding, sInitialLightIndexCapacity * sizeof(uint32_t), nullptr)
+    , mClusterBoundsBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, ClusterBoundsBufferBinding, LightClusters::ClusterCount * sizeof(ClusterBounds), nullptr)
+    , mLightAssignmentStatsBuffers{ShaderBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_READ, LightAssignmentStatsBufferBinding, sizeof(LightAssignmentStats), nullptr),
+                                   ShaderBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_READ, LightAssignmentStatsBufferBinding, sizeof(LightAssignmentStats), nullptr)}
+    , mLightView(1.f)
+    , mLightClusterStats()
+    , mShadows(true)
+    , mShadowCaching(true)
+    , mShadowMap(sShadowMapSpec, ShadowCascades::CascadeCount)
+    , mShadowIndirectBuffer(GL_DYNAMIC_DRAW, sInitialDrawCommandCapacity * sizeof(DrawCommand), nullptr)
+    , mShadowVisibleInstanceBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, VisibleInstanceBufferBinding, sInitialVisibleInstanceCapacity * sizeof(uint32_t), nullptr)
+    , mShadowCasterVersion(UINT64_MAX)
+    , mShadowAtlasTexture(sShadowAtlasSpec)
+    , mLightShadowBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, LightShadowBufferBinding, sInitialLightShadowCapacity * sizeof(uint32_t), nullptr)
+    , mShadowTileBuffer(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, ShadowTileBufferBinding, sShadowTileCapacity * sizeof(ShadowAtlas::ShadowTile), nullptr)
+    , mFrameStats()
+    , mStateCounters()
+    , mUniformRing(sUniformRingFrameSize)
+    , mCameraPassUniforms()
+    , mTime(static_cast<float>(glfwGetTime()))
+{
+    // the programs compile together, each one finishes as soon as it's done. The mesh shader
+    // permutations are built on first use
+    Shader::finishAll({&mCullInstancesShader,
+                       &mBuildDrawCommandsShader,
+                       &mDepthPrepassShader,
+                       &mBuildHiZShader,
+                       &mAssignLightsShader});
+
+    auto checkUniformBlocks = [] (const Shader& shader) {
+        check(validateUniformBlocks(shader), std::format("Renderer: {} has mismatched uniform blocks.", shader.name()).c_str());
+    };
+
+    for (Shader* shader : {&mCullInstancesShader, &mBuildDrawCommandsShader, &mDepthPrepassShader, &mBuildHiZShader, &mAssignLightsShader})
+    {
+        checkUniformBlocks(*shader);
+        mShaderWatcher.watch(*shader);
+    }
+
+    mMeshShaders.setLinkCallback(checkUniformBlocks);
+    mShaderWatcher.watch(mMeshShaders);
+
+    // a reloaded program is already swapped in, a mismatch only gets logged so editing can go on
+    mShaderWatcher.setReloadCallback([] (const Shader& shader) {validateUniformBlocks(shader);});
+
+    CullStats cullStats {};
+    for (ShaderBuffer& cullStatsBuffer : mCullStatsBuffers)
+        cullStatsBuffer.update(0, sizeof(CullStats), &cullStats);
+
+    LightAssignmentStats lightAssignmentStats {};
+    for (ShaderBuffer& lightAssignmentStatsBuffer : mLightAssignmentStatsBuffers)
+        lightAssignmentStatsBuffer.update(0, sizeof(LightAssignmentStats), &lightAssignmentStats);
+
+    // empty clusters until the first assignment
+    std::vector<LightClusters::Cluster> clusters(LightClusters::ClusterCount);
+    mLightGridBuffer.update(0, mLightGridBuffer.size(), clusters.data());
+
+    mShadowMap.setDepthCompare(true);
+    mShadowAtlasTexture.setDepthCompare(true);
+    mShadowFramebuffer.setDepthStencilOnly(true);
+
+    // the shadow pass only borrows the visible instance binding
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VisibleInstanceBufferBinding, mVisibleInstanceBuffer.id());
 }
 
 Renderer::~Renderer()
 {
 }
 
+void Renderer::resize(int32_t width, int32_t height)
+{
+    if (width <= 0 || height <= 0 || (width == mColorTexture.width() && height == mColorTexture.height()))
+        return;
+
+    // the render graph sizes its transient targets after this one
+    mColorTexture.resize(width, height);
+}
+
+void Renderer::render(const Camera &camera)
+{
+    StateCache::resetCounters();
+    mShaderWatcher.update();
+
+    mUniformRing.beginFrame();
+    writeFrameUniforms(camera);
+
+    mResourceManager->updateTextureStreaming(camera.viewProjection(), camera.position(),
+                                             camera.projection()[1][1], static_cast<float>(mColorTexture.height()));
+
+    if (mCullingMode == CullingMode::CPU)
+    {
+        cull(camera);
+        buildDrawCommands(camera);
+        uploadDrawCommands();
+
+        mHasPreviousVisibleSet = false;
+    }
+    else
+    {
+        prepareGPUCulling(camera);
+    }
+
+    prepareLighting(camera);
+    prepareShadows(camera);
+    buildRenderGraph();
+
+    mUniformRing.endFrame();
+
+    mStateCounters = StateCache::counters();
+    ++mFrameIndex;
+}
+
+void Renderer::setCullingMode(CullingMode cullingMode)
+{
+    mCullingMode = cullingMode;
+}
+
+Renderer::CullingMode Renderer::cullingMode() const
+{
+    return mCullingMode;
+}
+
+void Renderer::setOcclusionCulling(bool occlusionCulling)
+{
+    mOcclusionCulling = occlusionCulling;
+}
+
+bool Renderer::occlusionCulling() const
+{
+    return mOcclusionCulling;
+}
+
+void Renderer::setLightAssignmentMode(LightAssignmentMode lightAssignmentMode)
+{
+    mLightAssignmentMode = lightAssignmentMode;
+}
+
+Renderer::LightAssignmentMode Renderer::lightAssignmentMode() const
+{
+    return mLightAssignmentMode;
+}
+
+void Renderer::setShadows(bool shadows)
+{
+    mShadows = shadows;
+}
+
+bool Renderer::shadows() const
+{
+    return mShadows;
+}
+
+void Renderer::setShadowCaching(bool shadowCaching)
+{
+    mShadowCaching = shadowCaching;
+}
+
+bool Renderer::shadowCaching() const
+{
+    return mShadowCaching;
+}
+
+ShadowCascades &Renderer::shadowCascades()
+{
+    return mShadowCascades;
+}
+
+ShadowAtlas &Renderer::shadowAtlas()
+{
+    return mShadowAtlas;
+}
+
+const Texture2D &Renderer::colorTexture() const
+{
+    return mColorTexture;
+}
+
+const Renderer::FrameStats &Renderer::frameStats() const
+{
+    return mFrameStats;
+}
+
+const DrawQueue::Stats &Renderer::drawQueueStats() const
+{
+    return mDrawQueue.stats();
+}
+
+const RenderGraph &Renderer::renderGraph() const
+{
+    return mRenderGraph;
+}
+
+const StateCache::Counters &Renderer::stateCounters() const
+{
+    return mStateCounters;
+}
+
+UniformRingBuffer::Stats Renderer::uniformRingStats() const
+{
+    return mUniformRing.stats();
+}
+
+const LightClusters::Stats &Renderer::lightClusterStats() const
+{
+    return mLightClusterStats;
+}
+
+std::vector<DrawCommand> Renderer::readbackDrawCommands() const
+{
+    uint32_t drawCommandCount = mFrameStats.drawCommandCount;
+
+    if (mCullingMode == CullingMode::GPU)
+        glGetNamedBufferSubData(mDrawCountBuffer.id(), 0, sizeof(uint32_t), &drawCommandCount);
+
+    std::vector<DrawCommand> drawCommands(drawCommandCount);
+    glGetNamedBufferSubData(mIndirectBuffer.id(), 0, drawCommands.size() * sizeof(DrawCommand), drawCommands.data());
+    return drawCommands;
+}
+
+// one command per mesh with visible instances, instances packed in mesh order. The command
+// buffer itself is in sort key order, compare by base instance
+std::vector<DrawCommand> Renderer::referenceDrawCommands() const
+{
+    std::vector<DrawCommand> drawCommands;
+    uint32_t baseInstance = 0;
+
+    for (const auto& [meshID, mesh] : mResourceManager->mMeshes)
+    {
+        uint32_t visibleCount = static_cast<uint32_t>(mesh->visibleInstances().size());
+
+        if (!visibleCount)
+            continue;
+
+        drawCommands.push_back({
+            .count = mesh->geometry().indexCount,
+            .instanceCount = visibleCount,
+            .firstIndex = mesh->geometry().firstIndex,
+            .baseVertex = static_cast<int32_t>(mesh->geometry().baseVertex),
+            .baseInstance = baseInstance
+        });
+
+        baseInstance += visibleCount;
+    }
+
+    return drawCommands;
+}
+
+bool Renderer::validateDrawCommands() const
+{
+    if (mCullingMode == CullingMode::CPU)
+        return validateCPUCulling();
+    return validateGPUCulling();
+}
+
+void Renderer::dumpDrawCommands(const std::filesystem::path &path) const
+{
+    std::ofstream file(path);
+    check(file.is_open(), "Failed to open draw command dump file.");
+
+    std::vector<DrawCommand> drawCommands = readbackDrawCommands();
+
+    uint32_t visibleCount = 0;
+    for (const DrawCommand& drawCommand : drawCommands)
+        visibleCount += drawCommand.instanceCount;
+
+    file << std::format("{} draw commands, {} instances\n", drawCommands.size(), visibleCount);
+    file << "count, instanceCount, firstIndex, baseVertex, baseInstance\n";
+
+    for (const DrawCommand& drawCommand : drawCommands)
+    {
+        file << std::format("{}, {}, {}, {}, {}\n",
+                            drawCommand.count,
+                            drawCommand.instanceCount,
+                            drawCommand.firstIndex,
+                            drawCommand.baseVertex,
+                            drawCommand.baseInstance);
+    }
+
+    file << (validateDrawCommands()? "matches" : "DOES NOT match") << " the CPU reference\n";
+}
+
+// assigns the lights again on the cpu with the view of the last frame. Both paths keep the lights
+// of a cluster in slot order, the lists are still compared as sets
+bool Renderer::validateLightClusters()
+{
+    std::vector<LightClusters::Cluster> clusters(LightClusters::ClusterCount);
+    glGetNamedBufferSubData(mLightGridBuffer.id(), 0, clusters.size() * sizeof(LightClusters::Cluster), clusters.data());
+
+    uint32_t indexCount = 0;
+    for (const LightClusters::Cluster& cluster : clusters)
+        indexCount = glm::max(indexCount, cluster.offset + cluster.count);
+
+    std::vector<uint32_t> lightIndices(glm::min(indexCount, mLightIndexBuffer.size() / static_cast<uint32_t>(sizeof(uint32_t))));
+    glGetNamedBufferSubData(mLightIndexBuffer.id(), 0, lightIndices.size() * sizeof(uint32_t), lightIndices.data());
+
+    mLightClusters.assign(LightArena::instance().lights(), mLightView);
+
+    uint32_t mismatchCount = 0;
+
+    for (uint32_t i = 0; i < LightClusters::ClusterCount; ++i)
+    {
+        const LightClusters::Cluster& expected = mLightClusters.clusters().at(i);
+        const LightClusters::Cluster& actual = clusters.at(i);
+
+        if (actual.offset + actual.count > lightIndices.size())
+        {
+            ++mismatchCount;
+            continue;
+        }
+
+        auto expectedFirst = mLightClusters.lightIndices().begin() + expected.offset;
+        auto actualFirst = lightIndices.begin() + actual.offset;
+
+        std::vector<uint32_t> expectedLights(expectedFirst, expectedFirst + expected.count);
+        std::vector<uint32_t> actualLights(actualFirst, actualFirst + actual.count);
+
+        std::sort(expectedLights.begin(), expectedLights.end());
+        std::sort(actualLights.begin(), actualLights.end());
+
+        if (actualLights != expectedLights)
+            ++mismatchCount;
+    }
+
+    if (mismatchCount)
+        debugLog(std::format("Renderer: light clusters differ from the CPU reference for {} clusters.", mismatchCount), LogSeverity::Error);
+
+    return mismatchCount == 0;
+}
+
+void Renderer::cull(const Camera &camera)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    mFrustum = Frustum(camera.viewProjection());
+    mFrameStats = {};
+
+    for (const auto& [meshID, mesh] : mResourceManager->mMeshes)
+    {
+        ++mFrameStats.meshCount;
+        mFrameStats.instanceCount += mesh->instanceCount();
+        mFrameStats.visibleCount += mesh->cull(mFrustum);
+    }
+
+    mFrameStats.cullMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// every mesh becomes a draw packet sorted front to back by its closest visible instance. All
+// meshes share the shader and the geometry arena, so the queue still issues a single batch
+void Renderer::buildDrawCommands(const Camera& camera)
+{
+    mDrawQueue.clear();
+    mVisibleInstanceSlots.clear();
+    mVisibleInstanceSlots.reserve(mFrameStats.visibleCount);
+
+    const VertexArray& vertexArray = GeometryArena::instance().vertexArray();
+    Shader& shader = meshShader();
+
+    for (const auto& [meshID, mesh] : mResourceManager->mMeshes)
+    {
+        const std::vector<uint32_t>& visibleInstances = mesh->visibleInstances();
+
+        if (visibleInstances.empty())
+            continue;
+
+        const GeometryArena::Allocation& geometry = mesh->geometry();
+
+        DrawCommand drawCommand {
+            .count = geometry.indexCount,
+            .instanceCount = static_cast<uint32_t>(visibleInstances.size()),
+            .firstIndex = geometry.firstIndex,
+            .baseVertex = static_cast<int32_t>(geometry.baseVertex),
+            .baseInstance = static_cast<uint32_t>(mVisibleInstanceSlots.size())
+        };
+
+        float viewDepth = mesh->nearestVisibleDepth(camera.position(), camera.front());
+
+        mDrawQueue.submit({
+            .sortKey = DrawQueue::makeSortKey(DrawQueue::Opaque, shader.id(), vertexArray.id(), 0, viewDepth),
+            .shader = &shader,
+            .vertexArray = &vertexArray,
+            .texture = nullptr,
+            .command = drawCommand
+        });
+
+        for (uint32_t instanceIndex : visibleInstances)
+            mVisibleInstanceSlots.push_back(mesh->instanceSlots()[instanceIndex]);
+    }
+
+    mDrawQueue.sort();
+    mDrawCommands = mDrawQueue.drawCommands();
+
+    mFrameStats.drawCommandCount = static_cast<uint32_t>(mDrawCommands.size());
+}
+
+void Renderer::uploadDrawCommands()
+{
+    uint32_t drawCommandsSize = static_cast<uint32_t>(mDrawCommands.size() * sizeof(DrawCommand));
+    uint32_t visibleInstancesSize = static_cast<uint32_t>(mVisibleInstanceSlots.size() * sizeof(uint32_t));
+
+    if (drawCommandsSize > mIndirectBuffer.size())
+        mIndirectBuffer = IndirectBuffer(GL_DYNAMIC_DRAW, glm::max(drawCommandsSize, mIndirectBuffer.size() * 2), nullptr);
+
+    if (visibleInstancesSize > mVisibleInstanceBuffer.size())
+    {
+        mVisibleInstanceBuffer = ShaderBuffer(GL_SHADER_STORAGE_BUFFER,
+                                              GL_DYNAMIC_DRAW,
+                                              VisibleInstanceBufferBinding,
+                                              glm::max(visibleInstancesSize, mVisibleInstanceBuffer.size() * 2),
+                                              nullptr);
+    }
+
+    mIndirectBuffer.update(0, drawCommandsSize, mDrawCommands.data());
+    mVisibleInstanceBuffer.update(0, visibleInstancesSize, mVisibleInstanceSlots.data());
+}
+
+// the frame and view blocks stay bound for the whole frame, passes bind their own pass block
+void Renderer::writeFrameUniforms(const Camera &camera)
+{
+    float time = static_cast<float>(glfwGetTime());
+
+    FrameUniforms frameUniforms {
+        .time = time,
+        .deltaTime = time - mTime,
+        .frameIndex = mFrameIndex
+    };
+
+    mTime = time;
+
+    const glm::mat4& projection = camera.projection();
+    glm::vec2 viewportSize(mColorTexture.width(), mColorTexture.height());
+
+    ViewUniforms viewUniforms {
+        .view = camera.view(),
+        .projection = projection,
+        .viewProjection = camera.viewProjection(),
+        .inverseView = glm::inverse(camera.view()),
+        .inverseProjection = glm::inverse(projection),
+        .inverseViewProjection = glm::inverse(camera.viewProjection()),
+        .position = glm::vec4(camera.position(), 1.f),
+        .jitter = glm::vec2(0.f),
+        .viewportSize = viewportSize,
+        .nearZ = projection[3][2] / (projection[2][2] - 1.f),
+        .farZ = projection[3][2] / (projection[2][2] + 1.f)
+    };
+
+    PassUniforms cameraPassUniforms {
+        .viewProjection = camera.viewProjection(),
+        .viewportSize = viewportSize
+    };
+
+    mUniformRing.bind(FrameUniformBinding, mUniformRing.write(frameUniforms));
+    mUniformRing.bind(ViewUniformBinding, mUniformRing.write(viewUniforms));
+    mCameraPassUniforms = mUniformRing.write(cameraPassUniforms);
+}
+
+// declares the frame's passes and runs them, the graph owns every target except the color
+// texture the editor displays
+void Renderer::buildRenderGraph()
+{
+    int32_t width = mColorTexture.width();
+    int32_t height = mColorTexture.height();
+
+    mRenderGraph.reset();
+
+    RenderGraph::ResourceHandle color = mRenderGraph.importTexture("Color", mColorTexture);
+    RenderGraph::ResourceHandle shadowAtlas = mRenderGraph.importTexture("Shadow Atlas", mShadowAtlasTexture);
+    RenderGraph::ResourceHandle prepassDepth;
+    std::optional<RenderGraph::ResourceHandle> hiZ;
+
+    if (mCullingMode == CullingMode::GPU)
+    {
+        if (mOcclusionCulling)
+        {
+            mRenderGraph.addPass("Depth Pre-pass", RenderGraph::PassType::Graphics,
+                [&] (RenderGraph::PassBuilder& builder) {
+                    prepassDepth = builder.create("Pre-pass Depth", depthTextureSpec(width, height));
+                },
+                [&] (RenderGraph&) {
+                    renderDepthPrepass();
+                });
+
+            mRenderGraph.addPass("Hi-Z", RenderGraph::PassType::Compute,
+                [&] (RenderGraph::PassBuilder& builder) {
+                    builder.read(prepassDepth);
+                    hiZ = builder.create("Hi-Z", hiZTextureSpec(width, height));
+                },
+                [&] (RenderGraph& graph) {
+                    buildHiZ(graph.texture(prepassDepth), graph.texture(*hiZ));
+                });
+        }
+
+        mRenderGraph.addPass("GPU Culling", RenderGraph::PassType::Compute,
+            [&] (RenderGraph::PassBuilder& builder) {
+                if (hiZ)
+                    builder.read(*hiZ);
+                builder.sideEffect();
+            },
+            [&] (RenderGraph& graph) {
+                dispatchGPUCulling(hiZ? &graph.texture(*hiZ) : nullptr);
+            });
+    }
+
+    // only present on frames where a cascade lost its cached depth
+    bool renderShadows = mShadowLight && std::ranges::any_of(mShadowCascades.cascades(), &ShadowCascades::Cascade::dirty);
+
+    if (renderShadows)
+    {
+        // draws into layers of the shadow map array through its own framebuffer, the graph
+        // doesn't track array textures
+        mRenderGraph.addPass("Shadow Cascades", RenderGraph::PassType::Graphics,
+            [&] (RenderGraph::PassBuilder& builder) {
+                builder.sideEffect();
+            },
+            [&] (RenderGraph&) {
+                renderShadowCascades();
+            });
+    }
+
+    if (!mShadowAtlas.renderQueue().empty())
+    {
+        mRenderGraph.addPass("Shadow Atlas", RenderGraph::PassType::Graphics,
+            [&] (RenderGraph::PassBuilder& builder) {
+                builder.write(shadowAtlas);
+            },
+            [&] (RenderGraph&) {
+                renderShadowAtlas();
+            });
+    }
+
+    if (mLightAssignmentMode == LightAssignmentMode::GPU)
+    {
+        mRenderGraph.addPass("Light Clustering", RenderGraph::PassType::Compute,
+            [&] (RenderGraph::PassBuilder& builder) {
+                builder.sideEffect();
+            },
+            [&] (RenderGraph&) {
+                dispatchLightAssignment();
+            });
+    }
+
+    mRenderGraph.addPass("Scene", RenderGraph::PassType::Graphics,
+        [&] (RenderGraph::PassBuilder& builder) {
+            builder.write(color);
+            builder.read(shadowAtlas);
+            builder.create("Depth", depthTextureSpec(width, height));
+        },
+        [&] (RenderGraph&) {
+            renderScene();
+        });
+
+    mRenderGraph.compile();
+    mRenderGraph.execute();
+}
+
+// each mesh gets a region of the visible slot buffer as large as its instance count. The cull
+// shader fills the regions, the second pass emits one command per mesh with visible instances
+void Renderer::prepareGPUCulling(const Camera &camera)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    mFrustum = Frustum(camera.viewProjection());
+    mFrameStats = {};
+
+    uint32_t meshSlotCount = GeometryArena::instance().meshSlotCount();
+
+    mMeshDrawStates.assign(meshSlotCount, {});
+
+    uint32_t instanceOffset = 0;
+    for (const auto& [meshID, mesh] : mResourceManager->mMeshes)
+    {
+        ++mFrameStats.meshCount;
+        mFrameStats.instanceCount += mesh->instanceCount();
+
+        uint32_t meshIndex = mesh->geometry().meshIndex;
+
+        if (meshIndex == InvalidMeshIndex)
+            continue;
+
+        mMeshDrawStates.at(meshIndex).instanceOffset = instanceOffset;
+        instanceOffset += mesh->instanceCount();
+    }
+
+    mVisibleSlotCount = instanceOffset;
+    mFrameStats.cullMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// occluders are whatever was visible last frame, so the depth pre-pass has to run before this
+// resets or reallocates the buffers holding the previous visible set
+void Renderer::dispatchGPUCulling(Texture2D* hiZTexture)
+{
+    uint32_t meshSlotCount = static_cast<uint32_t>(mMeshDrawStates.size());
+    uint32_t instanceSlotCount = InstanceArena::instance().slotCount();
+
+    uint32_t drawCommandsSize = meshSlotCount * sizeof(DrawCommand);
+    uint32_t visibleInstancesSize = mVisibleSlotCount * sizeof(uint32_t);
+    uint32_t meshDrawStatesSize = meshSlotCount * sizeof(MeshDrawState);
+
+    if (drawCommandsSize > mIndirectBuffer.size())
+        mIndirectBuffer = IndirectBuffer(GL_DYNAMIC_DRAW, glm::max(drawCommandsSize, mIndirectBuffer.size() * 2), nullptr);
+
+    if (visibleInstancesSize > mVisibleInstanceBuffer.size())
+    {
+        mVisibleInstanceBuffer = ShaderBuffer(GL_SHADER_STORAGE_BUFFER,
+                                              GL_DYNAMIC_DRAW,
+                                              VisibleInstanceBufferBinding,
+                                              glm::max(visibleInstancesSize, mVisibleInstanceBuffer.size() * 2),
+                                              nullptr);
+    }
+
+    if (meshDrawStatesSize > mMeshDrawStateBuffer.size())
+    {
+        mMeshDrawStateBuffer = ShaderBuffer(GL_SHADER_STORAGE_BUFFER,
+                                            GL_DYNAMIC_DRAW,
+                                            MeshDrawStateBufferBinding,
+                                            glm::max(meshDrawStatesSize, mMeshDrawStateBuffer.size() * 2),
+                                            nullptr);
+    }
+
+    uint32_t drawCount = 0;
+    mMeshDrawStateBuffer.update(0, meshDrawStatesSize, mMeshDrawStates.data());
+    mDrawCountBuffer.update(0, sizeof(uint32_t), &drawCount);
+
+    CullStats cullStats {};
+    ShaderBuffer& cullStatsBuffer = mCullStatsBuffers.at(mFrameIndex % 2);
+    cullStatsBuffer.update(0, sizeof(CullStats), &cullStats);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CullStatsBufferBinding, cullStatsBuffer.id());
+
+    // the indirect buffer is written by the second pass
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DrawCommandBufferBinding, mIndirectBuffer.id());
+
+    if (hiZTexture)
+        hiZTexture->bind(0);
+
+    mCullInstancesShader.bind();
+    mCullInstancesShader.setUint("uSlotCount", instanceSlotCount);
+    mCullInstancesShader.setFloat4Array("uFrustumPlanes[0]", Frustum::Count, mFrustum.planes.data());
+    mCullInstancesShader.setInt("uOcclusionCulling", hiZTexture != nullptr);
+    glDispatchCompute((instanceSlotCount + sComputeWorkGroupSize - 1) / sComputeWorkGroupSize, 1, 1);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    mBuildDrawCommandsShader.bind();
+    mBuildDrawCommandsShader.setUint("uMeshCount", meshSlotCount);
+    glDispatchCompute((meshSlotCount + sComputeWorkGroupSize - 1) / sComputeWorkGroupSize, 1, 1);
+    mBuildDrawCommandsShader.unbind();
+
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    // the previous frame's counters are normally done by now
+    glGetNamedBufferSubData(mCullStatsBuffers.at((mFrameIndex + 1) % 2).id(), 0, sizeof(CullStats), &cullStats);
+    mFrameStats.visibleCount = cullStats.visibleCount;
+    mFrameStats.occludedCount = cullStats.occludedCount;
+
+    mMaxDrawCount = meshSlotCount;
+    mHasPreviousVisibleSet = true;
+}
+
+// uploads the changed lights and the cluster bounds when the projection changed. The directional
+// lights go to the mesh shader as a short list of slots, the others get clustered
+void Renderer::prepareLighting(const Camera &camera)
+{
+    LightArena& lightArena = LightArena::instance();
+    lightArena.upload();
+
+    uint32_t localLightCount = 0;
+    mDirectionalLights.clear();
+
+    for (uint32_t slot = 0; slot < lightArena.slotCount(); ++slot)
+    {
+        LightType type = lightArena.lights().at(slot).type;
+
+        if (type == LightType::Directional && mDirectionalLights.size() < MaxDirectionalLights)
+            mDirectionalLights.push_back(slot);
+
+        localLightCount += type == LightType::Point || type == LightType::Spot;
+    }
+
+    if (mLightClusters.setProjection(camera.projection()))
+    {
+        std::vector<ClusterBounds> clusterBounds;
+        clusterBounds.reserve(LightClusters::ClusterCount);
+
+        for (const BoundingBox& bb : mLightClusters.clusterBounds())
+            clusterBounds.push_back({glm::vec4(bb.min, 0.f), glm::vec4(bb.max, 0.f)});
+
+        mClusterBoundsBuffer.update(0, clusterBounds.size() * sizeof(ClusterBounds), clusterBounds.data());
+    }
+
+    mLightView = camera.view();
+
+    if (mLightAssignmentMode == LightAssignmentMode::CPU)
+    {
+        mLightClusters.assign(lightArena.lights(), mLightView);
+        uploadLightClusters();
+
+        mLightClusterStats = mLightClusters.stats();
+    }
+    else
+    {
+        mLightClusterStats.lightCount = localLightCount;
+    }
+}
+
+void Renderer::uploadLightClusters()
+{
+    const std::vector<LightClusters::Cluster>& clusters = mLightClusters.clusters();
+    const std::vector<uint32_t>& lightIndices = mLightClusters.lightIndices();
+
+    uint32_t lightIndicesSize = static_cast<uint32_t>(lightIndices.size() * sizeof(uint32_t));
+
+    if (lightIndicesSize > mLightIndexBuffer.size())
+    {
+        mLightIndexBuffer = ShaderBuffer(GL_SHADER_STORAGE_BUFFER,
+                                         GL_DYNAMIC_DRAW,
+                                         LightIndexBufferBinding,
+                                         glm::max(lightIndicesSize, mLightIndexBuffer.size() * 2),
+                                         nullptr);
+    }
+
+    mLightGridBuffer.update(0, clusters.size() * sizeof(LightClusters::Cluster), clusters.data());
+
+    if (lightIndicesSize)
+        mLightIndexBuffer.update(0, lightIndicesSize, lightIndices.data());
+}
+
+// one invocation per cluster. Clusters that don't fit in the index buffer lose their lights, the
+// counters of the previous frame tell how large it has to be and it grows for the next one
+void Renderer::dispatchLightAssignment()
+{
+    uint32_t indexCapacity = mLightIndexBuffer.size() / sizeof(uint32_t);
+
+    LightAssignmentStats stats {};
+    ShaderBuffer& statsBuffer = mLightAssignmentStatsBuffers.at(mFrameIndex % 2);
+    statsBuffer.update(0, sizeof(LightAssignmentStats), &stats);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LightAssignmentStatsBufferBinding, statsBuffer.id());
+
+    mAssignLightsShader.bind();
+    mAssignLightsShader.setUint("uLightSlotCount", LightArena::instance().slotCount());
+    mAssignLightsShader.setUint("uIndexCapacity", indexCapacity);
+    mAssignLightsShader.setMat4("uProjection", mLightClusters.projection());
+    mAssignLightsShader.setFloat("uNearZ", mLightClusters.nearPlane());
+    mAssignLightsShader.setFloat("uFarZ", mLightClusters.farPlane());
+    mAssignLightsShader.setFloat2("uSliceScaleBias", mLightClusters.sliceScaleBias());
+    glDispatchCompute((LightClusters::ClusterCount + sComputeWorkGroupSize - 1) / sComputeWorkGroupSize, 1, 1);
+    mAssignLightsShader.unbind();
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glGetNamedBufferSubData(mLightAssignmentStatsBuffers.at((mFrameIndex + 1) % 2).id(), 0, sizeof(LightAssignmentStats), &stats);
+    mLightClusterStats.indexCount = stats.indexCount;
+    mLightClusterStats.maxLightsPerCluster = stats.maxLightsPerCluster;
+    mLightClusterStats.occupiedClusterCount = stats.occupiedClusterCount;
+    mLightClusterStats.assignMs = 0.f;
+
+    if (stats.indexCount > indexCapacity)
+    {
+        mLightIndexBuffer = ShaderBuffer(GL_SHADER_STORAGE_BUFFER,
+                                         GL_DYNAMIC_DRAW,
+                                         LightIndexBufferBinding,
+                                         glm::max(stats.indexCount, indexCapacity * 2) * sizeof(uint32_t),
+                                         nullptr);
+    }
+}
+
+// the casters only get collected again when the instance arena changed
+void Renderer::prepareShadows(const Camera &camera)
+{
+    mShadowLight.reset();
+    mFrameStats.shadowCascadesRendered = 0;
+    mFrameStats.shadowTilesRendered = 0;
+    mFrameStats.shadowCasterInstanceCount = 0;
+
+    uint64_t casterVersion = InstanceArena::instance().changeCount();
+
+    if (!mShadowCaching)
+        mShadowAtlas.invalidate();
+
+    // without shadows the atlas lets go of every tile
+    static const std::vector<LightData> sNoLights;
+    const std::vector<LightData>& lights = LightArena::instance().lights();
+    mShadowAtlas.update(mShadows? lights : sNoLights, camera.view(), camera.projection(), casterVersion);
+
+    uploadShadowAtlas();
+
+    if (!mShadows || mDirectionalLights.empty())
+        return;
+
+    mShadowLight = mDirectionalLights.front();
+
+    if (casterVersion != mShadowCasterVersion)
+    {
+        mShadowCasterBounds = {};
+
+        for (const auto& [meshID, mesh] : mResourceManager->mMeshes)
+            mShadowCasterBounds.expand(mesh->instanceBounds());
+
+        mShadowCasterVersion = casterVersion;
+    }
+
+    if (!mShadowCaching)
+        mShadowCascades.invalidate();
+
+    mShadowCascades.update(camera.view(), camera.projection(), lights.at(*mShadowLight).direction, mShadowCasterBounds, casterVersion);
+}
+
+void Renderer::uploadShadowAtlas()
+{
+    const std::vector<uint32_t>& lightShadowIndices = mShadowAtlas.lightShadowIndices();
+    const std::vector<ShadowAtlas::ShadowTile>& shadowTiles = mShadowAtlas.shadowTiles();
+
+    uint32_t lightShadowIndicesSize = static_cast<uint32_t>(lightShadowIndices.size() * sizeof(uint32_t));
+    uint32_t shadowTilesSize = static_cast<uint32_t>(shadowTiles.size() * sizeof(ShadowAtlas::ShadowTile));
+
+    if (lightShadowIndicesSize > mLightShadowBuffer.size())
+    {
+        mLightShadowBuffer = ShaderBuffer(GL_SHADER_STORAGE_BUFFER,
+                                          GL_DYNAMIC_DRAW,
+                                          LightShadowBufferBinding,
+                                          glm::max(lightShadowIndicesSize, mLightShadowBuffer.size() * 2),
+                                          nullptr);
+    }
+
+    if (lightShadowIndicesSize)
+        mLightShadowBuffer.update(0, lightShadowIndicesSize, lightShadowIndices.data());
+
+    if (shadowTilesSize)
+        mShadowTileBuffer.update(0, shadowTilesSize, shadowTiles.data());
+}
+
+// every cascade that lost its depth gets its own culling pass, the commands of all of them go
+// into one buffer and each cascade draws its range with a single multi draw
+void Renderer::renderShadowCascades()
+{
+    const std::array<ShadowCascades::Cascade, ShadowCascades::CascadeCount>& cascades = mShadowCascades.cascades();
+    std::array<std::pair<uint32_t, uint32_t>, ShadowCascades::CascadeCount> commandRanges {};
+
+    mShadowDrawCommands.clear();
+    mShadowVisibleInstanceSlots.clear();
+
+    for (uint32_t i = 0; i < ShadowCascades::CascadeCount; ++i)
+    {
+        if (cascades.at(i).dirty)
+            commandRanges.at(i) = cullShadowCasters(Frustum(cascades.at(i).viewProjection));
+    }
+
+    beginShadowDraws();
+
+    glViewport(0, 0, ShadowCascades::Resolution, ShadowCascades::Resolution);
+    glEnable(GL_DEPTH_CLAMP);
+
+    for (uint32_t i = 0; i < ShadowCascades::CascadeCount; ++i)
+    {
+        if (!cascades.at(i).dirty)
+            continue;
+
+        mShadowFramebuffer.addDepthAttachmentLayer(mShadowMap, i);
+        mShadowFramebuffer.bind();
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        drawShadowCasters(commandRanges.at(i), cascades.at(i).viewProjection, ShadowCascades::Resolution);
+
+        mShadowCascades.markRendered(i);
+        ++mFrameStats.shadowCascadesRendered;
+    }
+
+    glDisable(GL_DEPTH_CLAMP);
+    mShadowFramebuffer.unbind();
+
+    endShadowDraws();
+}
+
+// the render graph binds the atlas, each face is scissored to its tile and cleared on its own so
+// the cached tiles around it keep their depth
+void Renderer::renderShadowAtlas()
+{
+    const std::vector<ShadowAtlas::Entry>& entries = mShadowAtlas.entries();
+    const std::vector<uint32_t>& renderQueue = mShadowAtlas.renderQueue();
+
+    std::vector<std::pair<uint32_t, uint32_t>> commandRanges;
+
+    mShadowDrawCommands.clear();
+    mShadowVisibleInstanceSlots.clear();
+
+    for (uint32_t entryIndex : renderQueue)
+    {
+        const ShadowAtlas::Entry& entry = entries.at(entryIndex);
+
+        for (uint32_t face = 0; face < entry.faceCount; ++face)
+            commandRanges.push_back(cullShadowCasters(Frustum(entry.viewProjections.at(face))));
+    }
+
+    beginShadowDraws();
+
+    glEnable(GL_SCISSOR_TEST);
+
+    uint32_t faceIndex = 0;
+
+    for (uint32_t entryIndex : renderQueue)
+    {
+        const ShadowAtlas::Entry& entry = entries.at(entryIndex);
+
+        for (uint32_t face = 0; face < entry.faceCount; ++face)
+        {
+            const ShadowAtlas::Tile& tile = entry.tiles.at(face);
+
+            glViewport(tile.x, tile.y, tile.size, tile.size);
+            glScissor(tile.x, tile.y, tile.size, tile.size);
+            glClear(GL_DEPTH_BUFFER_BIT);
+
+            drawShadowCasters(commandRanges.at(faceIndex++), entry.viewProjections.at(face), tile.size);
+        }
+
+        mFrameStats.shadowTilesRendered += entry.faceCount;
+    }
+
+    for (uint32_t entryIndex : renderQueue)
+        mShadowAtlas.markRendered(entryIndex);
+
+    glDisable(GL_SCISSOR_TEST);
+
+    endShadowDraws();
+}
+
+// appends one command per mesh with instances in the frustum, returns the first command and the count
+std::pair<uint32_t, uint32_t> Renderer::cullShadowCasters(const Frustum &frustum)
+{
+    uint32_t firstCommand = static_cast<uint32_t>(mShadowDrawCommands.size());
+
+    for (const auto& [meshID, mesh] : mResourceManager->mMeshes)
+    {
+        if (!mesh->cull(frustum, mShadowCasterInstances))
+            continue;
+
+        const GeometryArena::Allocation& geometry = mesh->geometry();
+
+        mShadowDrawCommands.push_back({
+            .count = geometry.indexCount,
+            .instanceCount = static_cast<uint32_t>(mShadowCasterInstances.size()),
+            .firstIndex = geometry.firstIndex,
+            .baseVertex = static_cast<int32_t>(geometry.baseVertex),
+            .baseInstance = static_cast<uint32_t>(mShadowVisibleInstanceSlots.size())
+        });
+
+        for (uint32_t instanceIndex : mShadowCasterInstances)
+            mShadowVisibleInstanceSlots.push_back(mesh->instanceSlots()[instanceIndex]);
+    }
+
+    return {firstCommand, static_cast<uint32_t>(mShadowDrawCommands.size()) - firstCommand};
+}
+
+// uploads the culled casters and binds them in place of the camera's visible instances
+void Renderer::beginShadowDraws()
+{
+    uint32_t drawCommandsSize = static_cast<uint32_t>(mShadowDrawCommands.size() * sizeof(DrawCommand));
+    uint32_t visibleInstancesSize = static_cast<uint32_t>(mShadowVisibleInstanceSlots.size() * sizeof(uint32_t));
+
+    if (drawCommandsSize > mShadowIndirectBuffer.size())
+        mShadowIndirectBuffer = IndirectBuffer(GL_DYNAMIC_DRAW, glm::max(drawCommandsSize, mShadowIndirectBuffer.size() * 2), nullptr);
+
+    if (visibleInstancesSize > mShadowVisibleInstanceBuffer.size())
+    {
+        mShadowVisibleInstanceBuffer = ShaderBuffer(GL_SHADER_STORAGE_BUFFER,
+                                                    GL_DYNAMIC_DRAW,
+                                                    VisibleInstanceBufferBinding,
+                                                    glm::max(visibleInstancesSize, mShadowVisibleInstanceBuffer.size() * 2),
+                                                    nullptr);
+    }
+
+    if (drawCommandsSize)
+    {
+        mShadowIndirectBuffer.update(0, drawCommandsSize, mShadowDrawCommands.data());
+        mShadowVisibleInstanceBuffer.update(0, visibleInstancesSize, mShadowVisibleInstanceSlots.data());
+    }
+
+    mFrameStats.shadowCasterInstanceCount += static_cast<uint32_t>(mShadowVisibleInstanceSlots.size());
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VisibleInstanceBufferBinding, mShadowVisibleInstanceBuffer.id());
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(1.5f, 2.f);
+
+    mDepthPrepassShader.bind();
+    GeometryArena::instance().vertexArray().bind();
+    mShadowIndirectBuffer.bind();
+}
+
+void Renderer::drawShadowCasters(std::pair<uint32_t, uint32_t> commandRange, const glm::mat4 &viewProjection, uint32_t resolution)
+{
+    auto [firstCommand, commandCount] = commandRange;
+
+    if (!commandCount)
+        return;
+
+    PassUniforms passUniforms {
+        .viewProjection = viewProjection,
+        .viewportSize = glm::vec2(static_cast<float>(resolution))
+    };
+
+    mUniformRing.bind(PassUniformBinding, mUniformRing.write(passUniforms));
+
+    glMultiDrawElementsIndirect(GL_TRIANGLES,
+                                GL_UNSIGNED_INT,
+                                reinterpret_cast<const void*>(static_cast<uintptr_t>(firstCommand * sizeof(DrawCommand))),
+                                commandCount,
+                                0);
+}
+
+void Renderer::endShadowDraws()
+{
+    mShadowIndirectBuffer.unbind();
+    GeometryArena::instance().vertexArray().unbind();
+    mDepthPrepassShader.unbind();
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_TEST);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VisibleInstanceBufferBinding, mVisibleInstanceBuffer.id());
+}
+
+void Renderer::renderDepthPrepass()
+{
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    // without a previous visible set the depth stays cleared and nothing gets occluded
+    if (mHasPreviousVisibleSet && mMaxDrawCount > 0)
+    {
+        glEnable(GL_DEPTH_TEST);
+
+        mDepthPrepassShader.bind();
+        mUniformRing.bind(PassUniformBinding, mCameraPassUniforms);
+
+        GeometryArena::instance().vertexArray().bind();
+        mIndirectBuffer.bind();
+        glBindBuffer(GL_PARAMETER_BUFFER, mDrawCountBuffer.id());
+
+        glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0, mMaxDrawCount, 0);
+
+        glBindBuffer(GL_PARAMETER_BUFFER, 0);
+        mIndirectBuffer.unbind();
+        GeometryArena::instance().vertexArray().unbind();
+        mDepthPrepassShader.unbind();
+
+        glDisable(GL_DEPTH_TEST);
+    }
+}
+
+void Renderer::buildHiZ(Texture2D &depthTexture, Texture2D &hiZTexture)
+{
+    // texelFetch on levels past the base level needs a mipmapped min filter
+    glTextureParameteri(hiZTexture.id(), GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+
+    mBuildHiZShader.bind();
+    depthTexture.bind(0);
+
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    for (uint32_t level = 0; level < hiZTexture.mipLevelCount(); ++level)
+    {
+        uint32_t levelWidth = glm::max(hiZTexture.width() >> level, 1);
+        uint32_t levelHeight = glm::max(hiZTexture.height() >> level, 1);
+
+        if (level > 0)
+            hiZTexture.bindImage(0, level - 1, GL_READ_ONLY);
+        hiZTexture.bindImage(1, level, GL_WRITE_ONLY);
+
+        mBuildHiZShader.setInt("uReduceDepth", level == 0);
+        glDispatchCompute((levelWidth + sHiZWorkGroupSize - 1) / sHiZWorkGroupSize,
+                          (levelHeight + sHiZWorkGroupSize - 1) / sHiZWorkGroupSize,
+                          1);
+
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    depthTexture.unbind(0);
+    mBuildHiZShader.unbind();
+}
+
+// the whole scene is a single multi draw call over the geometry arena
+void Renderer::renderScene()
+{
+    glClearColor(0.1f, 0.1f, 0.1f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+
+    bool gpuCulled = mCullingMode == CullingMode::GPU;
+
+    if (gpuCulled? mMaxDrawCount > 0 : !mDrawCommands.empty())
+    {
+        Shader& shader = meshShader();
+
+        shader.bind();
+        mUniformRing.bind(PassUniformBinding, mCameraPassUniforms);
+        shader.setFloat2("uSliceScaleBias", mLightClusters.sliceScaleBias());
+        shader.setUint("uDirectionalLightCount", static_cast<uint32_t>(mDirectionalLights.size()));
+
+        if (!mDirectionalLights.empty())
+            shader.setUintArray("uDirectionalLights[0]", static_cast<uint32_t>(mDirectionalLights.size()), mDirectionalLights.data());
+
+        // the permutation without shadows has none of these
+        if (mShadows)
+        {
+            std::array<glm::mat4, ShadowCascades::CascadeCount> cascadeViewProjections;
+            for (uint32_t i = 0; i < ShadowCascades::CascadeCount; ++i)
+                cascadeViewProjections.at(i) = mShadowCascades.cascades().at(i).viewProjection;
+
+            mShadowMap.bind(0);
+            shader.setUint("uShadowLight", mShadowLight.value_or(UINT32_MAX));
+            shader.setMat4Array("uCascadeViewProjections[0]", ShadowCascades::CascadeCount, cascadeViewProjections.data());
+            shader.setFloat4("uCascadeSplits", mShadowCascades.splitDepths());
+            shader.setFloat4("uCascadeTexelSizes", mShadowCascades.texelSizes());
+
+            mShadowAtlasTexture.bind(1);
+            shader.setUint("uLightShadowCount", static_cast<uint32_t>(mShadowAtlas.lightShadowIndices().size()));
+        }
+
+        if (gpuCulled)
+        {
+            GeometryArena::instance().vertexArray().bind();
+            mIndirectBuffer.bind();
+            glBindBuffer(GL_PARAMETER_BUFFER, mDrawCountBuffer.id());
+
+            glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0, mMaxDrawCount, 0);
+
+            glBindBuffer(GL_PARAMETER_BUFFER, 0);
+            mIndirectBuffer.unbind();
+        }
+        else
+        {
+            mDrawQueue.execute(mIndirectBuffer);
+        }
+
+        GeometryArena::instance().vertexArray().unbind();
+        shader.unbind();
+    }
+
+    glDisable(GL_DEPTH_TEST);
+}
+
+Shader &Renderer::meshShader()
+{
+    static const ShaderDefines sShadowDefines {{"SHADOWS", ""}};
+    static const ShaderDefines sNoShadowDefines;
+
+    return mMeshShaders.get(mShadows? sShadowDefines : sNoShadowDefines);
+}
+
+bool Renderer::validateCPUCulling() const
+{
+    std::vector<DrawCommand> drawCommands = readbackDrawCommands();
+
+    std::sort(drawCommands.begin(), drawCommands.end(), [] (const DrawCommand& a, const DrawCommand& b) {
+        return a.baseInstance < b.baseInstance;
+    });
+
+    if (drawCommands != referenceDrawCommands())
+        return false;
+
+    std::vector<uint32_t> visibleInstanceSlots(mFrameStats.visibleCount);
+    glGetNamedBufferSubData(mVisibleInstanceBuffer.id(), 0, visibleInstanceSlots.size() * sizeof(uint32_t), visibleInstanceSlots.data());
+
+    auto drawCommand = drawCommands.begin();
+    for (const auto& [meshID, mesh] : mResourceManager->mMeshes)
+    {
+        if (mesh->visibleInstances().empty())
+            continue;
+
+        for (uint32_t i = 0; i < drawCommand->instanceCount; ++i)
+        {
+            uint32_t instanceIndex = mesh->visibleInstances().at(i);
+
+            if (visibleInstanceSlots.at(drawCommand->baseInstance + i) != mesh->instanceSlots().at(instanceIndex))
+                return false;
+        }
+
+        ++drawCommand;
+    }
+
+    return true;
+}
+
+// culls again on the cpu with the frustum of the last frame and compares the visible slots of every
+// mesh. The compute shader appends in whatever order the atomics resolve, so slots are compared as sets
+bool Renderer::validateGPUCulling() const
+{
+    std::vector<DrawCommand> drawCommands = readbackDrawCommands();
+
+    std::unordered_map<uint32_t, const DrawCommand*> baseInstanceToCommand;
+    for (const DrawCommand& drawCommand : drawCommands)
+        baseInstanceToCommand.emplace(drawCommand.baseInstance, &drawCommand);
+
+    // the cull shader only writes inside the regions prepareGPUCulling handed out
+    std::vector<uint32_t> visibleInstanceSlots(mVisibleSlotCount);
+    glGetNamedBufferSubData(mVisibleInstanceBuffer.id(), 0, visibleInstanceSlots.size() * sizeof(uint32_t), visibleInstanceSlots.data());
+
+    uint32_t mismatchCount = 0;
+    std::vector<uint32_t> visibleInstances;
+
+    for (const auto& [meshID, mesh] : mResourceManager->mMeshes)
+    {
+        const GeometryArena::Allocation& geometry = mesh->geometry();
+
+        if (!mesh->instanceCount() || geometry.meshIndex >= mMeshDrawStates.size())
+            continue;
+
+        // the mesh's own visible list belongs to the cpu path
+        mesh->cull(mFrustum, visibleInstances);
+
+        std::vector<uint32_t> expectedSlots;
+        for (uint32_t instanceIndex : visibleInstances)
+            expectedSlots.push_back(mesh->instanceSlots().at(instanceIndex));
+
+        std::vector<uint32_t> gpuSlots;
+        uint32_t instanceOffset = mMeshDrawStates.at(geometry.meshIndex).instanceOffset;
+
+        if (auto itr = baseInstanceToCommand.find(instanceOffset); itr != baseInstanceToCommand.end())
+        {
+            const DrawCommand& drawCommand = *itr->second;
+
+            if (drawCommand.count != geometry.indexCount ||
+                drawCommand.firstIndex != geometry.firstIndex ||
+                drawCommand.baseVertex != static_cast<int32_t>(geometry.baseVertex) ||
+                static_cast<uint64_t>(drawCommand.baseInstance) + drawCommand.instanceCount > visibleInstanceSlots.size())
+            {
+                ++mismatchCount;
+                continue;
+            }
+
+            auto first = visibleInstanceSlots.begin() + drawCommand.baseInstance;
+            gpuSlots.assign(first, first + drawCommand.instanceCount);
+        }
+
+        std::sort(expectedSlots.begin(), expectedSlots.end());
+        std::sort(gpuSlots.begin(), gpuSlots.end());
+
+        // occlusion can only remove instances from the frustum culling result
+        bool matches = mOcclusionCulling
+            ? std::includes(expectedSlots.begin(), expectedSlots.end(), gpuSlots.begin(), gpuSlots.end())
+            : gpuSlots == expectedSlots;
+
+        if (!matches)
+            ++mismatchCount;
+    }
+
+    if (mismatchCount)
+        debugLog(std::format("Renderer: GPU culling differs from the CPU reference for {} meshes.", mismatchCount), LogSeverity::Error);
+
+    return mismatchCount == 0;
+}
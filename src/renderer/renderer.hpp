@@ -8,15 +8,246 @@
 #include <glad/glad.h>
 #include "../window/event.hpp"
 #include "../editor/camera.hpp"
+#include "../opengl/shader_watcher.hpp"
+#include "../opengl/framebuffer.hpp"
+#include "../opengl/buffer.hpp"
+#include "../opengl/state_cache.hpp"
+#include "../opengl/uniform_ring_buffer.hpp"
+#include "frustum.hpp"
+#include "draw_queue.hpp"
+#include "render_graph.hpp"
+#include "light_clusters.hpp"
+#include "shadow_cascades.hpp"
+#include "shadow_atlas.hpp"
+#include "frame_uniforms.hpp"
 
 class Editor;
+class ResourceManager;
 
 class Renderer
 {
 public:
-    Renderer();
+    static constexpr uint32_t VisibleInstanceBufferBinding = 4;
+    static constexpr uint32_t MeshDrawStateBufferBinding = 6;
+    static constexpr uint32_t DrawCommandBufferBinding = 7;
+    static constexpr uint32_t DrawCountBufferBinding = 8;
+    static constexpr uint32_t CullStatsBufferBinding = 9;
+    static constexpr uint32_t LightGridBufferBinding = 11;
+    static constexpr uint32_t LightIndexBufferBinding = 12;
+    static constexpr uint32_t ClusterBoundsBufferBinding = 13;
+    static constexpr uint32_t LightAssignmentStatsBufferBinding = 14;
+    static constexpr uint32_t LightShadowBufferBinding = 15;
+    static constexpr uint32_t ShadowTileBufferBinding = 16;
+    static constexpr uint32_t MaxDirectionalLights = 4;
+
+    // uniform block bindings, see frame_uniforms.hpp
+    static constexpr uint32_t FrameUniformBinding = 0;
+    static constexpr uint32_t ViewUniformBinding = 1;
+    static constexpr uint32_t PassUniformBinding = 2;
+
+    // CPU: SIMD culling per mesh, commands built and uploaded every frame.
+    // GPU: compute shaders cull the instance arena and compact the commands, the draw count
+    // never comes back to the cpu.
+    enum class CullingMode
+    {
+        CPU,
+        GPU
+    };
+
+    // where point and spot lights get binned into the clusters, see LightClusters
+    enum class LightAssignmentMode
+    {
+        CPU,
+        GPU
+    };
+
+    // with gpu culling the visible and occluded counts are those of the previous frame,
+    // so that reading them back doesn't wait on the current one
+    struct FrameStats
+    {
+        uint32_t meshCount;
+        uint32_t instanceCount;
+        uint32_t visibleCount;
+        uint32_t occludedCount;
+        uint32_t drawCommandCount;
+        float cullMs;
+        uint32_t shadowCascadesRendered;
+        uint32_t shadowTilesRendered;
+        uint32_t shadowCasterInstanceCount;
+    };
+
+public:
+    Renderer(std::shared_ptr<ResourceManager> resourceManager);
     ~Renderer();
 
+    void resize(int32_t width, int32_t height);
+    void render(const Camera& camera);
+
+    void setCullingMode(CullingMode cullingMode);
+    CullingMode cullingMode() const;
+
+    // hi-z occlusion culling, gpu culling mode only
+    void setOcclusionCulling(bool occlusionCulling);
+    bool occlusionCulling() const;
+
+    void setLightAssignmentMode(LightAssignmentMode lightAssignmentMode);
+    LightAssignmentMode lightAssignmentMode() const;
+
+    // cascaded shadow maps for the first directional light, atlas tiles for point and spot lights
+    void setShadows(bool shadows);
+    bool shadows() const;
+
+    // off renders every cascade and atlas tile again every frame, for comparison
+    void setShadowCaching(bool shadowCaching);
+    bool shadowCaching() const;
+
+    ShadowCascades& shadowCascades();
+    ShadowAtlas& shadowAtlas();
+
+    const Texture2D& colorTexture() const;
+    const FrameStats& frameStats() const;
+    const DrawQueue::Stats& drawQueueStats() const;
+    const RenderGraph& renderGraph() const;
+    // bindings made and skipped by the state cache during the last frame
+    const StateCache::Counters& stateCounters() const;
+    UniformRingBuffer::Stats uniformRingStats() const;
+    // the gpu path reports the previous frame and has no assign time
+    const LightClusters::Stats& lightClusterStats() const;
+
+    // the command buffer as the gpu sees it, and the one computed on the cpu from the culling results.
+    // Reading back stalls the pipeline, these are for debugging only
+    std::vector<DrawCommand> readbackDrawCommands() const;
+    std::vector<DrawCommand> referenceDrawCommands() const;
+    bool validateDrawCommands() const;
+    void dumpDrawCommands(const std::filesystem::path& path) const;
+    // compares the cluster light lists the shaders read against the cpu reference, stalls as well
+    bool validateLightClusters();
+
+private:
+    struct MeshDrawState
+    {
+        uint32_t instanceOffset;
+        uint32_t visibleCount;
+    };
+
+    struct CullStats
+    {
+        uint32_t visibleCount;
+        uint32_t frustumCulledCount;
+        uint32_t occludedCount;
+        uint32_t padding;
+    };
+
+    // std430 layout, mirrored by ClusterBounds in assign_lights.comp
+    struct ClusterBounds
+    {
+        glm::vec4 boundsMin;
+        glm::vec4 boundsMax;
+    };
+
+    struct LightAssignmentStats
+    {
+        uint32_t indexCount;
+        uint32_t maxLightsPerCluster;
+        uint32_t occupiedClusterCount;
+        uint32_t padding;
+    };
+
+    void cull(const Camera& camera);
+    void buildDrawCommands(const Camera& camera);
+    void uploadDrawCommands();
+    void writeFrameUniforms(const Camera& camera);
+    void buildRenderGraph();
+    void prepareGPUCulling(const Camera& camera);
+    void dispatchGPUCulling(Texture2D* hiZTexture);
+    void prepareLighting(const Camera& camera);
+    void uploadLightClusters();
+    void dispatchLightAssignment();
+    void prepareShadows(const Camera& camera);
+    void uploadShadowAtlas();
+    void renderShadowCascades();
+    void renderShadowAtlas();
+    std::pair<uint32_t, uint32_t> cullShadowCasters(const Frustum& frustum);
+    void beginShadowDraws();
+    void drawShadowCasters(std::pair<uint32_t, uint32_t> commandRange, const glm::mat4& viewProjection, uint32_t resolution);
+    void endShadowDraws();
+    void renderDepthPrepass();
+    void buildHiZ(Texture2D& depthTexture, Texture2D& hiZTexture);
+    void renderScene();
+
+    // the mesh shader permutation for the current settings
+    Shader& meshShader();
+
+    bool validateCPUCulling() const;
+    bool validateGPUCulling() const;
+
+private:
+    std::shared_ptr<ResourceManager> mResourceManager;
+
+    ShaderPermutations mMeshShaders;
+    Shader mCullInstancesShader;
+    Shader mBuildDrawCommandsShader;
+    Shader mDepthPrepassShader;
+    Shader mBuildHiZShader;
+    Shader mAssignLightsShader;
+    ShaderWatcher mShaderWatcher;
+
+    Texture2D mColorTexture;
+    RenderGraph mRenderGraph;
+
+    CullingMode mCullingMode;
+    bool mOcclusionCulling;
+    bool mHasPreviousVisibleSet;
+    Frustum mFrustum;
+    DrawQueue mDrawQueue;
+    std::vector<DrawCommand> mDrawCommands;
+    std::vector<uint32_t> mVisibleInstanceSlots;
+    std::vector<MeshDrawState> mMeshDrawStates;
+    IndirectBuffer mIndirectBuffer;
+    ShaderBuffer mVisibleInstanceBuffer;
+    ShaderBuffer mMeshDrawStateBuffer;
+    ShaderBuffer mDrawCountBuffer;
+    std::array<ShaderBuffer, 2> mCullStatsBuffers;
+    uint32_t mVisibleSlotCount;
+    uint32_t mMaxDrawCount;
+    uint32_t mFrameIndex;
+
+    LightAssignmentMode mLightAssignmentMode;
+    LightClusters mLightClusters;
+    ShaderBuffer mLightGridBuffer;
+    ShaderBuffer mLightIndexBuffer;
+    ShaderBuffer mClusterBoundsBuffer;
+    std::array<ShaderBuffer, 2> mLightAssignmentStatsBuffers;
+    std::vector<uint32_t> mDirectionalLights;
+    glm::mat4 mLightView;
+    LightClusters::Stats mLightClusterStats;
+
+    bool mShadows;
+    bool mShadowCaching;
+    std::optional<uint32_t> mShadowLight;
+    ShadowCascades mShadowCascades;
+    Texture2DArray mShadowMap;
+    Framebuffer mShadowFramebuffer;
+    IndirectBuffer mShadowIndirectBuffer;
+    ShaderBuffer mShadowVisibleInstanceBuffer;
+    std::vector<DrawCommand> mShadowDrawCommands;
+    std::vector<uint32_t> mShadowVisibleInstanceSlots;
+    std::vector<uint32_t> mShadowCasterInstances;
+    BoundingBox mShadowCasterBounds;
+    uint64_t mShadowCasterVersion;
+    ShadowAtlas mShadowAtlas;
+    Texture2D mShadowAtlasTexture;
+    ShaderBuffer mLightShadowBuffer;
+    ShaderBuffer mShadowTileBuffer;
+
+    FrameStats mFrameStats;
+    StateCache::Counters mStateCounters;
+
+    UniformRingBuffer mUniformRing;
+    // the camera's pass, shared by the depth pre-pass and the scene
+    UniformRingBuffer::Allocation mCameraPassUniforms;
+    float mTime;
+
 private:
     friend class Editor;
 };
@@ -0,0 +1,469 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "shadow_atlas.hpp"
+#include "frustum.hpp"
+#include "light_clusters.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+// a tile keeps its size while the wanted size stays within this factor of it
+static constexpr uint32_t sResizeHysteresis = 2;
+
+static constexpr uint32_t sCubeFaceCount = 6;
+
+// +X, -X, +Y, -Y, +Z, -Z, the order the shaders pick point light faces in
+static const std::array<std::pair<glm::vec3, glm::vec3>, sCubeFaceCount> sCubeFaces {{
+    {glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, -1.f, 0.f)},
+    {glm::vec3(-1.f, 0.f, 0.f), glm::vec3(0.f, -1.f, 0.f)},
+    {glm::vec3(0.f, 1.f, 0.f), glm::vec3(0.f, 0.f, 1.f)},
+    {glm::vec3(0.f, -1.f, 0.f), glm::vec3(0.f, 0.f, -1.f)},
+    {glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, -1.f, 0.f)},
+    {glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, -1.f, 0.f)}
+}};
+
+// tangent of half the field of view of a light's faces
+static float tanHalfFov(const LightData& light)
+{
+    if (light.type == LightType::Point)
+        return 1.f;
+
+    float halfAngle = glm::clamp(glm::acos(light.outerConeCos), glm::radians(0.5f), glm::radians(85.f));
+    return glm::tan(halfAngle);
+}
+
+// score is the light's share of the screen height scaled by its importance. A point light
+// spreads that over six faces of a quarter of its view each. Every size is shifted down by
+// sizeShift, which keeps the ranked lights together within the atlas
+static uint32_t desiredTileSize(float score, uint32_t faceCount, uint32_t sizeShift)
+{
+    float texels = glm::clamp(score * ShadowAtlas::MaxTileSize, 1.f, static_cast<float>(ShadowAtlas::MaxTileSize));
+    uint32_t tileSize = std::bit_floor(static_cast<uint32_t>(texels)) >> sizeShift;
+
+    if (faceCount == sCubeFaceCount)
+        tileSize /= 2;
+
+    return glm::clamp(tileSize, ShadowAtlas::MinTileSize, ShadowAtlas::MaxTileSize);
+}
+
+ShadowAtlas::ShadowAtlas()
+    : mFreeNodes()
+    , mCasterVersion()
+    , mUpdateBudget(2 * MaxTileSize * MaxTileSize)
+    , mStats()
+{
+    mFreeNodes.at(0).insert(0);
+}
+
+void ShadowAtlas::update(const std::vector<LightData> &lights,
+                         const glm::mat4 &view,
+                         const glm::mat4 &projection,
+                         uint64_t casterVersion)
+{
+    mCasterVersion = casterVersion;
+    mRenderQueue.clear();
+    mStats = {};
+
+    // rank the lights whose bounds touch the view, in view space
+    Frustum viewFrustum(projection);
+    std::vector<std::pair<float, uint32_t>> candidates;
+
+    for (uint32_t slot = 0; slot < lights.size(); ++slot)
+    {
+        const LightData& light = lights.at(slot);
+
+        if (light.shadowImportance <= 0.f)
+            continue;
+
+        std::optional<glm::vec4> sphere = LightClusters::lightBounds(light, view);
+
+        if (!sphere)
+            continue;
+
+        glm::vec3 center(*sphere);
+        float radius = sphere->w;
+
+        if (!viewFrustum.intersects(BoundingBox(center - radius, center + radius)))
+            continue;
+
+        float depth = -center.z;
+        float coverage = depth > radius? glm::min(radius * projection[1][1] / depth, 1.f) : 1.f;
+
+        candidates.emplace_back(coverage * light.shadowImportance, slot);
+    }
+
+    mStats.candidateCount = static_cast<uint32_t>(candidates.size());
+
+    uint32_t shadowedCount = glm::min(static_cast<uint32_t>(candidates.size()), MaxShadowedLights);
+    std::partial_sort(candidates.begin(), candidates.begin() + shadowedCount, candidates.end(), std::greater<>());
+    candidates.resize(shadowedCount);
+
+    // halve every tile until the ranked lights fit, leaving room for fragmentation
+    uint32_t sizeShift = 0;
+
+    for (; sizeShift < sLevelCount; ++sizeShift)
+    {
+        uint64_t texels = 0;
+
+        for (auto [score, slot] : candidates)
+        {
+            uint32_t faceCount = lights.at(slot).type == LightType::Point? sCubeFaceCount : 1;
+            uint32_t tileSize = desiredTileSize(score, faceCount, sizeShift);
+            texels += static_cast<uint64_t>(faceCount) * tileSize * tileSize;
+        }
+
+        if (texels <= static_cast<uint64_t>(Resolution) * Resolution * 3 / 4)
+            break;
+    }
+
+    std::unordered_map<uint32_t, float> scores;
+    for (auto [score, slot] : candidates)
+        scores.emplace(slot, score);
+
+    // free the tiles of lights that dropped out of the ranking or want a different size first,
+    // so the lights allocating after them can use the space
+    for (uint32_t i = static_cast<uint32_t>(mEntries.size()); i > 0; --i)
+    {
+        Entry& entry = mEntries.at(i - 1);
+        auto itr = scores.find(entry.lightSlot);
+
+        if (itr == scores.end() || entry.faceCount != (lights.at(entry.lightSlot).type == LightType::Point? sCubeFaceCount : 1))
+        {
+            freeTiles(entry);
+            mEntries.at(i - 1) = mEntries.back();
+            mEntries.pop_back();
+            continue;
+        }
+
+        entry.score = itr->second;
+        scores.erase(itr);
+
+        uint32_t tileSize = desiredTileSize(entry.score, entry.faceCount, sizeShift);
+
+        if (tileSize > entry.tileSize * sResizeHysteresis || tileSize * sResizeHysteresis < entry.tileSize)
+            freeTiles(entry);
+    }
+
+    for (auto [slot, score] : scores)
+    {
+        mEntries.push_back({
+            .lightSlot = slot,
+            .faceCount = lights.at(slot).type == LightType::Point? sCubeFaceCount : 1,
+            .score = score,
+            .rendered = false
+        });
+    }
+
+    std::ranges::sort(mEntries, std::greater<>(), &Entry::score);
+
+    // allocate best first, falling back to smaller tiles while the atlas is full
+    for (uint32_t i = 0; i < mEntries.size();)
+    {
+        Entry& entry = mEntries.at(i);
+
+        if (!entry.tileSize && !allocateTiles(entry, desiredTileSize(entry.score, entry.faceCount, sizeShift)))
+        {
+            mEntries.erase(mEntries.begin() + i);
+            continue;
+        }
+
+        ++i;
+    }
+
+    // lights that never rendered go first, they have no shadow at all yet
+    std::vector<uint32_t> unrendered;
+
+    for (uint32_t i = 0; i < mEntries.size(); ++i)
+    {
+        Entry& entry = mEntries.at(i);
+        const LightData& light = lights.at(entry.lightSlot);
+
+        entry.light = light;
+        entry.viewProjections = faceViewProjections(light);
+        entry.dirty = !entry.rendered
+            || entry.renderedCasterVersion != casterVersion
+            || shadowChanged(entry.renderedLight, light);
+
+        if (entry.dirty)
+            (entry.rendered? mRenderQueue : unrendered).push_back(i);
+
+        mStats.tileCount += entry.faceCount;
+        mStats.allocatedTexels += static_cast<uint64_t>(entry.faceCount) * entry.tileSize * entry.tileSize;
+    }
+
+    mRenderQueue.insert(mRenderQueue.begin(), unrendered.begin(), unrendered.end());
+
+    // the best queued light always renders, the others while they fit the budget
+    uint32_t queuedCount = 0;
+
+    for (uint32_t entryIndex : mRenderQueue)
+    {
+        const Entry& entry = mEntries.at(entryIndex);
+        uint64_t texels = static_cast<uint64_t>(entry.faceCount) * entry.tileSize * entry.tileSize;
+
+        if (queuedCount && mStats.queuedTexels + texels > mUpdateBudget)
+            break;
+
+        mStats.queuedTexels += texels;
+        ++queuedCount;
+    }
+
+    mStats.shadowedLightCount = static_cast<uint32_t>(mEntries.size());
+    mStats.pendingLightCount = static_cast<uint32_t>(mRenderQueue.size()) - queuedCount;
+    mStats.cachedLightCount = mStats.shadowedLightCount - static_cast<uint32_t>(mRenderQueue.size());
+
+    mRenderQueue.resize(queuedCount);
+
+    buildShadowTiles(static_cast<uint32_t>(lights.size()));
+}
+
+void ShadowAtlas::markRendered(uint32_t entryIndex)
+{
+    Entry& entry = mEntries.at(entryIndex);
+
+    entry.renderedLight = entry.light;
+    entry.renderedCasterVersion = mCasterVersion;
+    entry.rendered = true;
+    entry.dirty = false;
+}
+
+void ShadowAtlas::invalidate()
+{
+    for (Entry& entry : mEntries)
+        entry.renderedCasterVersion = UINT64_MAX;
+}
+
+void ShadowAtlas::setUpdateBudget(uint64_t updateBudget)
+{
+    mUpdateBudget = updateBudget;
+}
+
+uint64_t ShadowAtlas::updateBudget() const
+{
+    return mUpdateBudget;
+}
+
+const std::vector<ShadowAtlas::Entry> &ShadowAtlas::entries() const
+{
+    return mEntries;
+}
+
+const std::vector<uint32_t> &ShadowAtlas::renderQueue() const
+{
+    return mRenderQueue;
+}
+
+const ShadowAtlas::Stats &ShadowAtlas::stats() const
+{
+    return mStats;
+}
+
+const std::vector<uint32_t> &ShadowAtlas::lightShadowIndices() const
+{
+    return mLightShadowIndices;
+}
+
+const std::vector<ShadowAtlas::ShadowTile> &ShadowAtlas::shadowTiles() const
+{
+    return mShadowTiles;
+}
+
+// all faces of a light share one tile size, a light that doesn't get all of them gets none
+bool ShadowAtlas::allocateTiles(Entry &entry, uint32_t tileSize)
+{
+    for (; tileSize >= MinTileSize; tileSize /= 2)
+    {
+        uint32_t level = tileLevel(tileSize);
+        uint32_t nodesPerRow = Resolution / tileSize;
+        uint32_t faceIndex = 0;
+
+        for (; faceIndex < entry.faceCount; ++faceIndex)
+        {
+            std::optional<uint32_t> node = allocateNode(level);
+
+            if (!node)
+                break;
+
+            entry.tiles.at(faceIndex) = {
+                .x = (*node % nodesPerRow) * tileSize,
+                .y = (*node / nodesPerRow) * tileSize,
+                .size = tileSize
+            };
+        }
+
+        if (faceIndex == entry.faceCount)
+        {
+            entry.tileSize = tileSize;
+            entry.rendered = false;
+            return true;
+        }
+
+        for (uint32_t i = 0; i < faceIndex; ++i)
+        {
+            const Tile& tile = entry.tiles.at(i);
+            freeNode(level, (tile.y / tileSize) * nodesPerRow + tile.x / tileSize);
+        }
+    }
+
+    return false;
+}
+
+void ShadowAtlas::freeTiles(Entry &entry)
+{
+    if (!entry.tileSize)
+        return;
+
+    uint32_t level = tileLevel(entry.tileSize);
+    uint32_t nodesPerRow = Resolution / entry.tileSize;
+
+    for (uint32_t i = 0; i < entry.faceCount; ++i)
+    {
+        const Tile& tile = entry.tiles.at(i);
+        freeNode(level, (tile.y / entry.tileSize) * nodesPerRow + tile.x / entry.tileSize);
+    }
+
+    entry.tileSize = 0;
+    entry.rendered = false;
+}
+
+// takes a free node of the level, splitting a node of the level above when there is none
+std::optional<uint32_t> ShadowAtlas::allocateNode(uint32_t level)
+{
+    std::set<uint32_t>& freeNodes = mFreeNodes.at(level);
+
+    if (!freeNodes.empty())
+    {
+        uint32_t node = *freeNodes.begin();
+        freeNodes.erase(freeNodes.begin());
+        return node;
+    }
+
+    if (level == 0)
+        return std::nullopt;
+
+    std::optional<uint32_t> parent = allocateNode(level - 1);
+
+    if (!parent)
+        return std::nullopt;
+
+    uint32_t parentsPerRow = 1u << (level - 1);
+    uint32_t nodesPerRow = parentsPerRow * 2;
+    uint32_t x = (*parent % parentsPerRow) * 2;
+    uint32_t y = (*parent / parentsPerRow) * 2;
+
+    freeNodes.insert(y * nodesPerRow + x + 1);
+    freeNodes.insert((y + 1) * nodesPerRow + x);
+    freeNodes.insert((y + 1) * nodesPerRow + x + 1);
+
+    return y * nodesPerRow + x;
+}
+
+// merges the node with its siblings into their parent once all four are free
+void ShadowAtlas::freeNode(uint32_t level, uint32_t node)
+{
+    std::set<uint32_t>& freeNodes = mFreeNodes.at(level);
+
+    if (level == 0)
+    {
+        freeNodes.insert(node);
+        return;
+    }
+
+    uint32_t nodesPerRow = 1u << level;
+    uint32_t x = (node % nodesPerRow) & ~1u;
+    uint32_t y = (node / nodesPerRow) & ~1u;
+
+    std::array<uint32_t, 4> siblings {
+        y * nodesPerRow + x,
+        y * nodesPerRow + x + 1,
+        (y + 1) * nodesPerRow + x,
+        (y + 1) * nodesPerRow + x + 1
+    };
+
+    bool merge = std::ranges::all_of(siblings, [&] (uint32_t sibling) {
+        return sibling == node || freeNodes.contains(sibling);
+    });
+
+    if (!merge)
+    {
+        freeNodes.insert(node);
+        return;
+    }
+
+    for (uint32_t sibling : siblings)
+        freeNodes.erase(sibling);
+
+    freeNode(level - 1, (y / 2) * (nodesPerRow / 2) + x / 2);
+}
+
+uint32_t ShadowAtlas::tileLevel(uint32_t tileSize)
+{
+    return std::countr_zero(Resolution / tileSize);
+}
+
+std::array<glm::mat4, ShadowAtlas::MaxFaceCount> ShadowAtlas::faceViewProjections(const LightData &light)
+{
+    std::array<glm::mat4, MaxFaceCount> viewProjections {};
+
+    float nearZ = glm::max(light.range * 0.01f, 0.05f);
+    glm::mat4 projection = glm::perspective(2.f * glm::atan(tanHalfFov(light)), 1.f, nearZ, light.range);
+
+    if (light.type == LightType::Point)
+    {
+        for (uint32_t i = 0; i < sCubeFaceCount; ++i)
+        {
+            auto [direction, up] = sCubeFaces.at(i);
+            viewProjections.at(i) = projection * glm::lookAt(light.position, light.position + direction, up);
+        }
+    }
+    else
+    {
+        glm::vec3 up = glm::abs(light.direction.y) > 0.99f? glm::vec3(0.f, 0.f, 1.f) : glm::vec3(0.f, 1.f, 0.f);
+        viewProjections.at(0) = projection * glm::lookAt(light.position, light.position + light.direction, up);
+    }
+
+    return viewProjections;
+}
+
+// color and intensity don't affect the depth
+bool ShadowAtlas::shadowChanged(const LightData &a, const LightData &b)
+{
+    return a.type != b.type
+        || a.position != b.position
+        || a.range != b.range
+        || (a.type == LightType::Spot && (a.direction != b.direction || a.outerConeCos != b.outerConeCos));
+}
+
+// the queued lights render before anything samples the atlas, so they already use their new
+// projections. Lights waiting for the budget keep sampling the depth they were rendered with
+void ShadowAtlas::buildShadowTiles(uint32_t slotCount)
+{
+    mLightShadowIndices.assign(slotCount, InvalidShadowIndex);
+    mShadowTiles.clear();
+
+    for (uint32_t i = 0; i < mEntries.size(); ++i)
+    {
+        const Entry& entry = mEntries.at(i);
+        bool queued = std::ranges::find(mRenderQueue, i) != mRenderQueue.end();
+
+        if (!entry.rendered && !queued)
+            continue;
+
+        const LightData& light = queued? entry.light : entry.renderedLight;
+        std::array<glm::mat4, MaxFaceCount> viewProjections = queued? entry.viewProjections : faceViewProjections(light);
+
+        float texelScale = 2.f * tanHalfFov(light) / static_cast<float>(entry.tileSize);
+
+        mLightShadowIndices.at(entry.lightSlot) = static_cast<uint32_t>(mShadowTiles.size());
+
+        for (uint32_t face = 0; face < entry.faceCount; ++face)
+        {
+            const Tile& tile = entry.tiles.at(face);
+
+            mShadowTiles.push_back({
+                .viewProjection = viewProjections.at(face),
+                .atlasRect = glm::vec4(tile.x, tile.y, tile.size, 0.f) / static_cast<float>(Resolution) + glm::vec4(0.f, 0.f, 0.f, texelScale)
+            });
+        }
+    }
+}
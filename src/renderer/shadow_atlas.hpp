@@ -0,0 +1,128 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_SHADOW_ATLAS_HPP
+#define OPENGLRENDERINGENGINE_SHADOW_ATLAS_HPP
+
+#include <glm/glm.hpp>
+#include "light.hpp"
+
+// Hands out tiles of one large depth texture to the shadowed point and spot lights.
+// Every frame the lights touching the view are ranked by screen coverage times their shadow
+// importance, and the best ones get a power of two tile (six for point lights, one per cube
+// face) sized from that score. Tiles come from a quadtree: a tile splits into four when a
+// smaller one is needed and siblings merge back once all four are free.
+// Tiles keep their depth while the light and the casters stay the same. The lights that do need
+// rendering are queued best first and cut off at a texel budget, the rest wait for later frames.
+// Doesn't need a GL context.
+class ShadowAtlas
+{
+public:
+    static constexpr uint32_t Resolution = 4096;
+    static constexpr uint32_t MaxTileSize = 1024;
+    static constexpr uint32_t MinTileSize = 64;
+    static constexpr uint32_t MaxShadowedLights = 64;
+    static constexpr uint32_t MaxFaceCount = 6;
+    static constexpr uint32_t InvalidShadowIndex = UINT32_MAX;
+
+    struct Tile
+    {
+        uint32_t x;
+        uint32_t y;
+        uint32_t size;
+    };
+
+    // std430 layout, mirrored by ShadowTile in the shaders. atlasRect is the tile's offset and
+    // scale in atlas uv, w the world space texel size at unit distance from the light
+    struct ShadowTile
+    {
+        glm::mat4 viewProjection;
+        glm::vec4 atlasRect;
+    };
+
+    struct Entry
+    {
+        uint32_t lightSlot;
+        uint32_t faceCount;
+        uint32_t tileSize;
+        std::array<Tile, MaxFaceCount> tiles;
+        std::array<glm::mat4, MaxFaceCount> viewProjections;
+        float score;
+        LightData light;
+        // the light and caster version the tiles were last rendered with
+        LightData renderedLight;
+        uint64_t renderedCasterVersion;
+        bool rendered;
+        bool dirty;
+    };
+
+    struct Stats
+    {
+        uint32_t candidateCount;
+        uint32_t shadowedLightCount;
+        uint32_t tileCount;
+        uint32_t cachedLightCount;
+        uint32_t pendingLightCount;
+        uint64_t allocatedTexels;
+        uint64_t queuedTexels;
+    };
+
+public:
+    ShadowAtlas();
+
+    // casterVersion changes whenever a caster was added, removed or moved
+    void update(const std::vector<LightData>& lights,
+                const glm::mat4& view,
+                const glm::mat4& projection,
+                uint64_t casterVersion);
+
+    void markRendered(uint32_t entryIndex);
+    // every tile renders again, budget permitting
+    void invalidate();
+
+    // texels rendered per frame, the best queued light is always rendered
+    void setUpdateBudget(uint64_t updateBudget);
+    uint64_t updateBudget() const;
+
+    const std::vector<Entry>& entries() const;
+    // entry indices to render this frame, best first
+    const std::vector<uint32_t>& renderQueue() const;
+    const Stats& stats() const;
+
+    // per light slot, index of the light's first tile in shadowTiles() or InvalidShadowIndex.
+    // Only lights whose tiles hold depth have one
+    const std::vector<uint32_t>& lightShadowIndices() const;
+    const std::vector<ShadowTile>& shadowTiles() const;
+
+private:
+    static constexpr uint32_t sLevelCount = std::countr_zero(Resolution / MinTileSize) + 1;
+
+    bool allocateTiles(Entry& entry, uint32_t tileSize);
+    void freeTiles(Entry& entry);
+
+    std::optional<uint32_t> allocateNode(uint32_t level);
+    void freeNode(uint32_t level, uint32_t node);
+
+    static uint32_t tileLevel(uint32_t tileSize);
+    static std::array<glm::mat4, MaxFaceCount> faceViewProjections(const LightData& light);
+    static bool shadowChanged(const LightData& a, const LightData& b);
+
+    void buildShadowTiles(uint32_t slotCount);
+
+private:
+    // free quadtree nodes per level, a node is y * nodesPerRow + x. Ordered sets hand out the
+    // top left node first, which keeps the used part of the atlas compact
+    std::array<std::set<uint32_t>, sLevelCount> mFreeNodes;
+
+    std::vector<Entry> mEntries;
+    std::vector<uint32_t> mRenderQueue;
+    std::vector<uint32_t> mLightShadowIndices;
+    std::vector<ShadowTile> mShadowTiles;
+
+    uint64_t mCasterVersion;
+    uint64_t mUpdateBudget;
+    Stats mStats;
+};
+
+#endif //OPENGLRENDERINGENGINE_SHADOW_ATLAS_HPP
@@ -0,0 +1,192 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "shadow_cascades.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+// fraction of the cascade radius the window is padded by, and the largest step its center snaps to
+static constexpr float sCachePadding = 0.15f;
+// sphere radius rounding, keeps floating point noise in the slice corners from changing the size
+static constexpr float sRadiusGranularity = 1.f / 16.f;
+
+ShadowCascades::ShadowCascades()
+    : mCascades()
+    , mRenderedViewProjections()
+    , mRenderedCasterVersions()
+    , mRendered()
+    , mCasterVersion()
+    , mSplitLambda(0.75f)
+    , mShadowDistance(100.f)
+{
+}
+
+void ShadowCascades::update(const glm::mat4 &view,
+                            const glm::mat4 &projection,
+                            const glm::vec3 &lightDirection,
+                            const BoundingBox &casterBounds,
+                            uint64_t casterVersion)
+{
+    mCasterVersion = casterVersion;
+
+    // OpenGL perspective projection, see glm::perspective
+    float nearZ = projection[3][2] / (projection[2][2] - 1.f);
+    float farZ = glm::min(projection[3][2] / (projection[2][2] + 1.f), mShadowDistance);
+
+    // the light view has no translation, so light space only changes with the light direction
+    glm::vec3 up = glm::abs(lightDirection.y) > 0.99f? glm::vec3(0.f, 0.f, 1.f) : glm::vec3(0.f, 1.f, 0.f);
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.f), lightDirection, up);
+    glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+
+    float nearDepth = nearZ;
+
+    for (uint32_t i = 0; i < CascadeCount; ++i)
+    {
+        float t = static_cast<float>(i + 1) / CascadeCount;
+        float logSplit = nearZ * glm::pow(farZ / nearZ, t);
+        float uniformSplit = nearZ + (farZ - nearZ) * t;
+        float farDepth = glm::mix(uniformSplit, logSplit, mSplitLambda);
+
+        Cascade& cascade = mCascades.at(i);
+
+        cascade.viewProjection = fitCascade(inverseViewProjection, projection, nearDepth, farDepth, lightView, casterBounds, cascade.texelSize);
+        cascade.splitDepth = farDepth;
+        cascade.dirty = !mRendered.at(i)
+            || cascade.viewProjection != mRenderedViewProjections.at(i)
+            || mRenderedCasterVersions.at(i) != casterVersion;
+
+        nearDepth = farDepth;
+    }
+}
+
+void ShadowCascades::markRendered(uint32_t cascadeIndex)
+{
+    Cascade& cascade = mCascades.at(cascadeIndex);
+
+    cascade.dirty = false;
+    ++cascade.renderCount;
+
+    mRenderedViewProjections.at(cascadeIndex) = cascade.viewProjection;
+    mRenderedCasterVersions.at(cascadeIndex) = mCasterVersion;
+    mRendered.at(cascadeIndex) = true;
+}
+
+void ShadowCascades::invalidate()
+{
+    mRendered.fill(false);
+
+    for (Cascade& cascade : mCascades)
+        cascade.dirty = true;
+}
+
+void ShadowCascades::setSplitLambda(float splitLambda)
+{
+    mSplitLambda = glm::clamp(splitLambda, 0.f, 1.f);
+}
+
+void ShadowCascades::setShadowDistance(float shadowDistance)
+{
+    mShadowDistance = glm::max(shadowDistance, 1.f);
+}
+
+float ShadowCascades::splitLambda() const
+{
+    return mSplitLambda;
+}
+
+float ShadowCascades::shadowDistance() const
+{
+    return mShadowDistance;
+}
+
+const std::array<ShadowCascades::Cascade, ShadowCascades::CascadeCount> &ShadowCascades::cascades() const
+{
+    return mCascades;
+}
+
+glm::vec4 ShadowCascades::splitDepths() const
+{
+    glm::vec4 splitDepths;
+    for (uint32_t i = 0; i < CascadeCount; ++i)
+        splitDepths[i] = mCascades.at(i).splitDepth;
+    return splitDepths;
+}
+
+glm::vec4 ShadowCascades::texelSizes() const
+{
+    glm::vec4 texelSizes;
+    for (uint32_t i = 0; i < CascadeCount; ++i)
+        texelSizes[i] = mCascades.at(i).texelSize;
+    return texelSizes;
+}
+
+// the window covers the slice's bounding sphere plus the padding, its center moves in steps of whole
+// texels no larger than the padding so the sphere never leaves it. The depth range reaches from the
+// back of the sphere to the casters closest to the light, snapped to the same steps
+glm::mat4 ShadowCascades::fitCascade(const glm::mat4 &inverseViewProjection,
+                                     const glm::mat4 &projection,
+                                     float nearDepth,
+                                     float farDepth,
+                                     const glm::mat4 &lightView,
+                                     const BoundingBox &casterBounds,
+                                     float &texelSize) const
+{
+    auto ndcDepth = [&projection] (float viewDepth) {
+        return (-projection[2][2] * viewDepth + projection[3][2]) / viewDepth;
+    };
+
+    std::array<glm::vec3, 8> corners;
+
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        glm::vec4 ndc(i & 1? 1.f : -1.f, i & 2? 1.f : -1.f, ndcDepth(i & 4? farDepth : nearDepth), 1.f);
+        glm::vec4 corner = inverseViewProjection * ndc;
+        corners.at(i) = glm::vec3(corner) / corner.w;
+    }
+
+    glm::vec3 center(0.f);
+    for (const glm::vec3& corner : corners)
+        center += corner / 8.f;
+
+    float radius = 0.f;
+    for (const glm::vec3& corner : corners)
+        radius = glm::max(radius, glm::distance(corner, center));
+
+    radius = glm::ceil(radius / sRadiusGranularity) * sRadiusGranularity;
+
+    float halfExtent = radius * (1.f + sCachePadding);
+    texelSize = 2.f * halfExtent / Resolution;
+
+    float snapStep = texelSize * glm::max(glm::floor(radius * sCachePadding / texelSize), 1.f);
+
+    glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.f));
+    glm::vec2 windowCenter = glm::round(glm::vec2(lightCenter) / snapStep) * snapStep;
+
+    // light space looks down -z, larger z is closer to the light
+    float minZ = lightCenter.z - radius;
+    float maxZ = lightCenter.z + radius;
+
+    if (casterBounds.valid())
+    {
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            glm::vec3 corner(i & 1? casterBounds.max.x : casterBounds.min.x,
+                             i & 2? casterBounds.max.y : casterBounds.min.y,
+                             i & 4? casterBounds.max.z : casterBounds.min.z);
+
+            maxZ = glm::max(maxZ, (lightView * glm::vec4(corner, 1.f)).z);
+        }
+    }
+
+    minZ = glm::floor(minZ / snapStep) * snapStep;
+    maxZ = glm::ceil(maxZ / snapStep) * snapStep;
+
+    glm::mat4 lightProjection = glm::ortho(windowCenter.x - halfExtent,
+                                           windowCenter.x + halfExtent,
+                                           windowCenter.y - halfExtent,
+                                           windowCenter.y + halfExtent,
+                                           -maxZ,
+                                           -minZ);
+
+    return lightProjection * lightView;
+}
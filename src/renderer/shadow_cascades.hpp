@@ -0,0 +1,82 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_SHADOW_CASCADES_HPP
+#define OPENGLRENDERINGENGINE_SHADOW_CASCADES_HPP
+
+#include <glm/glm.hpp>
+#include "bounding_box.hpp"
+
+// Fits the cascades of a directional light's shadow map to slices of the camera frustum and
+// keeps track of which cascades still hold valid depth.
+// Every cascade is an orthographic projection around the bounding sphere of its slice, so its size
+// doesn't change when the camera turns. The window is padded and its center snapped to a grid of
+// whole texels, coarse enough that small camera moves leave the projection untouched. The depth
+// of a cascade is cached until its projection, the light or the casters change.
+// Doesn't need a GL context.
+class ShadowCascades
+{
+public:
+    static constexpr uint32_t CascadeCount = 4;
+    static constexpr int32_t Resolution = 2048;
+
+    struct Cascade
+    {
+        glm::mat4 viewProjection;
+        // view depth where the cascade ends
+        float splitDepth;
+        // world units per shadow map texel
+        float texelSize;
+        // the cached depth doesn't match the projection or the casters anymore
+        bool dirty;
+        uint32_t renderCount;
+    };
+
+public:
+    ShadowCascades();
+
+    // casterVersion changes whenever a caster was added, removed or moved
+    void update(const glm::mat4& view,
+                const glm::mat4& projection,
+                const glm::vec3& lightDirection,
+                const BoundingBox& casterBounds,
+                uint64_t casterVersion);
+
+    void markRendered(uint32_t cascadeIndex);
+    // every cascade renders again on the next update
+    void invalidate();
+
+    // 0 splits the depth range uniformly, 1 logarithmically
+    void setSplitLambda(float splitLambda);
+    void setShadowDistance(float shadowDistance);
+    float splitLambda() const;
+    float shadowDistance() const;
+
+    const std::array<Cascade, CascadeCount>& cascades() const;
+    glm::vec4 splitDepths() const;
+    glm::vec4 texelSizes() const;
+
+private:
+    glm::mat4 fitCascade(const glm::mat4& inverseViewProjection,
+                         const glm::mat4& projection,
+                         float nearDepth,
+                         float farDepth,
+                         const glm::mat4& lightView,
+                         const BoundingBox& casterBounds,
+                         float& texelSize) const;
+
+private:
+    std::array<Cascade, CascadeCount> mCascades;
+
+    // what the cached depth of each cascade was rendered with
+    std::array<glm::mat4, CascadeCount> mRenderedViewProjections;
+    std::array<uint64_t, CascadeCount> mRenderedCasterVersions;
+    std::array<bool, CascadeCount> mRendered;
+    uint64_t mCasterVersion;
+
+    float mSplitLambda;
+    float mShadowDistance;
+};
+
+#endif //OPENGLRENDERINGENGINE_SHADOW_CASCADES_HPP
@@ -10,6 +10,10 @@
 #include "../renderer/material.hpp"
 #include "../renderer/model.hpp"
 #include "../opengl/texture.hpp"
+#include "../opengl/texture_container.hpp"
+#include "../opengl/upload_manager.hpp"
+#include "texture_streamer.hpp"
+#include "texture_cooker.hpp"
 #include "../opengl/buffer.hpp"
 
 struct MeshData
@@ -18,6 +22,25 @@ struct MeshData
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
     std::optional<index_t> materialIndex;
+    // vertices then indices, empty when the staging buffer had no room
+    std::optional<StagingAllocation> staging;
+};
+
+// An image read on a worker thread. KTX2 and DDS files arrive mapped and upload as they are,
+// 8 bit images as their cpu built mip chain, cooked or not, and hdr images as the decoded image
+// that gets its mips on the gpu. Streamed textures hand their mips or container to the stream
+// source. The rest are copied to the staging buffer when it has room. Images whose content hash
+// is already loaded carry nothing but the hash
+struct LoadedTexture
+{
+    std::filesystem::path path;
+    uint64_t contentHash;
+    TextureSpecification specification;
+    std::shared_ptr<TextureStreamSource> streamSource;
+    std::shared_ptr<TextureContainer> container;
+    std::shared_ptr<LoadedImage> image;
+    std::vector<TextureMip> mips;
+    std::optional<StagedTexture> staged;
 };
 
 struct LoadedModelData
@@ -59,6 +82,22 @@ struct LoadedModelData
     std::vector<Mesh> meshes;
     std::vector<Material> materials;
     std::vector<std::pair<std::shared_ptr<Texture2D>, std::filesystem::path>> textures;
+    // per texture, null for the fully resident ones
+    std::vector<std::shared_ptr<TextureStreamSource>> textureStreamSources;
+
+    // per texture, what it was loaded as. Textures skipped for matching a loaded one have a null Texture2D
+    struct TextureSource
+    {
+        uint64_t contentHash;
+        TextureUsage usage;
+        float alphaCutoff;
+    };
+    std::vector<TextureSource> textureSources;
+
+    // the model's resources are usable once its main thread tasks have all run and the upload
+    // manager has issued this ticket
+    std::atomic<uint32_t> pendingTasks = 0;
+    uint64_t uploadTicket = 0;
     std::unordered_map<int32_t, uint32_t> indirectTextureMap;
 
     uint32_t getTextureIndex(int32_t matTexIndex) const
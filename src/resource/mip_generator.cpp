@@ -0,0 +1,349 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "mip_generator.hpp"
+
+#if defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
+#include <glm/gtc/constants.hpp>
+
+// levels with fewer texels are filtered on the calling thread
+static constexpr int32_t sParallelTexelCount = 256 * 256;
+
+// the kaiser windowed sinc spans 3 source texels either side of the destination texel center
+static constexpr uint32_t sKaiserTapCount = 6;
+static constexpr float sKaiserWidth = 3.f;
+static constexpr float sKaiserAlpha = 4.f;
+
+static constexpr uint32_t sCoverageSearchSteps = 12;
+static constexpr float sMaxCoverageScale = 8.f;
+
+// one axis of a 2x reduction, destination texel x reads source texels 2x + firstOffset onwards
+struct MipKernel
+{
+    int32_t firstOffset;
+    std::vector<float> weights;
+};
+
+struct FloatImage
+{
+    int32_t width;
+    int32_t height;
+    std::vector<glm::vec4> texels;
+};
+
+static float besselI0(float x)
+{
+    float sum = 1.f;
+    float term = 1.f;
+
+    for (int32_t k = 1; k < 16; ++k)
+    {
+        term *= (x * 0.5f / k) * (x * 0.5f / k);
+        sum += term;
+    }
+
+    return sum;
+}
+
+static MipKernel makeKaiserKernel()
+{
+    MipKernel kernel {.firstOffset = -2, .weights = std::vector<float>(sKaiserTapCount)};
+
+    float sum = 0.f;
+    for (uint32_t i = 0; i < sKaiserTapCount; ++i)
+    {
+        // source texel center minus destination texel center, in source texels
+        float distance = static_cast<float>(kernel.firstOffset + static_cast<int32_t>(i)) - 0.5f;
+        float x = distance * 0.5f;
+        float sinc = glm::sin(glm::pi<float>() * x) / (glm::pi<float>() * x);
+        float window = besselI0(sKaiserAlpha * glm::sqrt(1.f - glm::pow(distance / sKaiserWidth, 2.f))) / besselI0(sKaiserAlpha);
+
+        kernel.weights.at(i) = sinc * window;
+        sum += kernel.weights.at(i);
+    }
+
+    for (float& weight : kernel.weights)
+        weight /= sum;
+
+    return kernel;
+}
+
+static const MipKernel& mipKernel(MipFilter filter)
+{
+    static const MipKernel sBoxKernel {.firstOffset = 0, .weights = {0.5f, 0.5f}};
+    static const MipKernel sKaiserKernel = makeKaiserKernel();
+
+    return filter == MipFilter::Box? sBoxKernel : sKaiserKernel;
+}
+
+static const std::array<float, 256>& srgbToLinearTable()
+{
+    static const std::array<float, 256> sTable = [] () {
+        std::array<float, 256> table;
+        for (uint32_t i = 0; i < table.size(); ++i)
+        {
+            float srgb = i / 255.f;
+            table.at(i) = srgb <= 0.04045f? srgb / 12.92f : glm::pow((srgb + 0.055f) / 1.055f, 2.4f);
+        }
+        return table;
+    }();
+
+    return sTable;
+}
+
+// indexed by linear values in 1/65535 steps, fine enough for the darkest sRGB codes
+static const std::vector<uint8_t>& linearToSrgbTable()
+{
+    static const std::vector<uint8_t> sTable = [] () {
+        std::vector<uint8_t> table(65536);
+        for (uint32_t i = 0; i < table.size(); ++i)
+        {
+            float linear = i / 65535.f;
+            float srgb = linear <= 0.0031308f? linear * 12.92f : 1.055f * glm::pow(linear, 1.f / 2.4f) - 0.055f;
+            table.at(i) = static_cast<uint8_t>(glm::clamp(srgb, 0.f, 1.f) * 255.f + 0.5f);
+        }
+        return table;
+    }();
+
+    return sTable;
+}
+
+// sum of texels[i] * weights[i], all 4 channels at once
+static glm::vec4 weightedSum(const glm::vec4* const* texels, const float* weights, uint32_t count)
+{
+#if defined(__SSE2__)
+    __m128 sum = _mm_setzero_ps();
+    for (uint32_t i = 0; i < count; ++i)
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&texels[i]->x), _mm_set1_ps(weights[i])));
+
+    glm::vec4 result;
+    _mm_storeu_ps(&result.x, sum);
+    return result;
+#else
+    glm::vec4 sum(0.f);
+    for (uint32_t i = 0; i < count; ++i)
+        sum += *texels[i] * weights[i];
+    return sum;
+#endif
+}
+
+// splits rows [0, rowCount) into one band per hardware thread when the work is worth it
+template <typename F>
+static void forRowBands(int32_t rowCount, int32_t rowTexelCount, F&& filterRows)
+{
+    int32_t threadCount = static_cast<int32_t>(std::max(std::thread::hardware_concurrency(), 1u));
+
+    if (threadCount == 1 || rowCount * rowTexelCount < sParallelTexelCount)
+    {
+        filterRows(0, rowCount);
+        return;
+    }
+
+    int32_t bandSize = (rowCount + threadCount - 1) / threadCount;
+
+    std::vector<std::future<void>> bands;
+    for (int32_t firstRow = bandSize; firstRow < rowCount; firstRow += bandSize)
+    {
+        int32_t lastRow = glm::min(firstRow + bandSize, rowCount);
+        bands.push_back(std::async(std::launch::async, [&filterRows, firstRow, lastRow] () {
+            filterRows(firstRow, lastRow);
+        }));
+    }
+
+    filterRows(0, glm::min(bandSize, rowCount));
+
+    for (std::future<void>& band : bands)
+        band.get();
+}
+
+static uint32_t srgbChannelCount(uint32_t channelCount, bool srgb)
+{
+    return srgb? glm::min(channelCount, 3u) : 0;
+}
+
+static FloatImage decode(const uint8_t* data, int32_t width, int32_t height, uint32_t channelCount, bool srgb)
+{
+    const std::array<float, 256>& srgbToLinear = srgbToLinearTable();
+    uint32_t srgbChannels = srgbChannelCount(channelCount, srgb);
+
+    FloatImage image {width, height, std::vector<glm::vec4>(static_cast<size_t>(width) * height, glm::vec4(0.f, 0.f, 0.f, 1.f))};
+
+    for (size_t i = 0; i < image.texels.size(); ++i)
+    {
+        for (uint32_t channel = 0; channel < channelCount; ++channel)
+        {
+            uint8_t value = data[i * channelCount + channel];
+            image.texels.at(i)[channel] = channel < srgbChannels? srgbToLinear.at(value) : value / 255.f;
+        }
+    }
+
+    return image;
+}
+
+// separable, a horizontal pass into a half width image then a vertical one
+static FloatImage downsample(const FloatImage& source, const MipKernel& kernel)
+{
+    const uint32_t tapCount = static_cast<uint32_t>(kernel.weights.size());
+
+    int32_t width = glm::max(source.width / 2, 1);
+    int32_t height = glm::max(source.height / 2, 1);
+
+    FloatImage horizontal {width, source.height, std::vector<glm::vec4>(static_cast<size_t>(width) * source.height)};
+    FloatImage result {width, height, std::vector<glm::vec4>(static_cast<size_t>(width) * height)};
+
+    forRowBands(source.height, width, [&] (int32_t firstRow, int32_t lastRow) {
+        std::array<const glm::vec4*, sKaiserTapCount> taps;
+
+        for (int32_t y = firstRow; y < lastRow; ++y)
+        {
+            const glm::vec4* sourceRow = &source.texels.at(static_cast<size_t>(y) * source.width);
+
+            for (int32_t x = 0; x < width; ++x)
+            {
+                for (uint32_t i = 0; i < tapCount; ++i)
+                    taps.at(i) = &sourceRow[glm::clamp(x * 2 + kernel.firstOffset + static_cast<int32_t>(i), 0, source.width - 1)];
+
+                horizontal.texels.at(static_cast<size_t>(y) * width + x) = weightedSum(taps.data(), kernel.weights.data(), tapCount);
+            }
+        }
+    });
+
+    forRowBands(height, width, [&] (int32_t firstRow, int32_t lastRow) {
+        std::array<const glm::vec4*, sKaiserTapCount> taps;
+
+        for (int32_t y = firstRow; y < lastRow; ++y)
+        {
+            for (int32_t x = 0; x < width; ++x)
+            {
+                for (uint32_t i = 0; i < tapCount; ++i)
+                {
+                    int32_t sourceY = glm::clamp(y * 2 + kernel.firstOffset + static_cast<int32_t>(i), 0, source.height - 1);
+                    taps.at(i) = &horizontal.texels.at(static_cast<size_t>(sourceY) * width + x);
+                }
+
+                result.texels.at(static_cast<size_t>(y) * width + x) = weightedSum(taps.data(), kernel.weights.data(), tapCount);
+            }
+        }
+    });
+
+    return result;
+}
+
+static float alphaCoverage(const FloatImage& image, float alphaCutoff, float scale)
+{
+    size_t passing = 0;
+    for (const glm::vec4& texel : image.texels)
+        if (glm::min(texel.a * scale, 1.f) >= alphaCutoff)
+            ++passing;
+
+    return static_cast<float>(passing) / image.texels.size();
+}
+
+// bisects the alpha scale, coverage only grows with it. Coverage moves in steps on small levels,
+// so the closest scale seen wins rather than the last one
+static float coverageScale(const FloatImage& image, float alphaCutoff, float targetCoverage)
+{
+    float low = 0.f;
+    float high = sMaxCoverageScale;
+    float bestScale = 1.f;
+    float bestError = glm::abs(alphaCoverage(image, alphaCutoff, 1.f) - targetCoverage);
+
+    for (uint32_t step = 0; step < sCoverageSearchSteps; ++step)
+    {
+        float scale = (low + high) * 0.5f;
+        float coverage = alphaCoverage(image, alphaCutoff, scale);
+
+        if (glm::abs(coverage - targetCoverage) < bestError)
+        {
+            bestScale = scale;
+            bestError = glm::abs(coverage - targetCoverage);
+        }
+
+        if (coverage < targetCoverage)
+            low = scale;
+        else
+            high = scale;
+    }
+
+    return bestScale;
+}
+
+static TextureMip encode(const FloatImage& image, uint32_t channelCount, bool srgb, float alphaScale)
+{
+    const std::vector<uint8_t>& linearToSrgb = linearToSrgbTable();
+    uint32_t srgbChannels = srgbChannelCount(channelCount, srgb);
+
+    TextureMip mip {
+        .width = image.width,
+        .height = image.height,
+        .data = std::vector<uint8_t>(image.texels.size() * channelCount)
+    };
+
+    forRowBands(image.height, image.width, [&] (int32_t firstRow, int32_t lastRow) {
+        for (size_t i = static_cast<size_t>(firstRow) * image.width; i < static_cast<size_t>(lastRow) * image.width; ++i)
+        {
+            for (uint32_t channel = 0; channel < channelCount; ++channel)
+            {
+                float value = image.texels.at(i)[channel];
+
+                if (channel == 3)
+                    value *= alphaScale;
+
+                value = glm::clamp(value, 0.f, 1.f);
+
+                mip.data.at(i * channelCount + channel) = channel < srgbChannels?
+                    linearToSrgb.at(static_cast<size_t>(value * 65535.f + 0.5f)) :
+                    static_cast<uint8_t>(value * 255.f + 0.5f);
+            }
+        }
+    });
+
+    return mip;
+}
+
+namespace MipGenerator
+{
+    std::vector<TextureMip> generate(const uint8_t* data,
+                                     int32_t width,
+                                     int32_t height,
+                                     uint32_t channelCount,
+                                     const MipSettings& settings)
+    {
+        check(channelCount >= 1 && channelCount <= 4, "MipGenerator: Images need 1 to 4 channels.");
+
+        const MipKernel& kernel = mipKernel(settings.filter);
+        bool preserveCoverage = channelCount == 4 && settings.alphaCutoff > 0.f;
+
+        uint32_t levelCount = calculateMipLevels(width, height);
+
+        std::vector<TextureMip> mips;
+        mips.reserve(levelCount);
+
+        mips.push_back({
+            .width = width,
+            .height = height,
+            .data = std::vector<uint8_t>(data, data + static_cast<size_t>(width) * height * channelCount)
+        });
+
+        if (levelCount == 1)
+            return mips;
+
+        FloatImage level = decode(data, width, height, channelCount, settings.srgb);
+        float targetCoverage = preserveCoverage? alphaCoverage(level, settings.alphaCutoff, 1.f) : 0.f;
+
+        // each level filters the unscaled one above it, the coverage scale only applies to the output
+        while (mips.size() < levelCount)
+        {
+            level = downsample(level, kernel);
+
+            float alphaScale = preserveCoverage? coverageScale(level, settings.alphaCutoff, targetCoverage) : 1.f;
+            mips.push_back(encode(level, channelCount, settings.srgb, alphaScale));
+        }
+
+        return mips;
+    }
+}
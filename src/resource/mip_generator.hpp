@@ -0,0 +1,40 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_MIP_GENERATOR_HPP
+#define OPENGLRENDERINGENGINE_MIP_GENERATOR_HPP
+
+#include "../opengl/texture.hpp"
+
+enum class MipFilter
+{
+    Box,
+    Kaiser
+};
+
+struct MipSettings
+{
+    MipFilter filter = MipFilter::Kaiser;
+    // the color channels hold sRGB encoded values, alpha is always linear
+    bool srgb = false;
+    // above zero, every level's alpha is rescaled so the share of texels at or above the cutoff
+    // stays the one of the base level. Keeps alpha tested foliage from thinning out in the distance
+    float alphaCutoff = 0.f;
+};
+
+// Builds full mip chains on the cpu from 8 bit images of 1 to 4 channels. Each level is filtered
+// from the one above it as floats in linear space, sRGB channels are decoded on the way in and
+// encoded again on the way out. Levels big enough are split into row bands filtered on worker
+// threads. The output only depends on the input and the settings, so it can be cached.
+namespace MipGenerator
+{
+    // every level down to 1x1, the first one a copy of the input
+    std::vector<TextureMip> generate(const uint8_t* data,
+                                     int32_t width,
+                                     int32_t height,
+                                     uint32_t channelCount,
+                                     const MipSettings& settings);
+}
+
+#endif //OPENGLRENDERINGENGINE_MIP_GENERATOR_HPP
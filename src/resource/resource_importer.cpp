@@ -12,11 +12,18 @@
 // todo: handle texture loading fails
 // todo: handle "Load error: No LoadImageData callback specified"
 
+// fixed main thread cost of a task, and how fast uploads without staging go
+static constexpr float sTaskBaseCost = 0.05f;
+static constexpr float sDirectUploadBytesPerMs = 1024.f * 1024.f;
+
 namespace ResourceImporter
 {
-    std::future<std::shared_ptr<LoadedModelData>> loadModel(const std::filesystem::path &path, EnqueueCallback callback)
+    std::future<std::shared_ptr<LoadedModelData>> loadModel(const std::filesystem::path &path,
+                                                            EnqueueCallback callback,
+                                                            ImportSettings settings,
+                                                            std::shared_ptr<const TextureHashSet> loadedTextureHashes)
     {
-        return std::async(std::launch::async, [path, callback] () -> std::shared_ptr<LoadedModelData> {
+        return std::async(std::launch::async, [path, callback, settings, loadedTextureHashes] () -> std::shared_ptr<LoadedModelData> {
             std::shared_ptr<tinygltf::Model> gltfModel = loadGltfScene(path);
             std::shared_ptr<LoadedModelData> modelData = std::make_shared<LoadedModelData>();
 
@@ -32,26 +39,56 @@ namespace ResourceImporter
             for (const auto& gltfMesh : gltfModel->meshes)
                 meshDataFutures.push_back(createMeshData(*gltfModel, gltfMesh));
 
-            // upload mesh data to opengl
+            // upload mesh data to opengl. Meshes go first, textures are bigger and easier to wait for
             for (auto& meshDataFuture : meshDataFutures)
             {
-                callback([modelData, meshData = meshDataFuture.get()] () {
+                MeshData meshData = meshDataFuture.get();
+                float cost = meshTaskCost(meshData);
+
+                ++modelData->pendingTasks;
+                callback([modelData, meshData = std::move(meshData)] () {
                     modelData->meshes.push_back(createMesh(meshData));
-                });
+                    modelData->uploadTicket = UploadManager::instance().lastTicket();
+                    --modelData->pendingTasks;
+                }, TaskPriority::Normal, cost);
             }
 
-            // load texture data
+            // load texture data, building the mips and cooking them on the worker threads
             std::filesystem::path directory = path.parent_path();
-            std::vector<std::future<std::shared_ptr<LoadedImage>>> loadedImageFutures;
-            for (const auto& image : gltfModel->images)
-                loadedImageFutures.push_back(loadImageData(image, directory));
+            std::vector<TextureUsage> imageUsages = getImageUsages(*gltfModel, modelData->materials);
+            std::vector<float> imageAlphaCutoffs = getImageAlphaCutoffs(*gltfModel);
+            std::vector<std::future<std::shared_ptr<LoadedTexture>>> loadedTextureFutures;
+            for (size_t i = 0; i < gltfModel->images.size(); ++i)
+            {
+                loadedTextureFutures.push_back(loadImageData(gltfModel->images.at(i),
+                                                             directory,
+                                                             imageUsages.at(i),
+                                                             imageAlphaCutoffs.at(i),
+                                                             settings,
+                                                             loadedTextureHashes));
+            }
 
             // upload texture data to opengl
-            for (auto& loadedImageFuture : loadedImageFutures)
+            for (size_t i = 0; i < loadedTextureFutures.size(); ++i)
             {
-                callback([modelData, imageData = loadedImageFuture.get()] () {
-                    modelData->textures.push_back(makeTexturePathPair(imageData));
-                });
+                LoadedModelData::TextureSource textureSource {
+                    .usage = imageUsages.at(i),
+                    .alphaCutoff = imageAlphaCutoffs.at(i)
+                };
+
+                std::shared_ptr<LoadedTexture> textureData = loadedTextureFutures.at(i).get();
+                float cost = textureTaskCost(*textureData);
+
+                ++modelData->pendingTasks;
+                callback([modelData, textureData, textureSource] () mutable {
+                    textureSource.contentHash = textureData->contentHash;
+
+                    modelData->textures.push_back(makeTexturePathPair(textureData));
+                    modelData->textureStreamSources.push_back(textureData->streamSource);
+                    modelData->textureSources.push_back(textureSource);
+                    modelData->uploadTicket = UploadManager::instance().lastTicket();
+                    --modelData->pendingTasks;
+                }, TaskPriority::Low, cost);
             }
 
             return modelData;
@@ -75,7 +112,7 @@ namespace ResourceImporter
         check(error.empty(), std::format("Failed to load model {}\nLoad error: {}", path.string(), error).c_str());
 
         if (!warning.empty())
-            debugLog("ResourceImporter::loadGltfScene: Warning: " + warning);
+            debugLog("ResourceImporter::loadGltfScene: Warning: " + warning, LogSeverity::Warning);
 
         return model;
     }
@@ -131,11 +168,46 @@ namespace ResourceImporter
     {
         return {
             .name = meshData.name,
-            .mesh = std::make_shared<InstancedMesh>(meshData.vertices, meshData.indices),
+            .mesh = std::make_shared<InstancedMesh>(meshData.vertices, meshData.indices, meshData.staging),
             .materialIndex = meshData.materialIndex
         };
     }
 
+    float meshTaskCost(const MeshData& meshData)
+    {
+        if (meshData.staging)
+            return sTaskBaseCost;
+
+        size_t size = meshData.vertices.size() * sizeof(Vertex) + meshData.indices.size() * sizeof(uint32_t);
+        return sTaskBaseCost + size / sDirectUploadBytesPerMs;
+    }
+
+    float textureTaskCost(const LoadedTexture& loadedTexture)
+    {
+        if (loadedTexture.staged)
+            return sTaskBaseCost;
+
+        size_t size = 0;
+
+        if (loadedTexture.container)
+        {
+            for (uint32_t level = 0; level < loadedTexture.container->levelCount(); ++level)
+                size += loadedTexture.container->imageSize(level);
+        }
+        else if (loadedTexture.image)
+        {
+            // hdr, 32 bit float channels
+            size = static_cast<size_t>(loadedTexture.image->width()) * loadedTexture.image->height() * loadedTexture.image->components() * sizeof(float);
+        }
+        else
+        {
+            for (const TextureMip& mip : loadedTexture.mips)
+                size += mip.data.size();
+        }
+
+        return sTaskBaseCost + size / sDirectUploadBytesPerMs;
+    }
+
     // todo: fix that static cast
     std::future<MeshData> createMeshData(const tinygltf::Model& model, const tinygltf::Mesh& gltfMesh)
     {
@@ -151,6 +223,8 @@ namespace ResourceImporter
             if (gltfMesh.primitives.at(0).material != -1)
                 meshData.materialIndex = gltfMesh.primitives.at(0).material;
 
+            meshData.staging = GeometryArena::stage(meshData.vertices, meshData.indices);
+
             return meshData;
         });
     }
@@ -305,27 +379,255 @@ namespace ResourceImporter
         return map;
     }
 
-    std::future<std::shared_ptr<LoadedImage>> loadImageData(const tinygltf::Image& image, const std::filesystem::path& directory)
+    // an image sampled for different things by different materials keeps all four channels
+    std::vector<TextureUsage> getImageUsages(const tinygltf::Model& model, const std::vector<LoadedModelData::Material>& materials)
+    {
+        std::vector<std::optional<TextureUsage>> usages(model.images.size());
+
+        auto addUsage = [&usages] (int32_t imageIndex, TextureUsage usage) {
+            if (imageIndex == -1)
+                return;
+
+            std::optional<TextureUsage>& imageUsage = usages.at(imageIndex);
+
+            if (!imageUsage)
+                imageUsage = usage;
+            else if (*imageUsage != usage)
+                imageUsage = TextureUsage::Data;
+        };
+
+        for (const LoadedModelData::Material& material : materials)
+        {
+            addUsage(material.baseColorTexIndex, TextureUsage::Color);
+            addUsage(material.emissionTexIndex, TextureUsage::Color);
+            addUsage(material.normalTexIndex, TextureUsage::Normal);
+            addUsage(material.aoTexIndex, TextureUsage::Occlusion);
+            addUsage(material.metallicRoughnessTexIndex, TextureUsage::Data);
+        }
+
+        std::vector<TextureUsage> imageUsages(usages.size());
+        for (size_t i = 0; i < usages.size(); ++i)
+            imageUsages.at(i) = usages.at(i).value_or(TextureUsage::Color);
+
+        return imageUsages;
+    }
+
+    std::vector<float> getImageAlphaCutoffs(const tinygltf::Model& model)
+    {
+        std::vector<float> alphaCutoffs(model.images.size(), 0.f);
+
+        for (const tinygltf::Material& material : model.materials)
+        {
+            int32_t textureIndex = material.pbrMetallicRoughness.baseColorTexture.index;
+
+            if (material.alphaMode != "MASK" || textureIndex == -1)
+                continue;
+
+            int32_t imageIndex = model.textures.at(textureIndex).source;
+
+            if (imageIndex != -1)
+                alphaCutoffs.at(imageIndex) = glm::max(alphaCutoffs.at(imageIndex), static_cast<float>(material.alphaCutoff));
+        }
+
+        return alphaCutoffs;
+    }
+
+    std::future<std::shared_ptr<LoadedTexture>> loadImageData(const tinygltf::Image& image,
+                                                              const std::filesystem::path& directory,
+                                                              TextureUsage usage,
+                                                              float alphaCutoff,
+                                                              ImportSettings settings,
+                                                              std::shared_ptr<const TextureHashSet> loadedTextureHashes)
     {
         debugLog(std::format("ResourceImporter: Loading image {}", (directory / image.uri).string()));
-        return std::async(std::launch::async, [&image, &directory] () -> std::shared_ptr<LoadedImage> {
-            return std::make_shared<LoadedImage>(directory / image.uri);
+        return std::async(std::launch::async, [path = directory / image.uri, usage, alphaCutoff, settings, loadedTextureHashes] () {
+            return loadTexture(path, usage, alphaCutoff, settings, loadedTextureHashes.get());
         });
     }
 
-    std::pair<std::shared_ptr<Texture2D>, std::filesystem::path> makeTexturePathPair(const std::shared_ptr<LoadedImage>& imageData)
+    std::shared_ptr<LoadedTexture> loadTexture(const std::filesystem::path& path,
+                                               TextureUsage usage,
+                                               float alphaCutoff,
+                                               ImportSettings settings,
+                                               const TextureHashSet* loadedTextureHashes)
     {
-        TextureSpecification specification {
-            .width = imageData->width(),
-            .height = imageData->height(),
-            .format = imageData->format(),
-            .dataType = imageData->dataType(),
+        std::shared_ptr<LoadedTexture> textureData = std::make_shared<LoadedTexture>();
+        textureData->path = path;
+        textureData->contentHash = textureContentHash(path, usage, alphaCutoff, settings);
+
+        // another model already loaded the same texture, the resource manager hands out that one
+        if (textureData->contentHash && loadedTextureHashes && loadedTextureHashes->contains(textureData->contentHash))
+        {
+            debugLog(std::format("ResourceImporter: {} is already loaded", path.string()));
+            return textureData;
+        }
+
+        // pre-cooked files already have their format and mips
+        if (TextureContainer::supported(textureData->path))
+        {
+            auto container = std::make_shared<TextureContainer>(textureData->path);
+
+            if (container->success() && container->imageCount() == 1)
+            {
+                textureData->container = container;
+                textureData->specification = container->specification(TextureWrap::Repeat, TextureFilter::Anisotropic);
+
+                if (settings.streamTextures)
+                    makeStreamable(*textureData);
+
+                stageTexture(*textureData);
+                return textureData;
+            }
+
+            debugLog(std::format("ResourceImporter: {} isn't a loadable 2D texture container", textureData->path.string()), LogSeverity::Warning);
+        }
+
+        // color textures are expanded to RGBA, the only uncompressed format with an sRGB variant here
+        bool expand = settings.compressTextures || usage == TextureUsage::Color;
+        textureData->image = std::make_shared<LoadedImage>(textureData->path, expand? 4 : 0);
+
+        const LoadedImage& loadedImage = *textureData->image;
+
+        textureData->specification = {
+            .width = loadedImage.width(),
+            .height = loadedImage.height(),
+            .format = loadedImage.format(),
+            .dataType = loadedImage.dataType(),
             .wrapMode = TextureWrap::Repeat,
             .filterMode = TextureFilter::Anisotropic,
             .generateMipMaps = true
         };
 
-        return {std::make_shared<Texture2D>(specification, imageData->data()), imageData->path()};
+        // hdr images stay uncompressed and get their mips on the gpu
+        if (!loadedImage.success() || loadedImage.dataType() != TextureDataType::UINT8)
+            return textureData;
+
+        MipSettings mipSettings = TextureCooker::mipSettings(usage, settings.mipFilter, alphaCutoff);
+
+        if (!settings.compressTextures)
+        {
+            textureData->specification.format = TextureCooker::uncompressedFormat(usage, loadedImage.format());
+            textureData->mips = MipGenerator::generate(static_cast<const uint8_t*>(loadedImage.data()),
+                                                       loadedImage.width(),
+                                                       loadedImage.height(),
+                                                       loadedImage.components(),
+                                                       mipSettings);
+            textureData->image.reset();
+
+            if (settings.streamTextures)
+                makeStreamable(*textureData);
+
+            stageTexture(*textureData);
+            return textureData;
+        }
+
+        const uint8_t* rgba = static_cast<const uint8_t*>(loadedImage.data());
+        bool opaque = TextureCooker::opaque(rgba, loadedImage.width(), loadedImage.height());
+
+        textureData->specification.format = TextureCooker::compressedFormat(usage, settings.textureQuality, opaque);
+        textureData->mips = TextureCooker::cook(rgba,
+                                                loadedImage.width(),
+                                                loadedImage.height(),
+                                                textureData->specification.format,
+                                                mipSettings);
+
+        size_t cookedSize = 0;
+        for (const TextureMip& mip : textureData->mips)
+            cookedSize += mip.data.size();
+
+        debugLog(std::format("ResourceImporter: Cooked {} to {}, {:.2f} MB -> {:.2f} MB",
+                             textureData->path.filename().string(),
+                             toStr(textureData->specification.format),
+                             imageSize(TextureFormat::RGBA8, loadedImage.width(), loadedImage.height()) * 4.0 / 3.0 / 1e6,
+                             cookedSize / 1e6));
+
+        // the decoded pixels aren't needed anymore
+        textureData->image.reset();
+
+        if (settings.streamTextures)
+            makeStreamable(*textureData);
+
+        stageTexture(*textureData);
+        return textureData;
+    }
+
+    uint64_t textureContentHash(const std::filesystem::path& path, TextureUsage usage, float alphaCutoff, ImportSettings settings)
+    {
+        uint64_t hash = hashFile(path);
+
+        // unreadable files, and containers that upload as they are
+        if (hash == 0 || TextureContainer::supported(path))
+            return hash;
+
+        hash = hashBytes(&usage, sizeof(usage), hash);
+        hash = hashBytes(&alphaCutoff, sizeof(alphaCutoff), hash);
+        hash = hashBytes(&settings.compressTextures, sizeof(settings.compressTextures), hash);
+        hash = hashBytes(&settings.textureQuality, sizeof(settings.textureQuality), hash);
+        hash = hashBytes(&settings.mipFilter, sizeof(settings.mipFilter), hash);
+
+        return hash;
+    }
+
+    // hands the mips or the container over to a stream source if the texture is worth streaming
+    void makeStreamable(LoadedTexture& textureData)
+    {
+        auto streamSource = std::make_shared<TextureStreamSource>(TextureStreamSource {
+            .specification = textureData.specification,
+            .mips = std::move(textureData.mips),
+            .container = std::move(textureData.container)
+        });
+
+        if (TextureStreamer::streamable(*streamSource))
+        {
+            textureData.streamSource = streamSource;
+            return;
+        }
+
+        textureData.mips = std::move(streamSource->mips);
+        textureData.container = std::move(streamSource->container);
+    }
+
+    // the staged copy replaces the mips or the container, streamed textures keep theirs on the cpu
+    void stageTexture(LoadedTexture& textureData)
+    {
+        if (textureData.streamSource)
+            return;
+
+        if (textureData.container)
+        {
+            if ((textureData.staged = UploadManager::instance().stageTexture(*textureData.container)))
+                textureData.container.reset();
+        }
+        else if (!textureData.mips.empty())
+        {
+            if ((textureData.staged = UploadManager::instance().stageTexture(textureData.mips)))
+                textureData.mips = {};
+        }
+    }
+
+    std::pair<std::shared_ptr<Texture2D>, std::filesystem::path> makeTexturePathPair(const std::shared_ptr<LoadedTexture>& textureData)
+    {
+        if (textureData->staged)
+        {
+            auto texture = std::make_shared<Texture2D>(textureData->specification);
+            UploadManager::instance().submitTexture(*textureData->staged, texture);
+            return {texture, textureData->path};
+        }
+
+        if (const auto& streamSource = textureData->streamSource)
+            return {TextureStreamer::createTexture(*streamSource, TextureStreamer::tailLevel(streamSource->specification)), textureData->path};
+
+        if (textureData->container)
+            return {std::make_shared<Texture2D>(textureData->specification, *textureData->container), textureData->path};
+
+        if (!textureData->mips.empty())
+            return {std::make_shared<Texture2D>(textureData->specification, textureData->mips), textureData->path};
+
+        if (textureData->image)
+            return {std::make_shared<Texture2D>(textureData->specification, textureData->image->data()), textureData->path};
+
+        // skipped, its content is already loaded
+        return {nullptr, textureData->path};
     }
 
     BoundingBox computeBoundingBox(const tinygltf::Model& model, int nodeIndex, const glm::mat4& parentTransform)
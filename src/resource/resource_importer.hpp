@@ -10,12 +10,32 @@
 #include <glm/gtc/type_ptr.hpp>
 #include "../utils.hpp"
 #include "loaded_resource.hpp"
+#include "texture_cooker.hpp"
 
-using EnqueueCallback = std::function<void(std::function<void()>&&)>;
+// hands a task to the main thread, costMs is its expected main thread time
+using EnqueueCallback = std::function<void(Task&& task, TaskPriority priority, float costMs)>;
+
+// content hashes of the textures loaded when an import starts
+using TextureHashSet = std::unordered_set<uint64_t>;
+
+struct ImportSettings
+{
+    // 8 bit images get block compressed on the worker threads
+    bool compressTextures;
+    // block format choice for compressed color and data textures
+    TextureQuality textureQuality;
+    // textures with a full mip chain start with their mip tail and stream the rest
+    bool streamTextures;
+    // 8 bit images get their mips on the worker threads with this filter
+    MipFilter mipFilter;
+};
 
 namespace ResourceImporter
 {
-    std::future<std::shared_ptr<LoadedModelData>> loadModel(const std::filesystem::path& path, EnqueueCallback callback);
+    std::future<std::shared_ptr<LoadedModelData>> loadModel(const std::filesystem::path& path,
+                                                            EnqueueCallback callback,
+                                                            ImportSettings settings,
+                                                            std::shared_ptr<const TextureHashSet> loadedTextureHashes);
 
     std::shared_ptr<tinygltf::Model> loadGltfScene(const std::filesystem::path& path);
 
@@ -25,6 +45,10 @@ namespace ResourceImporter
 
     LoadedModelData::Mesh createMesh(const MeshData& meshData);
 
+    // main thread time of a task, most of it the uploads the staging buffer had no room for
+    float meshTaskCost(const MeshData& meshData);
+    float textureTaskCost(const LoadedTexture& loadedTexture);
+
     std::future<MeshData> createMeshData(const tinygltf::Model& model, const tinygltf::Mesh& gltfMesh);
 
     std::vector<Vertex> loadMeshVertices(const tinygltf::Model& model, const tinygltf::Mesh& mesh);
@@ -39,9 +63,33 @@ namespace ResourceImporter
 
     std::unordered_map<int32_t, uint32_t> createIndirectTextureToImageMap(const tinygltf::Model& model);
 
-    std::future<std::shared_ptr<LoadedImage>> loadImageData(const tinygltf::Image& image, const std::filesystem::path& directory);
+    std::vector<TextureUsage> getImageUsages(const tinygltf::Model& model, const std::vector<LoadedModelData::Material>& materials);
+
+    // the alpha cutoff of the masked materials using each image as base color, 0 for the rest
+    std::vector<float> getImageAlphaCutoffs(const tinygltf::Model& model);
+
+    std::future<std::shared_ptr<LoadedTexture>> loadImageData(const tinygltf::Image& image,
+                                                              const std::filesystem::path& directory,
+                                                              TextureUsage usage,
+                                                              float alphaCutoff,
+                                                              ImportSettings settings,
+                                                              std::shared_ptr<const TextureHashSet> loadedTextureHashes);
+
+    // skips decoding when the content hash is in loadedTextureHashes
+    std::shared_ptr<LoadedTexture> loadTexture(const std::filesystem::path& path,
+                                               TextureUsage usage,
+                                               float alphaCutoff,
+                                               ImportSettings settings,
+                                               const TextureHashSet* loadedTextureHashes);
+
+    // the file's bytes plus whatever changes what gets uploaded from them, 0 if the file can't be read
+    uint64_t textureContentHash(const std::filesystem::path& path, TextureUsage usage, float alphaCutoff, ImportSettings settings);
+
+    void makeStreamable(LoadedTexture& textureData);
+
+    void stageTexture(LoadedTexture& textureData);
 
-    std::pair<std::shared_ptr<Texture2D>, std::filesystem::path> makeTexturePathPair(const std::shared_ptr<LoadedImage>& imageData);
+    std::pair<std::shared_ptr<Texture2D>, std::filesystem::path> makeTexturePathPair(const std::shared_ptr<LoadedTexture>& textureData);
 
     BoundingBox computeBoundingBox(const tinygltf::Model& model, int nodeIndex, const glm::mat4& parentTransform);
 }
@@ -4,6 +4,9 @@
 
 #include "resource_manager.hpp"
 
+// main thread time per frame for the importer's tasks
+static constexpr float sDefaultTaskBudget = 2.f;
+
 static gpu_tex_handle64_t makeBindless(uint32_t textureID)
 {
     gpu_tex_handle64_t gpuTextureHandle = glGetTextureHandleARB(textureID);
@@ -32,7 +35,12 @@ ResourceManager::ResourceManager()
     : SubscriberSNS({Topic::Type::Resources, Topic::Type::SceneGraph})
     , mBindlessTextureSSBO(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, 1, 1024 * sizeof(gpu_tex_handle64_t), nullptr)
     , mMaterialsSSBO(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, 2, 256 * sizeof(Material), nullptr)
+    , mTaskBudgetMs(sDefaultTaskBudget)
+    , mImportSettings({.compressTextures = true, .textureQuality = TextureQuality::High, .streamTextures = true, .mipFilter = MipFilter::Kaiser})
 {
+    // workers stage through it, so it has to exist before the first import
+    UploadManager::instance();
+
     loadDefaultTextures();
     loadDefaultMaterial();
 }
@@ -47,16 +55,149 @@ bool ResourceManager::importModel(const std::filesystem::path &path)
 {
     if (resourceLoaded(mModelPaths, path))
     {
-        debugLog(std::format("Model \"{}\" is already loaded.", path.string()));
+        debugLog(std::format("Model \"{}\" is already loaded.", path.string()), LogSeverity::Warning);
         return false;
     }
 
-    EnqueueCallback callback = [this] (Task&& t) {mTaskQueue.push(std::move(t));};
-    mLoadedModelFutures.push_back(ResourceImporter::loadModel(path, callback));
+    auto loadedTextureHashes = std::make_shared<TextureHashSet>();
+    for (const auto& [contentHash, textureID] : mTextureHashes)
+        loadedTextureHashes->insert(contentHash);
+
+    EnqueueCallback callback = [this] (Task&& t, TaskPriority priority, float costMs) {
+        mTaskQueue.push(std::move(t), priority, costMs);
+    };
+    mLoadedModelFutures.push_back(ResourceImporter::loadModel(path, callback, mImportSettings, loadedTextureHashes));
 
     return true;
 }
 
+bool ResourceManager::importing() const
+{
+    return !mLoadedModelFutures.empty() || !mUploadingModels.empty();
+}
+
+void ResourceManager::setTextureCompression(bool compressTextures)
+{
+    mImportSettings.compressTextures = compressTextures;
+}
+
+bool ResourceManager::textureCompression() const
+{
+    return mImportSettings.compressTextures;
+}
+
+void ResourceManager::setTextureQuality(TextureQuality textureQuality)
+{
+    mImportSettings.textureQuality = textureQuality;
+}
+
+TextureQuality ResourceManager::textureQuality() const
+{
+    return mImportSettings.textureQuality;
+}
+
+void ResourceManager::setTextureStreaming(bool streamTextures)
+{
+    mImportSettings.streamTextures = streamTextures;
+}
+
+bool ResourceManager::textureStreaming() const
+{
+    return mImportSettings.streamTextures;
+}
+
+void ResourceManager::setMipFilter(MipFilter mipFilter)
+{
+    mImportSettings.mipFilter = mipFilter;
+}
+
+MipFilter ResourceManager::mipFilter() const
+{
+    return mImportSettings.mipFilter;
+}
+
+// the screen size of an instance is the projected diameter of its bounds, a material gets the
+// largest over the instances using it, scaled by its tiling
+void ResourceManager::updateTextureStreaming(const glm::mat4 &viewProjection, const glm::vec3 &viewPosition,
+                                             float projectionScale, float viewportHeight)
+{
+    Frustum frustum(viewProjection);
+
+    mStreamingMaterialScreenSizes.assign(mMaterialArray.size(), 0.f);
+
+    for (const auto& [meshID, mesh] : mMeshes)
+    {
+        mStreamingVisibleInstances.clear();
+        mesh->cull(frustum, mStreamingVisibleInstances);
+
+        const AABBArray& boxes = mesh->instanceBoxes();
+        const std::vector<uint32_t>& materials = mesh->instanceMaterials();
+
+        for (uint32_t instanceIndex : mStreamingVisibleInstances)
+        {
+            glm::vec3 center(boxes.data(AABBArray::CenterX)[instanceIndex],
+                             boxes.data(AABBArray::CenterY)[instanceIndex],
+                             boxes.data(AABBArray::CenterZ)[instanceIndex]);
+            glm::vec3 extent(boxes.data(AABBArray::ExtentX)[instanceIndex],
+                             boxes.data(AABBArray::ExtentY)[instanceIndex],
+                             boxes.data(AABBArray::ExtentZ)[instanceIndex]);
+
+            float radius = glm::length(extent);
+            float distance = glm::max(glm::distance(center, viewPosition) - radius, 0.01f);
+            float screenSize = radius * projectionScale * viewportHeight / distance;
+
+            uint32_t materialIndex = materials.at(instanceIndex);
+            if (materialIndex < mStreamingMaterialScreenSizes.size())
+                mStreamingMaterialScreenSizes.at(materialIndex) = glm::max(mStreamingMaterialScreenSizes.at(materialIndex), screenSize);
+        }
+    }
+
+    // bindless index to texture id, only the streamed ones matter
+    std::unordered_map<gpu_tex_handle64_t, uuid64_t> handleToTextureID;
+    for (const auto& [textureID, gpuTexHandle] : mBindlessTextureMap)
+        if (mTextureStreamer.streamed(textureID))
+            handleToTextureID.emplace(gpuTexHandle, textureID);
+
+    auto request = [this, &handleToTextureID] (index_t texIndex, float screenSize) {
+        if (texIndex >= mBindlessTextureArray.size())
+            return;
+
+        auto itr = handleToTextureID.find(mBindlessTextureArray.at(texIndex));
+        if (itr != handleToTextureID.end())
+            mTextureStreamer.request(itr->second, screenSize);
+    };
+
+    for (size_t i = 0; i < mMaterialArray.size(); ++i)
+    {
+        const Material& material = mMaterialArray.at(i);
+        float screenSize = mStreamingMaterialScreenSizes.at(i) * glm::max(material.tiling.x, material.tiling.y);
+
+        if (screenSize <= 0.f)
+            continue;
+
+        request(material.baseColorTexIndex, screenSize);
+        request(material.metallicRoughnessTexIndex, screenSize);
+        request(material.normalTexIndex, screenSize);
+        request(material.aoTexIndex, screenSize);
+        request(material.emissionTexIndex, screenSize);
+    }
+
+    // swap the rebuilt views into the bindless table, the old ones go once the gpu is done with them
+    for (const auto& [textureID, texture] : mTextureStreamer.update())
+    {
+        gpu_tex_handle64_t oldHandle = mBindlessTextureMap.at(textureID);
+        gpu_tex_handle64_t newHandle = makeBindless(texture->id());
+        index_t texIndex = getTextureIndex(textureID);
+
+        mBindlessTextureArray.at(texIndex) = newHandle;
+        mBindlessTextureMap.at(textureID) = newHandle;
+        mBindlessTextureSSBO.update(texIndex * sizeof(gpu_tex_handle64_t), sizeof(gpu_tex_handle64_t), &newHandle);
+
+        mTextureStreamer.retire(mTextures.at(textureID), oldHandle);
+        mTextures.at(textureID) = texture;
+    }
+}
+
 void ResourceManager::notify(const Message &message)
 {
     if (const auto m = message.getIf<Message::MeshInstanceUpdate>())
@@ -122,20 +263,38 @@ void ResourceManager::notify(const Message &message)
 
 void ResourceManager::processMainThreadTasks()
 {
-    while (auto task = mTaskQueue.pop())
-        (*task)();
+    mTaskQueue.process(mTaskBudgetMs);
 
     for (auto itr = mLoadedModelFutures.begin(); itr != mLoadedModelFutures.end();)
     {
         if (itr->wait_for(std::chrono::seconds(0)) == std::future_status::ready)
         {
-            auto loadedModel = itr->get();
-            addModel(loadedModel);
+            mUploadingModels.push_back(itr->get());
             itr = mLoadedModelFutures.erase(itr);
         }
         else
             ++itr;
     }
+
+    UploadManager::instance().update();
+
+    std::erase_if(mUploadingModels, [this] (const std::shared_ptr<LoadedModelData>& modelData) {
+        if (modelData->pendingTasks > 0 || !UploadManager::instance().issued(modelData->uploadTicket))
+            return false;
+
+        addModel(modelData);
+        return true;
+    });
+}
+
+void ResourceManager::setTaskBudget(float taskBudgetMs)
+{
+    mTaskBudgetMs = taskBudgetMs;
+}
+
+float ResourceManager::taskBudget() const
+{
+    return mTaskBudgetMs;
 }
 
 std::shared_ptr<Model> ResourceManager::getModel(uuid64_t id)
@@ -176,13 +335,14 @@ void ResourceManager::updateMaterial(index_t materialIndex)
 
 void ResourceManager::addModel(std::shared_ptr<LoadedModelData> modelData)
 {
+    uuid64_t modelID = UUIDRegistry::generateModelID();
+
     // add meshes, textures, and materials to resources
     std::unordered_map<index_t, uuid64_t> loadedMeshIndexToMeshUUID = addMeshes(modelData);
-    std::unordered_map<index_t, uint32_t> loadedTextureIndexToResourceIndex = addTextures(modelData);
+    std::unordered_map<index_t, uint32_t> loadedTextureIndexToResourceIndex = addTextures(modelData, modelID);
     std::unordered_map<std::string, uuid64_t> loadedMatNameToMatID = addMaterials(modelData, loadedTextureIndexToResourceIndex);
 
     // add model
-    uuid64_t modelID = UUIDRegistry::generateModelID();
     std::shared_ptr<Model> model = std::make_shared<Model>();
 
     model->root = createModelNodeHierarchy(modelData, modelData->root, loadedMeshIndexToMeshUUID, loadedMatNameToMatID);
@@ -212,19 +372,54 @@ std::unordered_map<index_t, uuid64_t> ResourceManager::addMeshes(std::shared_ptr
     return loadedMeshIndexToMeshUUID;
 }
 
-std::unordered_map<index_t, uint32_t> ResourceManager::addTextures(std::shared_ptr<LoadedModelData> modelData)
+// textures whose content is already loaded resolve to the loaded resource and its bindless slot
+std::unordered_map<index_t, uint32_t> ResourceManager::addTextures(std::shared_ptr<LoadedModelData> modelData, uuid64_t modelID)
 {
     std::unordered_map<index_t, uint32_t> loadedTextureIndexToResourceIndex;
+    std::vector<uuid64_t>& modelTextures = mModelTextures[modelID];
 
     for (size_t i = 0; i < modelData->textures.size(); ++i)
     {
-        const auto& [texture, texturePath] = modelData->textures.at(i);
+        auto [texture, texturePath] = modelData->textures.at(i);
+        auto streamSource = modelData->textureStreamSources.at(i);
+        const LoadedModelData::TextureSource& textureSource = modelData->textureSources.at(i);
+
+        if (auto itr = mTextureHashes.find(textureSource.contentHash); textureSource.contentHash && itr != mTextureHashes.end())
+        {
+            uuid64_t textureID = itr->second;
+
+            ++mTextureRefCounts.at(textureID);
+            modelTextures.push_back(textureID);
+            loadedTextureIndexToResourceIndex.emplace(i, getTextureIndex(textureID));
+
+            continue;
+        }
+
+        // skipped by the importer but deleted since, load it here
+        if (!texture)
+        {
+            auto textureData = ResourceImporter::loadTexture(texturePath, textureSource.usage, textureSource.alphaCutoff, mImportSettings, nullptr);
+            texture = ResourceImporter::makeTexturePathPair(textureData).first;
+            streamSource = textureData->streamSource;
+        }
 
         uuid64_t textureID = UUIDRegistry::generateTextureID();
         mTextures.emplace(textureID, texture);
         mTextureNames.emplace(textureID, texturePath.filename().string());
         mTexturePaths.emplace(textureID, texturePath);
 
+        if (streamSource)
+            mTextureStreamer.add(textureID, streamSource, texture);
+
+        if (textureSource.contentHash)
+        {
+            mTextureHashes.emplace(textureSource.contentHash, textureID);
+            mTextureContentHashes.emplace(textureID, textureSource.contentHash);
+        }
+
+        mTextureRefCounts.emplace(textureID, 1);
+        modelTextures.push_back(textureID);
+
         gpu_tex_handle64_t gpuTexHandle = makeBindless(texture->id());
         mBindlessTextureMap.emplace(textureID, gpuTexHandle);
         mBindlessTextureArray.push_back(gpuTexHandle);
@@ -329,6 +524,10 @@ Model::Node ResourceManager::createModelNodeHierarchy(std::shared_ptr<LoadedMode
 void ResourceManager::deleteModel(uuid64_t id)
 {
     std::shared_ptr<Model> model = mModels.at(id);
+    std::unordered_set<uuid64_t> meshIDs = getModelMeshIDs(*model);
+
+    // the scene graph drops the instances of the meshes first, their removal still needs the meshes
+    SNS::publishMessage(Topic::Type::Resources, Message::create<Message::ModelDeleted>(id, meshIDs));
 
     // delete model
     mModels.erase(id);
@@ -336,28 +535,36 @@ void ResourceManager::deleteModel(uuid64_t id)
     mModelPaths.erase(id);
 
     // delete model meshes
-    std::unordered_set<uuid64_t> meshIDs = getModelMeshIDs(*model);
-
     for (uuid64_t meshID : meshIDs)
     {
         mMeshes.erase(meshID);
         mMeshNames.erase(meshID);
     }
 
-    // send message
-    SNS::publishMessage(Topic::Type::Resources, Message::create<Message::ModelDeleted>(id, meshIDs));
+    // release model textures
+    for (uuid64_t textureID : mModelTextures.at(id))
+        releaseTexture(textureID);
+    mModelTextures.erase(id);
 }
 
 void ResourceManager::deleteTexture(uuid64_t id)
 {
     std::shared_ptr<Texture2D> texture = mTextures.at(id);
-    index_t removeIndex = mBindlessTextureMap.at(id);
+    index_t removeIndex = getTextureIndex(id);
 
     // delete texture
     mTextures.erase(id);
     mTextureNames.erase(id);
     mTexturePaths.erase(id);
     mBindlessTextureMap.erase(id);
+    mTextureStreamer.remove(id);
+    mTextureRefCounts.erase(id);
+
+    if (auto itr = mTextureContentHashes.find(id); itr != mTextureContentHashes.end())
+    {
+        mTextureHashes.erase(itr->second);
+        mTextureContentHashes.erase(itr);
+    }
 
     // make bindless texture non resident
     glMakeTextureHandleNonResidentARB(mBindlessTextureArray.at(removeIndex));
@@ -380,6 +587,17 @@ void ResourceManager::deleteTexture(uuid64_t id)
     SNS::publishMessage(Topic::Type::SceneGraph, Message::create<Message::TextureDeleted>(id, removeIndex, transferIndex));
 }
 
+void ResourceManager::releaseTexture(uuid64_t id)
+{
+    // deleted directly while still referenced
+    auto itr = mTextureRefCounts.find(id);
+    if (itr == mTextureRefCounts.end())
+        return;
+
+    if (--itr->second == 0)
+        deleteTexture(id);
+}
+
 void ResourceManager::deleteMaterial(uuid64_t id)
 {
     index_t removeIndex = mMaterials.at(id);
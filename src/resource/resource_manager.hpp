@@ -10,10 +10,12 @@
 #include "../app/uuid_registry.hpp"
 #include "../opengl/shader.hpp"
 #include "../renderer/material.hpp"
+#include "../renderer/frustum.hpp"
 #include "resource_importer.hpp"
 
 class Editor;
 class Renderer;
+class HeadlessApplication;
 
 class ResourceManager : public SubscriberSNS
 {
@@ -22,10 +24,33 @@ public:
     ~ResourceManager();
 
     bool importModel(const std::filesystem::path& path);
+    // true while an imported model is loading or waiting for its uploads
+    bool importing() const;
+
+    // imported 8 bit textures are block compressed on the importer's threads
+    void setTextureCompression(bool compressTextures);
+    bool textureCompression() const;
+    // BC7, or the smaller BC1/BC3, for compressed color and data textures
+    void setTextureQuality(TextureQuality textureQuality);
+    TextureQuality textureQuality() const;
+    // imported textures with a full mip chain are streamed under the streamer's budget
+    void setTextureStreaming(bool streamTextures);
+    bool textureStreaming() const;
+    // filter for the mips built on import
+    void setMipFilter(MipFilter mipFilter);
+    MipFilter mipFilter() const;
+
+    // requests mips for the materials of the instances in view and swaps in the new views.
+    // projectionScale is projection[1][1]
+    void updateTextureStreaming(const glm::mat4& viewProjection, const glm::vec3& viewPosition,
+                                float projectionScale, float viewportHeight);
 
     void notify(const Message &message) override;
 
+    // runs the importer's main thread tasks within the task budget
     void processMainThreadTasks();
+    void setTaskBudget(float taskBudgetMs);
+    float taskBudget() const;
 
     std::shared_ptr<Model> getModel(uuid64_t id);
     std::shared_ptr<InstancedMesh> getMesh(uuid64_t id);
@@ -39,6 +64,8 @@ public:
 
     void deleteModel(uuid64_t id);
     void deleteTexture(uuid64_t id);
+    // drops one model's reference, the last one deletes the texture
+    void releaseTexture(uuid64_t id);
     void deleteMaterial(uuid64_t id);
 
     std::optional<uuid64_t> getModelID(const std::shared_ptr<Model>& model);
@@ -48,7 +75,7 @@ public:
 private:
     void addModel(std::shared_ptr<LoadedModelData> modelData);
     std::unordered_map<index_t, uuid64_t> addMeshes(std::shared_ptr<LoadedModelData> modelData);
-    std::unordered_map<index_t, uint32_t> addTextures(std::shared_ptr<LoadedModelData> modelData);
+    std::unordered_map<index_t, uint32_t> addTextures(std::shared_ptr<LoadedModelData> modelData, uuid64_t modelID);
     std::unordered_map<std::string, uuid64_t> addMaterials(std::shared_ptr<LoadedModelData> modelData,
                                                            const std::unordered_map<index_t, uint32_t>& loadedTextureIndexToResourceIndex);
     Model::Node createModelNodeHierarchy(std::shared_ptr<LoadedModelData> modelData,
@@ -75,7 +102,15 @@ private:
     std::unordered_map<uuid64_t, std::filesystem::path> mTexturePaths;
     std::unordered_map<uuid64_t, gpu_tex_handle64_t> mBindlessTextureMap;
     std::vector<gpu_tex_handle64_t> mBindlessTextureArray;
+    // imported textures by content hash, shared by every model importing the same content
+    std::unordered_map<uint64_t, uuid64_t> mTextureHashes;
+    std::unordered_map<uuid64_t, uint64_t> mTextureContentHashes;
+    std::unordered_map<uuid64_t, uint32_t> mTextureRefCounts;
+    std::unordered_map<uuid64_t, std::vector<uuid64_t>> mModelTextures;
     ShaderBuffer mBindlessTextureSSBO;
+    TextureStreamer mTextureStreamer;
+    std::vector<uint32_t> mStreamingVisibleInstances;
+    std::vector<float> mStreamingMaterialScreenSizes;
 
     // All materials
     std::unordered_map<uuid64_t, index_t> mMaterials;
@@ -85,11 +120,16 @@ private:
 
     // Async Loading
     std::vector<std::future<std::shared_ptr<LoadedModelData>>> mLoadedModelFutures;
+    // loaded, waiting for their main thread tasks to run and the upload manager to issue their copies
+    std::vector<std::shared_ptr<LoadedModelData>> mUploadingModels;
     MainThreadTaskQueue mTaskQueue;
+    float mTaskBudgetMs;
+    ImportSettings mImportSettings;
 
 private:
     friend class Editor;
     friend class Renderer;
+    friend class HeadlessApplication;
 };
 
 #endif //OPENGLRENDERINGENGINE_RESOURCE_MANAGER_HPP
@@ -0,0 +1,517 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "texture_cooker.hpp"
+
+static constexpr uint32_t sBlockTexelCount = 16;
+
+// BC7 interpolation weights for 4 bit indices, out of 64
+static constexpr std::array<int32_t, 16> sBC7Weights {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// endpoint refits after the principal axis fit
+static constexpr uint32_t sBC7RefineIterations = 2;
+
+// bits are written lsb first, as the block formats are defined
+class BitWriter
+{
+public:
+    BitWriter(uint8_t* data, uint32_t byteCount)
+        : mData(data)
+        , mBit()
+    {
+        std::fill_n(data, byteCount, 0);
+    }
+
+    void write(uint32_t value, uint32_t bitCount)
+    {
+        for (uint32_t i = 0; i < bitCount; ++i, ++mBit)
+        {
+            if ((value >> i) & 1)
+                mData[mBit / 8] |= static_cast<uint8_t>(1 << (mBit % 8));
+        }
+    }
+
+private:
+    uint8_t* mData;
+    uint32_t mBit;
+};
+
+struct BC7Endpoints
+{
+    glm::ivec4 quantized[2];
+    uint32_t pBits[2];
+};
+
+// 7 bits per channel and a p-bit shared by the channels, the p-bit with the smaller error wins
+static void quantizeBC7Endpoint(const glm::vec4& endpoint, glm::ivec4& quantized, uint32_t& pBit)
+{
+    float bestError = FLT_MAX;
+
+    for (uint32_t p = 0; p < 2; ++p)
+    {
+        glm::ivec4 candidate = glm::clamp(glm::ivec4(glm::round((endpoint - static_cast<float>(p)) * 0.5f)), 0, 127);
+        glm::vec4 reconstructed = glm::vec4(candidate * 2 + static_cast<int32_t>(p));
+        glm::vec4 difference = reconstructed - endpoint;
+        float error = glm::dot(difference, difference);
+
+        if (error < bestError)
+        {
+            bestError = error;
+            quantized = candidate;
+            pBit = p;
+        }
+    }
+}
+
+static glm::ivec4 unquantizeBC7Endpoint(const glm::ivec4& quantized, uint32_t pBit)
+{
+    return quantized * 2 + static_cast<int32_t>(pBit);
+}
+
+// picks the closest palette entry for every texel, returns the summed squared error
+static int32_t fitBC7Indices(const std::array<glm::ivec4, sBlockTexelCount>& texels,
+                             const BC7Endpoints& endpoints,
+                             std::array<uint8_t, sBlockTexelCount>& indices)
+{
+    glm::ivec4 e0 = unquantizeBC7Endpoint(endpoints.quantized[0], endpoints.pBits[0]);
+    glm::ivec4 e1 = unquantizeBC7Endpoint(endpoints.quantized[1], endpoints.pBits[1]);
+
+    std::array<glm::ivec4, 16> palette;
+    for (uint32_t i = 0; i < palette.size(); ++i)
+        palette.at(i) = ((64 - sBC7Weights.at(i)) * e0 + sBC7Weights.at(i) * e1 + 32) >> 6;
+
+    int32_t totalError = 0;
+
+    for (uint32_t texel = 0; texel < sBlockTexelCount; ++texel)
+    {
+        int32_t bestError = INT32_MAX;
+
+        for (uint32_t i = 0; i < palette.size(); ++i)
+        {
+            glm::ivec4 difference = texels.at(texel) - palette.at(i);
+            int32_t error = difference.x * difference.x + difference.y * difference.y + difference.z * difference.z + difference.w * difference.w;
+
+            if (error < bestError)
+            {
+                bestError = error;
+                indices.at(texel) = static_cast<uint8_t>(i);
+            }
+        }
+
+        totalError += bestError;
+    }
+
+    return totalError;
+}
+
+// least squares endpoints for fixed indices
+static bool refitBC7Endpoints(const std::array<glm::ivec4, sBlockTexelCount>& texels,
+                              const std::array<uint8_t, sBlockTexelCount>& indices,
+                              glm::vec4& e0,
+                              glm::vec4& e1)
+{
+    float a = 0.f, b = 0.f, c = 0.f;
+    glm::vec4 d(0.f), e(0.f);
+
+    for (uint32_t texel = 0; texel < sBlockTexelCount; ++texel)
+    {
+        float w = sBC7Weights.at(indices.at(texel)) / 64.f;
+        glm::vec4 x(texels.at(texel));
+
+        a += (1.f - w) * (1.f - w);
+        b += (1.f - w) * w;
+        c += w * w;
+        d += (1.f - w) * x;
+        e += w * x;
+    }
+
+    float determinant = a * c - b * b;
+
+    if (glm::abs(determinant) < 1e-6f)
+        return false;
+
+    e0 = glm::clamp((c * d - b * e) / determinant, 0.f, 255.f);
+    e1 = glm::clamp((a * e - b * d) / determinant, 0.f, 255.f);
+
+    return true;
+}
+
+static uint16_t packRGB565(const glm::vec3& color)
+{
+    glm::uvec3 quantized = glm::uvec3(glm::round(glm::clamp(color, 0.f, 255.f) * glm::vec3(31.f, 63.f, 31.f) / 255.f));
+    return static_cast<uint16_t>((quantized.r << 11) | (quantized.g << 5) | quantized.b);
+}
+
+// the top bits are repeated into the low ones, the way the hardware expands them
+static glm::ivec3 unpackRGB565(uint16_t color)
+{
+    int32_t r = (color >> 11) & 31;
+    int32_t g = (color >> 5) & 63;
+    int32_t b = color & 31;
+
+    return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+}
+
+namespace TextureCooker
+{
+    TextureFormat compressedFormat(TextureUsage usage, TextureQuality quality, bool opaque)
+    {
+        switch (usage)
+        {
+            case TextureUsage::Normal: return TextureFormat::BC5;
+            case TextureUsage::Occlusion: return TextureFormat::BC4;
+            default: break;
+        }
+
+        bool srgb = usage == TextureUsage::Color;
+
+        if (quality == TextureQuality::High)
+            return srgb? TextureFormat::BC7_SRGB : TextureFormat::BC7;
+
+        if (opaque)
+            return srgb? TextureFormat::BC1_SRGB : TextureFormat::BC1;
+
+        return srgb? TextureFormat::BC3_SRGB : TextureFormat::BC3;
+    }
+
+    TextureFormat uncompressedFormat(TextureUsage usage, TextureFormat imageFormat)
+    {
+        if (usage == TextureUsage::Color && imageFormat == TextureFormat::RGBA8)
+            return TextureFormat::RGBA8_SRGB;
+        return imageFormat;
+    }
+
+    bool opaque(const uint8_t* rgba, int32_t width, int32_t height)
+    {
+        size_t texelCount = static_cast<size_t>(width) * height;
+
+        for (size_t i = 0; i < texelCount; ++i)
+        {
+            if (rgba[i * 4 + 3] != 255)
+                return false;
+        }
+
+        return true;
+    }
+
+    MipSettings mipSettings(TextureUsage usage, MipFilter filter, float alphaCutoff)
+    {
+        return {
+            .filter = filter,
+            .srgb = usage == TextureUsage::Color,
+            .alphaCutoff = usage == TextureUsage::Color? alphaCutoff : 0.f
+        };
+    }
+
+    std::vector<TextureMip> cook(const uint8_t* rgba, int32_t width, int32_t height, TextureFormat format, const MipSettings& mipSettings)
+    {
+        size_t blockSize = imageSize(format, 4, 4);
+
+        std::vector<TextureMip> mips = MipGenerator::generate(rgba, width, height, 4, mipSettings);
+
+        for (TextureMip& mip : mips)
+        {
+            std::vector<uint8_t> blocks(imageSize(format, mip.width, mip.height));
+            std::array<uint8_t, sBlockTexelCount * 4> texels;
+
+            int32_t blockCountX = (mip.width + 3) / 4;
+            int32_t blockCountY = (mip.height + 3) / 4;
+
+            for (int32_t blockY = 0; blockY < blockCountY; ++blockY)
+            {
+                for (int32_t blockX = 0; blockX < blockCountX; ++blockX)
+                {
+                    // blocks hanging over the edge repeat the edge texels
+                    for (int32_t y = 0; y < 4; ++y)
+                    {
+                        for (int32_t x = 0; x < 4; ++x)
+                        {
+                            int32_t sourceX = glm::min(blockX * 4 + x, mip.width - 1);
+                            int32_t sourceY = glm::min(blockY * 4 + y, mip.height - 1);
+
+                            std::copy_n(&mip.data.at((sourceY * mip.width + sourceX) * 4), 4, &texels.at((y * 4 + x) * 4));
+                        }
+                    }
+
+                    uint8_t* block = &blocks.at((blockY * blockCountX + blockX) * blockSize);
+
+                    switch (format)
+                    {
+                        case TextureFormat::BC1:
+                        case TextureFormat::BC1_SRGB: encodeBC1Block(texels.data(), block); break;
+                        case TextureFormat::BC3:
+                        case TextureFormat::BC3_SRGB: encodeBC3Block(texels.data(), block); break;
+                        case TextureFormat::BC4: encodeBC4Block(texels.data(), 0, block); break;
+                        case TextureFormat::BC5: encodeBC5Block(texels.data(), block); break;
+                        default: encodeBC7Block(texels.data(), block); break;
+                    }
+                }
+            }
+
+            mip.data = std::move(blocks);
+        }
+
+        return mips;
+    }
+
+    // the 4 color mode, color0 > color1, with endpoints at the ends of the block's principal axis
+    void encodeBC1Block(const uint8_t* texels, uint8_t* block)
+    {
+        std::array<glm::vec3, sBlockTexelCount> colors;
+        glm::vec3 mean(0.f);
+
+        for (uint32_t i = 0; i < sBlockTexelCount; ++i)
+        {
+            colors.at(i) = glm::vec3(texels[i * 4], texels[i * 4 + 1], texels[i * 4 + 2]);
+            mean += colors.at(i);
+        }
+
+        mean /= static_cast<float>(sBlockTexelCount);
+
+        glm::mat3 covariance(0.f);
+        for (const glm::vec3& color : colors)
+            covariance += glm::outerProduct(color - mean, color - mean);
+
+        // power iteration for the principal axis
+        glm::vec3 axis(1.f);
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            axis = covariance * axis;
+
+            float length = glm::length(axis);
+            if (length < 1e-6f)
+                break;
+
+            axis /= length;
+        }
+
+        float minProjection = 0.f;
+        float maxProjection = 0.f;
+
+        if (glm::length(axis) > 0.5f)
+        {
+            minProjection = FLT_MAX;
+            maxProjection = -FLT_MAX;
+
+            for (const glm::vec3& color : colors)
+            {
+                float projection = glm::dot(color - mean, axis);
+                minProjection = glm::min(minProjection, projection);
+                maxProjection = glm::max(maxProjection, projection);
+            }
+        }
+
+        uint16_t color0 = packRGB565(mean + axis * maxProjection);
+        uint16_t color1 = packRGB565(mean + axis * minProjection);
+
+        if (color0 < color1)
+            std::swap(color0, color1);
+
+        // equal endpoints would switch the block to the 3 color mode, where index 3 is transparent.
+        // index 0 alone reproduces the color
+        uint32_t indexBits = 0;
+
+        if (color0 > color1)
+        {
+            glm::ivec3 c0 = unpackRGB565(color0);
+            glm::ivec3 c1 = unpackRGB565(color1);
+            std::array<glm::ivec3, 4> palette {c0, c1, (2 * c0 + c1) / 3, (c0 + 2 * c1) / 3};
+
+            for (uint32_t texel = 0; texel < sBlockTexelCount; ++texel)
+            {
+                uint32_t bestIndex = 0;
+                int32_t bestError = INT32_MAX;
+
+                for (uint32_t i = 0; i < palette.size(); ++i)
+                {
+                    glm::ivec3 difference = glm::ivec3(colors.at(texel)) - palette.at(i);
+                    int32_t error = difference.x * difference.x + difference.y * difference.y + difference.z * difference.z;
+
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        bestIndex = i;
+                    }
+                }
+
+                indexBits |= bestIndex << (texel * 2);
+            }
+        }
+
+        block[0] = static_cast<uint8_t>(color0);
+        block[1] = static_cast<uint8_t>(color0 >> 8);
+        block[2] = static_cast<uint8_t>(color1);
+        block[3] = static_cast<uint8_t>(color1 >> 8);
+
+        for (uint32_t i = 0; i < 4; ++i)
+            block[4 + i] = static_cast<uint8_t>(indexBits >> (i * 8));
+    }
+
+    // alpha as a BC4 block followed by a BC1 color block, which always decodes in 4 color mode here
+    void encodeBC3Block(const uint8_t* texels, uint8_t* block)
+    {
+        encodeBC4Block(texels, 3, block);
+        encodeBC1Block(texels, block + 8);
+    }
+
+    // the 8 value mode, red0 > red1, palette runs from the block's max down to its min
+    void encodeBC4Block(const uint8_t* texels, uint32_t channel, uint8_t* block)
+    {
+        std::array<int32_t, sBlockTexelCount> values;
+        for (uint32_t i = 0; i < sBlockTexelCount; ++i)
+            values.at(i) = texels[i * 4 + channel];
+
+        int32_t maxValue = *std::ranges::max_element(values);
+        int32_t minValue = *std::ranges::min_element(values);
+
+        std::array<int32_t, 8> palette {maxValue, minValue};
+        for (int32_t i = 2; i < 8; ++i)
+            palette.at(i) = ((8 - i) * maxValue + (i - 1) * minValue + 3) / 7;
+
+        uint64_t indexBits = 0;
+
+        if (maxValue > minValue)
+        {
+            for (uint32_t texel = 0; texel < sBlockTexelCount; ++texel)
+            {
+                uint64_t bestIndex = 0;
+                int32_t bestError = INT32_MAX;
+
+                for (uint32_t i = 0; i < palette.size(); ++i)
+                {
+                    int32_t error = glm::abs(values.at(texel) - palette.at(i));
+
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        bestIndex = i;
+                    }
+                }
+
+                indexBits |= bestIndex << (texel * 3);
+            }
+        }
+
+        block[0] = static_cast<uint8_t>(maxValue);
+        block[1] = static_cast<uint8_t>(minValue);
+
+        for (uint32_t i = 0; i < 6; ++i)
+            block[2 + i] = static_cast<uint8_t>(indexBits >> (i * 8));
+    }
+
+    // red and green as two BC4 blocks
+    void encodeBC5Block(const uint8_t* texels, uint8_t* block)
+    {
+        encodeBC4Block(texels, 0, block);
+        encodeBC4Block(texels, 1, block + 8);
+    }
+
+    // mode 6: a single RGBA line with 7 bit endpoints, a p-bit per endpoint and 4 bit indices.
+    // The line starts along the principal axis of the block and is refit by least squares
+    void encodeBC7Block(const uint8_t* texels, uint8_t* block)
+    {
+        std::array<glm::ivec4, sBlockTexelCount> blockTexels;
+        glm::vec4 mean(0.f);
+
+        for (uint32_t i = 0; i < sBlockTexelCount; ++i)
+        {
+            blockTexels.at(i) = glm::ivec4(texels[i * 4], texels[i * 4 + 1], texels[i * 4 + 2], texels[i * 4 + 3]);
+            mean += glm::vec4(blockTexels.at(i));
+        }
+
+        mean /= static_cast<float>(sBlockTexelCount);
+
+        glm::mat4 covariance(0.f);
+        for (const glm::ivec4& texel : blockTexels)
+        {
+            glm::vec4 offset = glm::vec4(texel) - mean;
+            covariance += glm::outerProduct(offset, offset);
+        }
+
+        // power iteration for the principal axis
+        glm::vec4 axis(1.f);
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            axis = covariance * axis;
+
+            float length = glm::length(axis);
+            if (length < 1e-6f)
+                break;
+
+            axis /= length;
+        }
+
+        float minProjection = 0.f;
+        float maxProjection = 0.f;
+
+        if (glm::length(axis) > 0.5f)
+        {
+            minProjection = FLT_MAX;
+            maxProjection = -FLT_MAX;
+
+            for (const glm::ivec4& texel : blockTexels)
+            {
+                float projection = glm::dot(glm::vec4(texel) - mean, axis);
+                minProjection = glm::min(minProjection, projection);
+                maxProjection = glm::max(maxProjection, projection);
+            }
+        }
+
+        glm::vec4 e0 = glm::clamp(mean + axis * minProjection, 0.f, 255.f);
+        glm::vec4 e1 = glm::clamp(mean + axis * maxProjection, 0.f, 255.f);
+
+        BC7Endpoints endpoints;
+        quantizeBC7Endpoint(e0, endpoints.quantized[0], endpoints.pBits[0]);
+        quantizeBC7Endpoint(e1, endpoints.quantized[1], endpoints.pBits[1]);
+
+        std::array<uint8_t, sBlockTexelCount> indices;
+        int32_t error = fitBC7Indices(blockTexels, endpoints, indices);
+
+        for (uint32_t iteration = 0; iteration < sBC7RefineIterations && error > 0; ++iteration)
+        {
+            if (!refitBC7Endpoints(blockTexels, indices, e0, e1))
+                break;
+
+            BC7Endpoints refitEndpoints;
+            quantizeBC7Endpoint(e0, refitEndpoints.quantized[0], refitEndpoints.pBits[0]);
+            quantizeBC7Endpoint(e1, refitEndpoints.quantized[1], refitEndpoints.pBits[1]);
+
+            std::array<uint8_t, sBlockTexelCount> refitIndices;
+            int32_t refitError = fitBC7Indices(blockTexels, refitEndpoints, refitIndices);
+
+            if (refitError >= error)
+                break;
+
+            endpoints = refitEndpoints;
+            indices = refitIndices;
+            error = refitError;
+        }
+
+        // the anchor index is stored without its top bit, it has to be below 8
+        if (indices.front() & 8)
+        {
+            std::swap(endpoints.quantized[0], endpoints.quantized[1]);
+            std::swap(endpoints.pBits[0], endpoints.pBits[1]);
+
+            for (uint8_t& index : indices)
+                index = 15 - index;
+        }
+
+        BitWriter writer(block, 16);
+        writer.write(1 << 6, 7);
+
+        for (int32_t channel = 0; channel < 4; ++channel)
+        {
+            writer.write(endpoints.quantized[0][channel], 7);
+            writer.write(endpoints.quantized[1][channel], 7);
+        }
+
+        writer.write(endpoints.pBits[0], 1);
+        writer.write(endpoints.pBits[1], 1);
+
+        writer.write(indices.front(), 3);
+        for (uint32_t i = 1; i < sBlockTexelCount; ++i)
+            writer.write(indices.at(i), 4);
+    }
+}
@@ -0,0 +1,58 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_TEXTURE_COOKER_HPP
+#define OPENGLRENDERINGENGINE_TEXTURE_COOKER_HPP
+
+#include "../opengl/texture.hpp"
+#include "mip_generator.hpp"
+
+// what a material samples a texture for, decides the block format
+enum class TextureUsage
+{
+    Color,
+    Normal,
+    Occlusion,
+    Data
+};
+
+// how color and data textures trade size for quality, normal and occlusion maps don't change
+enum class TextureQuality
+{
+    // BC7
+    High,
+    // BC1 for opaque textures, BC3 when there is alpha
+    Compact
+};
+
+// color textures hold sRGB encoded values and use the sRGB formats, sampling returns linear color
+
+// Turns RGBA8 images into block compressed mip chains ready for glCompressedTextureSubImage2D.
+// Color and packed data textures become BC7 (mode 6), or BC1/BC3 at compact quality, normal maps BC5
+// and occlusion BC4. Color textures get the sRGB variant of their format.
+// The mips come from the MipGenerator before encoding. Everything here is plain cpu work and
+// meant to run on the importer's worker threads.
+namespace TextureCooker
+{
+    TextureFormat compressedFormat(TextureUsage usage, TextureQuality quality, bool opaque);
+    // the format of an uncompressed 8 bit image of the given usage
+    TextureFormat uncompressedFormat(TextureUsage usage, TextureFormat imageFormat);
+
+    // true if every texel has full alpha
+    bool opaque(const uint8_t* rgba, int32_t width, int32_t height);
+
+    // sRGB for color, alpha coverage kept for color with an alpha cutoff
+    MipSettings mipSettings(TextureUsage usage, MipFilter filter, float alphaCutoff);
+
+    std::vector<TextureMip> cook(const uint8_t* rgba, int32_t width, int32_t height, TextureFormat format, const MipSettings& mipSettings);
+
+    // one 4x4 block of RGBA8 texels in, one block out
+    void encodeBC1Block(const uint8_t* texels, uint8_t* block);
+    void encodeBC3Block(const uint8_t* texels, uint8_t* block);
+    void encodeBC4Block(const uint8_t* texels, uint32_t channel, uint8_t* block);
+    void encodeBC5Block(const uint8_t* texels, uint8_t* block);
+    void encodeBC7Block(const uint8_t* texels, uint8_t* block);
+}
+
+#endif //OPENGLRENDERINGENGINE_TEXTURE_COOKER_HPP
@@ -0,0 +1,385 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "texture_streamer.hpp"
+
+static constexpr GLuint64 sRetireWaitTimeout = 1'000'000'000;
+
+// -- TextureStreamSource -- //
+
+uint32_t TextureStreamSource::levelCount() const
+{
+    if (container)
+        return container->levelCount();
+    return static_cast<uint32_t>(mips.size());
+}
+
+const uint8_t *TextureStreamSource::levelData(uint32_t level) const
+{
+    if (container)
+        return container->imageData(level, 0);
+    return mips.at(level).data.data();
+}
+
+size_t TextureStreamSource::levelSize(uint32_t level) const
+{
+    if (container)
+        return container->imageSize(level);
+    return mips.at(level).data.size();
+}
+
+TextureMip TextureStreamSource::readLevel(uint32_t level) const
+{
+    const uint8_t* data = levelData(level);
+
+    return {
+        .width = glm::max(specification.width >> level, 1),
+        .height = glm::max(specification.height >> level, 1),
+        .data = std::vector<uint8_t>(data, data + levelSize(level))
+    };
+}
+
+// -- TextureStreamer -- //
+
+TextureStreamer::TextureStreamer()
+    : mBudget(DefaultBudget)
+    , mUploadBudget(DefaultUploadBudget)
+    , mResidentBytes()
+    , mPendingBytes()
+    , mFrameIndex()
+    , mStats()
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    releaseRetired(true);
+}
+
+bool TextureStreamer::streamable(const TextureStreamSource &source)
+{
+    const TextureSpecification& specification = source.specification;
+
+    if (source.container && source.container->imageCount() != 1)
+        return false;
+
+    return source.levelCount() == calculateMipLevels(specification.width, specification.height) && tailLevel(specification) > 0;
+}
+
+uint32_t TextureStreamer::tailLevel(const TextureSpecification &specification)
+{
+    uint32_t level = 0;
+    while (glm::max(specification.width >> level, specification.height >> level) > MipTailSize)
+        ++level;
+    return level;
+}
+
+std::shared_ptr<Texture2D> TextureStreamer::createTexture(const TextureStreamSource &source, uint32_t firstLevel)
+{
+    auto texture = std::make_shared<Texture2D>(levelSpecification(source.specification, firstLevel));
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (uint32_t level = firstLevel; level < source.levelCount(); ++level)
+    {
+        texture->uploadMip(level - firstLevel,
+                           glm::max(source.specification.width >> level, 1),
+                           glm::max(source.specification.height >> level, 1),
+                           source.levelData(level),
+                           source.levelSize(level));
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    return texture;
+}
+
+void TextureStreamer::add(uuid64_t textureID, std::shared_ptr<TextureStreamSource> source, std::shared_ptr<Texture2D> texture)
+{
+    uint32_t tail = tailLevel(source->specification);
+
+    mTextures.emplace(textureID, StreamedTexture {
+        .source = std::move(source),
+        .texture = std::move(texture),
+        .tailLevel = tail,
+        .residentLevel = tail,
+        .wantedLevel = tail,
+        .lastRequestFrame = mFrameIndex
+    });
+}
+
+void TextureStreamer::remove(uuid64_t textureID)
+{
+    mTextures.erase(textureID);
+}
+
+bool TextureStreamer::streamed(uuid64_t textureID) const
+{
+    return mTextures.contains(textureID);
+}
+
+std::optional<std::pair<uint32_t, uint32_t>> TextureStreamer::residency(uuid64_t textureID) const
+{
+    auto itr = mTextures.find(textureID);
+
+    if (itr == mTextures.end())
+        return {};
+
+    return std::make_pair(itr->second.residentLevel, itr->second.source->levelCount());
+}
+
+void TextureStreamer::request(uuid64_t textureID, float screenSize)
+{
+    auto itr = mTextures.find(textureID);
+
+    if (itr == mTextures.end() || screenSize <= 0.f)
+        return;
+
+    StreamedTexture& texture = itr->second;
+    const TextureSpecification& specification = texture.source->specification;
+
+    // the level whose size is closest to the covered pixels from above
+    float textureSize = static_cast<float>(glm::max(specification.width, specification.height));
+    float level = glm::floor(glm::log2(textureSize / screenSize));
+    uint32_t wantedLevel = static_cast<uint32_t>(glm::clamp(level, 0.f, static_cast<float>(texture.tailLevel)));
+
+    texture.wantedLevel = glm::min(texture.wantedLevel, wantedLevel);
+    texture.lastRequestFrame = mFrameIndex;
+}
+
+std::vector<TextureStreamer::Swap> TextureStreamer::update()
+{
+    std::vector<Swap> swaps;
+
+    mStats.streamedLevels = 0;
+    mStats.evictedLevels = 0;
+    mStats.uploadedBytes = 0;
+
+    releaseRetired(false);
+
+    mResidentBytes = 0;
+    mPendingBytes = 0;
+    for (const auto& [textureID, texture] : mTextures)
+    {
+        mResidentBytes += residentSize(*texture.source, texture.residentLevel);
+
+        if (texture.pendingLoad)
+            mPendingBytes += texture.source->levelSize(texture.residentLevel - 1);
+    }
+
+    // the budget may have shrunk
+    makeRoom(0, nullptr, swaps);
+
+    // upload finished loads
+    for (auto& [textureID, texture] : mTextures)
+    {
+        if (!texture.pendingLoad || texture.pendingLoad->wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            continue;
+
+        uint64_t size = texture.source->levelSize(texture.residentLevel - 1);
+
+        if (mStats.uploadedBytes > 0 && mStats.uploadedBytes + size > mUploadBudget)
+            continue;
+
+        TextureMip mip = texture.pendingLoad->get();
+        texture.pendingLoad.reset();
+        mPendingBytes -= size;
+
+        // nobody asked for it this frame, or others took the room meanwhile
+        if (texture.wantedLevel >= texture.residentLevel || !makeRoom(size, &texture, swaps))
+            continue;
+
+        rebuild(textureID, texture, texture.residentLevel - 1, &mip, swaps);
+
+        mResidentBytes += size;
+        mStats.uploadedBytes += size;
+        ++mStats.streamedLevels;
+    }
+
+    // start loads, the textures missing the most levels first
+    std::vector<std::pair<uuid64_t, StreamedTexture*>> candidates;
+    uint32_t pendingLoadCount = 0;
+
+    for (auto& [textureID, texture] : mTextures)
+    {
+        if (texture.pendingLoad)
+            ++pendingLoadCount;
+        else if (texture.wantedLevel < texture.residentLevel)
+            candidates.emplace_back(textureID, &texture);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [] (const auto& a, const auto& b) {
+        return a.second->residentLevel - a.second->wantedLevel > b.second->residentLevel - b.second->wantedLevel;
+    });
+
+    for (auto& [textureID, texture] : candidates)
+    {
+        if (pendingLoadCount >= MaxPendingLoads)
+            break;
+
+        uint32_t level = texture->residentLevel - 1;
+        uint64_t size = texture->source->levelSize(level);
+
+        if (!makeRoom(size, texture, swaps))
+            continue;
+
+        texture->pendingLoad = std::async(std::launch::async, [source = texture->source, level] () {
+            return source->readLevel(level);
+        });
+
+        mPendingBytes += size;
+        ++pendingLoadCount;
+    }
+
+    // requests are per frame
+    mStats.fullBytes = 0;
+    for (auto& [textureID, texture] : mTextures)
+    {
+        texture.wantedLevel = texture.tailLevel;
+        mStats.fullBytes += residentSize(*texture.source, 0);
+    }
+
+    mStats.streamedTextureCount = static_cast<uint32_t>(mTextures.size());
+    mStats.pendingLoadCount = pendingLoadCount;
+    mStats.retiringTextureCount = static_cast<uint32_t>(mRetiredTextures.size());
+    mStats.residentBytes = mResidentBytes;
+
+    ++mFrameIndex;
+
+    return swaps;
+}
+
+void TextureStreamer::retire(std::shared_ptr<Texture2D> texture, gpu_tex_handle64_t handle)
+{
+    mRetiredTextures.push_back({
+        .texture = std::move(texture),
+        .handle = handle,
+        .fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)
+    });
+}
+
+void TextureStreamer::setBudget(uint64_t budget)
+{
+    mBudget = budget;
+}
+
+uint64_t TextureStreamer::budget() const
+{
+    return mBudget;
+}
+
+void TextureStreamer::setUploadBudget(uint64_t uploadBudget)
+{
+    mUploadBudget = uploadBudget;
+}
+
+uint64_t TextureStreamer::uploadBudget() const
+{
+    return mUploadBudget;
+}
+
+const TextureStreamer::Stats &TextureStreamer::stats() const
+{
+    return mStats;
+}
+
+TextureSpecification TextureStreamer::levelSpecification(const TextureSpecification &specification, uint32_t level)
+{
+    TextureSpecification levelSpecification = specification;
+    levelSpecification.width = glm::max(specification.width >> level, 1);
+    levelSpecification.height = glm::max(specification.height >> level, 1);
+    levelSpecification.generateMipMaps = calculateMipLevels(levelSpecification.width, levelSpecification.height) > 1;
+
+    return levelSpecification;
+}
+
+uint64_t TextureStreamer::residentSize(const TextureStreamSource &source, uint32_t level)
+{
+    uint64_t size = 0;
+    for (uint32_t i = level; i < source.levelCount(); ++i)
+        size += source.levelSize(i);
+    return size;
+}
+
+// the new view shares every level from max(level, residentLevel) down with the old one
+void TextureStreamer::rebuild(uuid64_t textureID, StreamedTexture &texture, uint32_t level, const TextureMip *mip, std::vector<Swap> &swaps)
+{
+    auto rebuiltTexture = std::make_shared<Texture2D>(levelSpecification(texture.source->specification, level));
+
+    uint32_t sharedLevel = glm::max(level, texture.residentLevel);
+    rebuiltTexture->copyMips(*texture.texture,
+                             sharedLevel - texture.residentLevel,
+                             sharedLevel - level,
+                             texture.source->levelCount() - sharedLevel);
+
+    if (mip)
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        rebuiltTexture->uploadMip(0, mip->width, mip->height, mip->data.data(), mip->data.size());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    texture.texture = rebuiltTexture;
+    texture.residentLevel = level;
+
+    // a view replaced within the same update never reaches the bindless table
+    auto itr = std::find_if(swaps.begin(), swaps.end(), [textureID] (const Swap& swap) {
+        return swap.textureID == textureID;
+    });
+
+    if (itr != swaps.end())
+        itr->texture = rebuiltTexture;
+    else
+        swaps.push_back({textureID, rebuiltTexture});
+}
+
+bool TextureStreamer::makeRoom(uint64_t bytes, const StreamedTexture* requester, std::vector<Swap> &swaps)
+{
+    while (mResidentBytes + mPendingBytes + bytes > mBudget)
+    {
+        uuid64_t victimID = 0;
+        StreamedTexture* victim = nullptr;
+
+        for (auto& [textureID, texture] : mTextures)
+        {
+            if (&texture == requester || texture.pendingLoad || texture.residentLevel >= texture.tailLevel)
+                continue;
+
+            // every resident level is still wanted this frame
+            if (texture.lastRequestFrame == mFrameIndex && texture.residentLevel >= texture.wantedLevel)
+                continue;
+
+            if (!victim || texture.lastRequestFrame < victim->lastRequestFrame)
+            {
+                victimID = textureID;
+                victim = &texture;
+            }
+        }
+
+        if (!victim)
+            return false;
+
+        uint64_t size = victim->source->levelSize(victim->residentLevel);
+        rebuild(victimID, *victim, victim->residentLevel + 1, nullptr, swaps);
+
+        mResidentBytes -= size;
+        ++mStats.evictedLevels;
+    }
+
+    return true;
+}
+
+void TextureStreamer::releaseRetired(bool wait)
+{
+    std::erase_if(mRetiredTextures, [wait] (const RetiredTexture& retiredTexture) {
+        GLenum status = glClientWaitSync(retiredTexture.fence, 0, wait? sRetireWaitTimeout : 0);
+
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            return false;
+
+        glMakeTextureHandleNonResidentARB(retiredTexture.handle);
+        glDeleteSync(retiredTexture.fence);
+        return true;
+    });
+}
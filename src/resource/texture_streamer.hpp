@@ -0,0 +1,136 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_TEXTURE_STREAMER_HPP
+#define OPENGLRENDERINGENGINE_TEXTURE_STREAMER_HPP
+
+#include <glad/glad.h>
+#include "../opengl/texture_container.hpp"
+#include "../app/types.hpp"
+
+// The full mip chain of a streamed texture. Cooked mips stay in memory, containers stay mapped
+struct TextureStreamSource
+{
+    TextureSpecification specification;
+    std::vector<TextureMip> mips;
+    std::shared_ptr<TextureContainer> container;
+
+    uint32_t levelCount() const;
+    const uint8_t* levelData(uint32_t level) const;
+    size_t levelSize(uint32_t level) const;
+    // a copy of one level, for the worker threads
+    TextureMip readLevel(uint32_t level) const;
+};
+
+// Keeps the textures it's given partially resident. A texture starts with only its mip tail, the
+// levels at or below MipTailSize, which never leave. Finer levels are requested every frame from
+// how many pixels the surfaces using the texture cover, read on worker threads and uploaded a few
+// per frame. Every change of the resident levels builds a new texture holding just those levels,
+// copies the levels it shares with the old one on the gpu and hands it back to be swapped into
+// the bindless table. The old one is freed once a fence says the gpu is done with it.
+// When the resident levels don't fit the budget, the finest levels of the textures that were
+// requested longest ago go first. Levels still wanted this frame are never evicted for others.
+class TextureStreamer
+{
+public:
+    static constexpr int32_t MipTailSize = 128;
+    static constexpr uint32_t MaxPendingLoads = 16;
+    static constexpr uint64_t DefaultBudget = 512ull << 20;
+    static constexpr uint64_t DefaultUploadBudget = 16ull << 20;
+
+    struct Swap
+    {
+        uuid64_t textureID;
+        std::shared_ptr<Texture2D> texture;
+    };
+
+    struct Stats
+    {
+        uint32_t streamedTextureCount;
+        uint32_t pendingLoadCount;
+        uint32_t retiringTextureCount;
+        uint64_t residentBytes;
+        uint64_t fullBytes;
+        // this frame
+        uint32_t streamedLevels;
+        uint32_t evictedLevels;
+        uint64_t uploadedBytes;
+    };
+
+public:
+    TextureStreamer();
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // a full chain bigger than the tail, with a single image
+    static bool streamable(const TextureStreamSource& source);
+    static uint32_t tailLevel(const TextureSpecification& specification);
+    // the texture holding levels [firstLevel, levelCount) of the source
+    static std::shared_ptr<Texture2D> createTexture(const TextureStreamSource& source, uint32_t firstLevel);
+
+    // texture holds the source's tail, as made by createTexture
+    void add(uuid64_t textureID, std::shared_ptr<TextureStreamSource> source, std::shared_ptr<Texture2D> texture);
+    void remove(uuid64_t textureID);
+    bool streamed(uuid64_t textureID) const;
+    // finest resident level and level count, for the editor
+    std::optional<std::pair<uint32_t, uint32_t>> residency(uuid64_t textureID) const;
+
+    // a surface sampling the texture covers about screenSize pixels across
+    void request(uuid64_t textureID, float screenSize);
+
+    // uploads finished loads, evicts, starts new loads. Returns the textures whose view changed,
+    // the caller swaps them in and hands the old views to retire()
+    std::vector<Swap> update();
+    void retire(std::shared_ptr<Texture2D> texture, gpu_tex_handle64_t handle);
+
+    void setBudget(uint64_t budget);
+    uint64_t budget() const;
+    // bytes uploaded per frame, the first finished load always goes through
+    void setUploadBudget(uint64_t uploadBudget);
+    uint64_t uploadBudget() const;
+
+    const Stats& stats() const;
+
+private:
+    struct StreamedTexture
+    {
+        std::shared_ptr<TextureStreamSource> source;
+        std::shared_ptr<Texture2D> texture;
+        uint32_t tailLevel;
+        uint32_t residentLevel;
+        // finest level requested since the last update, the tail if none
+        uint32_t wantedLevel;
+        uint64_t lastRequestFrame;
+        std::optional<std::future<TextureMip>> pendingLoad;
+    };
+
+    struct RetiredTexture
+    {
+        std::shared_ptr<Texture2D> texture;
+        gpu_tex_handle64_t handle;
+        GLsync fence;
+    };
+
+    static TextureSpecification levelSpecification(const TextureSpecification& specification, uint32_t level);
+    static uint64_t residentSize(const TextureStreamSource& source, uint32_t level);
+
+    void rebuild(uuid64_t textureID, StreamedTexture& texture, uint32_t level, const TextureMip* mip, std::vector<Swap>& swaps);
+    bool makeRoom(uint64_t bytes, const StreamedTexture* requester, std::vector<Swap>& swaps);
+    void releaseRetired(bool wait);
+
+private:
+    std::unordered_map<uuid64_t, StreamedTexture> mTextures;
+    std::vector<RetiredTexture> mRetiredTextures;
+
+    uint64_t mBudget;
+    uint64_t mUploadBudget;
+    uint64_t mResidentBytes;
+    uint64_t mPendingBytes;
+    uint64_t mFrameIndex;
+    Stats mStats;
+};
+
+#endif //OPENGLRENDERINGENGINE_TEXTURE_STREAMER_HPP
@@ -0,0 +1,160 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#include "light_node.hpp"
+#include "../renderer/light_arena.hpp"
+
+static LightType lightType(NodeType nodeType)
+{
+    switch (nodeType)
+    {
+        case NodeType::DirectionalLight: return LightType::Directional;
+        case NodeType::PointLight: return LightType::Point;
+        case NodeType::SpotLight: return LightType::Spot;
+        default: return LightType::None;
+    }
+}
+
+LightNode::LightNode(NodeType type, const std::string& name, const glm::mat4& transformation, SceneNode* parent)
+    : SceneNode(type, name, transformation, parent)
+    , mColor(1.f)
+    , mIntensity(1.f)
+    , mRange(10.f)
+    , mInnerConeAngle(glm::radians(20.f))
+    , mOuterConeAngle(glm::radians(30.f))
+    , mShadowImportance(1.f)
+    , mLightSlot(LightArena::instance().allocate())
+{
+    check(lightType(type) != LightType::None, "Light nodes need a light node type.");
+}
+
+LightNode::~LightNode()
+{
+    LightArena::instance().free(mLightSlot);
+}
+
+void *LightNode::operator new(size_t size)
+{
+    if (size == sizeof(LightNode))
+        return ObjectPool<LightNode>::instance().allocate();
+    return ::operator new(size);
+}
+
+void LightNode::operator delete(void *ptr, size_t size)
+{
+    if (size == sizeof(LightNode))
+        ObjectPool<LightNode>::instance().deallocate(ptr);
+    else
+        ::operator delete(ptr);
+}
+
+void LightNode::reserve(size_t nodeCount)
+{
+    ObjectPool<LightNode>::instance().reserve(nodeCount);
+}
+
+void LightNode::updateGlobalTransform()
+{
+    if (mDirty)
+    {
+        if (mParent)
+        {
+            mGlobalTransform = mParent->globalTransform() * mLocalTransform;
+        }
+        else
+        {
+            mGlobalTransform = mLocalTransform;
+        }
+
+        mDirty = false;
+
+        updateLight();
+    }
+
+    for (auto child : mChildren)
+        child->updateGlobalTransform();
+}
+
+void LightNode::setColor(const glm::vec3 &color)
+{
+    mColor = color;
+    updateLight();
+}
+
+void LightNode::setIntensity(float intensity)
+{
+    mIntensity = intensity;
+    updateLight();
+}
+
+void LightNode::setRange(float range)
+{
+    mRange = range;
+    updateLight();
+}
+
+void LightNode::setConeAngles(float innerAngle, float outerAngle)
+{
+    mOuterConeAngle = glm::clamp(outerAngle, 0.f, glm::half_pi<float>());
+    mInnerConeAngle = glm::clamp(innerAngle, 0.f, mOuterConeAngle);
+    updateLight();
+}
+
+void LightNode::setShadowImportance(float shadowImportance)
+{
+    mShadowImportance = glm::max(shadowImportance, 0.f);
+    updateLight();
+}
+
+const glm::vec3 &LightNode::color() const
+{
+    return mColor;
+}
+
+float LightNode::intensity() const
+{
+    return mIntensity;
+}
+
+float LightNode::range() const
+{
+    return mRange;
+}
+
+float LightNode::innerConeAngle() const
+{
+    return mInnerConeAngle;
+}
+
+float LightNode::outerConeAngle() const
+{
+    return mOuterConeAngle;
+}
+
+float LightNode::shadowImportance() const
+{
+    return mShadowImportance;
+}
+
+uint32_t LightNode::lightSlot() const
+{
+    return mLightSlot;
+}
+
+void LightNode::updateLight()
+{
+    LightData light {
+        .position = glm::vec3(mGlobalTransform[3]),
+        .range = mRange,
+        .color = mColor,
+        .intensity = mIntensity,
+        .direction = glm::normalize(-glm::vec3(mGlobalTransform[2])),
+        .type = lightType(mType),
+        .innerConeCos = glm::cos(mInnerConeAngle),
+        .outerConeCos = glm::cos(mOuterConeAngle),
+        .shadowImportance = mShadowImportance
+    };
+
+    LightArena::instance().update(mLightSlot, light);
+}
@@ -0,0 +1,55 @@
+//
+// Created by Gianni on 6/02/2025.
+//
+
+#ifndef OPENGLRENDERINGENGINE_LIGHT_NODE_HPP
+#define OPENGLRENDERINGENGINE_LIGHT_NODE_HPP
+
+#include "scene_node.hpp"
+#include "../renderer/light.hpp"
+
+// Directional, point or spot light, depending on the node type. The light sits at the node's
+// origin and points down its -Z axis. Every light node owns a LightArena slot that follows
+// its transform and parameters.
+class LightNode : public SceneNode
+{
+public:
+    LightNode(NodeType type, const std::string& name, const glm::mat4& transformation, SceneNode* parent);
+    ~LightNode();
+
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+    static void reserve(size_t nodeCount);
+
+    void updateGlobalTransform() override;
+
+    void setColor(const glm::vec3& color);
+    void setIntensity(float intensity);
+    void setRange(float range);
+    // half angles in radians, inner <= outer
+    void setConeAngles(float innerAngle, float outerAngle);
+    // weight of the light when the shadow atlas is shared out, 0 disables its shadow
+    void setShadowImportance(float shadowImportance);
+
+    const glm::vec3& color() const;
+    float intensity() const;
+    float range() const;
+    float innerConeAngle() const;
+    float outerConeAngle() const;
+    float shadowImportance() const;
+    uint32_t lightSlot() const;
+
+private:
+    void updateLight();
+
+private:
+    glm::vec3 mColor;
+    float mIntensity;
+    float mRange;
+    float mInnerConeAngle;
+    float mOuterConeAngle;
+    float mShadowImportance;
+    uint32_t mLightSlot;
+};
+
+#endif //OPENGLRENDERINGENGINE_LIGHT_NODE_HPP
@@ -31,6 +31,26 @@ MeshNode::~MeshNode()
     SNS::publishMessage(Topic::Type::SceneGraph, Message::create<Message::RemoveMeshInstance>(mMeshID, mInstanceID));
 }
 
+void *MeshNode::operator new(size_t size)
+{
+    if (size == sizeof(MeshNode))
+        return ObjectPool<MeshNode>::instance().allocate();
+    return ::operator new(size);
+}
+
+void MeshNode::operator delete(void *ptr, size_t size)
+{
+    if (size == sizeof(MeshNode))
+        ObjectPool<MeshNode>::instance().deallocate(ptr);
+    else
+        ::operator delete(ptr);
+}
+
+void MeshNode::reserve(size_t nodeCount)
+{
+    ObjectPool<MeshNode>::instance().reserve(nodeCount);
+}
+
 void MeshNode::notify(const Message &message)
 {
     if (const auto m = message.getIf<Message::MaterialDeleted>())
@@ -44,7 +64,7 @@ void MeshNode::notify(const Message &message)
 
     if (const auto m = message.getIf<Message::MaterialRemap>())
     {
-        if (!mModifiedMaterial && mMatName == m->matName)
+        if (!mModifiedMaterial && mMatName.str() == m->matName)
         {
             mMatIndex = m->newMatIndex;
             SNS::publishMessage(Topic::Type::SceneGraph, Message::create<Message::MeshInstanceUpdate>(mMeshID, mID, mInstanceID, mMatIndex, mGlobalTransform));
@@ -15,6 +15,10 @@ public:
              uuid64_t meshID, uint32_t instanceID, index_t materialIndex, const std::string& matName);
     ~MeshNode();
 
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+    static void reserve(size_t nodeCount);
+
     void notify(const Message &message) override;
     void updateGlobalTransform() override;
 
@@ -25,8 +29,11 @@ private:
     uuid64_t mMeshID;
     uint32_t mInstanceID;
     index_t mMatIndex;
-    std::string mMatName;
+    InternedString mMatName;
     bool mModifiedMaterial;
+
+private:
+    friend class SceneGraph;
 };
 
 #endif //OPENGLRENDERINGENGINE_MESH_NODE_HPP
@@ -3,41 +3,263 @@
 //
 
 #include "scene_graph.hpp"
+#include "../resource/resource_manager.hpp"
 
-SceneGraph::SceneGraph()
-    : mRoot(NodeType::Empty, "RootNode", glm::identity<glm::mat4>(), nullptr)
+static void countMeshNodesRecursive(const Model::Node& node, std::unordered_map<uuid64_t, uint32_t>& meshNodeCounts)
+{
+    if (node.meshID)
+        ++meshNodeCounts[*node.meshID];
+
+    for (const auto& child : node.children)
+        countMeshNodesRecursive(child, meshNodeCounts);
+}
+
+SceneGraph::SceneGraph(std::shared_ptr<ResourceManager> resourceManager)
+    : SubscriberSNS({Topic::Type::SceneGraph, Topic::Type::Resources})
+    , mRoot(NodeType::Empty, "RootNode", glm::identity<glm::mat4>(), nullptr)
+    , mResourceManager(resourceManager)
 {
 }
 
+SceneGraph::~SceneGraph()
+{
+    // the nodes are destroyed after the BVH and still publish their removal
+    unsubscribe(Topic::Type::SceneGraph);
+}
+
 void SceneGraph::updateTransforms()
 {
     mRoot.updateGlobalTransform();
+
+    if (mBVH.needsRebuild())
+        mBVH.rebuild();
 }
 
 void SceneGraph::notify(const Message &message)
 {
+    if (const auto m = message.getIf<Message::MeshInstanceUpdate>())
+    {
+        auto itr = mInstanceIdToProxyMap.find(m->instanceID);
+
+        if (itr != mInstanceIdToProxyMap.end())
+            mBVH.update(itr->second, mResourceManager->getMesh(m->meshID)->boundingBox().transform(m->transformation));
+    }
+
+    if (const auto m = message.getIf<Message::RemoveMeshInstance>())
+    {
+        auto itr = mInstanceIdToProxyMap.find(m->instanceID);
+
+        if (itr != mInstanceIdToProxyMap.end())
+        {
+            mBVH.remove(itr->second);
+            mInstanceIdToProxyMap.erase(itr);
+        }
+    }
+
+    // arrives before the meshes are erased, deleting a mesh node removes its instance from the mesh
     if (const auto& m = message.getIf<Message::ModelDeleted>())
     {
         std::vector<SceneNode*> stack(1, &mRoot);
+        std::vector<MeshNode*> deletedNodes;
 
         while (!stack.empty())
         {
             SceneNode* node = stack.back();
             stack.pop_back();
 
-            if (node->type() == NodeType::Mesh)
+            // a deleted node takes its subtree with it
+            if (node->type() == NodeType::Mesh && m->meshIDs.contains(dynamic_cast<MeshNode*>(node)->meshID()))
             {
-                MeshNode* meshNode = dynamic_cast<MeshNode*>(node);
-
-                if (m->meshIDs.contains(meshNode->meshID()))
-                {
-                    meshNode->orphan();
-                    delete meshNode;
-                }
+                deletedNodes.push_back(dynamic_cast<MeshNode*>(node));
+                continue;
             }
 
             for (auto child : node->children())
                 stack.push_back(child);
         }
+
+        for (MeshNode* meshNode : deletedNodes)
+        {
+            meshNode->orphan();
+            delete meshNode;
+        }
+    }
+}
+
+std::vector<SceneNode*> SceneGraph::instantiate(const Model &model, SceneNode *parent, const std::vector<glm::mat4> &transforms)
+{
+    std::vector<SceneNode*> instanceRoots;
+    uint32_t copyCount = static_cast<uint32_t>(transforms.size());
+
+    if (!copyCount)
+        return instanceRoots;
+
+    // size everything for all copies up front
+    std::unordered_map<uuid64_t, uint32_t> meshNodeCounts;
+    countMeshNodesRecursive(model.root, meshNodeCounts);
+
+    uint32_t meshNodeCount = getModelMeshNodeCount(model);
+    SceneNode::reserve((getModelNodeCount(model) - meshNodeCount) * copyCount);
+    MeshNode::reserve(meshNodeCount * copyCount);
+
+    std::unordered_map<uuid64_t, PendingInstances> pendingInstances;
+    for (const auto& [meshID, count] : meshNodeCounts)
+    {
+        PendingInstances& pending = pendingInstances[meshID];
+        pending.nodes.reserve(count * copyCount);
+        pending.instances.reserve(count * copyCount);
+
+        std::shared_ptr<InstancedMesh> mesh = mResourceManager->getMesh(meshID);
+        mesh->reserve(mesh->instanceCount() + count * copyCount);
+    }
+
+    // build the node subtrees, collecting the instance records per mesh
+    instanceRoots.reserve(copyCount);
+    for (const glm::mat4& transform : transforms)
+    {
+        SceneNode* instanceRoot = createNodeHierarchy(model, model.root, parent, transform * model.root.transformation, pendingInstances);
+        parent->addChild(instanceRoot);
+        instanceRoots.push_back(instanceRoot);
+    }
+
+    // one upload per mesh
+    for (auto& [meshID, pending] : pendingInstances)
+    {
+        std::shared_ptr<InstancedMesh> mesh = mResourceManager->getMesh(meshID);
+        std::vector<uint32_t> instanceIDs = mesh->addInstances(std::move(pending.instances));
+
+        for (size_t i = 0; i < instanceIDs.size(); ++i)
+        {
+            MeshNode* meshNode = pending.nodes.at(i);
+            meshNode->mInstanceID = instanceIDs.at(i);
+
+            BoundingBox bounds = mesh->boundingBox().transform(meshNode->globalTransform());
+            mInstanceIdToProxyMap.emplace(meshNode->mInstanceID, mBVH.insert(bounds, meshNode->id()));
+        }
+    }
+
+    // a big batch of incremental inserts is worse than a fresh SAH build
+    if (mBVH.needsRebuild())
+        mBVH.rebuild();
+
+    return instanceRoots;
+}
+
+LightNode *SceneGraph::addLight(NodeType type, SceneNode *parent, const glm::mat4 &transform)
+{
+    static const std::unordered_map<NodeType, std::string> sLightNames {
+        {NodeType::DirectionalLight, "Directional Light"},
+        {NodeType::PointLight, "Point Light"},
+        {NodeType::SpotLight, "Spot Light"}
+    };
+
+    LightNode* lightNode = new LightNode(type, sLightNames.at(type), transform, parent);
+    parent->addChild(lightNode);
+
+    return lightNode;
+}
+
+SceneNode *SceneGraph::scatterPointLights(uint32_t count, const BoundingBox &bounds, float range)
+{
+    std::mt19937 rng(count);
+    std::uniform_real_distribution<float> x(bounds.min.x, bounds.max.x);
+    std::uniform_real_distribution<float> y(bounds.min.y, bounds.max.y);
+    std::uniform_real_distribution<float> z(bounds.min.z, bounds.max.z);
+    std::uniform_real_distribution<float> hue(0.f, 6.f);
+
+    SceneNode* group = new SceneNode(NodeType::Empty, std::format("Point Lights ({})", count), glm::identity<glm::mat4>(), &mRoot);
+    mRoot.addChild(group);
+
+    LightNode::reserve(count);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        LightNode* lightNode = addLight(NodeType::PointLight, group, glm::translate(glm::identity<glm::mat4>(), glm::vec3(x(rng), y(rng), z(rng))));
+
+        float h = hue(rng);
+        glm::vec3 color = glm::clamp(glm::vec3(glm::abs(h - 3.f) - 1.f, 2.f - glm::abs(h - 2.f), 2.f - glm::abs(h - 4.f)), 0.f, 1.f);
+
+        // fill lights for the clustering, they don't compete for the shadow atlas
+        lightNode->setColor(color);
+        lightNode->setRange(range);
+        lightNode->setShadowImportance(0.f);
+    }
+
+    return group;
+}
+
+SceneNode *SceneGraph::findNode(uuid64_t id)
+{
+    std::vector<SceneNode*> stack(1, &mRoot);
+
+    while (!stack.empty())
+    {
+        SceneNode* node = stack.back();
+        stack.pop_back();
+
+        if (node->id() == id)
+            return node;
+
+        for (auto child : node->children())
+            stack.push_back(child);
+    }
+
+    return nullptr;
+}
+
+const BVH &SceneGraph::bvh() const
+{
+    return mBVH;
+}
+
+SceneNode *SceneGraph::createNodeHierarchy(const Model &model,
+                                           const Model::Node &modelNode,
+                                           SceneNode *parent,
+                                           const glm::mat4& localTransform,
+                                           std::unordered_map<uuid64_t, PendingInstances>& pendingInstances)
+{
+    static const std::string sNoMaterialName;
+
+    SceneNode* sceneNode;
+
+    if (auto meshID = modelNode.meshID)
+    {
+        index_t materialIndex = 0;
+
+        if (auto materialID = model.getMaterialID(modelNode))
+            materialIndex = mResourceManager->getMatIndex(*materialID);
+
+        const std::string& matName = modelNode.materialName? *modelNode.materialName : sNoMaterialName;
+
+        // the instance ID is assigned once the instances of this mesh get uploaded
+        MeshNode* meshNode = new MeshNode(NodeType::Mesh,
+                                          modelNode.name,
+                                          localTransform,
+                                          parent,
+                                          *meshID,
+                                          0,
+                                          materialIndex,
+                                          matName);
+
+        PendingInstances& pending = pendingInstances.at(*meshID);
+        pending.nodes.push_back(meshNode);
+        pending.instances.push_back(InstancedMesh::makeInstanceData(parent->globalTransform() * localTransform,
+                                                                    static_cast<uint32_t>(meshNode->id()),
+                                                                    materialIndex));
+        sceneNode = meshNode;
     }
+    else
+    {
+        sceneNode = new SceneNode(NodeType::Empty, modelNode.name, localTransform, parent);
+    }
+
+    // the instance data is written with the final transform, so the node doesn't need
+    // to publish an update unless its parent is still waiting for one
+    sceneNode->mGlobalTransform = parent->globalTransform() * localTransform;
+    sceneNode->mDirty = parent->mDirty;
+
+    for (const auto& child : modelNode.children)
+        sceneNode->addChild(createNodeHierarchy(model, child, sceneNode, child.transformation, pendingInstances));
+
+    return sceneNode;
 }
@@ -6,18 +6,57 @@
 #define OPENGLRENDERINGENGINE_SCENE_GRAPH_HPP
 
 #include "../app/simple_notification_service.hpp"
+#include "../renderer/model.hpp"
+#include "../renderer/bvh.hpp"
 #include "mesh_node.hpp"
+#include "light_node.hpp"
+
+class ResourceManager;
 
 class SceneGraph : public SubscriberSNS
 {
 public:
-    SceneGraph();
+    SceneGraph(std::shared_ptr<ResourceManager> resourceManager);
+    ~SceneGraph();
 
     void updateTransforms();
     void notify(const Message &message) override;
 
+    // places one copy of the model under parent for every transform and returns the copies' root nodes
+    std::vector<SceneNode*> instantiate(const Model& model, SceneNode* parent, const std::vector<glm::mat4>& transforms);
+
+    // type is one of the light node types
+    LightNode* addLight(NodeType type, SceneNode* parent, const glm::mat4& transform);
+
+    // count point lights of random colors spread over bounds, grouped under a new node below the root
+    SceneNode* scatterPointLights(uint32_t count, const BoundingBox& bounds, float range);
+
+    SceneNode* findNode(uuid64_t id);
+
+    // world space bounds of every mesh instance, the proxies hold the mesh node IDs
+    const BVH& bvh() const;
+
+private:
+    struct PendingInstances
+    {
+        std::vector<MeshNode*> nodes;
+        std::vector<InstancedMesh::InstanceData> instances;
+    };
+
+    SceneNode* createNodeHierarchy(const Model& model,
+                                   const Model::Node& modelNode,
+                                   SceneNode* parent,
+                                   const glm::mat4& localTransform,
+                                   std::unordered_map<uuid64_t, PendingInstances>& pendingInstances);
+
 public:
     SceneNode mRoot;
+
+private:
+    std::shared_ptr<ResourceManager> mResourceManager;
+
+    BVH mBVH;
+    std::unordered_map<uint32_t, uint32_t> mInstanceIdToProxyMap;
 };
 
 #endif //OPENGLRENDERINGENGINE_SCENE_GRAPH_HPP
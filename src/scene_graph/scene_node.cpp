@@ -32,6 +32,27 @@ SceneNode::~SceneNode()
         delete node;
 }
 
+void *SceneNode::operator new(size_t size)
+{
+    // derived nodes without their own pool end up here with a different size
+    if (size == sizeof(SceneNode))
+        return ObjectPool<SceneNode>::instance().allocate();
+    return ::operator new(size);
+}
+
+void SceneNode::operator delete(void *ptr, size_t size)
+{
+    if (size == sizeof(SceneNode))
+        ObjectPool<SceneNode>::instance().deallocate(ptr);
+    else
+        ::operator delete(ptr);
+}
+
+void SceneNode::reserve(size_t nodeCount)
+{
+    ObjectPool<SceneNode>::instance().reserve(nodeCount);
+}
+
 void SceneNode::setParent(SceneNode *parent)
 {
     mParent = parent;
@@ -73,10 +94,10 @@ NodeType SceneNode::type() const
 
 const std::string &SceneNode::name() const
 {
-    return mName;
+    return mName.str();
 }
 
-const std::multiset<SceneNode*>& SceneNode::children() const
+const SceneNodeChildren& SceneNode::children() const
 {
     return mChildren;
 }
@@ -99,7 +120,7 @@ void SceneNode::setLocalTransform(const glm::mat4 &transform)
 
 bool SceneNode::operator<(const SceneNode* other) const
 {
-    return std::less<std::string>()(mName, other->mName);
+    return std::less<std::string>()(mName.str(), other->mName.str());
 }
 
 void SceneNode::updateGlobalTransform()
@@ -9,6 +9,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include "../app/uuid_registry.hpp"
 #include "../app/simple_notification_service.hpp"
+#include "../app/pool_allocator.hpp"
+#include "../app/interned_string.hpp"
 #include "../renderer/instanced_mesh.hpp"
 #include "../utils.hpp"
 
@@ -21,6 +23,9 @@ enum class NodeType
     SpotLight
 };
 
+class SceneNode;
+using SceneNodeChildren = std::multiset<SceneNode*, std::less<SceneNode*>, PoolAllocator<SceneNode*>>;
+
 class SceneNode : public SubscriberSNS
 {
 public:
@@ -28,6 +33,10 @@ public:
     SceneNode(NodeType type, const std::string& name, const glm::mat4& transformation, SceneNode* parent);
     virtual ~SceneNode();
 
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+    static void reserve(size_t nodeCount);
+
     void setParent(SceneNode* parent);
     void addChild(SceneNode* child);
     void removeChild(SceneNode* child);
@@ -37,7 +46,7 @@ public:
     uuid64_t id() const;
     NodeType type() const;
     const std::string& name() const;
-    const std::multiset<SceneNode*>& children() const;
+    const SceneNodeChildren& children() const;
 
     const glm::mat4& localTransform() const;
     const glm::mat4& globalTransform();
@@ -49,13 +58,16 @@ public:
 protected:
     uuid64_t mID;
     NodeType mType;
-    std::string mName;
+    InternedString mName;
     glm::mat4 mLocalTransform;
     glm::mat4 mGlobalTransform;
     bool mDirty;
 
     SceneNode* mParent;
-    std::multiset<SceneNode*> mChildren;
+    SceneNodeChildren mChildren;
+
+private:
+    friend class SceneGraph;
 };
 
 #endif //OPENGLRENDERINGENGINE_SCENE_NODE_HPP
@@ -4,9 +4,40 @@
 
 #include "utils.hpp"
 
-void debugLog(const std::string& logMSG)
+static std::mutex sLogMutex;
+static std::deque<LogEntry> sLogHistory;
+
+static const char* logPrefix(LogSeverity severity)
+{
+    switch (severity)
+    {
+        case LogSeverity::Warning: return "[Warning] ";
+        case LogSeverity::Error: return "[Error] ";
+        default: return "[Debug Log] ";
+    }
+}
+
+void debugLog(const std::string& logMSG, LogSeverity severity)
+{
+    std::lock_guard<std::mutex> lock(sLogMutex);
+
+    std::cout << logPrefix(severity) << logMSG << std::endl;
+
+    sLogHistory.push_back({logMSG, severity});
+    if (sLogHistory.size() > LogHistorySize)
+        sLogHistory.pop_front();
+}
+
+std::vector<LogEntry> logHistory()
+{
+    std::lock_guard<std::mutex> lock(sLogMutex);
+    return {sLogHistory.begin(), sLogHistory.end()};
+}
+
+void clearLogHistory()
 {
-    std::cout << "[Debug Log] " << logMSG << std::endl;
+    std::lock_guard<std::mutex> lock(sLogMutex);
+    sLogHistory.clear();
 }
 
 void check(bool result, const char* msg, std::source_location location)
@@ -46,22 +77,150 @@ std::string fileExtension(const std::filesystem::path& path)
     return extension;
 }
 
-void MainThreadTaskQueue::push(Task &&task)
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= FNVPrime;
+    }
+
+    return hash;
+}
+
+uint64_t hashFile(const std::filesystem::path& path)
 {
-    std::lock_guard<std::mutex> lock(mTaskQueueMutex);
-    mTaskQueue.push_back(std::move(task));
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file)
+        return 0;
+
+    std::vector<char> buffer(1 << 16);
+    uint64_t hash = FNVOffsetBasis;
+
+    while (file)
+    {
+        file.read(buffer.data(), buffer.size());
+        hash = hashBytes(buffer.data(), static_cast<size_t>(file.gcount()), hash);
+    }
+
+    return hash;
 }
 
-std::optional<Task> MainThreadTaskQueue::pop()
+// weight of the latest task when updating the cost scale, and how far the scale can go
+static constexpr float sCostScaleRate = 0.1f;
+static constexpr float sMinCostScale = 0.25f;
+static constexpr float sMaxCostScale = 8.f;
+
+MainThreadTaskQueue::MainThreadTaskQueue()
+    : mQueued()
+    , mRan()
+    , mElapsedMs()
+    , mCostScale(1.f)
 {
-    std::lock_guard<std::mutex> lock(mTaskQueueMutex);
+    for (Channel& channel : mChannels)
+    {
+        Node* stub = new Node {nullptr, {}, 0.f};
+        channel.head = stub;
+        channel.tail = stub;
+    }
+}
 
-    if (!mTaskQueue.empty())
+MainThreadTaskQueue::~MainThreadTaskQueue()
+{
+    for (Channel& channel : mChannels)
     {
-        Task task = std::move(mTaskQueue.front());
-        mTaskQueue.pop_front();
-        return task;
+        Node* node = channel.tail;
+        while (node)
+        {
+            Node* next = node->next.load(std::memory_order_relaxed);
+            delete node;
+            node = next;
+        }
     }
+}
+
+void MainThreadTaskQueue::push(Task &&task, TaskPriority priority, float costMs)
+{
+    Node* node = new Node {nullptr, std::move(task), costMs};
+    Channel& channel = mChannels.at(static_cast<uint32_t>(priority));
+
+    Node* previous = channel.head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+
+    mQueued.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t MainThreadTaskQueue::process(float budgetMs)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [start] () {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    mRan = 0;
+
+    uint32_t priority;
+    while (Node* node = front(priority))
+    {
+        float elapsed = elapsedMs();
+        if (mRan > 0 && elapsed + node->costMs * mCostScale > budgetMs)
+            break;
+
+        node->task();
+        ++mRan;
+
+        // tasks estimated at nothing say nothing about the estimates
+        float taskMs = elapsedMs() - elapsed;
+        if (node->costMs > 0.f)
+        {
+            float scale = std::clamp(taskMs / node->costMs, sMinCostScale, sMaxCostScale);
+            mCostScale += (scale - mCostScale) * sCostScaleRate;
+        }
+
+        popFront(priority);
+    }
+
+    mElapsedMs = elapsedMs();
+
+    return mRan;
+}
+
+bool MainThreadTaskQueue::empty() const
+{
+    return mQueued.load(std::memory_order_relaxed) == 0;
+}
+
+MainThreadTaskQueue::Stats MainThreadTaskQueue::stats() const
+{
+    return {
+        .queued = mQueued.load(std::memory_order_relaxed),
+        .ran = mRan,
+        .elapsedMs = mElapsedMs,
+        .costScale = mCostScale
+    };
+}
+
+MainThreadTaskQueue::Node *MainThreadTaskQueue::front(uint32_t& priority)
+{
+    for (priority = 0; priority < PriorityCount; ++priority)
+        if (Node* next = mChannels.at(priority).tail->next.load(std::memory_order_acquire))
+            return next;
+
+    return nullptr;
+}
+
+// the front node becomes the new stub, its task already ran
+void MainThreadTaskQueue::popFront(uint32_t priority)
+{
+    Channel& channel = mChannels.at(priority);
+    Node* next = channel.tail->next.load(std::memory_order_acquire);
+
+    delete channel.tail;
+    channel.tail = next;
+    channel.tail->task = nullptr;
 
-    return std::nullopt;
+    mQueued.fetch_sub(1, std::memory_order_relaxed);
 }
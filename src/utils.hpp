@@ -11,7 +11,30 @@
 
 using Task = std::function<void()>;
 
-void debugLog(const std::string& logMSG);
+inline constexpr uint64_t FNVOffsetBasis = 14695981039346656037ull;
+inline constexpr uint64_t FNVPrime = 1099511628211ull;
+
+inline constexpr size_t LogHistorySize = 512;
+
+enum class LogSeverity
+{
+    Info,
+    Warning,
+    Error
+};
+
+struct LogEntry
+{
+    std::string message;
+    LogSeverity severity;
+};
+
+// prints the message and keeps it in the log history, any thread
+void debugLog(const std::string& logMSG, LogSeverity severity = LogSeverity::Info);
+
+// the last LogHistorySize messages, oldest first
+std::vector<LogEntry> logHistory();
+void clearLogHistory();
 
 void check(bool result, const char* msg, std::source_location location = std::source_location::current());
 
@@ -19,15 +42,97 @@ std::filesystem::path fileDialog();
 
 std::string fileExtension(const std::filesystem::path& path);
 
+// 64 bit FNV-1a, pass the previous result as hash to continue it
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash = FNVOffsetBasis);
+
+// hashBytes over the characters, usable in constant expressions
+constexpr uint64_t hashString(std::string_view string, uint64_t hash = FNVOffsetBasis)
+{
+    for (char c : string)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= FNVPrime;
+    }
+
+    return hash;
+}
+
+// hash of the file's bytes, 0 if it can't be read
+uint64_t hashFile(const std::filesystem::path& path);
+
+enum class TaskPriority
+{
+    High,
+    Normal,
+    Low
+};
+
+// Work handed to the main thread by the importer's workers. Producers push from any thread
+// without locking, each priority is its own intrusive MPSC list (Vyukov's): a push swaps the new
+// node in as the head and links the old head to it, the consumer follows the links from a stub.
+// A push that swapped the head but hasn't linked yet hides itself and what follows for a frame.
+// The consumer runs tasks within a time budget using the producer's cost estimate, scaled by how
+// far the estimates have been off so far, and leaves the rest for the next call.
 class MainThreadTaskQueue
 {
 public:
-    void push(Task&& task);
-    std::optional<Task> pop();
+    static constexpr uint32_t PriorityCount = 3;
+    static constexpr float DefaultTaskCost = 0.1f;
+
+    struct Stats
+    {
+        uint32_t queued;
+        // last process call
+        uint32_t ran;
+        float elapsedMs;
+        // measured over estimated cost
+        float costScale;
+    };
+
+public:
+    MainThreadTaskQueue();
+    ~MainThreadTaskQueue();
+
+    MainThreadTaskQueue(const MainThreadTaskQueue&) = delete;
+    MainThreadTaskQueue& operator=(const MainThreadTaskQueue&) = delete;
+
+    // any thread. costMs is the expected main thread time of the task
+    void push(Task&& task, TaskPriority priority = TaskPriority::Normal, float costMs = DefaultTaskCost);
+
+    // consumer thread only. Runs the higher priorities first and each priority in push order until
+    // the next task's estimate would go over the budget. The first task always runs so one costing
+    // more than the budget can't hold the queue up. Returns how many ran
+    uint32_t process(float budgetMs);
+
+    bool empty() const;
+    Stats stats() const;
 
 private:
-    std::deque<Task> mTaskQueue;
-    std::mutex mTaskQueueMutex;
+    struct Node
+    {
+        std::atomic<Node*> next;
+        Task task;
+        float costMs;
+    };
+
+    struct Channel
+    {
+        // the last pushed node, swapped by producers
+        std::atomic<Node*> head;
+        // consumer only, its next node is the oldest task
+        Node* tail;
+    };
+
+    Node* front(uint32_t& priority);
+    void popFront(uint32_t priority);
+
+private:
+    std::array<Channel, PriorityCount> mChannels;
+    std::atomic<uint32_t> mQueued;
+
+    uint32_t mRan;
+    float mElapsedMs;
+    float mCostScale;
 };
 
 #endif //OPENGLRENDERINGENGINE_UTILS_HPP
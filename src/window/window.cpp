@@ -12,11 +12,28 @@ void APIENTRY glDebugOutput(GLenum source,
                             const char* message,
                             const void* userParam);
 
-Window::Window(uint32_t width, uint32_t height)
+Window::Window(uint32_t width, uint32_t height, bool headless)
     : mWidth(width)
     , mHeight(height)
+    , mHeadless(headless)
 {
-    glfwInit();
+    bool initialized = glfwInit();
+
+    if (!initialized && mHeadless)
+    {
+        debugLog("Window: No display available, falling back to an OSMesa context.", LogSeverity::Warning);
+
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+        initialized = glfwInit();
+    }
+
+    check(initialized, "Failed to initialize GLFW.");
+
+    if (mHeadless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    if (glfwGetPlatform() == GLFW_PLATFORM_NULL)
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
@@ -34,6 +51,12 @@ Window::Window(uint32_t width, uint32_t height)
     bool pfnLoaded = gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
     check(pfnLoaded, "Failed to load OpenGL function pointers.");
 
+    // let the driver compile on as many threads as it likes, see Shader
+    if (GLAD_GL_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    else if (GLAD_GL_ARB_parallel_shader_compile)
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+
 #ifdef DEBUG_MODE
     glEnable(GL_DEBUG_OUTPUT);
     glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
@@ -80,6 +103,11 @@ bool Window::opened() const
     return !glfwWindowShouldClose(mWindow);
 }
 
+bool Window::headless() const
+{
+    return mHeadless;
+}
+
 Window::operator GLFWwindow*() const
 {
     return mWindow;
@@ -14,7 +14,9 @@
 class Window
 {
 public:
-    Window(uint32_t width, uint32_t height);
+    // a headless window is never shown. Without a display to connect to, GLFW's null platform
+    // with an OSMesa context is used instead, which renders on the cpu (llvmpipe)
+    Window(uint32_t width, uint32_t height, bool headless = false);
     ~Window();
 
     void pollEvents();
@@ -24,6 +26,7 @@ public:
     uint32_t width() const;
     uint32_t height() const;
     bool opened() const;
+    bool headless() const;
 
     operator GLFWwindow*() const;
 
@@ -41,6 +44,7 @@ private:
     std::vector<Event> mEventQueue;
     uint32_t mWidth;
     uint32_t mHeight;
+    bool mHeadless;
 };
 
 #endif //OPENGLRENDERINGENGINE_WINDOW_HPP